@@ -3,6 +3,7 @@
 #include <mutex>
 #include <unordered_map>
 #include <functional>
+#include "StringId.h"
 
 namespace Gino
 {
@@ -48,7 +49,7 @@ namespace Gino
 
 		std::unique_ptr<Scene> m_scene;
 
-		std::unordered_map<std::string, std::function<void()>> m_consoleCommands;
+		std::unordered_map<StringId, std::function<void()>> m_consoleCommands;		// Keyed by the lower case command
 
 
 	};
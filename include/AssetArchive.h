@@ -0,0 +1,112 @@
+#pragma once
+
+namespace Gino
+{
+	struct AssetPackSettings
+	{
+		bool compress = true;				// LZ4 style block compression, kept per entry when it saves at least 1/8
+		uint32_t minCompressBytes = 512;	// Smaller files are always stored
+	};
+
+	struct AssetPackReport
+	{
+		uint32_t files = 0;
+		uint32_t compressedFiles = 0;
+		uint64_t sourceBytes = 0;
+		uint64_t archiveBytes = 0;
+		float packMs = 0.f;
+	};
+
+	// Process wide counters of asset reads (see AssetArchive::SetStatisticsEnabled)
+	struct AssetIOStats
+	{
+		uint64_t archiveReads = 0;
+		uint64_t archiveBytes = 0;			// Stored (possibly compressed) bytes
+		uint64_t decompressedBytes = 0;		// Output of compressed entries
+		uint64_t looseReads = 0;			// Files that were not in the archive (or no archive is mounted)
+		uint64_t looseBytes = 0;
+		float readMs = 0.f;					// Summed over all threads
+		float decompressMs = 0.f;
+	};
+
+	// Bytes of one asset: points into the archive mapping for stored entries, into owned for compressed entries and loose files
+	struct AssetView
+	{
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		std::vector<uint8_t> owned;
+	};
+
+	/*
+		Single file asset archive, memory mapped once and read through a table of contents.
+
+		Layout (entry data 16 byte aligned):
+			PackHeader
+			entry data
+			PackEntry[entryCount]		// Sorted by path hash
+			char[stringTableSize]		// Entry paths relative to the packed root, '/' separated
+
+		An entry stores the offset, stored and original size, the content hash (Utils::HashBytes of the original
+		bytes, so Utils::HashFile needs no read) and whether it is compressed. Paths are looked up case insensitively.
+
+		When an archive is mounted over a directory, Utils::ReadFile, Utils::ReadImageFile, Utils::HashFile and the
+		Assimp IO system read files under that directory from the archive first and fall back to loose files.
+	*/
+	class AssetArchive
+	{
+	public:
+		AssetArchive() = default;
+		~AssetArchive() = default;
+
+		AssetArchive(const AssetArchive&) = delete;
+		AssetArchive& operator=(const AssetArchive&) = delete;
+
+		// mountPoint: directory the archived paths are relative to (the root given to Pack)
+		bool Open(const std::filesystem::path& archivePath, const std::filesystem::path& mountPoint);
+		void Close();
+
+		bool Contains(const std::filesystem::path& filePath) const;
+		bool GetContentHash(const std::filesystem::path& filePath, uint64_t& hash) const;
+		bool Read(const std::filesystem::path& filePath, AssetView& view) const;
+
+		// Archived files directly inside directory (not recursive), returned as directory / archived file name
+		std::vector<std::filesystem::path> GetFilesIn(const std::filesystem::path& directory) const;
+
+		const std::filesystem::path& GetArchivePath() const;
+		uint32_t GetEntryCount() const;
+
+		// Packer: every file under rootDir into one archive
+		static AssetPackReport Pack(const std::filesystem::path& rootDir, const std::filesystem::path& archivePath, const AssetPackSettings& settings = {});
+
+		// Process wide mount. A pending "<archivePath>.new" (written by Pack while the archive was mounted) replaces the archive first.
+		static bool Mount(const std::filesystem::path& archivePath, const std::filesystem::path& mountPoint);
+		static void Unmount();
+		static const AssetArchive* GetMounted();
+
+		// Reads any asset, from the mounted archive or as a loose file. Records I/O statistics.
+		static bool ReadAsset(const std::filesystem::path& filePath, AssetView& view);
+
+		// I/O statistics mode: off by default, the counters need timers on every read
+		static void SetStatisticsEnabled(bool enabled);
+		static bool IsStatisticsEnabled();
+		static AssetIOStats GetStatistics();
+
+		// LZ4 block format (no frame). Decompress fails on malformed input instead of reading or writing out of bounds.
+		static void Compress(const uint8_t* src, size_t size, std::vector<uint8_t>& out);
+		static bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+
+	private:
+		struct PackEntry;
+
+		const PackEntry* Find(const std::filesystem::path& filePath) const;
+
+	private:
+		Utils::MappedFile m_file;
+		std::filesystem::path m_archivePath;
+		std::filesystem::path m_mountPoint;		// Lexically normal
+		const PackEntry* m_entries = nullptr;
+		uint32_t m_entryCount = 0;
+		const char* m_stringTable = nullptr;
+		uint64_t m_stringTableSize = 0;
+	};
+}
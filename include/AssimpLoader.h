@@ -1,13 +1,15 @@
 #pragma once
 #include <string>
 #include <optional>
-#include <variant>
+#include <unordered_map>
 
 #include <assimp/Importer.hpp>      // C++ importer interface
 #include <assimp/scene.h>           // Output data structure
 #include <assimp/postprocess.h>     // Post processing flags
 #include <assimp/pbrmaterial.h>
 
+#include "Graphics/ResourceTypes.h"
+
 
 struct aiMesh;
 struct aiScene;
@@ -16,22 +18,31 @@ struct aiScene;
 
 namespace Gino
 {
+	class ThreadPool;
+
+	// Texture slots are indices into AssimpLoader::GetTexturePaths() (every path is stored once), or s_noTexture
 	struct AssimpMaterialPaths
 	{
-		std::optional<std::string> diffuseFilePath;
-		std::optional<std::string> specularFilePath;
-		std::optional<std::string> normalFilePath;
-		std::optional<std::string> opacityFilePath;
+		static constexpr uint32_t s_noTexture = ~0u;
+
+		uint32_t diffuse = s_noTexture;
+		uint32_t specular = s_noTexture;
+		uint32_t normal = s_noTexture;
+		uint32_t opacity = s_noTexture;
+
+		bool operator==(const AssimpMaterialPaths&) const = default;
 	};
 
 	struct AssimpMaterialPathsPBR
 	{
+		static constexpr uint32_t s_noTexture = ~0u;
+
 		// Ref: glTF overview https://github.com/KhronosGroup/glTF/blob/master/specification/2.0/figures/gltfOverview-2.0.0b.png
-		std::optional<std::string> albedo;
-		std::optional<std::string> normal;
-		std::optional<std::string> metallicAndRoughness;		// Metalness in BLUE channel, roughness in GREEN channel
-		std::optional<std::string> ao;
-		std::optional<std::string> emission;
+		uint32_t albedo = s_noTexture;
+		uint32_t normal = s_noTexture;
+		uint32_t metallicAndRoughness = s_noTexture;		// Metalness in BLUE channel, roughness in GREEN channel
+		uint32_t ao = s_noTexture;
+		uint32_t emission = s_noTexture;
 
 
 		aiVector3D baseColorFactor;				// Multiplied component wise with albedo
@@ -45,73 +56,140 @@ namespace Gino
 		emissiveFactor (scaling factor for emissive texture)
 		*/
 
-
+		bool operator==(const AssimpMaterialPathsPBR& other) const
+		{
+			return albedo == other.albedo && normal == other.normal && metallicAndRoughness == other.metallicAndRoughness && ao == other.ao && emission == other.emission &&
+				baseColorFactor == other.baseColorFactor && metallicAndRoughnessFactor == other.metallicAndRoughnessFactor;
+		}
 	};
 
 
 	struct AssimpMeshSubset
 	{
 		unsigned int vertexStart;
+		unsigned int vertexCount;
 		unsigned int indexStart;
 		unsigned int indexCount;
-		std::variant<AssimpMaterialPaths, AssimpMaterialPathsPBR> mats;
+		unsigned int materialIndex;		// Index into GetMaterials()/GetMaterialsPBR() (deduplicated)
+		unsigned int node;				// Index into GetNodes() of the node that references the mesh
 	};
 
-
-	struct AssimpVertex
+	// Node of the source scene hierarchy. Nodes are stored breadth first: a parent always comes before its children
+	// and the nodes of one depth are contiguous.
+	struct AssimpNode
 	{
-		aiVector3D position;
-		aiVector3D normal;
-		aiVector2D uv;
-		aiVector3D tangent;
-		aiVector3D bitangent;
+		static constexpr uint32_t s_noParent = ~0u;
 
+		uint32_t parent = s_noParent;
+		DirectX::SimpleMath::Matrix transform;		// Relative to the parent, row vectors like every other matrix of the engine
 	};
 
 
 	/*
-	
-	To do:
-
-	- Refactor material grabbing so that the duplicates are removed (Grab materials in ctor and grab materials in ProcessMesh..)
-	-- Priority: Low
-	
+		CPU memory held by an import, counted by hand since the process peak working set cannot be reset per import.
+		Counts what is resident: the Assimp scene arrays that are still alive plus output that has been written.
 	*/
+	struct ImportMemoryStats
+	{
+		size_t currentBytes = 0;
+		size_t peakBytes = 0;
+
+		void Allocate(size_t bytes)
+		{
+			currentBytes += bytes;
+			peakBytes = currentBytes > peakBytes ? currentBytes : peakBytes;
+		}
+
+		void Release(size_t bytes)
+		{
+			currentBytes -= bytes < currentBytes ? bytes : currentBytes;
+		}
+	};
+
 
 	class AssimpLoader
 	{
+	public:
+		// Post processing applied on import. Part of the mesh cache key, so changing these re-imports everything.
+		static constexpr unsigned int s_importFlags =
+			aiProcess_Triangulate |
+
+			// For Direct3D
+			aiProcess_ConvertToLeftHanded |
+			//aiProcess_FlipUVs |					// (0, 0) is top left
+			//aiProcess_FlipWindingOrder |		// D3D front face is CW
+
+			aiProcess_GenSmoothNormals |
+			aiProcess_CalcTangentSpace;
+
 	public:
 		AssimpLoader() = delete;
-		AssimpLoader(const std::filesystem::path& filePath, bool PBR = false);
+		// Vertices are written straight into Vertex_POS_UV_NORMAL, into buffers sized up front from the scene.
+		// A first pass walks the node hierarchy breadth first, lists the meshes in that order and gives each its vertex and
+		// index range (exclusive prefix sums),
+		// the second converts them into their ranges, on the thread pool when there is one. The output does not depend
+		// on the thread count.
+		// Streaming converts in batches of a few MB and releases the arrays of each aiMesh once its last reference is
+		// converted, so the scene and the output are never both fully resident.
+		AssimpLoader(const std::filesystem::path& filePath, bool PBR = false, bool streaming = false, ImportMemoryStats* memoryStats = nullptr, ThreadPool* threadPool = nullptr);
 		~AssimpLoader() = default;
 
-		const std::vector<AssimpVertex>& GetVertices() const;
+		bool IsLoaded() const;		// False when the file could not be imported, the loader is empty then
+
+		const std::vector<Vertex_POS_UV_NORMAL>& GetVertices() const;
 		const std::vector<uint32_t>& GetIndices() const;
 
+		// Moves the buffers out (no copy), the loader is empty afterwards
+		std::vector<Vertex_POS_UV_NORMAL> TakeVertices();
+		std::vector<uint32_t> TakeIndices();
+
 		const std::vector<AssimpMeshSubset>& GetSubsets() const;
+		const std::vector<AssimpNode>& GetNodes() const;
 		const std::vector<AssimpMaterialPaths>& GetMaterials() const;
 
 		const std::vector<AssimpMaterialPathsPBR>& GetMaterialsPBR() const;
+		const std::vector<std::string>& GetTexturePaths() const;
 
 
 	private:
-		void ProcessMesh(aiMesh* mesh, const aiScene* scene);
-		void ProcessNode(aiNode* node, const aiScene* scene);
+		void CollectNodes(const aiScene* scene);		// Breadth first, fills m_nodes, m_meshOrder and the subset ranges
+		void ConvertMeshes(aiScene* scene);
+		void ConvertMesh(const aiMesh* mesh, const AssimpMeshSubset& subset);		// Into the (sized) output range of subset
+
+		uint32_t InternTexturePath(const aiString& path);
+		template <typename T>
+		void AddMaterial(const T& material, std::vector<T>& materials);
 
 	private:
 		bool m_PBR;
+		bool m_streaming;
 		std::filesystem::path m_filePath;
+		ImportMemoryStats* m_memoryStats;
+		ThreadPool* m_threadPool;
+		bool m_loaded = false;
 
 		uint32_t m_meshVertexCount = 0;
 		uint32_t m_meshIndexCount = 0;
+		std::vector<uint32_t> m_meshOrder;			// aiMesh index of every subset
 
-		std::vector<AssimpVertex> m_vertices;
+		std::vector<Vertex_POS_UV_NORMAL> m_vertices;
 		std::vector<uint32_t> m_indices;
 		std::vector<AssimpMeshSubset> m_subsets;
+		std::vector<AssimpNode> m_nodes;
 		std::vector<AssimpMaterialPaths> m_materials;
 
 		std::vector<AssimpMaterialPathsPBR> m_materialsPBR;
 
+		// Interned texture paths (relative to the source directory on disk) and the aiScene material index -> deduplicated material index remap
+		std::string m_directory;
+		std::vector<std::string> m_texturePaths;
+		std::unordered_map<std::string, uint32_t> m_texturePathIndices;
+		std::vector<uint32_t> m_materialRemap;
+
+		// Streaming bookkeeping: node references left per aiMesh, and bytes of the scene still resident
+		std::vector<uint32_t> m_meshReferences;
+		size_t m_sceneBytes = 0;
+
 	};
 
 }
@@ -17,7 +17,7 @@ namespace Gino
 		TransformType = 1,
 		ModelType
 	};
-	// NOTE ===== Dont forget to add a ComponentMapper for the new ComponentType (currently in Entity)
+	// NOTE ===== Dont forget to add a ComponentMapper and an Archetype column for the new ComponentType (currently in EntityStorage)
 
 	class Component
 	{
@@ -32,23 +32,48 @@ namespace Gino
 		ComponentType m_type;
 	};
 
+	class TransformSystem;
+
+	// Handle to a slot in the TransformSystem of the scene, which owns the data
 	class Transform : public Component
 	{
 	public:
-		Transform();
-		~Transform() = default;
+		Transform(TransformSystem* system);
+		~Transform();		// Releases the slot
 
-		DirectX::SimpleMath::Matrix GetWorldMatrix() const;
+		// Stored by value in the EntityStorage, which moves it between archetypes. The moved from one has no slot left.
+		Transform(Transform&& other) noexcept;
+		Transform& operator=(Transform&& other) noexcept;
+		Transform(const Transform&) = delete;
+		Transform& operator=(const Transform&) = delete;
 
-		// Helper functions
-		// set, get matrix, etc
-	public:
-		DirectX::SimpleMath::Vector3 m_position;
-		DirectX::SimpleMath::Vector3 m_rotation;
-		DirectX::SimpleMath::Vector3 m_scaling = { 1.f, 1.f, 1.f };
+		void SetPosition(const DirectX::SimpleMath::Vector3& position);
+		void SetRotation(const DirectX::SimpleMath::Vector3& eulerDegrees);		// Pitch (x), yaw (y), roll (z)
+		void SetRotation(const DirectX::SimpleMath::Quaternion& rotation);
+		void SetScaling(const DirectX::SimpleMath::Vector3& scaling);
 
-	};
+		DirectX::SimpleMath::Vector3 GetPosition() const;
+		DirectX::SimpleMath::Quaternion GetRotation() const;
+		DirectX::SimpleMath::Vector3 GetScaling() const;
+
+		// Position, rotation and scaling are relative to the parent from then on. nullptr detaches. Fails on cycles.
+		bool SetParent(const Transform* parent);
+		bool HasParent() const;
+
+		// Computed by TransformSystem::Update, changes show up after the next one
+		const DirectX::SimpleMath::Matrix& GetWorldMatrix() const;
+
+		uint32_t GetIndex() const;		// Slot in the TransformSystem
 
+		static DirectX::SimpleMath::Quaternion EulerToQuaternion(const DirectX::SimpleMath::Vector3& eulerDegrees);
+
+	private:
+		static constexpr uint32_t s_noSlot = ~0u;
+
+		TransformSystem* m_system;
+		uint32_t m_index;
+
+	};
 
 
 }
@@ -1,5 +1,8 @@
 #pragma once
 #include <windows.h>
+#include <mutex>
+#include "ResourceCache.h"
+#include "Graphics/HDREncoder.h"
 
 namespace Gino
 {
@@ -8,6 +11,11 @@ namespace Gino
 	class Renderer;
 	class ImGuiRenderer;
 	class AssimpLoader;
+	struct ModelImportData;
+	struct AssimpMeshSubset;
+	struct Vertex_POS_UV_NORMAL;
+	struct MeshCluster;
+	struct MeshLod;
 	class FPCamera;
 	struct Texture;
 	class Model;
@@ -15,6 +23,8 @@ namespace Gino
 	class Component;
 	class Entity;
 	class Scene;
+	class ThreadPool;
+	enum class TextureRole : uint8_t;
 	
 	class Engine
 	{
@@ -29,6 +39,36 @@ namespace Gino
 			// Pixel resolution
 			int resolutionWidth = 2560;
 			int resolutionHeight = 1440;
+
+			// Asset settings
+			bool compactVertices = true;		// PBR models use Vertex_Compact (20 bytes) instead of Vertex_POS_UV_NORMAL (56 bytes)
+			bool streamingImport = true;		// Release every aiMesh right after conversion (lower peak memory on mesh cache misses)
+			bool parallelImport = true;			// Convert the meshes of an Assimp import on the worker pool (same output as the serial path)
+			bool textureStreaming = true;		// Model textures start with their tail mips and stream finer mips on demand (see TextureStreamer)
+			uint32_t textureBudgetMB = 512;		// GPU memory budget of streamed textures
+			std::filesystem::path assetArchive = "../assets.gpak";		// Mounted over ../assets when it exists (see AssetArchive), built by PackAssets
+			bool ioStatistics = false;			// Count and time every asset read, measure the error of HDR encodes (shown under Load Statistics)
+			uint32_t textureCacheBudgetMB = 1024;	// Unreferenced textures are evicted (least recently used first) above this, full mip chains counted
+			uint32_t modelCacheBudgetMB = 256;		// Same for unreferenced models (GPU buffers and cluster data)
+		};
+
+		// Accumulated over all loads since startup
+		struct LoadStatistics
+		{
+			uint32_t texturesLoaded = 0;
+			uint32_t texturesFromCooked = 0;	// Subset of texturesLoaded that came from the cooked texture cache (block compressed or RGBA8 mips)
+			uint32_t textureCacheHits = 0;		// Cooked texture cache lookups, one per decoded texture (see TextureCooker::OpenCached)
+			uint32_t textureCacheMisses = 0;	// Decoded from the source, the result is written to the cache
+			uint32_t hdrTexturesLoaded = 0;		// Subset of texturesLoaded from .hdr sources
+			size_t hdrTextureBytes = 0;			// Full chains of those in their loaded format
+			size_t hdrTextureFloatBytes = 0;	// Same chains as RGBA32F, what they would take without an HDR format
+			uint32_t hdrTexturesMeasured = 0;	// HDR textures encoded from source with Settings::ioStatistics, the errors below are over their level 0
+			float hdrWorstLogPSNR = 0.f;		// dB, see HDRError
+			float hdrMeanRelativeError = 0.f;	// Average of the per texture means
+			float hdrMaxRelativeError = 0.f;
+			float textureDecodeMs = 0.f;		// Wall time of the decode + mip generation stage (runs on the worker pool)
+			float textureUploadMs = 0.f;		// Wall time of GPU resource creation (device thread)
+			size_t peakImportBytes = 0;			// Largest ImportMemoryStats::peakBytes of any Assimp model import
 		};
 
 	public:
@@ -40,42 +80,76 @@ namespace Gino
 		void SimulateAndRender(float dt);
 
 		Input* GetInput();
+		ThreadPool* GetThreadPool();
 		std::function<void(HWND, UINT, WPARAM, LPARAM)> GetImGuiHook() const;
 
 		// Creational functions
-		Model* CreateModel(const std::string& id, const std::filesystem::path& filePath, bool PBR = false);
-		Model* GetModel(const std::string& id);
+		// Models and textures live in refcounted caches: a model stays resident while a handle to it exists, the textures
+		// of its materials while the model exists. Unreferenced ones are kept (creating the same ID again revives the
+		// model) until the cache goes over its budget or they are unloaded.
+		// Model IDs and texture paths are StringId keys: a lookup is one hash map probe on a precomputed hash.
+		// The model is created under the ID of name.
+		ModelHandle CreateModel(std::string_view name, const std::filesystem::path& filePath, bool PBR = false);
+		// Returns a placeholder right away, import and texture decode run on the worker pool.
+		// The placeholder can be attached to entities immediately but is not drawn until Model::IsResident(),
+		// GPU creation happens at the start of a later SimulateAndRender. onResident is called on the device thread at that point.
+		ModelHandle CreateModelAsync(std::string_view name, const std::filesystem::path& filePath, bool PBR = false, std::function<void(Model*)> onResident = {});
+		ModelHandle GetModel(StringId id);
+		uint32_t GetPendingModelCount() const;		// Async loads that are not resident yet
+
+		// Frees the model and the textures only it used. Fails while the model is loading or something still holds a handle to it.
+		bool UnloadModel(StringId id);
+
+		ResourceCacheStats GetTextureCacheStats() const;
+		ResourceCacheStats GetModelCacheStats() const;
+
+		const LoadStatistics& GetLoadStatistics() const;
+
+		// Offline tool: block compresses every texture loaded so far into cache/textures (see TextureCooker).
+		// Later loads of these textures use the cooked files. CPU only, safe to call from the console thread.
+		void CookTextures();
 
+		// Offline tool: packs ../assets into the asset archive. Takes effect on the next start when the archive is already mounted.
+		void PackAssets();
 
 
 
 	private:
-		/*
-		
-		// The cache should reset if we switch scene.
-		// Engine does not support streaming or single-removals
-		// It will only Load new or clear completely 
-		// Lets make this when we actually have multiple scenes
-		TextureCache
-		ModelCache
-		// These can live inside Model Loader for now
+		struct TextureRequest
+		{
+			std::string filePath;
+			bool srgb = true;
+			TextureRole role{};			// Color by default
+			HDRFormat hdrFormat = HDRFormat::RGBA16F;		// .hdr sources only. A cooked file (BC6H by default) is used instead when there is one.
+
+			// Channel packed ORM texture (see ChannelPacker): filePath is the packed path of these sources, either may be empty
+			bool packedORM = false;
+			std::string occlusionSource;
+			std::string metallicRoughnessSource;
+		};
 
-		ModelLoader()
+		struct DecodedTextures;
+		struct ModelLoadJob;
 
-		auto mod = ModelLoader->LoadModel(name, filePath)
-		
-		Entity e;
-		e.AddComponent<ComponentType::ModelType>(mod.get());
-		
-		*/
+		TextureHandle LoadTexture(const std::string& filePath, bool srgb = true, HDRFormat hdrFormat = HDRFormat::RGBA16F);
+		void DecodeTextures(const std::vector<TextureRequest>& requests, DecodedTextures& decoded);		// Decodes and builds mips for all non-resident textures in parallel, safe on any thread
+		void UploadTextures(DecodedTextures& decoded);			// Device thread, skips textures that another load made resident in the meantime
+		std::vector<TextureHandle> ResolveTextures(const std::vector<std::string>& filePaths);		// One lookup per path, empty if not loaded
 
-		Texture* LoadTexture(const std::string& filePath, bool srgb = true);
-		std::unique_ptr<Model> LoadModel(const std::filesystem::path& filePath, bool PBR);
+		ModelHandle AddModel(StringId id);			// Empty (non-resident) model under a new ID
+		void ImportModel(ModelLoadJob& job);					// CPU stage: mesh cache or Assimp import, texture decode, vertex compression. Safe on any thread.
+		void FinalizeModel(ModelLoadJob& job);					// GPU stage on the device thread, makes the model resident
+		void FinalizeModelLoads();								// Finalizes the next async load whose CPU stage is done
+		void OptimizeMeshSubsets(std::vector<Vertex_POS_UV_NORMAL>& vertices, std::vector<uint32_t>& indices, const std::vector<AssimpMeshSubset>& subsets, std::vector<std::vector<MeshCluster>>& clusters);		// Also builds the culling clusters of every subset
+		void GenerateMeshLods(const std::vector<Vertex_POS_UV_NORMAL>& vertices, std::vector<uint32_t>& indices, const std::vector<AssimpMeshSubset>& subsets, std::vector<std::vector<MeshLod>>& lods);		// Appends the simplified levels of every subset to indices
 
-		std::unique_ptr<Model> LoadPhongModel(const AssimpLoader& loader);
-		std::unique_ptr<Model> LoadPBRModel(const AssimpLoader& loader);
+		static std::vector<TextureRequest> GetTextureRequests(const ModelImportData& data);
+		void CompressVertices(ModelLoadJob& job);
+		void CreatePhongModel(const ModelLoadJob& job);
+		void CreatePBRModel(const ModelLoadJob& job);
 
 	private:
+		std::unique_ptr<ThreadPool> m_threadPool;
 		std::unique_ptr<DXDevice> m_dxDev;
 		std::unique_ptr<Renderer> m_renderer;
 		std::unique_ptr<Input> m_input;
@@ -85,9 +159,22 @@ namespace Gino
 		Scene* m_scene;
 
 		// "Model Loader"
-		// Our engine only has one memory context.
-		std::unordered_map<std::string, std::unique_ptr<Model>> m_loadedModels; 
-		std::unordered_map<std::string, std::unique_ptr<Texture>> m_loadedTextures;
+		// Our engine only has one memory context. Models hold handles to their textures, so they go first on destruction.
+		// Only the device thread inserts and frees, import jobs look textures up concurrently.
+		ResourceCache<Texture> m_textures;
+		ResourceCache<Model> m_models;
+		std::vector<std::unique_ptr<ModelLoadJob>> m_pendingModels;		// Async loads in flight, in submission order
+		LoadStatistics m_loadStats;
+		bool m_compactVertices;
+		bool m_streamingImport;
+		bool m_parallelImport;
+		bool m_textureStreaming;
+		bool m_ioStatistics;
+		std::filesystem::path m_assetArchive;
+
+		// Source, sRGB and role of every loaded texture, for CookTextures
+		std::mutex m_textureSourcesMutex;
+		std::unordered_map<StringId, TextureRequest> m_textureSources;		// Keyed by filePath
 		
 		/* To  make: */
 		/*
@@ -1,77 +1,88 @@
 #pragma once
-#include "Component.h"
-
-#include "Graphics/Model.h"
+#include "EntityStorage.h"
+#include <type_traits>
 
 namespace Gino
 {
-	static constexpr int MAX_COMPONENTS = 16;
-
-	// Map component type to real types with some metadata for Entity usage
-	template <ComponentType T>
-	struct ComponentMapper;
-
-	template <>
-	struct ComponentMapper<ComponentType::TransformType>
-	{ 
-		using type = Transform; 
-		static constexpr uint32_t bit = ComponentType::TransformType;
-		static constexpr int index = bit - 1;		// Enum starts at 1, so we map the enum directly to array indices
-	};
-
-	template <>
-	struct ComponentMapper<ComponentType::ModelType>
-	{ 
-		using type = Model; 
-		static constexpr uint32_t bit = ComponentType::ModelType;
-		static constexpr int index = bit - 1;
-	};
-
-
-
+	// Components are stored in the EntityStorage of the scene, the entity only knows its archetype and row there
 	class Entity
 	{
 	public:
-		Entity();
+		// Called after a component is added (true) or removed (false), lets the owner keep derived data up to date
+		using ComponentCallback = std::function<void(Entity*, ComponentType, bool)>;
+
+	public:
+		// The Transform is allocated from transforms
+		Entity(EntityStorage* storage, TransformSystem* transforms);
 		~Entity();
 
+		Entity(const Entity&) = delete;
+		Entity& operator=(const Entity&) = delete;
+
 		template <ComponentType T>
-		void AddComponent(Component* comp);
+		void AddComponent(typename ComponentMapper<T>::type comp);
 
-		template <ComponentType T> 
+		// Destroys the component (for a Model only the reference), the Transform can't be removed
+		template <ComponentType T>
+		void RemoveComponent();
+
+		// The Model, or a pointer to the Transform in the storage. That one is good until an entity of the same
+		// archetype is created, destroyed or changes components, don't keep it.
+		template <ComponentType T>
 		auto GetComponent() const;
 
+		// Bitflags using ComponentMapper<T>::bit
 		uint32_t GetActiveComponentBits() const;
 
+		void SetComponentCallback(ComponentCallback callback);
+
 	private:
-		std::array<Component*, MAX_COMPONENTS> m_components;
+		friend class EntityStorage;
 
-		// Bitflags using ComponentType
-		uint32_t m_activeComponentBits;		
+		EntityStorage* m_storage;
+		Archetype* m_archetype = nullptr;
+		uint32_t m_row = 0;
 
+		ComponentCallback m_onComponentChanged;
 	};
 
 	template<ComponentType T>
-	inline void Entity::AddComponent(Component* comp)
+	inline void Entity::AddComponent(typename ComponentMapper<T>::type comp)
 	{
-		// Check that the component given is the right type
-		assert((comp->GetBit() & ComponentMapper<T>::bit) == ComponentMapper<T>::bit);
-
 		// Check that the component type doesn't already exist
-		assert((m_activeComponentBits & ComponentMapper<T>::bit) != ComponentMapper<T>::bit);
+		assert((GetActiveComponentBits() & ComponentMapper<T>::bit) != ComponentMapper<T>::bit);
 
 		// Add component since it doesnt exist
-		m_components[ComponentMapper<T>::index] = comp;
-		m_activeComponentBits |= ComponentMapper<T>::bit;
+		m_storage->AddComponent<T>(this, std::move(comp));
+
+		if (m_onComponentChanged)
+			m_onComponentChanged(this, T, true);
+	}
+
+	template<ComponentType T>
+	inline void Entity::RemoveComponent()
+	{
+		static_assert(T != ComponentType::TransformType, "The Transform is owned by the Entity");
+
+		if ((GetActiveComponentBits() & ComponentMapper<T>::bit) != ComponentMapper<T>::bit)
+			return;
+
+		// Notify first so the callback can still read the component
+		if (m_onComponentChanged)
+			m_onComponentChanged(this, T, false);
+
+		m_storage->RemoveComponent(this, ComponentMapper<T>::index);
 	}
 
 	template<ComponentType T>
 	auto Entity::GetComponent() const
 	{
 		// Make sure the component exists!
-		assert((m_activeComponentBits & ComponentMapper<T>::bit) == ComponentMapper<T>::bit);
-		return static_cast<ComponentMapper<T>::type*>(m_components[ComponentMapper<T>::index]);
+		assert((GetActiveComponentBits() & ComponentMapper<T>::bit) == ComponentMapper<T>::bit);
+		auto& component = m_archetype->Get<T>(m_row);
+		if constexpr (std::is_pointer_v<typename ComponentMapper<T>::type>)
+			return component;
+		else
+			return &component;
 	}
 }
-
-
@@ -0,0 +1,155 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <unordered_map>
+
+#include "Component.h"
+#include "Graphics/Model.h"
+
+namespace Gino
+{
+	class Entity;
+
+	static constexpr int MAX_COMPONENTS = 16;
+
+	// Map component type to real types with some metadata for Entity usage
+	template <ComponentType T>
+	struct ComponentMapper;
+
+	template <>
+	struct ComponentMapper<ComponentType::TransformType>
+	{
+		using type = Transform;		// Stored by value, a handle to the slot in the TransformSystem
+		static constexpr int index = ComponentType::TransformType - 1;		// Enum starts at 1, so we map the enum directly to array indices
+		static constexpr uint32_t bit = 1u << index;						// Same as Component::GetBit
+	};
+
+	template <>
+	struct ComponentMapper<ComponentType::ModelType>
+	{
+		using type = Model*;		// Models are shared (ResourceCache), the component is the reference
+		static constexpr int index = ComponentType::ModelType - 1;
+		static constexpr uint32_t bit = 1u << index;
+	};
+
+
+	/*
+		All entities with the same set of components (mask of ComponentMapper bits).
+		Components are stored by value, one typed array per component, rows are entities: entities[row] has Column<T>()[row].
+		A reference to a component is only good until a row of the archetype is added, moved or removed.
+	*/
+	struct Archetype
+	{
+		// One array per ComponentType, in ComponentMapper index order. Only those in mask hold rows.
+		using Columns = std::tuple<
+			std::vector<ComponentMapper<ComponentType::TransformType>::type>,
+			std::vector<ComponentMapper<ComponentType::ModelType>::type>>;
+
+		uint32_t mask = 0;
+		Columns columns;
+		std::vector<Entity*> entities;
+
+		template <ComponentType T>
+		std::vector<typename ComponentMapper<T>::type>& Column()
+		{
+			return std::get<ComponentMapper<T>::index>(columns);
+		}
+
+		template <ComponentType T>
+		typename ComponentMapper<T>::type& Get(uint32_t row)
+		{
+			assert((mask & ComponentMapper<T>::bit) != 0);
+			return Column<T>()[row];
+		}
+
+		// func(column, index) for every column in mask, index is a std::integral_constant of the ComponentMapper index
+		template <typename Func>
+		void ForEachColumn(Func&& func)
+		{
+			[&]<size_t... Is>(std::index_sequence<Is...>)
+			{
+				(((mask & (1u << Is)) != 0 ? func(std::get<Is>(columns), std::integral_constant<size_t, Is>()) : void()), ...);
+			}(std::make_index_sequence<std::tuple_size_v<Columns>>());
+		}
+	};
+
+
+	/*
+		Archetype storage of the components of a scene's entities.
+		- Adding or removing a component moves the entity's components to the archetype of its new mask (created on first use)
+		- Rows are swap removed, so an archetype stays dense and the moved entity is told its new row
+		- ForEach visits the archetypes that contain the queried components and walks their arrays linearly,
+		  no per entity lookups, mask checks or pointers to follow
+	*/
+	class EntityStorage
+	{
+	public:
+		EntityStorage() = default;
+		~EntityStorage() = default;
+
+		EntityStorage(const EntityStorage&) = delete;
+		EntityStorage& operator=(const EntityStorage&) = delete;
+
+		// Used by Entity, which keeps its archetype and row
+		void Insert(Entity* entity, Transform&& transform);		// Entity with only a Transform
+		void Remove(Entity* entity);							// Destroys its components
+		template <ComponentType T>
+		void AddComponent(Entity* entity, typename ComponentMapper<T>::type&& component);
+		void RemoveComponent(Entity* entity, int index);		// Destroys the component
+
+		// func(Entity*, ComponentMapper<Ts>::type&...) for every entity that has at least the components Ts.
+		// Entities must not be created, destroyed or gain or lose components from inside func.
+		template <ComponentType... Ts, typename Func>
+		void ForEach(Func&& func) const;
+
+		uint32_t GetArchetypeCount() const;
+
+		// Transform + Model gather against the previous archetype layout (columns of component pointers, every Transform
+		// allocated on its own) at 1K/10K/100K entities, printed to the console
+		static void RunBenchmark();
+
+	private:
+		Archetype* GetArchetype(uint32_t mask);
+		// Moves the components of entity to the archetype of its mask with added set and removed cleared. The removed ones
+		// are destroyed, the columns of the added ones are left one row short. Returns the new archetype.
+		Archetype* MoveEntity(Entity* entity, uint32_t added, uint32_t removed);
+		void RemoveRow(Archetype* archetype, uint32_t row);
+
+		template <ComponentType... Ts, typename Func, typename... Columns>
+		static void ForEachRow(const Archetype& archetype, Func& func, Columns... columns);		// One column per component of Ts
+
+	private:
+		std::unordered_map<uint32_t, std::unique_ptr<Archetype>> m_archetypes;
+		std::vector<Archetype*> m_archetypeList;		// Creation order
+	};
+
+	template <ComponentType T>
+	inline void EntityStorage::AddComponent(Entity* entity, typename ComponentMapper<T>::type&& component)
+	{
+		Archetype* archetype = MoveEntity(entity, ComponentMapper<T>::bit, 0);
+		archetype->Column<T>().push_back(std::move(component));
+	}
+
+	template <ComponentType... Ts, typename Func, typename... Columns>
+	inline void EntityStorage::ForEachRow(const Archetype& archetype, Func& func, Columns... columns)
+	{
+		const size_t count = archetype.entities.size();
+		for (size_t row = 0; row < count; ++row)
+			func(archetype.entities[row], columns[row]...);
+	}
+
+	template <ComponentType... Ts, typename Func>
+	inline void EntityStorage::ForEach(Func&& func) const
+	{
+		constexpr uint32_t required = (ComponentMapper<Ts>::bit | ...);
+		for (Archetype* archetype : m_archetypeList)
+		{
+			if ((archetype->mask & required) != required)
+				continue;
+
+			ForEachRow<Ts...>(*archetype, func, archetype->Column<Ts>().data()...);
+		}
+	}
+}
@@ -44,6 +44,8 @@ namespace Gino
 
 		DirectX::SimpleMath::Matrix GetViewMatrix() const;
 		DirectX::SimpleMath::Matrix GetProjectionMatrix() const;
+		float GetFovInDegs() const;			// Vertical
+		float GetNearPlane() const;
 
 		// Finalize changes this frame (movement/rotation)
 		void Update(float dt);
@@ -0,0 +1,51 @@
+#pragma once
+#include "Graphics/MipGenerator.h"
+
+namespace Gino
+{
+	class ThreadPool;
+
+	enum class BCFormat
+	{
+		BC1,		// RGB, 4 bpp
+		BC3,		// RGB (BC1 block) + alpha (BC4 block), 8 bpp
+		BC4,		// Single channel (R), 4 bpp
+		BC5,		// Two channels (RG), 8 bpp. Normal maps, Z is rebuilt in the shader
+		BC7			// RGBA, 8 bpp. Only mode 6 (single subset, 7.7.7.7 + p-bit endpoints, 4 bit indices) is emitted
+	};
+
+	// Block compressed mip chain. Level data is tightly packed rows of 4x4 blocks.
+	struct CompressedTexture
+	{
+		BCFormat format = BCFormat::BC1;
+		bool srgb = false;
+		std::vector<MipLevel> levels;
+	};
+
+	/*
+		CPU block compressor for RGBA8 mip chains.
+		Endpoints come from the principal axis of each block and are refined with a least squares fit.
+		Palette index selection (the hot loop) is done with SSE, four texels at a time.
+		Block rows of all levels are independent and are spread across the thread pool.
+	*/
+	class BCEncoder
+	{
+	public:
+		BCEncoder(ThreadPool* threadPool = nullptr);		// No pool = single threaded
+		~BCEncoder() = default;
+
+		CompressedTexture Compress(const MipChain& chain, BCFormat format, bool srgb) const;
+
+		// Back to RGBA8 (missing channels are 0, missing alpha is 255). Used for quality measurements.
+		static MipChain Decompress(const CompressedTexture& texture);
+
+		// PSNR in dB over the channels the format stores (e.g R only for BC4). Infinity for a lossless match.
+		static float CalcPSNR(const MipLevel& reference, const MipLevel& decoded, BCFormat format);
+
+		static uint32_t GetBlockSize(BCFormat format);		// Bytes per 4x4 block
+		static const char* GetFormatName(BCFormat format);
+
+	private:
+		ThreadPool* m_threadPool;
+	};
+}
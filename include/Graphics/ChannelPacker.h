@@ -0,0 +1,29 @@
+#pragma once
+
+namespace Gino
+{
+	/*
+		Import time channel packer for PBR materials: merges ambient occlusion, roughness and metalness into one RGBA8
+		texture with the glTF ORM layout (occlusion in R, roughness in G, metalness in B), so the shader needs one SRV
+		and one fetch for all three.
+
+		Sources are a glTF occlusion texture (.r) and a glTF metallicRoughness texture (roughness .g, metalness .b),
+		either may be empty. A missing occlusion packs as 1 (unoccluded), missing roughness/metalness as 0 (what the
+		default texture held). Occlusion is resampled to the metallicRoughness size when they differ.
+
+		The packed texture is not written as an image: it is named by GetPackedPath and goes through the texture cache
+		like any other source (see TextureCooker), keyed by HashSources.
+	*/
+	class ChannelPacker
+	{
+	public:
+		// Name of the packed texture: key of the loaded texture and stem of its cache files. Not a file on disk.
+		static std::string GetPackedPath(const std::string& occlusionPath, const std::string& metallicRoughnessPath);
+
+		// Contents of both sources and the layout, the cache key of the packed texture
+		static uint64_t HashSources(const std::string& occlusionPath, const std::string& metallicRoughnessPath);
+
+		// RGBA8 image, released with ImageData::Release like any decoded image
+		static Utils::ImageData PackORM(const std::string& occlusionPath, const std::string& metallicRoughnessPath);
+	};
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "Graphics/ResourceTypes.h"
+#include "MeshletBuilder.h"
+
+namespace Gino
+{
+	// Camera frustum and position in the local space of one model instance
+	struct ClusterCullView
+	{
+		std::array<DirectX::SimpleMath::Vector4, 6> planes;		// Inside if dot(plane.xyz, p) + plane.w >= 0
+		DirectX::SimpleMath::Vector3 cameraPosition;
+	};
+
+	/*
+		CPU cluster culling: frustum (cluster AABB) and backface (normal cone).
+		Both tests run in model space, which keeps them conservative under any affine world matrix:
+		the AABB goes against planes extracted from world * view * projection, and whether a triangle
+		faces a point does not change under an affine transform.
+	*/
+	class ClusterCuller
+	{
+	public:
+		static ClusterCullView MakeView(const DirectX::SimpleMath::Matrix& world, const DirectX::SimpleMath::Matrix& view, const DirectX::SimpleMath::Matrix& projection, const DirectX::SimpleMath::Vector3& cameraPosition);
+
+		static bool IsInFrustum(const MeshCluster& cluster, const ClusterCullView& view);
+		static bool IsBackfacing(const MeshCluster& cluster, const ClusterCullView& view);
+		static bool IsVisible(const MeshCluster& cluster, const ClusterCullView& view);
+	};
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+namespace Gino
+{
+	class ThreadPool;
+
+	// RGBA16F cube map with a full mip chain. Subresources are in D3D11 order: face major (+x, -x, +y, -y, +z, -z), then mips.
+	struct CubeMapData
+	{
+		uint32_t faceSize = 0;
+		uint32_t mipCount = 0;
+		std::vector<std::vector<uint16_t>> subresources;		// faceSize >> mip squared texels, 4 halfs each
+
+		const std::vector<uint16_t>& GetSubresource(uint32_t face, uint32_t mip) const;
+	};
+
+	/*
+		CPU resampling of an equirectangular HDR image into a cube map, so that the sky samples a mip mapped cube
+		instead of doing atan2/acos per pixel on a 128 bit equirect texture.
+		- Level 0: every face texel averages a 4x4 grid of bilinear taps of the equirect, which also covers the
+		  horizontal compression of the equirect towards the poles
+		- Mips: 2x2 box filter of the previous (float) level, per face
+		Rows are split across the thread pool, texels are filtered in SSE registers (one texel = RGBA floats).
+		Results are cached under cache/cubemaps and reused while they are newer than the source.
+	*/
+	class CubemapConverter
+	{
+	public:
+		CubemapConverter(ThreadPool* threadPool = nullptr);		// No pool = single threaded
+		~CubemapConverter() = default;
+
+		// faceSize 0 = smallest power of two that keeps the equator resolution (width / 4)
+		CubeMapData Convert(const Utils::ImageData& equirect, uint32_t faceSize = 0) const;
+
+		// Cached cube of the .hdr at sourcePath, converted and written to the cache first if needed
+		CubeMapData LoadOrConvert(const std::filesystem::path& sourcePath) const;
+
+		static std::filesystem::path GetCachePath(const std::filesystem::path& sourcePath);
+		static bool IsCacheUpToDate(const std::filesystem::path& sourcePath);		// Cache file exists and is newer than the source
+		static bool Write(const std::filesystem::path& filePath, const CubeMapData& cube);
+		static bool Read(const std::filesystem::path& filePath, CubeMapData& cube);
+
+		// Unnormalized direction through (s, t) in [-1, 1] of a face, D3D orientation (t points down)
+		static void GetFaceDirection(uint32_t face, float s, float t, float& x, float& y, float& z);
+
+	private:
+		ThreadPool* m_threadPool;
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "DXDevice.h"
+
+namespace Gino
+{
+	struct CompressedTexture;
+	struct MipChain;
+	struct MipLevel;
+	struct HDRTexture;
+	enum class BCFormat;
+	enum class HDRFormat;
+
+	/*
+		Minimal DDS container (DX10 extended header, single 2D texture with a full or partial mip chain).
+		Reading memory maps the file and hands the level data straight to CreateTexture2D.
+	*/
+	class DDSFile
+	{
+	public:
+		DDSFile() = default;
+		~DDSFile() = default;
+
+		static bool Write(const std::filesystem::path& filePath, const CompressedTexture& texture);
+		static bool Write(const std::filesystem::path& filePath, const MipChain& chain, bool srgb);		// RGBA8 (LDR) chains only
+		static bool Write(const std::filesystem::path& filePath, const HDRTexture& texture);
+
+		static DXGI_FORMAT ToDXGIFormat(BCFormat format, bool srgb);
+		static DXGI_FORMAT ToDXGIFormat(HDRFormat format);
+
+		// Maps and validates the file. Supports BC1-BC7, R8G8B8A8 and the HDRFormat formats as 2D textures.
+		bool Open(const std::filesystem::path& filePath);
+		void Close();
+
+		DXGI_FORMAT GetFormat() const;
+		uint32_t GetWidth() const;
+		uint32_t GetHeight() const;
+		uint32_t GetMipCount() const;
+		size_t GetDataSize() const;			// Bytes of all levels, what the full chain takes on the GPU
+
+		// Points into the mapping, valid while the file is open
+		const std::vector<D3D11_SUBRESOURCE_DATA>& GetSubresources() const;
+
+	private:
+		static bool Write(const std::filesystem::path& filePath, DXGI_FORMAT format, const std::vector<MipLevel>& levels);
+
+	private:
+		Utils::MappedFile m_file;
+		DXGI_FORMAT m_format = DXGI_FORMAT_UNKNOWN;
+		uint32_t m_width = 0;
+		uint32_t m_height = 0;
+		size_t m_dataSize = 0;
+		std::vector<D3D11_SUBRESOURCE_DATA> m_subresources;
+	};
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "Graphics/MipGenerator.h"
+
+namespace Gino
+{
+	class ThreadPool;
+
+	enum class HDRFormat
+	{
+		RGBA32F,		// 128 bpp, the decoded source as is
+		RGBA16F,		// 64 bpp, half floats, keeps alpha
+		R11G11B10F,		// 32 bpp, unsigned floats with 6/6/5 bit mantissas, no alpha
+		RGB9E5,			// 32 bpp, 9 bit mantissas with a shared exponent, no alpha
+		BC6H			// 8 bpp, unsigned half floats. Only mode 11 (single region, 10 bit endpoints, 4 bit indices) is emitted.
+	};
+
+	// HDR mip chain in a GPU format. Level data is tightly packed rows of texels, or of 4x4 blocks for BC6H.
+	struct HDRTexture
+	{
+		HDRFormat format = HDRFormat::RGBA32F;
+		std::vector<MipLevel> levels;
+	};
+
+	// RGB error of a decoded level against its RGBA32F reference
+	struct HDRError
+	{
+		float logPSNR = 0.f;				// dB over log2(1 + x), so that dark and bright texels count alike. Infinity for a lossless match.
+		float meanRelativeError = 0.f;		// |decoded - reference| / max(reference, 1/1024)
+		float maxRelativeError = 0.f;
+	};
+
+	/*
+		CPU encoder for linear RGBA32F mip chains (MipChain::hdr, filtered in linear space by MipGenerator).
+		Negative values (e.g ringing of the mip filter next to very bright texels) are clamped to 0 and values above
+		the largest finite value of the format to that value.
+		- RGBA16F, R11G11B10F: rounded to nearest even, one texel per SSE register
+		- RGB9E5: four texels per SSE register (transposed), the shared exponent comes from the largest channel
+		- BC6H: endpoints at the extremes of the principal axis of the block in half float bit space (roughly
+		  logarithmic, so errors are relative), refined with a least squares fit. Palette index selection is done with
+		  SSE, four texels at a time.
+		Rows (block rows for BC6H) of all levels are independent and are spread across the thread pool.
+	*/
+	class HDREncoder
+	{
+	public:
+		HDREncoder(ThreadPool* threadPool = nullptr);		// No pool = single threaded
+		~HDREncoder() = default;
+
+		HDRTexture Encode(const MipChain& chain, HDRFormat format) const;
+
+		// Back to RGBA32F (alpha is 1 for formats without alpha). Used for error measurements.
+		static MipChain Decode(const HDRTexture& texture);
+		static HDRError CalcError(const MipLevel& reference, const MipLevel& decoded);
+
+		static uint32_t GetBitsPerTexel(HDRFormat format);
+		static const char* GetFormatName(HDRFormat format);
+		static uint64_t GetDataSize(const HDRTexture& texture);
+
+	private:
+		ThreadPool* m_threadPool;
+	};
+}
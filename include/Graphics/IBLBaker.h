@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+
+#include "CubemapConverter.h"
+
+namespace Gino
+{
+	class ThreadPool;
+
+	struct IBLSettings
+	{
+		uint32_t irradianceSourceSize = 64;		// SH projection reads the environment mip with this face size (or the largest below it)
+		uint32_t specularSize = 128;			// Face size of the prefiltered cube mip 0 (clamped to the environment)
+		uint32_t specularMipCount = 6;			// Roughness of mip m = m / (specularMipCount - 1)
+		uint32_t specularSamples = 256;			// GGX importance samples per prefiltered texel
+		uint32_t brdfLutSize = 128;
+		uint32_t brdfLutSamples = 512;
+	};
+
+	struct IBLData
+	{
+		std::array<std::array<float, 4>, 9> irradianceSH{};		// Cosine convolved SH9 irradiance, rgb + padding (constant buffer layout)
+		CubeMapData specular;									// GGX prefiltered radiance (RGBA16F), see IBLSettings::specularMipCount
+		uint32_t brdfLutSize = 0;
+		std::vector<uint16_t> brdfLut;							// RG16F split sum scale and bias of F0, u = NdotV, v = roughness
+	};
+
+	/*
+		CPU precomputation of image based lighting from an HDR environment:
+		- Irradiance: 9 coefficient SH projection of a small environment mip, convolved with the clamped cosine lobe
+		- Specular: GGX prefiltered cube mip chain (split sum, N = V = R). Importance sampled with the sample mip picked
+		  from the sample pdf (filtered importance sampling), so few samples do not alias
+		- BRDF LUT: split sum scale and bias of F0 over NdotV and roughness
+		Rows are split across the thread pool. Results are cached under cache/ibl, keyed by a hash of the source file
+		contents and the settings, so at runtime only the cached file is read.
+	*/
+	class IBLBaker
+	{
+	public:
+		IBLBaker(ThreadPool* threadPool = nullptr);		// No pool = single threaded
+		~IBLBaker() = default;
+
+		IBLData Bake(const CubeMapData& environment, const IBLSettings& settings = {}) const;
+
+		// Cached IBL of the equirect .hdr at sourcePath, converted (CubemapConverter) and baked first if needed
+		IBLData LoadOrBake(const std::filesystem::path& sourcePath, const IBLSettings& settings = {}) const;
+
+		static std::filesystem::path GetCachePath(const std::filesystem::path& sourcePath, uint64_t key);
+		static bool Write(const std::filesystem::path& filePath, const IBLData& data);
+		static bool Read(const std::filesystem::path& filePath, IBLData& data);
+
+	private:
+		ThreadPool* m_threadPool;
+	};
+}
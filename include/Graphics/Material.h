@@ -1,9 +1,19 @@
 #pragma once
+#include <variant>
 
 namespace Gino
 {
 	struct Texture;
 
+	// What a material slot holds. Drives mip filtering and block compression format at cook time.
+	enum class TextureRole : uint8_t
+	{
+		Color,			// albedo, emission, diffuse
+		Normal,			// tangent space normal maps (XY used, Z rebuilt in the shader)
+		Mask,			// single channel in .r: opacity
+		Packed			// multi channel data: ORM (occlusion .r, roughness .g, metalness .b), specular
+	};
+
 	enum class MaterialType
 	{
 		Phong,
@@ -24,8 +34,7 @@ namespace Gino
 	{
 		Texture* albedo = nullptr;
 		Texture* normal = nullptr;
-		Texture* metallicAndRoughness = nullptr;
-		Texture* ao = nullptr;
+		Texture* orm = nullptr;			// glTF layout: occlusion (.r), roughness (.g), metalness (.b). Packed on import by ChannelPacker.
 		Texture* emission = nullptr;
 
 		// Other misc. data can be stored here too
@@ -0,0 +1,56 @@
+#pragma once
+
+namespace Gino
+{
+	class ThreadPool;
+
+	enum class MipFilter
+	{
+		Box,			// 2x2 average (cheapest, slightly blurry)
+		Kaiser,			// Kaiser windowed sinc, radius 3 (sharper, default for asset textures)
+		Lanczos			// Lanczos3 (sharpest, can ring on hard edges)
+	};
+
+	struct MipGenSettings
+	{
+		MipFilter filter = MipFilter::Kaiser;
+		bool srgb = true;			// Color channels are decoded to linear before filtering and re-encoded afterwards (alpha is always linear)
+		bool normalMap = false;		// Texels are treated as [0, 1] encoded unit vectors and renormalized on every level
+		uint32_t maxLevels = 0;		// 0 = full chain down to 1x1
+	};
+
+	struct MipLevel
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t rowPitch = 0;
+		std::vector<uint8_t> data;
+	};
+
+	// Full mip chain of an RGBA image. RGBA8 for LDR input, RGBA32F for HDR input (see hdr).
+	struct MipChain
+	{
+		bool hdr = false;
+		std::vector<MipLevel> levels;
+	};
+
+	/*
+		CPU replacement for ID3D11DeviceContext::GenerateMips.
+		Filtering is separable and done in linear float RGBA (one SSE register per texel), each level is
+		filtered from the previous (float) level so there is no requantization between levels.
+		Rows of a level are split across the thread pool. Levels are dependent and are processed in order.
+	*/
+	class MipGenerator
+	{
+	public:
+		MipGenerator(ThreadPool* threadPool = nullptr);		// No pool = single threaded
+		~MipGenerator() = default;
+
+		MipChain Generate(const Utils::ImageData& image, const MipGenSettings& settings = {}) const;
+
+		static uint32_t CalcLevelCount(uint32_t width, uint32_t height);
+
+	private:
+		ThreadPool* m_threadPool;
+	};
+}
@@ -2,9 +2,14 @@
 #include "ResourceTypes.h"
 #include "Graphics/Material.h"
 #include "Component.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "ResourceCache.h"
 
 namespace Gino
 {
+	struct AssimpNode;
+
 	// Represents offsets into a common VB/IB that represents a specific submesh of a model for drawing
 	// This is essentially a "render unit" (Draw call + Pipeline states)
 	struct Mesh
@@ -12,16 +17,41 @@ namespace Gino
 		uint32_t numIndices;			// Vertex count to draw
 		uint32_t indicesFirstIndex;		// First index in IB
 		uint32_t vertexOffset;			// First index in VB
+
+		// Dequantization of Vertex_Compact positions (position = offset + unorm * scale), unused for full vertices
+		DirectX::SimpleMath::Vector3 positionOffset = { 0.f, 0.f, 0.f };
+		DirectX::SimpleMath::Vector3 positionScale = { 1.f, 1.f, 1.f };
+
+		// Culling clusters of this mesh in Model::GetClusters() (0 = not clustered, always drawn whole)
+		uint32_t clusterStart = 0;
+		uint32_t clusterCount = 0;
+
+		// Simplified levels of this mesh in Model::GetLods(), LOD0 is numIndices/indicesFirstIndex
+		uint32_t lodStart = 0;
+		uint32_t lodCount = 0;
+
+		// Model units per UV unit (LOD0), drives the mip estimate of texture streaming. 0 = UVs have no area.
+		float uvDensity = 0.f;
+
+		// Node of the source hierarchy the mesh hangs off, Model::GetNodeTransform() goes in front of the instance transform
+		uint32_t node = 0;
 	};
 
 	// A collection of meshes and material that represents a coherent geometric model
 	class Model : public Component
 	{
+	public:
+		static constexpr uint32_t s_maxLods = 4;		// LOD0 included
+
 	public:
 		Model();
 		~Model() = default;
 
-		void Initialize(const Buffer& vb, const Buffer& ib, const std::vector<std::pair<Mesh, Material>>& meshesAndMaterials);
+		void Initialize(const Buffer& vb, const Buffer& ib, const std::vector<std::pair<Mesh, Material>>& meshesAndMaterials, VertexFormat vertexFormat = VertexFormat::Full);
+
+		// False while an async load is in flight (see Engine::CreateModelAsync), the model is empty until then
+		void SetResident();
+		bool IsResident() const;
 
 		// Mesh have an implicit but weak relation to materials.
 		// Here we ensure that we are working with them in pairs but still keeping them separate.
@@ -31,15 +61,66 @@ namespace Gino
 		ID3D11Buffer* GetVB() const;
 		ID3D11Buffer* GetIB() const;
 
+		VertexFormat GetVertexFormat() const;
+		uint32_t GetVertexStride() const;
+
+		// Node hierarchy of the source scene, breadth first (parents before children). Resolves the model space transform
+		// of every node and scales Mesh::uvDensity by it. Call before SetClusters, the bounds include the node transforms.
+		void SetNodes(const AssimpNode* nodes, size_t nodeCount);
+		const std::vector<uint32_t>& GetNodeParents() const;
+		const DirectX::SimpleMath::Matrix& GetNodeTransform(uint32_t node) const;		// Model space, identity without nodes
+
+		// Clusters reference index ranges of the IB, the CPU copy of the indices is what per-frame compaction reads from.
+		// Also sets the model bounds.
+		void SetClusters(const MeshCluster* clusters, size_t clusterCount, const uint32_t* indices, size_t indexCount);
+		const std::vector<MeshCluster>& GetClusters() const;
+		const std::vector<uint32_t>& GetIndices() const;
+
+		void SetLods(const MeshLod* lods, size_t lodCount);
+		const std::vector<MeshLod>& GetLods() const;
+		uint32_t GetLodCount() const;							// Levels of the most detailed mesh, LOD0 included
+		float GetLodError(uint32_t lod) const;					// Largest error of any mesh at that level (see MeshLod::error)
+		MeshLod GetMeshLod(const Mesh& mesh, uint32_t lod) const;		// Clamped to the levels the mesh has
+
+		// Model space bounding sphere of all clusters
+		const DirectX::SimpleMath::Vector3& GetBoundsCenter() const;
+		float GetBoundsRadius() const;
+
+		// Handles of the textures the materials use: they stay resident (not evictable) as long as the model exists
+		void SetTextureReferences(std::vector<TextureHandle>&& textures);
+		const std::vector<TextureHandle>& GetTextureReferences() const;
+
+		// VB/IB and the CPU side cluster and LOD data, the cost of the model in the engine's model cache (textures not included)
+		size_t GetMemoryBytes() const;
+
 	private:
 		void AddMesh(const Mesh& mesh, const Material& material);
 
 	private:
+		bool m_resident = false;
+
 		Buffer m_vb;
 		Buffer m_ib;
+		VertexFormat m_vertexFormat = VertexFormat::Full;
 
 		std::vector<Mesh> m_meshes;
 		std::vector<Material> m_materials;
+
+		std::vector<uint32_t> m_nodeParents;
+		std::vector<DirectX::SimpleMath::Matrix> m_nodeLocalTransforms;		// Relative to the parent
+		std::vector<DirectX::SimpleMath::Matrix> m_nodeTransforms;			// Model space
+
+		std::vector<MeshCluster> m_clusters;
+		std::vector<uint32_t> m_indices;
+
+		std::vector<MeshLod> m_lods;
+		std::array<float, s_maxLods> m_lodErrors{};
+		uint32_t m_lodCount = 1;
+
+		DirectX::SimpleMath::Vector3 m_boundsCenter = { 0.f, 0.f, 0.f };
+		float m_boundsRadius = 0.f;
+
+		std::vector<TextureHandle> m_textureReferences;
 	};
 }
 
@@ -2,8 +2,9 @@
 #include "DXDevice.h"
 #include "ShaderGroup.h"
 #include "ResourceTypes.h"
+#include "TextureStreamer.h"
 
-#include "Component.h"		// Needs to know Transform Component
+#include "RenderList.h"		// Draw input of the scene
 
 namespace Gino
 {
@@ -12,15 +13,17 @@ namespace Gino
 	
 	class ImGuiRenderer;
 	class SkyboxRenderer;
+	class ThreadPool;
+	class TransformSystem;
 
 	class Renderer
 	{
 	public:
-		Renderer(DXDevice* dxDev, bool vsync);
+		Renderer(DXDevice* dxDev, bool vsync, const TextureStreamingSettings& streamingSettings = {}, ThreadPool* threadPool = nullptr);
 		~Renderer();
 
 		void SetRenderCamera(FPCamera* cam);	// Primary user camera to use for rendering
-		void SetModels(const std::vector<std::pair<Model*, std::vector<Transform*>>>* models);
+		void SetModels(const RenderList* models, const TransformSystem* transforms);		// World matrices of the instances
 
 		/*
 		 
@@ -48,6 +51,18 @@ namespace Gino
 		// Exposed surface area to outside modules
 		// This is required because we need to hook ImGui to the Window Proc for this applications main window!
 		ImGuiRenderer* GetImGui() const;
+		TextureStreamer* GetTextureStreamer() const;
+
+	private:
+		// Buckets the instances of every model by LOD from their projected screen space error (see Model::GetLodError).
+		// Also reports the screen footprint of every model to the texture streamer.
+		void SelectLods();
+
+		// Fills m_culledIB with the visible clusters of every clustered model (see Model::GetClusters), for its LOD0 instances
+		void CullClusters();
+
+		// Loads (or bakes) the image based lighting of the skybox environment, see IBLBaker
+		void InitializeIBL(ThreadPool* threadPool);
 
 	private:
 		struct TestMipData
@@ -62,6 +77,8 @@ namespace Gino
 			DirectX::SimpleMath::Vector4 cameraPosition;
 			float normalMapOn = 1.f;
 			float aoTexOn = 1.f;
+			float iblOn = 1.f;
+			float iblSpecularMaxMip = 0.f;		// Prefiltered mip of roughness 1
 
 		};
 
@@ -72,10 +89,52 @@ namespace Gino
 			// We can add attenuation later (we will use inverse square law for PBR for now)
 		};
 
+		struct CB_IBL
+		{
+			DirectX::SimpleMath::Vector4 irradianceSH[9];		// Cosine convolved SH9 irradiance (rgb)
+		};
+
 		struct CB_PerObject
 		{
 			DirectX::SimpleMath::Matrix model;
 		};
+
+		// Range of a mesh in m_culledIB
+		struct CulledDraw
+		{
+			uint32_t first;
+			uint32_t count;
+		};
+
+		// Instances of one model at one LOD: m_lodInstances[first, first + count)
+		struct LodGroup
+		{
+			uint32_t first;
+			uint32_t count;
+		};
+
+		struct LodStats
+		{
+			std::vector<uint32_t> instancesPerLod;
+			uint64_t trianglesDrawn = 0;
+			uint64_t trianglesAtLod0 = 0;		// What the same instances would have drawn at LOD0
+		};
+
+		struct ClusterCullStats
+		{
+			uint32_t clustersTotal = 0;
+			uint32_t clustersVisible = 0;
+			uint64_t trianglesTotal = 0;
+			uint64_t trianglesSubmitted = 0;
+		};
+
+		// Dequantization for Vertex_Compact positions (unused by full vertices) and the node transform of the mesh (see Mesh)
+		struct CB_PerMesh
+		{
+			DirectX::SimpleMath::Vector4 positionOffset;
+			DirectX::SimpleMath::Vector4 positionScale;
+			DirectX::SimpleMath::Matrix nodeTransform;
+		};
 		
 		// Should change to Per Frame, Per Pass, Per Material and Per Object constant buffers
 		// Constant buffers by binding frequency!
@@ -88,12 +147,15 @@ namespace Gino
 
 	// Things to render
 	private:
-		const std::vector<std::pair<Model*, std::vector<Transform*>>>* m_opaqueModels; // Current scene data
+		const RenderList* m_opaqueModels; // Current scene data
+		const TransformSystem* m_transforms = nullptr;
 
 	// Render resources
 	private:
 		std::unique_ptr<ImGuiRenderer> m_imGui;
 		std::unique_ptr<SkyboxRenderer> m_skybox;
+		std::unique_ptr<TextureStreamer> m_textureStreamer;
+		int m_textureBudgetMB;
 
 		bool m_vsync;
 		DXDevice* m_dxDev;
@@ -108,12 +170,35 @@ namespace Gino
 		// Lights
 		Buffer m_sbPointLights;
 
+		// Image based lighting (baked from the skybox environment)
+		ConstantBuffer<CB_IBL> m_cbIBL;
+		Texture m_iblSpecular;
+		Texture m_brdfLut;
+		SamplerStatePtr m_iblSampler;
+
 		// Model draw pass
 		ShaderGroup m_forwardOpaquePBRShaders;
+		ShaderGroup m_forwardOpaquePBRCompactShaders;
 		ShaderGroup m_forwardOpaquePhongShaders;
 		ConstantBuffer<CB_PerObject> m_cbPerObject;
+		ConstantBuffer<CB_PerMesh> m_cbPerMesh;
 		Buffer m_instanceBuffer;
 		Framebuffer m_renderFramebuffer;
+
+		// LOD selection (rebuilt every frame)
+		std::vector<uint32_t> m_lodInstances;		// TransformSystem slots of the instances of all models, grouped by model then LOD
+		std::vector<uint32_t> m_instanceLods;
+		std::vector<LodGroup> m_lodGroups;
+		std::vector<uint32_t> m_lodGroupStart;		// Per model: first of its Model::GetLodCount() entries in m_lodGroups
+		LodStats m_lodStats;
+
+		// Cluster culling (rebuilt every frame)
+		Buffer m_culledIB;
+		uint32_t m_culledIBCapacity = 0;
+		std::vector<uint32_t> m_culledIndices;
+		std::vector<CulledDraw> m_culledDraws;
+		std::vector<int32_t> m_culledDrawStart;		// Per model: first entry in m_culledDraws, -1 = not culled (drawn from its own IB)
+		ClusterCullStats m_cullStats;
 		Texture m_depth;
 		Texture m_renderTexture;
 
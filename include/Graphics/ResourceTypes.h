@@ -5,10 +5,16 @@
 #include "DXDevice.h"
 #include "SimpleMath.h"		// Must be included AFTER <d3d11.h>/<DirectXMath.h> (SimpleMath depends on DirectXMath)
 #include "ShaderGroup.h"
+#include "HDREncoder.h"
 
 
 namespace Gino
 {
+	struct MipChain;
+	class DDSFile;
+	class ThreadPool;
+	struct CubeMapData;
+
 	struct Vertex_POS_UV_NORMAL
 	{
 		DirectX::SimpleMath::Vector3 pos;
@@ -20,6 +26,24 @@ namespace Gino
 		static std::vector<D3D11_INPUT_ELEMENT_DESC> GetElementDescriptors();
 	};
 
+	// 20 byte layout for PBR models, encoded/decoded by VertexCompressor.
+	// Positions are relative to the AABB of the subset they belong to (see Mesh::positionOffset/positionScale).
+	struct Vertex_Compact
+	{
+		uint16_t pos[4];			// xyz: UNORM16 in the subset AABB, w: bitangent sign (0 = -1, 65535 = +1)
+		uint16_t uv[2];				// Half floats
+		int16_t normal[2];			// Octahedral, SNORM16
+		int16_t tangent[2];			// Octahedral, SNORM16
+
+		static std::vector<D3D11_INPUT_ELEMENT_DESC> GetElementDescriptors();
+	};
+
+	enum class VertexFormat
+	{
+		Full,			// Vertex_POS_UV_NORMAL
+		Compact			// Vertex_Compact
+	};
+
 	// depth and stencil clear flags set automatically, override if needed
 	struct DepthStencilClearDesc
 	{
@@ -69,6 +93,12 @@ namespace Gino
 		std::vector<uint32_t> data;
 	};
 
+	struct IndexBufferDescRaw
+	{
+		const uint32_t* data;
+		size_t count;
+	};
+
 	template <typename T>
 	struct StructuredBufferDesc
 	{
@@ -121,6 +151,7 @@ namespace Gino
 		void Initialize(const DevicePtr& dev, const VertexBufferDesc<T>& desc);			// Templated version for ease of use
 		void Initialize(const DevicePtr& dev, const VertexBufferDescRaw& desc);
 		void Initialize(const DevicePtr& dev, const IndexBufferDesc& desc);
+		void Initialize(const DevicePtr& dev, const IndexBufferDescRaw& desc);
 
 		template <typename T>
 		void Initialize(const DevicePtr& dev, const StructuredBufferDesc<T>& desc);
@@ -288,11 +319,24 @@ namespace Gino
 		ID3D11DepthStencilView* GetDSV() const;
 		ID3D11UnorderedAccessView* GetUAV() const;
 
-		void InitializeFromFile(const DevicePtr& dev, const DeviceContextPtr& ctx, const std::filesystem::path& filePath, bool srgb = true, bool genMipMaps = true);
+		// .hdr files get linear CPU mips (when genMipMaps) and are encoded to hdrFormat, see HDREncoder
+		void InitializeFromFile(const DevicePtr& dev, const DeviceContextPtr& ctx, const std::filesystem::path& filePath, bool srgb = true, bool genMipMaps = true, HDRFormat hdrFormat = HDRFormat::RGBA16F);
+		// GPU side of InitializeFromFile for images that were already decoded (e.g on a worker thread). Does not release the image.
+		void InitializeFromImage(const DevicePtr& dev, const DeviceContextPtr& ctx, Utils::ImageData& imageData, bool srgb = true, bool genMipMaps = true, bool hdr = false);
+		// Immutable texture from a precomputed (CPU) mip chain. SRV only, no GenerateMips and no RTV.
+		void InitializeFromMipChain(const DevicePtr& dev, const DeviceContextPtr& ctx, const MipChain& chain, bool srgb = true);
+		// Immutable texture straight from a (mapped) DDS file, e.g a cooked block compressed texture. SRV only.
+		void InitializeFromDDS(const DevicePtr& dev, const DeviceContextPtr& ctx, const DDSFile& dds);
+		// Immutable texture from an encoded HDR mip chain (RGBA16F, R11G11B10F, BC6H, ...). SRV only.
+		void InitializeFromHDR(const DevicePtr& dev, const DeviceContextPtr& ctx, const HDRTexture& hdr);
 		void InitializeFromExisting(const Tex2DPtr& tex, const RtvPtr& rtv = nullptr, const SrvPtr& srv = nullptr, const DsvPtr& dsv = nullptr, const UavPtr& uav = nullptr);
 
 		// Expects in order: +x, -x, +y, -y, +z, -z
 		void InitializeCubeFromFile(const DevicePtr& dev, const DeviceContextPtr& ctx, const std::vector<std::filesystem::path>& filepaths, bool srgb = true, bool genMipMaps = true, bool hdr = false);
+		// Immutable cube (full mip chain) from an equirectangular .hdr, converted on the CPU and cached on disk (see CubemapConverter)
+		void InitializeCubeFromFile(const DevicePtr& dev, const DeviceContextPtr& ctx, const std::filesystem::path& equirectHDR, ThreadPool* threadPool = nullptr, HDRFormat format = HDRFormat::RGBA16F);
+		// Immutable cube from CPU side faces and mips. The faces are RGBA16F, other formats re-encode them with HDREncoder.
+		void InitializeCubeFromData(const DevicePtr& dev, const DeviceContextPtr& ctx, const CubeMapData& cube, HDRFormat format = HDRFormat::RGBA16F, ThreadPool* threadPool = nullptr);
 
 	private:
 		void CreateViews(const DevicePtr& dev, const DeviceContextPtr& ctx, const D3D11_TEXTURE2D_DESC& desc);
@@ -5,6 +5,7 @@
 namespace Gino
 {
 	class FPCamera;
+	class ThreadPool;
 
 	class SkyboxRenderer
 	{
@@ -15,12 +16,14 @@ namespace Gino
 		};
 
 	public:
-		SkyboxRenderer(DXDevice* dev);
+		SkyboxRenderer(DXDevice* dev, ThreadPool* threadPool = nullptr);		// Thread pool for the skybox conversion
 		~SkyboxRenderer() = default;
 
 		void SetCamera(FPCamera* camera);
 		void Render(Framebuffer& framebuffer, const D3D11_VIEWPORT& vp);
 
+		const std::filesystem::path& GetEnvironmentPath() const;		// HDR equirect of the sky, also the source of the image based lighting
+
 	private:
 		DXDevice* m_dxDev;
 
@@ -33,6 +36,7 @@ namespace Gino
 		DepthStencilStatePtr m_dss;
 		Texture m_skyboxTex;
 		Texture m_skyboxHDR;
+		std::filesystem::path m_environmentPath;
 	};
 }
 
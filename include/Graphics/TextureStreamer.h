@@ -0,0 +1,125 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+
+#include "DXDevice.h"
+#include "MipGenerator.h"
+#include "DDSFile.h"
+
+namespace Gino
+{
+	struct Texture;
+	struct HDRTexture;
+	struct Vertex_POS_UV_NORMAL;
+	class Model;
+
+	struct TextureStreamingSettings
+	{
+		size_t budgetBytes = 512ull * 1024 * 1024;			// GPU memory for all streamed textures
+		size_t uploadBytesPerFrame = 16ull * 1024 * 1024;	// Newly allocated levels are uploaded over several frames (at least one level per frame)
+		uint32_t tailSize = 128;							// Levels at or below this size are resident from load on and never evicted
+		float mipBias = 0.f;								// Added to every estimate, positive = coarser
+	};
+
+	struct TextureStreamingStats
+	{
+		uint32_t textures = 0;
+		uint32_t texturesAtWantedMip = 0;		// Fully uploaded down to the estimated mip
+		uint32_t texturesBudgetClamped = 0;		// Held coarser than the estimate by the budget
+		size_t budgetBytes = 0;
+		size_t allocatedBytes = 0;				// GPU memory of all streamed textures
+		size_t residentBytes = 0;				// Part of allocatedBytes that has been uploaded (visible through the SRV)
+		size_t wantedBytes = 0;					// What the estimates would need without a budget
+		size_t fullChainBytes = 0;				// What the streamed textures would need fully resident
+
+		// Decisions of the last Update
+		uint32_t streamedIn = 0;
+		uint32_t evicted = 0;
+		uint32_t levelsUploaded = 0;
+		size_t uploadedBytes = 0;
+		uint32_t pendingLevels = 0;				// Allocated but not uploaded yet
+	};
+
+	/*
+		Mip streaming for textures that were loaded with a CPU side source (decoded mip chain or mapped cooked file).
+		Every texture starts with its tail mips only. Each frame the renderer reports how many pixels a model unit of
+		every model covers at its nearest instance, which gives a mip estimate per material texture from the UV density
+		of the meshes (Mesh::uvDensity). Textures are then reallocated to the estimate under the memory budget:
+		- Finer levels are allocated at once but uploaded over the next frames, the SRV MostDetailedMip clamps
+		  sampling to the levels that are uploaded
+		- Levels that are not needed are only evicted when the budget is exceeded (largest levels and textures
+		  that hold more than their estimate go first)
+		Reallocation copies the levels both textures share on the GPU, so only new levels come from the CPU source.
+		Device thread only.
+	*/
+	class TextureStreamer
+	{
+	public:
+		TextureStreamer(DXDevice* dxDev, const TextureStreamingSettings& settings = {});
+		~TextureStreamer();
+
+		// Takes over the source and initializes texture with its tail mips
+		void Add(Texture* texture, MipChain&& chain, bool srgb);
+		void Add(Texture* texture, std::unique_ptr<DDSFile> dds);
+		void Add(Texture* texture, HDRTexture&& hdr);
+		// Drops the source of a texture that is about to be destroyed, no-op for textures that are not streamed
+		void Remove(const Texture* texture);
+
+		// Per frame: BeginFrame, RequestModel for every drawn model, then Update
+		void BeginFrame();
+		void RequestModel(const Model* model, float pixelsPerUnit);		// Screen pixels per model unit at the nearest instance
+		void Update();
+
+		void SetBudget(size_t bytes);
+		const TextureStreamingStats& GetStats() const;
+
+		// Model units per UV unit of an indexed triangle list (square root of world area over UV area), 0 if the UVs have no area
+		static float CalcUVDensity(const Vertex_POS_UV_NORMAL* vertices, const uint32_t* indices, uint32_t indexCount);
+
+	private:
+		struct SourceLevel
+		{
+			const uint8_t* data;
+			uint32_t rowPitch;
+			uint32_t width;
+			uint32_t height;
+			size_t bytes;
+		};
+
+		struct StreamedTexture
+		{
+			Texture* texture = nullptr;
+			DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+			std::vector<SourceLevel> levels;
+
+			// Owners of SourceLevel::data, only one is used
+			MipChain chain;					// Also holds the levels of encoded HDR textures
+			std::unique_ptr<DDSFile> dds;
+
+			uint32_t tailMip = 0;			// Finest level that is never evicted
+			uint32_t allocatedMip = 0;		// Finest level of the GPU texture
+			uint32_t residentMip = 0;		// Finest uploaded level, MostDetailedMip = residentMip - allocatedMip
+			uint32_t wantedMip = 0;			// Estimate of this frame
+			uint32_t targetMip = 0;			// Estimate after the budget
+
+			Tex2DPtr gpuTexture;
+			bool viewDirty = false;
+		};
+
+	private:
+		void Add(StreamedTexture&& streamed);
+		void Reallocate(StreamedTexture& streamed, uint32_t allocatedMip);
+		void UploadLevel(StreamedTexture& streamed);		// Uploads residentMip - 1
+		void UpdateView(StreamedTexture& streamed);
+
+		size_t GetBytesFrom(const StreamedTexture& streamed, uint32_t mip) const;		// Levels [mip, end)
+
+	private:
+		DXDevice* m_dxDev;
+		TextureStreamingSettings m_settings;
+		TextureStreamingStats m_stats;
+
+		std::vector<StreamedTexture> m_textures;
+		std::unordered_map<const Texture*, uint32_t> m_textureIndices;
+	};
+}
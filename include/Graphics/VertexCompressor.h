@@ -0,0 +1,46 @@
+#pragma once
+#include "Graphics/ResourceTypes.h"
+
+namespace Gino
+{
+	// Dequantization of compact positions: position = offset + unorm * scale
+	struct PositionQuantization
+	{
+		DirectX::SimpleMath::Vector3 offset;
+		DirectX::SimpleMath::Vector3 scale;
+	};
+
+	// Worst case round trip error over a vertex range
+	struct VertexCompressionError
+	{
+		float maxPosition = 0.f;			// Model units
+		float maxUV = 0.f;
+		float maxNormalDegrees = 0.f;
+		float maxTangentDegrees = 0.f;		// Against the tangent orthogonalized to the normal
+		uint32_t handednessFlips = 0;		// Vertices whose reconstructed bitangent points the other way
+
+		VertexCompressionError& operator+=(const VertexCompressionError& other);
+	};
+
+	/*
+		Vertex_POS_UV_NORMAL (56 bytes) <-> Vertex_Compact (20 bytes)
+
+		- Position:		UNORM16 in the AABB passed in (one per subset, so precision scales with the subset and not the model)
+		- UV:			Half floats
+		- Normal:		Octahedral encoding, SNORM16 (< 0.05 degrees)
+		- Tangent:		Octahedral encoding, SNORM16, orthogonalized against the normal
+		- Bitangent:	Only the handedness is kept: bitangent = cross(normal, tangent) * sign
+	*/
+	class VertexCompressor
+	{
+	public:
+		static PositionQuantization CalcPositionQuantization(const Vertex_POS_UV_NORMAL* vertices, size_t count);
+
+		static Vertex_Compact Encode(const Vertex_POS_UV_NORMAL& vertex, const PositionQuantization& quantization);
+		static Vertex_POS_UV_NORMAL Decode(const Vertex_Compact& vertex, const PositionQuantization& quantization);
+
+		static void Encode(const Vertex_POS_UV_NORMAL* vertices, Vertex_Compact* output, size_t count, const PositionQuantization& quantization);
+
+		static VertexCompressionError MeasureError(const Vertex_POS_UV_NORMAL* original, const Vertex_Compact* compressed, size_t count, const PositionQuantization& quantization);
+	};
+}
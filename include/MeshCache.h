@@ -0,0 +1,135 @@
+#pragma once
+#include "AssimpLoader.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "Graphics/ResourceTypes.h"
+
+namespace Gino
+{
+	/*
+		Binary cache of the final import result (post Assimp + conversion to our vertex layout).
+		A cache hit memory maps the file and hands the vertex/index sections directly to the GPU buffers.
+
+		Layout (all sections 16 byte aligned):
+			MeshCacheHeader
+			Vertex_POS_UV_NORMAL[vertexCount]
+			uint32_t[indexCount]
+			MeshCacheSubset[subsetCount]
+			MeshCluster[clusterCount]
+			MeshLod[lodCount]
+			AssimpNode[nodeCount]			// Breadth first, parents before children
+			MeshCacheMaterial[materialCount]
+			uint32_t[texturePathCount]		// String table offsets
+			char[stringTableSize]			// Null terminated texture paths, each stored once
+	*/
+
+	struct MeshCacheKey
+	{
+		uint64_t sourceStamp;		// Names, sizes and write times of the source file and its same-stem siblings (.bin, .mtl)
+		uint64_t sourceHash;		// Content hash of the same files, only computed when the stamp does not match (0 until then)
+		uint32_t importFlags;
+		uint32_t pbr;
+	};
+
+	struct MeshCacheSubset
+	{
+		uint32_t vertexStart;
+		uint32_t vertexCount;
+		uint32_t indexStart;
+		uint32_t indexCount;
+		uint32_t materialIndex;
+		uint32_t clusterStart;
+		uint32_t clusterCount;
+		uint32_t lodStart;			// Simplified levels after LOD0 (which is indexStart/indexCount)
+		uint32_t lodCount;
+		uint32_t node;				// Transform of the mesh in the model (AssimpNode index)
+	};
+
+	struct MeshCacheMaterial
+	{
+		static constexpr uint32_t s_noTexture = ~0u;
+
+		// Indices into the texture path table or s_noTexture
+		// Phong:	diffuse, specular, normal, opacity, (unused)
+		// PBR:		albedo, normal, metallicAndRoughness, ao, emission
+		uint32_t textures[5];
+		float baseColorFactor[3];
+		float metallicAndRoughnessFactor[2];
+	};
+
+	struct MeshCacheHeader
+	{
+		static constexpr uint32_t s_magic = 0x48534D47;		// 'GMSH'
+		static constexpr uint32_t s_version = 7;		// 2: subset vertex counts, optimized index/vertex order. 3: clusters. 4: LODs. 5: interned texture paths. 6: node hierarchy. 7: source stamp
+
+		uint32_t magic;
+		uint32_t version;
+		MeshCacheKey key;
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t subsetCount;
+		uint32_t clusterCount;
+		uint32_t lodCount;
+		uint32_t nodeCount;
+		uint32_t materialCount;
+		uint32_t texturePathCount;
+		uint32_t stringTableSize;
+
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		uint64_t subsetOffset;
+		uint64_t clusterOffset;
+		uint64_t lodOffset;
+		uint64_t nodeOffset;
+		uint64_t materialOffset;
+		uint64_t texturePathOffset;
+		uint64_t stringOffset;
+	};
+
+	// Non-owning view of everything needed to build a Model, either from Assimp or from a mapped cache file
+	struct ModelImportData
+	{
+		bool pbr = false;
+
+		const Vertex_POS_UV_NORMAL* vertices = nullptr;
+		uint32_t vertexCount = 0;
+		const uint32_t* indices = nullptr;
+		uint32_t indexCount = 0;
+
+		std::vector<MeshCacheSubset> subsets;
+		const MeshCluster* clusters = nullptr;		// Referenced by MeshCacheSubset::clusterStart/clusterCount
+		uint32_t clusterCount = 0;
+		const MeshLod* lods = nullptr;			// Referenced by MeshCacheSubset::lodStart/lodCount
+		uint32_t lodCount = 0;
+		std::vector<AssimpNode> nodes;						// Referenced by MeshCacheSubset::node
+		std::vector<AssimpMaterialPaths> materials;			// Deduplicated, referenced by MeshCacheSubset::materialIndex
+		std::vector<AssimpMaterialPathsPBR> materialsPBR;
+		std::vector<std::string> texturePaths;				// Referenced by the material texture indices
+	};
+
+	class MeshCache
+	{
+	public:
+		MeshCache() = default;
+		~MeshCache() = default;
+
+		// Only stats the source files, the content hash is left for HashSources (archived sources have it for free)
+		static MeshCacheKey MakeKey(const std::filesystem::path& sourcePath, uint32_t importFlags, bool pbr);
+		// Fills in key.sourceHash if it is not there yet, Write needs it
+		static void HashSources(const std::filesystem::path& sourcePath, MeshCacheKey& key);
+		static std::filesystem::path GetCachePath(const std::filesystem::path& sourcePath);
+		static void Write(const std::filesystem::path& cachePath, const MeshCacheKey& key, const ModelImportData& data);
+
+		// Maps the cache file and validates it against the key. Returns false on a miss (absent, stale or corrupt).
+		// A matching stamp is a hit without reading the sources. Otherwise the sources are hashed, and if their contents
+		// still match, the new stamp is written to the cache file.
+		// The returned data points into the mapping and is valid for the lifetime of this object.
+		bool Open(const std::filesystem::path& cachePath, const std::filesystem::path& sourcePath, MeshCacheKey& key);
+		const ModelImportData& GetData() const;
+
+	private:
+		Utils::MappedFile m_file;
+		ModelImportData m_data;
+	};
+}
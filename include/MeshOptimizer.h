@@ -0,0 +1,50 @@
+#pragma once
+
+namespace Gino
+{
+	// Post-transform vertex cache statistics of an index buffer (FIFO cache simulation)
+	struct VertexCacheStats
+	{
+		uint64_t triangleCount = 0;
+		uint64_t vertexCount = 0;			// Unique vertices referenced
+		uint64_t transformedCount = 0;		// Cache misses = vertex shader invocations
+
+		float GetACMR() const;		// Average cache miss ratio: transformed / triangles (0.5 ideal, 3 worst)
+		float GetATVR() const;		// Average transform to vertex ratio: transformed / vertices (1 ideal)
+
+		VertexCacheStats& operator+=(const VertexCacheStats& other);
+	};
+
+	struct MeshOptimizeSettings
+	{
+		uint32_t cacheSize = 16;			// Simulated post-transform cache (FIFO)
+		bool overdraw = true;				// Reorder Tipsify clusters front-to-back-ish (outward facing first)
+		float overdrawThreshold = 1.05f;	// Allowed ACMR increase when splitting clusters for the overdraw sort
+		bool vertexFetch = true;			// Reorder vertices in first-use order
+	};
+
+	/*
+		Index/vertex reordering for a single indexed triangle list (one mesh subset), all in place.
+		Indices are local to the vertex range that is passed in.
+
+		- OptimizeVertexCache:	Tipsify (Sander, Nehab, Barczak 2007), linear time
+		- OptimizeOverdraw:		Splits the Tipsify output into clusters at cache flushes / low ACMR points
+								and sorts the clusters by how much they face away from the mesh center
+		- OptimizeVertexFetch:	Renumbers vertices in first-use order so vertex fetches are mostly sequential
+	*/
+	class MeshOptimizer
+	{
+	public:
+		static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+		// Positions are read as 3 floats at the start of every vertex
+		static void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride, uint32_t cacheSize = 16, float threshold = 1.05f);
+
+		static void OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexStride, uint32_t* indices, size_t indexCount);
+
+		// All of the above, in order, as configured by settings
+		static void Optimize(void* vertices, size_t vertexCount, size_t vertexStride, uint32_t* indices, size_t indexCount, const MeshOptimizeSettings& settings = {});
+
+		static VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+	};
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+namespace Gino
+{
+	// Index range of one simplified level of a subset. Plain data, stored as is in the mesh cache.
+	struct MeshLod
+	{
+		uint32_t indexStart;		// First index in the model IB, indices are subset relative like LOD0
+		uint32_t indexCount;
+		float error;				// Worst collapse error in model units: RMS distance to the accumulated LOD0 planes (an estimate, not a bound)
+	};
+
+	/*
+		Quadric error metric edge collapse simplification (Garland & Heckbert 1997) of one indexed triangle list.
+		Collapses move a vertex onto one of its neighbors (half edge collapse), so the result indexes the same
+		vertex buffer as the input and LODs can share it.
+
+		Topology is kept intact:
+		- Border vertices (open edges) only slide along the border
+		- UV/normal seams (two vertices at one position) collapse together along the seam
+		- Vertices shared by more than two wedges, or on non-manifold edges, are locked
+		Collapses that would flip a triangle are rejected.
+	*/
+	class MeshSimplifier
+	{
+	public:
+		// Positions are read as 3 floats at the start of every vertex.
+		// Stops at targetIndexCount or when the next collapse would exceed targetError (model units).
+		// The error of a collapse is the area weighted RMS distance of the kept vertex to the planes of the LOD0 triangles
+		// merged into it, so the real surface deviation can locally be larger.
+		// resultError receives the largest error of the collapses that were made.
+		static std::vector<uint32_t> Simplify(const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride,
+			size_t targetIndexCount, float targetError, float* resultError = nullptr);
+	};
+}
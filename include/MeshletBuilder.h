@@ -0,0 +1,46 @@
+#pragma once
+
+namespace Gino
+{
+	// A contiguous triangle range of a subset with culling bounds. Plain data, stored as is in the mesh cache.
+	struct MeshCluster
+	{
+		static constexpr float s_noCone = 1.f;		// coneCutoff for clusters whose normals spread too far to ever be backfacing
+
+		uint32_t indexStart;		// First index in the model IB
+		uint32_t indexCount;
+		uint32_t vertexCount;		// Unique vertices referenced
+
+		float center[3];			// Bounding sphere
+		float radius;
+		float aabbMin[3];
+		float aabbMax[3];
+
+		// Backface cone: the cluster is entirely backfacing from a camera at c if
+		// dot(center - c, coneAxis) >= coneCutoff * length(center - c) + radius
+		float coneAxis[3];
+		float coneCutoff;			// sin(max angle between axis and triangle normals), or s_noCone
+	};
+
+	struct MeshletSettings
+	{
+		uint32_t maxVertices = 64;
+		uint32_t maxTriangles = 124;
+	};
+
+	/*
+		Splits an indexed triangle list (one subset) into clusters of at most maxVertices/maxTriangles.
+		Clusters grow greedily over shared edges/vertices, preferring triangles that add the fewest new vertices
+		and then the ones closest to the cluster. The triangles are reordered in place so every cluster is
+		one contiguous index range, in roughly the incoming (vertex cache optimized) order.
+	*/
+	class MeshletBuilder
+	{
+	public:
+		// Positions are read as 3 floats at the start of every vertex. Cluster index ranges are offset by indexBase.
+		static std::vector<MeshCluster> Build(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride, uint32_t indexBase = 0, const MeshletSettings& settings = {});
+
+		// Bounds of a single triangle range (used by Build)
+		static MeshCluster ComputeBounds(const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexStride);
+	};
+}
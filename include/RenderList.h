@@ -0,0 +1,81 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+
+namespace Gino
+{
+	class Entity;
+	class Model;
+
+	/*
+		Instances of a scene by model, the draw input of the Renderer.
+		Maintained incrementally: entities are added and removed when their components change, so a frame only pays
+		for what changed instead of rebuilding the lists from every entity.
+		- Every instance is a TransformSystem slot in one flat array, each model owns a contiguous range of it
+		- Removal swaps the last instance of the model into the hole (order is not kept)
+		- Adding or removing shifts every later range by one slot, which moves a single instance per range (its first
+		  one to its end, or back), so the cost grows with the model count, not the instance count
+		- A model range goes away with its last instance, so the list never points at a model nobody uses
+		- Instances of models that are still loading wait in a pending list until the model is resident.
+		  Update checks those only, it costs nothing once everything has loaded.
+	*/
+	class RenderList
+	{
+	public:
+		// Instances of model: GetInstances()[first, first + count)
+		struct ModelRange
+		{
+			Model* model;
+			uint32_t first;
+			uint32_t count;
+		};
+
+	public:
+		RenderList() = default;
+		~RenderList() = default;
+
+		// entity must not be in the list yet. transform is its TransformSystem slot.
+		void Add(const Entity* entity, Model* model, uint32_t transform);
+		// No-op for entities that are not in the list
+		void Remove(const Entity* entity);
+		bool Contains(const Entity* entity) const;
+
+		// Moves pending instances whose model became resident into the lists. Returns how many moved.
+		uint32_t Update();
+
+		const std::vector<ModelRange>& GetModels() const;
+		const std::vector<uint32_t>& GetInstances() const;		// TransformSystem slots, grouped by model
+		uint32_t GetInstanceCount() const;
+		uint32_t GetPendingCount() const;
+
+		// Per frame cost against a full rebuild at 1K, 10K and 100K entities, printed to the console. CPU only.
+		static void RunBenchmark();
+
+	private:
+		struct Pending
+		{
+			const Entity* entity;
+			Model* model;
+			uint32_t transform;
+		};
+
+		struct Slot
+		{
+			Model* model;
+			uint32_t index;			// Into m_instances, or into m_pending
+			bool pending;
+		};
+
+	private:
+		void Insert(const Entity* entity, Model* model, uint32_t transform);		// Resident model
+		void Move(uint32_t from, uint32_t to);		// Instance and its owner, within m_instances
+
+	private:
+		std::vector<uint32_t> m_instances;
+		std::vector<const Entity*> m_owners;		// Entity of every instance, parallel to m_instances
+		std::vector<ModelRange> m_models;			// In the order of their ranges
+		std::unordered_map<const Model*, uint32_t> m_modelSlots;		// Into m_models
+		std::unordered_map<const Entity*, Slot> m_slots;
+		std::vector<Pending> m_pending;
+	};
+}
@@ -0,0 +1,312 @@
+#pragma once
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+
+#include "StringId.h"
+
+namespace Gino
+{
+	struct ResourceCacheStats
+	{
+		size_t budgetBytes = 0;
+		size_t residentBytes = 0;
+		size_t unreferencedBytes = 0;		// Part of residentBytes that eviction may free
+		uint32_t resources = 0;
+		uint32_t unreferenced = 0;
+
+		// Accumulated since creation
+		uint32_t evictions = 0;				// LRU evictions by Trim
+		uint32_t removals = 0;				// Explicit Remove calls that freed a resource
+		size_t evictedBytes = 0;
+	};
+
+	/*
+		Cache of resources keyed by StringId, with refcounted handles and a byte cost per resource.
+		Referenced resources are never freed. Unreferenced ones stay resident (a later Find revives them) until
+		Trim evicts them in least recently used order to get back under the budget, or Remove frees them explicitly.
+		Referenced resources can take the cache over budget, Trim then frees everything it can.
+
+		Lookups and handle copies are thread safe. Resources are only freed by Trim and Remove, so onEvict runs on the
+		thread that calls those. Handles must not outlive the cache.
+	*/
+	template <typename T>
+	class ResourceCache
+	{
+	private:
+		struct Entry
+		{
+			StringId key;
+			std::unique_ptr<T> resource;
+			size_t bytes = 0;
+			uint32_t refCount = 0;
+			uint64_t lastUse = 0;
+		};
+
+	public:
+		class Handle
+		{
+		public:
+			Handle() = default;
+			~Handle() { Reset(); }
+
+			Handle(const Handle& other) : m_cache(other.m_cache), m_entry(other.m_entry) { AddRef(); }
+			Handle(Handle&& other) noexcept : m_cache(other.m_cache), m_entry(other.m_entry) { other.m_cache = nullptr; other.m_entry = nullptr; }
+			Handle& operator=(Handle other) noexcept { std::swap(m_cache, other.m_cache); std::swap(m_entry, other.m_entry); return *this; }
+
+			T* Get() const { return m_entry ? m_entry->resource.get() : nullptr; }
+			T* operator->() const { return Get(); }
+			explicit operator bool() const { return m_entry != nullptr; }
+
+			StringId GetKey() const { return m_entry ? m_entry->key : StringId(); }		// Empty for an empty handle
+			void Reset();
+
+		private:
+			friend class ResourceCache;
+			Handle(ResourceCache* cache, Entry* entry) : m_cache(cache), m_entry(entry) {}		// Reference already counted under the cache lock
+			void AddRef();
+
+		private:
+			ResourceCache* m_cache = nullptr;
+			Entry* m_entry = nullptr;
+		};
+
+	public:
+		// onEvict runs right before a resource is freed by Trim or Remove (not when the cache itself is destroyed), under the cache lock
+		// so it must not call back into this cache
+		ResourceCache(size_t budgetBytes = SIZE_MAX, std::function<void(StringId, T*)> onEvict = {});
+		~ResourceCache() = default;
+
+		ResourceCache(const ResourceCache&) = delete;
+		ResourceCache& operator=(const ResourceCache&) = delete;
+
+		// key must not be in the cache yet (the resident resource is returned if it is)
+		Handle Insert(StringId key, std::unique_ptr<T> resource, size_t bytes);
+		// Empty handle when key is not resident. Counts as a use for the LRU order.
+		Handle Find(StringId key);
+		bool Contains(StringId key) const;
+		uint32_t GetRefCount(StringId key) const;
+		// Cost of a resource that was inserted before its size was known (e.g a placeholder)
+		void SetBytes(const Handle& handle, size_t bytes);
+
+		// Frees key if nothing references it, false otherwise (or if it is not resident)
+		bool Remove(StringId key);
+		// Evicts unreferenced resources, least recently used first, until the cache is within budget. Returns the eviction count.
+		uint32_t Trim();
+
+		void SetBudget(size_t bytes);
+		ResourceCacheStats GetStats() const;
+
+	private:
+		void Release(Entry* entry);
+		void Free(Entry& entry);			// Locked, entry unreferenced
+
+	private:
+		mutable std::mutex m_mutex;
+		std::unordered_map<StringId, Entry> m_entries;		// Node based, entries do not move
+		std::function<void(StringId, T*)> m_onEvict;
+		size_t m_budgetBytes;
+		size_t m_residentBytes = 0;
+		uint64_t m_useCounter = 0;
+		uint32_t m_evictions = 0;
+		uint32_t m_removals = 0;
+		size_t m_evictedBytes = 0;
+	};
+
+	template<typename T>
+	inline void ResourceCache<T>::Handle::Reset()
+	{
+		if (m_entry)
+			m_cache->Release(m_entry);
+		m_cache = nullptr;
+		m_entry = nullptr;
+	}
+
+	template<typename T>
+	inline void ResourceCache<T>::Handle::AddRef()
+	{
+		if (!m_entry)
+			return;
+		std::lock_guard<std::mutex> lock(m_cache->m_mutex);
+		++m_entry->refCount;
+	}
+
+	template<typename T>
+	inline ResourceCache<T>::ResourceCache(size_t budgetBytes, std::function<void(StringId, T*)> onEvict) :
+		m_onEvict(std::move(onEvict)),
+		m_budgetBytes(budgetBytes)
+	{
+	}
+
+	template<typename T>
+	inline typename ResourceCache<T>::Handle ResourceCache<T>::Insert(StringId key, std::unique_ptr<T> resource, size_t bytes)
+	{
+		Entry* entry = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto [it, inserted] = m_entries.try_emplace(key);
+			entry = &it->second;
+			if (!inserted)
+			{
+				// The resident one wins, resource is dropped
+				std::cout << "Gino::ResourceCache : '" << key.GetName() << "' is already resident\n";
+				assert(false);
+				++entry->refCount;
+				return Handle(this, entry);
+			}
+
+			entry->key = key;
+			entry->resource = std::move(resource);
+			entry->bytes = bytes;
+			entry->refCount = 1;
+			entry->lastUse = ++m_useCounter;
+			m_residentBytes += bytes;
+		}
+		return Handle(this, entry);
+	}
+
+	template<typename T>
+	inline typename ResourceCache<T>::Handle ResourceCache<T>::Find(StringId key)
+	{
+		Entry* entry = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_entries.find(key);
+			if (it == m_entries.end())
+				return Handle();
+
+			// Referenced before the lock is released, so that Trim can not free it in between
+			entry = &it->second;
+			++entry->refCount;
+			entry->lastUse = ++m_useCounter;
+		}
+		return Handle(this, entry);
+	}
+
+	template<typename T>
+	inline bool ResourceCache<T>::Contains(StringId key) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_entries.find(key) != m_entries.end();
+	}
+
+	template<typename T>
+	inline uint32_t ResourceCache<T>::GetRefCount(StringId key) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(key);
+		return it != m_entries.end() ? it->second.refCount : 0;
+	}
+
+	template<typename T>
+	inline void ResourceCache<T>::SetBytes(const Handle& handle, size_t bytes)
+	{
+		assert(handle.m_cache == this);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_residentBytes = m_residentBytes - handle.m_entry->bytes + bytes;
+		handle.m_entry->bytes = bytes;
+	}
+
+	template<typename T>
+	inline bool ResourceCache<T>::Remove(StringId key)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(key);
+		if (it == m_entries.end() || it->second.refCount > 0)
+			return false;
+
+		Free(it->second);
+		++m_removals;
+		m_entries.erase(it);
+		return true;
+	}
+
+	template<typename T>
+	inline uint32_t ResourceCache<T>::Trim()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_residentBytes <= m_budgetBytes)
+			return 0;
+
+		std::vector<Entry*> candidates;
+		for (auto& [key, entry] : m_entries)
+		{
+			if (entry.refCount == 0)
+				candidates.push_back(&entry);
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const Entry* lhs, const Entry* rhs) { return lhs->lastUse < rhs->lastUse; });
+
+		uint32_t evicted = 0;
+		for (Entry* entry : candidates)
+		{
+			if (m_residentBytes <= m_budgetBytes)
+				break;
+
+			m_evictedBytes += entry->bytes;
+			Free(*entry);
+			const StringId key = entry->key;
+			m_entries.erase(key);
+			++evicted;
+		}
+		m_evictions += evicted;
+		return evicted;
+	}
+
+	template<typename T>
+	inline void ResourceCache<T>::SetBudget(size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_budgetBytes = bytes;
+	}
+
+	template<typename T>
+	inline ResourceCacheStats ResourceCache<T>::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		ResourceCacheStats stats;
+		stats.budgetBytes = m_budgetBytes;
+		stats.residentBytes = m_residentBytes;
+		stats.resources = static_cast<uint32_t>(m_entries.size());
+		for (const auto& [key, entry] : m_entries)
+		{
+			if (entry.refCount == 0)
+			{
+				stats.unreferencedBytes += entry.bytes;
+				++stats.unreferenced;
+			}
+		}
+		stats.evictions = m_evictions;
+		stats.removals = m_removals;
+		stats.evictedBytes = m_evictedBytes;
+		return stats;
+	}
+
+	template<typename T>
+	inline void ResourceCache<T>::Release(Entry* entry)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		assert(entry->refCount > 0);
+		--entry->refCount;
+		entry->lastUse = ++m_useCounter;		// The last user just let go, older unreferenced resources go first
+	}
+
+	template<typename T>
+	inline void ResourceCache<T>::Free(Entry& entry)
+	{
+		if (m_onEvict)
+			m_onEvict(entry.key, entry.resource.get());
+		m_residentBytes -= entry.bytes;
+		entry.resource.reset();
+	}
+
+	// The engine's caches (see Engine)
+	struct Texture;
+	class Model;
+	using TextureHandle = ResourceCache<Texture>::Handle;
+	using ModelHandle = ResourceCache<Model>::Handle;
+}
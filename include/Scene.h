@@ -3,9 +3,14 @@
 #include <utility>
 #include "Engine.h"
 #include "Entity.h"
+#include "RenderList.h"
+#include "TransformSystem.h"
+#include "SlotMap.h"
 
 namespace Gino
 {
+	using EntityHandle = SlotHandle;
+
 	class Scene
 	{
 	public:
@@ -14,23 +19,45 @@ namespace Gino
 
 		void Update(float dt);
 
-		const std::vector<std::pair<Model*, std::vector<Transform*>>>* GetModelInstances() const;
+		const RenderList* GetModelInstances() const;
+		const TransformSystem* GetTransforms() const;
 
 	private:
-		void FinalizeScene();	// Called at the end of scene initialization
+		// Named entities can also be found with FindEntity
+		EntityHandle CreateEntity(std::string_view name = {});
+		Entity* GetEntity(EntityHandle handle);			// nullptr once the entity is destroyed
+		EntityHandle FindEntity(StringId name) const;
+		void DestroyEntity(EntityHandle handle);			// Its children stay, as roots
+		// Child transform relative to the parent's. A null parent detaches. Fails on stale handles and cycles.
+		bool SetParent(EntityHandle child, EntityHandle parent);
 
-		Entity* CreateEntity(const std::string& name);
-		Entity* GetEntity(const std::string& name);
+		// Gathers the entities that have a Model into the render list in one pass over the storage.
+		// OnComponentChanged keeps it in sync from then on.
+		void BuildRenderList();
+		// Keeps the render list in sync with the Model components
+		void OnComponentChanged(Entity* entity, ComponentType type, bool added);
 
 	private:
 		Engine* m_engine;
-		bool m_finalized = false;
 
-		// { model1, vector<Matrix> } 
-		// { model2, vector<Matrix> }
-		std::vector<std::pair<Model*, std::vector<Transform*>>> m_modelInstances;
+		RenderList m_renderList;
+		bool m_renderListBuilt = false;
+
+		// Declared before the entities, which release their Transform slot and storage row on destruction
+		TransformSystem m_transforms;
+		EntityStorage m_storage;
+
+		// Models the entities use, resident for the lifetime of the scene
+		std::vector<ModelHandle> m_models;
+
+		struct EntityRecord
+		{
+			std::unique_ptr<Entity> entity;
+			StringId name;
+		};
 
-		std::unordered_map<std::string, std::unique_ptr<Entity>> m_entities;
+		SlotMap<EntityRecord> m_entities;
+		std::unordered_map<StringId, EntityHandle> m_entityNames;
 	};
 }
 
@@ -0,0 +1,154 @@
+#pragma once
+#include <vector>
+#include <assert.h>
+#include <stdint.h>
+#include <utility>
+
+namespace Gino
+{
+	/*
+		32 bit handle into a SlotMap: slot index in the low s_indexBits, generation above.
+		The generation of a slot changes every time its value is removed, so handles to removed values go stale instead of
+		pointing at whatever reuses the slot. Generation 0 is never used, a default handle is null.
+	*/
+	struct SlotHandle
+	{
+		static constexpr uint32_t s_indexBits = 20;		// 1M live values
+		static constexpr uint32_t s_indexMask = (1u << s_indexBits) - 1;
+		static constexpr uint32_t s_generationMask = (1u << (32 - s_indexBits)) - 1;
+
+		uint32_t value = 0;
+
+		uint32_t GetIndex() const { return value & s_indexMask; }
+		uint32_t GetGeneration() const { return value >> s_indexBits; }
+
+		explicit operator bool() const { return value != 0; }
+		bool operator==(const SlotHandle& other) const { return value == other.value; }
+		bool operator!=(const SlotHandle& other) const { return value != other.value; }
+	};
+
+	/*
+		Values in one dense array (removal swaps the last one in, so iteration is linear), found through a sparse slot
+		array in O(1): handle -> slot -> dense index. Slots are reused, the generation tells old handles apart.
+	*/
+	template <typename T>
+	class SlotMap
+	{
+	public:
+		SlotHandle Insert(T value);
+		bool Remove(SlotHandle handle);			// False for stale handles
+
+		// nullptr for stale handles
+		T* Get(SlotHandle handle);
+		const T* Get(SlotHandle handle) const;
+		bool Contains(SlotHandle handle) const;
+
+		size_t GetSize() const { return m_values.size(); }
+		SlotHandle GetHandle(size_t denseIndex) const;
+
+		// Dense iteration, the order changes on removal
+		typename std::vector<T>::iterator begin() { return m_values.begin(); }
+		typename std::vector<T>::iterator end() { return m_values.end(); }
+		typename std::vector<T>::const_iterator begin() const { return m_values.begin(); }
+		typename std::vector<T>::const_iterator end() const { return m_values.end(); }
+
+	private:
+		struct Slot
+		{
+			uint32_t dense = 0;
+			uint32_t generation = 1;
+		};
+
+		uint32_t FindDense(SlotHandle handle) const;		// ~0u if stale
+
+	private:
+		std::vector<T> m_values;
+		std::vector<uint32_t> m_valueSlots;			// Dense index -> slot
+		std::vector<Slot> m_slots;
+		std::vector<uint32_t> m_freeSlots;
+	};
+
+	template<typename T>
+	inline SlotHandle SlotMap<T>::Insert(T value)
+	{
+		uint32_t slot;
+		if (!m_freeSlots.empty())
+		{
+			slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else
+		{
+			slot = static_cast<uint32_t>(m_slots.size());
+			assert(slot <= SlotHandle::s_indexMask);
+			m_slots.emplace_back();
+		}
+
+		m_slots[slot].dense = static_cast<uint32_t>(m_values.size());
+		m_values.push_back(std::move(value));
+		m_valueSlots.push_back(slot);
+		return SlotHandle{ (m_slots[slot].generation << SlotHandle::s_indexBits) | slot };
+	}
+
+	template<typename T>
+	inline bool SlotMap<T>::Remove(SlotHandle handle)
+	{
+		const uint32_t dense = FindDense(handle);
+		if (dense == ~0u)
+			return false;
+
+		const uint32_t last = static_cast<uint32_t>(m_values.size()) - 1;
+		if (dense != last)
+		{
+			m_values[dense] = std::move(m_values[last]);
+			m_valueSlots[dense] = m_valueSlots[last];
+			m_slots[m_valueSlots[dense]].dense = dense;
+		}
+		m_values.pop_back();
+		m_valueSlots.pop_back();
+
+		// Skip 0 on wrap around so that no live handle is ever null
+		Slot& slot = m_slots[handle.GetIndex()];
+		slot.generation = (slot.generation + 1) & SlotHandle::s_generationMask;
+		if (slot.generation == 0)
+			slot.generation = 1;
+		m_freeSlots.push_back(handle.GetIndex());
+		return true;
+	}
+
+	template<typename T>
+	inline T* SlotMap<T>::Get(SlotHandle handle)
+	{
+		const uint32_t dense = FindDense(handle);
+		return dense != ~0u ? &m_values[dense] : nullptr;
+	}
+
+	template<typename T>
+	inline const T* SlotMap<T>::Get(SlotHandle handle) const
+	{
+		const uint32_t dense = FindDense(handle);
+		return dense != ~0u ? &m_values[dense] : nullptr;
+	}
+
+	template<typename T>
+	inline bool SlotMap<T>::Contains(SlotHandle handle) const
+	{
+		return FindDense(handle) != ~0u;
+	}
+
+	template<typename T>
+	inline SlotHandle SlotMap<T>::GetHandle(size_t denseIndex) const
+	{
+		const uint32_t slot = m_valueSlots[denseIndex];
+		return SlotHandle{ (m_slots[slot].generation << SlotHandle::s_indexBits) | slot };
+	}
+
+	template<typename T>
+	inline uint32_t SlotMap<T>::FindDense(SlotHandle handle) const
+	{
+		const uint32_t index = handle.GetIndex();
+		if (!handle || index >= m_slots.size() || m_slots[index].generation != handle.GetGeneration())
+			return ~0u;
+		return m_slots[index].dense;
+	}
+}
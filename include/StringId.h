@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <functional>
+
+namespace Gino
+{
+	/*
+		64 bit FNV-1a hash of a name (same hash as Utils::HashBytes), used as the key of models, textures and console commands.
+		Comparing and hashing an ID is one integer operation, and IDs of literals are computed at compile time:
+			static constexpr StringId s_sponza = "sponza";
+		Debug builds keep the names of IDs created with Register in a name table for GetName, and report hash collisions
+		between them. Only the places that make an ID a key register it, building an ID for a lookup has no side effects.
+	*/
+	class StringId
+	{
+	public:
+		constexpr StringId() = default;
+		constexpr StringId(std::string_view name) : m_hash(Hash(name)) {}
+		constexpr StringId(const char* name) : StringId(std::string_view(name)) {}
+		StringId(const std::string& name) : StringId(std::string_view(name)) {}
+
+		constexpr uint64_t GetHash() const { return m_hash; }
+		constexpr explicit operator bool() const { return m_hash != 0; }
+		constexpr bool operator==(const StringId& other) const { return m_hash == other.m_hash; }
+		constexpr bool operator!=(const StringId& other) const { return m_hash != other.m_hash; }
+
+		// The registered name, or the hash in hex if there is none (release builds, or IDs that were never registered)
+		std::string GetName() const;
+
+		// ID of name, which GetName reports in debug builds. For keys being inserted, not for lookups.
+		static StringId Register(std::string_view name);
+
+		static constexpr uint64_t Hash(std::string_view name)
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (const char c : name)
+			{
+				hash ^= static_cast<uint8_t>(c);
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+	private:
+		static void RegisterName(uint64_t hash, std::string_view name);
+
+	private:
+		uint64_t m_hash = 0;
+	};
+}
+
+template <>
+struct std::hash<Gino::StringId>
+{
+	size_t operator()(const Gino::StringId& id) const noexcept { return static_cast<size_t>(id.GetHash()); }
+};
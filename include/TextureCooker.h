@@ -0,0 +1,86 @@
+#pragma once
+#include <memory>
+
+#include "Graphics/BCEncoder.h"
+#include "Graphics/HDREncoder.h"
+#include "Graphics/DDSFile.h"
+#include "Graphics/Material.h"
+
+namespace Gino
+{
+	class ThreadPool;
+
+	struct TextureCookSettings
+	{
+		MipFilter filter = MipFilter::Kaiser;
+		bool packedAsBC7 = false;		// BC1 is usually enough for metallic/roughness, BC7 when banding shows
+		HDRFormat hdrFormat = HDRFormat::BC6H;		// .hdr sources
+	};
+
+	struct TextureCookReport
+	{
+		std::filesystem::path source;
+		std::filesystem::path cooked;
+		bool success = false;
+
+		BCFormat format = BCFormat::BC1;
+		bool hdr = false;					// .hdr source, cooked to hdrFormat instead of format
+		HDRFormat hdrFormat = HDRFormat::BC6H;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipCount = 0;
+
+		uint64_t uncompressedBytes = 0;		// RGBA8 (RGBA32F for HDR) with the same mip chain
+		uint64_t cookedBytes = 0;
+		float psnrTop = 0.f;				// Top level, over the channels the format stores. Log space PSNR for HDR (see HDRError).
+		float psnrWorst = 0.f;				// Worst level in the chain
+		float maxRelativeError = 0.f;		// HDR only, worst texel of the chain
+		float cookMs = 0.f;
+	};
+
+	/*
+		Offline texture cooker: source image -> CPU mips -> block compression -> DDS under cache/textures.
+		The format is chosen from the texture's material role:
+			Color	-> BC7				Normal	-> BC5
+			Mask	-> BC4				Packed	-> BC1 (or BC7), e.g ORM
+		Formats without an sRGB variant (BC4/BC5) fall back to BC7 for sRGB requests.
+		HDR (.hdr) sources get linear mips and are encoded to TextureCookSettings::hdrFormat (BC6H by default) by HDREncoder.
+
+		Cooked files are keyed by the source contents, the target format and sRGB, so an edited source never hits a
+		stale file and copies of a source share one. Besides the block compressed cooks, the cache also holds
+		uncompressed (RGBA8) mip chains that texture loads write on a miss, so every texture is decoded only once.
+	*/
+	class TextureCooker
+	{
+	public:
+		TextureCooker(ThreadPool* threadPool, const TextureCookSettings& settings = {});
+		~TextureCooker() = default;
+
+		TextureCookReport Cook(const std::filesystem::path& sourcePath, TextureRole role, bool srgb) const;
+		// Channel packed ORM texture (see ChannelPacker), cached under its packed path
+		TextureCookReport CookORM(const std::string& occlusionPath, const std::string& metallicRoughnessPath) const;
+
+		BCFormat SelectFormat(TextureRole role, bool srgb) const;
+
+		// Mapped cache file of a source (Utils::HashFile of its contents): the block compressed cook if there is one,
+		// else the uncompressed chain. nullptr on a miss.
+		std::unique_ptr<DDSFile> OpenCached(const std::filesystem::path& sourcePath, uint64_t sourceHash, TextureRole role, bool srgb) const;
+		static bool WriteUncompressed(const std::filesystem::path& sourcePath, uint64_t sourceHash, const MipChain& chain, bool srgb);
+
+		// Same for HDR sources: the HDR cook if there is one, else the chain a load wrote in format
+		std::unique_ptr<DDSFile> OpenCachedHDR(const std::filesystem::path& sourcePath, uint64_t sourceHash, HDRFormat format) const;
+		static bool WriteHDR(const std::filesystem::path& sourcePath, uint64_t sourceHash, const HDRTexture& texture);
+
+		static std::filesystem::path GetCachePath(const std::filesystem::path& sourcePath, uint64_t sourceHash, DXGI_FORMAT format, bool srgb);
+
+		static void PrintReport(const std::vector<TextureCookReport>& reports);
+
+	private:
+		TextureCookReport CookHDR(const std::filesystem::path& sourcePath) const;
+		TextureCookReport CookImage(const std::filesystem::path& sourcePath, uint64_t sourceHash, Utils::ImageData& image, TextureRole role, bool srgb, float readMs) const;		// Releases image
+
+	private:
+		ThreadPool* m_threadPool;
+		TextureCookSettings m_settings;
+	};
+}
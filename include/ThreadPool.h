@@ -0,0 +1,56 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <memory>
+
+namespace Gino
+{
+	// Fixed set of worker threads consuming a shared FIFO job queue.
+	// Jobs must not touch the D3D11 immediate context, that stays on the main (device) thread.
+	class ThreadPool
+	{
+	public:
+		// 0 workers = one per hardware thread, minus the calling thread
+		ThreadPool(uint32_t workerCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		template <typename Func>
+		auto Submit(Func&& func) -> std::future<decltype(func())>;
+
+		// Runs func(i) for i in [0, count) and blocks until all are done.
+		// The calling thread participates, so this is safe to call from inside a job.
+		// If func throws, the remaining items still run and the first exception is rethrown here.
+		void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+		uint32_t GetWorkerCount() const;
+
+	private:
+		void Enqueue(std::function<void()> job);
+		void WorkerLoop();
+
+	private:
+		std::vector<std::thread> m_workers;
+		std::queue<std::function<void()>> m_jobs;
+		std::mutex m_mutex;
+		std::condition_variable m_jobAvailable;
+		bool m_stop = false;
+	};
+
+	template<typename Func>
+	inline auto ThreadPool::Submit(Func&& func) -> std::future<decltype(func())>
+	{
+		using ReturnType = decltype(func());
+
+		// std::function requires copyable callables, so the task lives behind a shared_ptr
+		auto task = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<Func>(func));
+		auto future = task->get_future();
+		Enqueue([task]() { (*task)(); });
+		return future;
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <vector>
+#include <SimpleMath.h>
+
+namespace Gino
+{
+	class Transform;
+	class ThreadPool;
+
+	/*
+		Storage of every Transform in a scene, structure of arrays: position, rotation (unit quaternion) and scale each live
+		in one float array per component, so four transforms fill one SSE register per component.
+		- Transforms are slots, a released slot is reused by the next allocation (indices stay stable while in use)
+		- Setters mark the slot dirty. Update rebuilds S * R * T of the dirty slots only, four at a time, into a contiguous
+		  array of world matrices (the same matrix Transform::GetWorldMatrix used to build from Euler angles per call).
+		- Dirty slots are tracked per group of four, so a frame only touches the groups that changed
+		- A transform can have a parent, its position/rotation/scale are then relative to the parent's world matrix.
+		  Update propagates breadth first, one depth level at a time: every dirty transform of a level is final before the
+		  next level reads it, so a level is split over the thread pool with no further synchronization.
+		  Only dirty subtrees are visited (a dirty transform pulls in its children, nothing else is looked at).
+	*/
+	class TransformSystem
+	{
+	public:
+		static constexpr uint32_t s_noParent = ~0u;
+
+	public:
+		TransformSystem(ThreadPool* threadPool = nullptr);		// Without a pool every level is propagated on the calling thread
+		~TransformSystem() = default;
+
+		TransformSystem(const TransformSystem&) = delete;
+		TransformSystem& operator=(const TransformSystem&) = delete;
+
+		// Identity transform
+		uint32_t Allocate();
+		void Release(uint32_t index);		// Children of the slot become roots
+
+		// The local transform is kept as is (it is relative to the new parent from now on). s_noParent detaches.
+		// Fails if parent is index or one of its descendants.
+		bool SetParent(uint32_t index, uint32_t parent);
+		uint32_t GetParent(uint32_t index) const;
+		uint32_t GetDepth(uint32_t index) const;		// 0 for roots
+
+		void SetPosition(uint32_t index, const DirectX::SimpleMath::Vector3& position);
+		void SetRotation(uint32_t index, const DirectX::SimpleMath::Quaternion& rotation);
+		void SetScaling(uint32_t index, const DirectX::SimpleMath::Vector3& scaling);
+
+		DirectX::SimpleMath::Vector3 GetPosition(uint32_t index) const;
+		DirectX::SimpleMath::Quaternion GetRotation(uint32_t index) const;
+		DirectX::SimpleMath::Vector3 GetScaling(uint32_t index) const;
+
+		// As of the last Update
+		const DirectX::SimpleMath::Matrix& GetWorldMatrix(uint32_t index) const;
+
+		// Recomputes the world matrices of the dirty transforms and their descendants. Returns how many world matrices were computed.
+		uint32_t Update();
+
+		uint32_t GetCount() const;		// Allocated slots
+
+		// Copies the world matrices of the slots in indices into dst, straight from the world matrix array
+		// (e.g. a mapped instance buffer, written with streaming stores)
+		void CopyWorldMatrices(const uint32_t* indices, size_t count, DirectX::SimpleMath::Matrix* dst) const;
+
+		// Matrices per ms of the batched update against the per call Euler path at 100K transforms, printed to the console
+		static void RunBenchmark();
+		// Propagation through 64K transform hierarchies (wide and deep), serial against the thread pool, printed to the console
+		static void RunHierarchyBenchmark(ThreadPool* threadPool);
+
+	private:
+		void MarkDirty(uint32_t index);
+		void ComputeGroup(uint32_t group);		// Local matrices of the four transforms starting at group * 4
+		void Unlink(uint32_t index);			// From the child list of its parent
+		void UpdateDepths(uint32_t index);		// Of index and its descendants, from the parent depth
+		void PropagateLevel(uint32_t depth);	// World matrices of m_levels[depth], queues the children into the next level
+		void PropagateRange(const uint32_t* indices, size_t count, std::vector<uint32_t>& children);
+
+	private:
+		// Components, padded to a multiple of four
+		std::vector<float> m_positionX, m_positionY, m_positionZ;
+		std::vector<float> m_rotationX, m_rotationY, m_rotationZ, m_rotationW;
+		std::vector<float> m_scalingX, m_scalingY, m_scalingZ;
+
+		std::vector<DirectX::SimpleMath::Matrix> m_local;
+		std::vector<DirectX::SimpleMath::Matrix> m_world;
+
+		// Hierarchy, children as an intrusive doubly linked list so that attach and detach are O(1)
+		std::vector<uint32_t> m_parent;
+		std::vector<uint32_t> m_firstChild;
+		std::vector<uint32_t> m_nextSibling;
+		std::vector<uint32_t> m_prevSibling;
+		std::vector<uint32_t> m_depth;
+
+		// Update scratch: dirty transforms by depth, and whether a transform is already queued
+		std::vector<std::vector<uint32_t>> m_levels;
+		std::vector<std::vector<uint32_t>> m_chunkChildren;		// Per thread pool chunk of a level
+		std::vector<uint8_t> m_queued;
+		ThreadPool* m_threadPool;
+
+		std::vector<uint8_t> m_groupDirtyMask;		// Per group of four, one bit per transform
+		std::vector<uint32_t> m_dirtyGroups;		// Groups with a non zero mask
+		std::vector<uint32_t> m_freeSlots;
+		uint32_t m_slotCount = 0;
+		uint32_t m_allocatedCount = 0;
+	};
+}
@@ -3,12 +3,65 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <string_view>
+
+namespace Gino
+{
+	class ThreadPool;
+}
 
 namespace Gino::Utils
 {
 	std::string WstrToStr(std::wstring str);
 	std::wstring StrToWstr(std::string str);
 	std::vector<uint8_t> ReadFile(const std::filesystem::path& filePath);
+
+	// 64-bit FNV-1a. Used for cache keys (not cryptographic)
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+	uint64_t HashFile(const std::filesystem::path& filePath, uint64_t seed = 14695981039346656037ull);
+
+	// "<stem of namedAfter>_<hash as 16 hex digits><extension>", for cache files that read like their source in logs
+	std::string HashedFileName(const std::filesystem::path& namedAfter, uint64_t hash, std::string_view extension);
+
+	// Creates the parent directories and writes through a temporary file that is renamed over filePath once complete,
+	// so that an interrupted write never leaves a valid looking file behind. Safe to call concurrently for the same file, the
+	// last complete write wins. Failures are logged under owner.
+	bool WriteFileAtomic(const std::filesystem::path& filePath, const std::function<void(std::ofstream&)>& write, std::string_view owner);
+
+	// IEEE half precision. FloatToHalf rounds to nearest even and clamps to the largest finite half (65504) instead of overflowing to inf
+	uint16_t FloatToHalf(float value);
+	float HalfToFloat(uint16_t value);
+
+	bool IsPowerOfTwo(uint32_t value);
+	uint32_t CalcMipCount(uint32_t size);		// Levels from size down to 1, 0 for size 0
+
+	// Runs func(begin, end) over [0, rowCount) in jobs of rowsPerJob rows on the pool, or in one call without a pool
+	void ForRows(ThreadPool* threadPool, uint32_t rowCount, uint32_t rowsPerJob, const std::function<void(uint32_t, uint32_t)>& func);
+
+	// Read-only memory mapped view of a whole file. Unmapped on destruction.
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool Open(const std::filesystem::path& filePath);
+		void Close();
+
+		const uint8_t* GetData() const;
+		size_t GetSize() const;
+
+	private:
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+	};
 	
 	struct ImageData
 	{
@@ -0,0 +1,70 @@
+// ForwardPBR_VS for Vertex_Compact input (see VertexCompressor.h), same output so it pairs with ForwardPBR_PS
+struct VS_INPUT
+{
+    float4 pos : POSITION;          // xyz: UNORM in the mesh AABB, w: bitangent sign (0 or 1)
+    float2 uv : TEXCOORD;
+    float2 normal : NORMAL;         // Octahedral
+    float2 tangent : TANGENT;       // Octahedral
+	
+    float4 wm_row0 : INSTANCE_WM_ROW0;
+    float4 wm_row1 : INSTANCE_WM_ROW1;
+    float4 wm_row2 : INSTANCE_WM_ROW2;
+    float4 wm_row3 : INSTANCE_WM_ROW3;
+
+};
+
+struct VS_OUT
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD;
+	float3 normal : NORMAL;
+    float3 worldPos : WORLDPOS;
+    
+    float3 tangent : TANGENT;
+    float3 bitangent : BITANGENT;
+};
+
+cbuffer CB_PerFrame : register(b0)
+{
+    matrix view;
+    matrix projection;
+    float3 cameraPosition;
+    
+}
+
+cbuffer CB_PerMesh : register(b2)
+{
+    float4 positionOffset;
+    float4 positionScale;
+    matrix nodeTransform;       // Mesh space -> model space
+}
+
+float3 OctDecode(float2 p)
+{
+    float3 n = float3(p.x, p.y, 1.f - abs(p.x) - abs(p.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.f ? -t : t;
+    return normalize(n);
+}
+
+VS_OUT main(VS_INPUT input)
+{
+	VS_OUT output = (VS_OUT)0;
+	
+    matrix worldMat = matrix(input.wm_row0, input.wm_row1, input.wm_row2, input.wm_row3);
+    worldMat = mul(transpose(worldMat), nodeTransform);
+
+    float3 pos = positionOffset.xyz + input.pos.xyz * positionScale.xyz;
+    float3 normal = OctDecode(input.normal);
+    float3 tangent = OctDecode(input.tangent);
+    float bitangentSign = input.pos.w > 0.5f ? 1.f : -1.f;
+
+    output.worldPos = mul(worldMat, float4(pos, 1.f)).xyz;
+    output.pos = mul(projection, mul(view, float4(output.worldPos, 1.f)));
+    output.normal = normalize(mul(worldMat, float4(normal, 0.f)).xyz);
+    output.tangent = normalize(mul(worldMat, float4(tangent, 0.f)).xyz);
+    output.bitangent = cross(output.normal, output.tangent) * bitangentSign;
+    output.uv = input.uv;
+	
+	return output;
+}
@@ -17,15 +17,19 @@ struct SB_PointLight
 
 
 Texture2D albedoTex : register(t0);
-Texture2D metallicAndRoughnessTex : register(t1);
+Texture2D ormTex : register(t1);            // glTF layout: occlusion in R, roughness in G, metalness in B (ChannelPacker)
 Texture2D normalTex : register(t2);
-Texture2D aoTex : register(t3);
-Texture2D emissionTex : register(t4);
+Texture2D emissionTex : register(t3);
+
+// Image based lighting (IBLBaker)
+TextureCube specularIBL : register(t5);     // GGX prefiltered environment, mip = roughness * iblSpecularMaxMip
+Texture2D brdfLut : register(t6);           // Split sum scale and bias of F0 over (NdotV, roughness)
 
 StructuredBuffer<SB_PointLight> pointLightList : register(t7);
 
 SamplerState mainSampler : register(s0);
 SamplerState pointSampler : register(s1);
+SamplerState iblSampler : register(s2);
 
 cbuffer CB_PerFrame : register(b0)      // To retrive the camera position
 {
@@ -36,6 +40,13 @@ cbuffer CB_PerFrame : register(b0)      // To retrive the camera position
     // Temp
     float normalMapOn;
     float aoTexOn;
+    float iblOn;
+    float iblSpecularMaxMip;
+}
+
+cbuffer CB_IBL : register(b3)
+{
+    float4 irradianceSH[9];     // Cosine convolved SH9 irradiance of the environment
 }
 
 const static float PI = 3.1415f;
@@ -47,6 +58,8 @@ float DistributionGGX(float3 N, float3 H, float roughness);
 float GeometrySchlickGGX(float NdotV, float roughness);
 float GeometrySmith(float3 N, float3 V, float3 L, float roughness);
 float3 fresnelSchlick(float cosTheta, float3 F0);
+float3 fresnelSchlickRoughness(float cosTheta, float3 F0, float roughness);
+float3 EvaluateIrradiance(float3 N);
 
 float4 main(PS_IN input) : SV_TARGET
 {
@@ -56,9 +69,10 @@ float4 main(PS_IN input) : SV_TARGET
     //float aoInput = g_ao;
     
     float3 albedoInput = albedoTex.Sample(mainSampler, input.uv).xyz;
-    float metallicInput = metallicAndRoughnessTex.Sample(mainSampler, input.uv).b;
-    float roughnessInput = metallicAndRoughnessTex.Sample(mainSampler, input.uv).g;
-    float aoInput = aoTex.Sample(mainSampler, input.uv).r;
+    float3 orm = ormTex.Sample(mainSampler, input.uv).rgb;
+    float aoInput = orm.r;
+    float roughnessInput = orm.g;
+    float metallicInput = orm.b;
     
     //return float4(albedo, 1.f);
     //return float4(roughnessInput.xxx, 1.f);
@@ -142,6 +156,22 @@ float4 main(PS_IN input) : SV_TARGET
     
     
     float3 ambient = float3(0.03f, 0.03f, 0.03f) * albedoInput * aoInput * aoTexOn;
+    if (iblOn > 0.5f)
+    {
+        // Split sum: SH irradiance for diffuse, prefiltered environment and BRDF LUT for specular
+        float NdotV = max(dot(N, V), 0.0);
+        float3 F = fresnelSchlickRoughness(NdotV, F0, roughnessInput);
+        float3 kD = (float3(1.f, 1.f, 1.f) - F) * (1.0 - metallicInput);
+        float3 diffuse = EvaluateIrradiance(N) * albedoInput / PI;
+        
+        float3 R = reflect(-V, N);
+        float3 prefiltered = specularIBL.SampleLevel(iblSampler, R, roughnessInput * iblSpecularMaxMip).rgb;
+        float2 envBRDF = brdfLut.SampleLevel(iblSampler, float2(NdotV, roughnessInput), 0).rg;
+        float3 specular = prefiltered * (F * envBRDF.x + envBRDF.y);
+        
+        float ao = lerp(1.f, aoInput, aoTexOn);
+        ambient = (kD * diffuse + specular) * ao;
+    }
     float3 color = ambient + Lo;
     
     //return float4(ambient, 1.f);
@@ -171,7 +201,9 @@ float3 GetFinalNormal(float3 tangent, float3 bitangent, float3 inputNormal, floa
     tbn = transpose(tbn);
     
     // Normal map is in [0, 1] space so we need to transform it to [-1, 1] space
-    float3 mappedSpaceNor = normalize(tanSpaceNor * 2.f - 1.f);
+    // Z is rebuilt from XY so that two channel (BC5) normal maps work too
+    float2 mappedXY = tanSpaceNor.xy * 2.f - 1.f;
+    float3 mappedSpaceNor = normalize(float3(mappedXY, sqrt(saturate(1.f - dot(mappedXY, mappedXY)))));
     
     // Orient the tangent space correctly in world space
     float3 mapNorWorld = normalize(mul(tbn, mappedSpaceNor));
@@ -223,4 +255,24 @@ float GeometrySmith(float3 N, float3 V, float3 L, float roughness)
 float3 fresnelSchlick(float cosTheta, float3 F0)
 {
     return F0 + (1.0 - F0) * pow(max(1.0 - cosTheta, 0.0), 5.0);
+}
+
+// Fresnel for ambient light, rough surfaces reflect less at grazing angles
+float3 fresnelSchlickRoughness(float cosTheta, float3 F0, float roughness)
+{
+    return F0 + (max(float3(1.0 - roughness, 1.0 - roughness, 1.0 - roughness), F0) - F0) * pow(max(1.0 - cosTheta, 0.0), 5.0);
+}
+
+float3 EvaluateIrradiance(float3 N)
+{
+    float3 irradiance = irradianceSH[0].rgb * 0.282095f;
+    irradiance += irradianceSH[1].rgb * 0.488603f * N.y;
+    irradiance += irradianceSH[2].rgb * 0.488603f * N.z;
+    irradiance += irradianceSH[3].rgb * 0.488603f * N.x;
+    irradiance += irradianceSH[4].rgb * 1.092548f * N.x * N.y;
+    irradiance += irradianceSH[5].rgb * 1.092548f * N.y * N.z;
+    irradiance += irradianceSH[6].rgb * 0.315392f * (3.f * N.z * N.z - 1.f);
+    irradiance += irradianceSH[7].rgb * 1.092548f * N.x * N.z;
+    irradiance += irradianceSH[8].rgb * 0.546274f * (N.x * N.x - N.y * N.y);
+    return max(irradiance, 0.f);
 }
\ No newline at end of file
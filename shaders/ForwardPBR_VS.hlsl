@@ -37,12 +37,19 @@ cbuffer CB_PerObject : register(b1)
     matrix model;
 }
 
+cbuffer CB_PerMesh : register(b2)
+{
+    float4 positionOffset;      // Compact vertices only
+    float4 positionScale;
+    matrix nodeTransform;       // Mesh space -> model space
+}
+
 VS_OUT main(VS_INPUT input)
 {
 	VS_OUT output = (VS_OUT)0;
 	
     matrix worldMat = matrix(input.wm_row0, input.wm_row1, input.wm_row2, input.wm_row3);
-    worldMat = transpose(worldMat);
+    worldMat = mul(transpose(worldMat), nodeTransform);
 
 	//output.pos = float4(input.pos, 1.f);
 	//output.uv = input.uv;
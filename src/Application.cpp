@@ -166,7 +166,7 @@ namespace Gino
 		// The only lock needed will be on popping the queue and pushing to the queue.
 		// This means we would need to make a SharedQueue structure which lets us push and pop in a thread-safe manner
 		// If we do want some function to happen asynchronously (e.g Model Loading), then we can dispatch threads for that and handle that specifically
-		auto it = std::find_if(m_consoleCommands.begin(), m_consoleCommands.end(), [&input](const auto& command) { return command.first == input; });
+		auto it = m_consoleCommands.find(input);
 		if (it != m_consoleCommands.end())
 		{
 			std::cout << "Command: '" << input << "' success!\n";
@@ -193,10 +193,23 @@ namespace Gino
 	{
 		// Init functions
 		auto appKillCommand = [this]() { KillApp(); };
+		auto cookTexturesCommand = [this]() { if (m_engine) m_engine->CookTextures(); };
+		auto packAssetsCommand = [this]() { if (m_engine) m_engine->PackAssets(); };
+		auto benchRenderListCommand = []() { RenderList::RunBenchmark(); };
+		auto benchTransformsCommand = []() { TransformSystem::RunBenchmark(); };
+		auto benchEntitiesCommand = []() { EntityStorage::RunBenchmark(); };
+		auto benchHierarchyCommand = [this]() { if (m_engine) TransformSystem::RunHierarchyBenchmark(m_engine->GetThreadPool()); };
 
 		// Assign functions
-		m_consoleCommands.insert({ "q", appKillCommand });
-		m_consoleCommands.insert({ "quit", appKillCommand });
+		auto addCommand = [this](std::string_view name, std::function<void()> action) { m_consoleCommands.insert({ StringId::Register(name), std::move(action) }); };
+		addCommand("q", appKillCommand);
+		addCommand("quit", appKillCommand);
+		addCommand("cook_textures", cookTexturesCommand);
+		addCommand("pack_assets", packAssetsCommand);
+		addCommand("bench_render_list", benchRenderListCommand);
+		addCommand("bench_transforms", benchTransformsCommand);
+		addCommand("bench_entities", benchEntitiesCommand);
+		addCommand("bench_hierarchy", benchHierarchyCommand);
 	}
 
 	void Application::KillApp()
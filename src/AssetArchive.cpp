@@ -0,0 +1,678 @@
+#include "pch.h"
+#include "AssetArchive.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <unordered_set>
+
+namespace Gino
+{
+	struct AssetArchive::PackEntry
+	{
+		uint64_t pathHash;			// Utils::HashBytes of the lower case path
+		uint64_t contentHash;		// Utils::HashBytes of the original bytes
+		uint64_t offset;
+		uint64_t storedSize;
+		uint64_t size;
+		uint32_t pathOffset;		// Into the string table
+		uint32_t pathLength;
+		uint32_t flags;
+		uint32_t padding;
+	};
+
+	namespace
+	{
+		constexpr uint32_t s_packMagic = 0x4B415047;		// 'GPAK'
+		constexpr uint32_t s_packVersion = 1;
+		constexpr uint64_t s_dataAlignment = 16;
+		constexpr uint32_t s_entryCompressed = 1u << 0;
+
+		struct PackHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t entryCount;
+			uint32_t padding;
+			uint64_t tocOffset;
+			uint64_t stringTableOffset;
+			uint64_t stringTableSize;
+		};
+
+		// LZ4 block format constants
+		constexpr size_t s_minMatch = 4;
+		constexpr size_t s_lastLiterals = 5;			// The last 5 bytes are always literals
+		constexpr size_t s_matchStartMargin = 12;		// The last match starts at least 12 bytes before the end
+		constexpr size_t s_maxOffset = 0xFFFF;
+		constexpr uint32_t s_hashBits = 12;
+
+		std::unique_ptr<AssetArchive> s_mounted;
+
+		std::atomic<bool> s_statsEnabled{ false };
+		std::atomic<uint64_t> s_archiveReads{ 0 };
+		std::atomic<uint64_t> s_archiveBytes{ 0 };
+		std::atomic<uint64_t> s_decompressedBytes{ 0 };
+		std::atomic<uint64_t> s_looseReads{ 0 };
+		std::atomic<uint64_t> s_looseBytes{ 0 };
+		std::atomic<uint64_t> s_readMicroseconds{ 0 };
+		std::atomic<uint64_t> s_decompressMicroseconds{ 0 };
+
+		uint64_t ToMicroseconds(float seconds)
+		{
+			return static_cast<uint64_t>(seconds * 1000000.f);
+		}
+
+		char ToLower(char c)
+		{
+			return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+		}
+
+		std::string ToLower(std::string str)
+		{
+			for (char& c : str)
+				c = ToLower(c);
+			return str;
+		}
+
+		bool EqualsNoCase(const char* a, size_t aLength, const std::string& b)
+		{
+			if (aLength != b.size())
+				return false;
+			for (size_t i = 0; i < aLength; ++i)
+			{
+				if (ToLower(a[i]) != ToLower(b[i]))
+					return false;
+			}
+			return true;
+		}
+
+		uint64_t HashPath(const std::string& path)
+		{
+			const std::string lower = ToLower(path);
+			return Utils::HashBytes(lower.data(), lower.size());
+		}
+
+		std::filesystem::path MakeAbsolute(const std::filesystem::path& path)
+		{
+			std::error_code ec;
+			const auto absolute = std::filesystem::absolute(path, ec);
+			return (ec ? path : absolute).lexically_normal();
+		}
+
+		// Path of filePath relative to the (absolute, normal) root in archive form, false if it is not under root
+		bool MakeEntryPath(const std::filesystem::path& root, const std::filesystem::path& filePath, std::string& entryPath)
+		{
+			const auto relative = MakeAbsolute(filePath).lexically_relative(root);
+			if (relative.empty() || *relative.begin() == ".." || relative == ".")
+				return false;
+
+			entryPath = relative.generic_string();
+			return true;
+		}
+
+		bool ReadLooseFile(const std::filesystem::path& filePath, std::vector<uint8_t>& data)
+		{
+			std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+			if (!file.is_open())
+				return false;
+
+			data.resize(static_cast<size_t>(file.tellg()));
+			file.seekg(0);
+			file.read((char*)data.data(), data.size());
+			return static_cast<bool>(file);
+		}
+
+		// Already entropy coded, not worth the time to try
+		bool IsCompressible(const std::filesystem::path& filePath)
+		{
+			const std::string extension = ToLower(filePath.extension().string());
+			return extension != ".jpg" && extension != ".jpeg" && extension != ".png";
+		}
+
+		uint32_t Load32(const uint8_t* src)
+		{
+			uint32_t value;
+			std::memcpy(&value, src, sizeof(value));
+			return value;
+		}
+
+		uint32_t HashSequence(uint32_t sequence)
+		{
+			return (sequence * 2654435761u) >> (32 - s_hashBits);
+		}
+
+		// Remainder of a length whose token nibble is saturated (15)
+		void WriteLength(std::vector<uint8_t>& out, size_t length)
+		{
+			length -= 15;
+			for (; length >= 255; length -= 255)
+				out.push_back(255);
+			out.push_back(static_cast<uint8_t>(length));
+		}
+
+		void WriteSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+		{
+			const size_t matchCode = matchLength - s_minMatch;
+			out.push_back(static_cast<uint8_t>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15)));
+			if (literalLength >= 15)
+				WriteLength(out, literalLength);
+			out.insert(out.end(), literals, literals + literalLength);
+
+			out.push_back(static_cast<uint8_t>(offset & 0xFF));
+			out.push_back(static_cast<uint8_t>(offset >> 8));
+			if (matchCode >= 15)
+				WriteLength(out, matchCode);
+		}
+
+		void WriteLastLiterals(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLength)
+		{
+			out.push_back(static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4));
+			if (literalLength >= 15)
+				WriteLength(out, literalLength);
+			out.insert(out.end(), literals, literals + literalLength);
+		}
+
+		// Length continuation bytes (255 means another byte follows)
+		bool ReadLength(const uint8_t* src, size_t srcSize, size_t& in, size_t& length)
+		{
+			uint8_t byte = 255;
+			while (byte == 255)
+			{
+				if (in >= srcSize)
+					return false;
+				byte = src[in++];
+				length += byte;
+			}
+			return true;
+		}
+	}
+
+	bool AssetArchive::Open(const std::filesystem::path& archivePath, const std::filesystem::path& mountPoint)
+	{
+		Close();
+
+		if (!m_file.Open(archivePath))
+			return false;
+
+		const uint8_t* base = m_file.GetData();
+		const uint64_t fileSize = m_file.GetSize();
+
+		PackHeader header{};
+		if (fileSize >= sizeof(header))
+			std::memcpy(&header, base, sizeof(header));
+
+		const bool validHeader = fileSize >= sizeof(header) && header.magic == s_packMagic && header.version == s_packVersion &&
+			header.tocOffset % alignof(PackEntry) == 0 && header.tocOffset <= fileSize &&
+			header.entryCount <= (fileSize - header.tocOffset) / sizeof(PackEntry) &&
+			header.stringTableOffset <= fileSize && header.stringTableSize <= fileSize - header.stringTableOffset;
+		if (!validHeader)
+		{
+			std::cout << "Gino::AssetArchive : Invalid archive: " << archivePath << "\n";
+			m_file.Close();
+			return false;
+		}
+
+		const PackEntry* entries = reinterpret_cast<const PackEntry*>(base + header.tocOffset);
+		for (uint32_t i = 0; i < header.entryCount; ++i)
+		{
+			const PackEntry& entry = entries[i];
+			const bool validEntry = entry.offset <= fileSize && entry.storedSize <= fileSize - entry.offset &&
+				(uint64_t)entry.pathOffset + entry.pathLength <= header.stringTableSize &&
+				((entry.flags & s_entryCompressed) || entry.storedSize == entry.size);
+			if (!validEntry)
+			{
+				std::cout << "Gino::AssetArchive : Truncated archive: " << archivePath << "\n";
+				m_file.Close();
+				return false;
+			}
+		}
+
+		m_archivePath = archivePath;
+		m_mountPoint = MakeAbsolute(mountPoint);
+		m_entries = entries;
+		m_entryCount = header.entryCount;
+		m_stringTable = reinterpret_cast<const char*>(base + header.stringTableOffset);
+		m_stringTableSize = header.stringTableSize;
+		return true;
+	}
+
+	void AssetArchive::Close()
+	{
+		m_file.Close();
+		m_archivePath.clear();
+		m_mountPoint.clear();
+		m_entries = nullptr;
+		m_entryCount = 0;
+		m_stringTable = nullptr;
+		m_stringTableSize = 0;
+	}
+
+	const AssetArchive::PackEntry* AssetArchive::Find(const std::filesystem::path& filePath) const
+	{
+		std::string entryPath;
+		if (m_entryCount == 0 || !MakeEntryPath(m_mountPoint, filePath, entryPath))
+			return nullptr;
+
+		const uint64_t pathHash = HashPath(entryPath);
+		const PackEntry* end = m_entries + m_entryCount;
+		const PackEntry* it = std::lower_bound(m_entries, end, pathHash, [](const PackEntry& entry, uint64_t hash) { return entry.pathHash < hash; });
+		for (; it != end && it->pathHash == pathHash; ++it)
+		{
+			if (EqualsNoCase(m_stringTable + it->pathOffset, it->pathLength, entryPath))
+				return it;
+		}
+		return nullptr;
+	}
+
+	bool AssetArchive::Contains(const std::filesystem::path& filePath) const
+	{
+		return Find(filePath) != nullptr;
+	}
+
+	bool AssetArchive::GetContentHash(const std::filesystem::path& filePath, uint64_t& hash) const
+	{
+		const PackEntry* entry = Find(filePath);
+		if (!entry)
+			return false;
+
+		hash = entry->contentHash;
+		return true;
+	}
+
+	bool AssetArchive::Read(const std::filesystem::path& filePath, AssetView& view) const
+	{
+		const bool stats = s_statsEnabled;
+		Timer readTimer;
+
+		const PackEntry* entry = Find(filePath);
+		if (!entry)
+			return false;
+
+		const uint8_t* stored = m_file.GetData() + entry->offset;
+		view.owned.clear();
+		if (entry->flags & s_entryCompressed)
+		{
+			Timer decompressTimer;
+			view.owned.resize(entry->size);
+			if (!Decompress(stored, entry->storedSize, view.owned.data(), view.owned.size()))
+			{
+				std::cout << "Gino::AssetArchive : Corrupt entry " << filePath << " in " << m_archivePath << "\n";
+				view.owned.clear();
+				return false;
+			}
+			view.data = view.owned.data();
+
+			if (stats)
+			{
+				s_decompressedBytes += entry->size;
+				s_decompressMicroseconds += ToMicroseconds(decompressTimer.TimeElapsed());
+			}
+		}
+		else
+		{
+			view.data = stored;
+		}
+		view.size = static_cast<size_t>(entry->size);
+
+		if (stats)
+		{
+			++s_archiveReads;
+			s_archiveBytes += entry->storedSize;
+			s_readMicroseconds += ToMicroseconds(readTimer.TimeElapsed());
+		}
+		return true;
+	}
+
+	std::vector<std::filesystem::path> AssetArchive::GetFilesIn(const std::filesystem::path& directory) const
+	{
+		std::vector<std::filesystem::path> files;
+
+		std::string prefix;
+		if (MakeEntryPath(m_mountPoint, directory, prefix))
+			prefix += "/";
+		else if (MakeAbsolute(directory) != m_mountPoint)
+			return files;
+
+		for (uint32_t i = 0; i < m_entryCount; ++i)
+		{
+			const PackEntry& entry = m_entries[i];
+			const std::string entryPath(m_stringTable + entry.pathOffset, entry.pathLength);
+			if (entryPath.size() > prefix.size() && EqualsNoCase(entryPath.data(), prefix.size(), prefix) &&
+				entryPath.find('/', prefix.size()) == std::string::npos)
+			{
+				files.push_back(directory / entryPath.substr(prefix.size()));
+			}
+		}
+		return files;
+	}
+
+	const std::filesystem::path& AssetArchive::GetArchivePath() const
+	{
+		return m_archivePath;
+	}
+
+	uint32_t AssetArchive::GetEntryCount() const
+	{
+		return m_entryCount;
+	}
+
+	AssetPackReport AssetArchive::Pack(const std::filesystem::path& rootDir, const std::filesystem::path& archivePath, const AssetPackSettings& settings)
+	{
+		Timer packTimer;
+		AssetPackReport report;
+
+		const auto root = MakeAbsolute(rootDir);
+		const auto archiveAbsolute = MakeAbsolute(archivePath);
+
+		// Sorted so that the same tree always produces the same archive
+		std::vector<std::pair<std::string, std::filesystem::path>> files;
+		std::error_code ec;
+		for (const auto& dirEntry : std::filesystem::recursive_directory_iterator(root, ec))
+		{
+			if (!dirEntry.is_regular_file())
+				continue;
+
+			const auto absolute = MakeAbsolute(dirEntry.path());
+			std::string entryPath;
+			if (absolute.parent_path() == archiveAbsolute.parent_path() && absolute.filename().string().starts_with(archiveAbsolute.filename().string() + "."))
+				continue;		// Our own temporary/.new files when packing into the root
+			if (absolute != archiveAbsolute && MakeEntryPath(root, absolute, entryPath))
+				files.emplace_back(entryPath, absolute);
+		}
+		if (ec)
+		{
+			std::cout << "Gino::AssetArchive : Could not read directory: " << rootDir << " (" << ec.message() << ")\n";
+			return report;
+		}
+		std::sort(files.begin(), files.end());
+
+		// Packing over the mounted archive would change it under its mapping: write a pending archive that Mount picks up
+		std::filesystem::path targetPath = archivePath;
+		if (s_mounted && MakeAbsolute(s_mounted->GetArchivePath()) == archiveAbsolute)
+			targetPath += ".new";
+
+		const bool written = Utils::WriteFileAtomic(targetPath, [&](std::ofstream& file)
+			{
+				const auto padTo = [&file](uint64_t alignment)
+				{
+					static const char zeros[s_dataAlignment] = {};
+					const uint64_t position = static_cast<uint64_t>(file.tellp());
+					file.write(zeros, (alignment - position % alignment) % alignment);
+				};
+
+				PackHeader header{};
+				file.write((const char*)&header, sizeof(header));
+
+				std::vector<PackEntry> entries;
+				std::vector<std::string> entryPaths;
+				std::unordered_set<std::string> packedPaths;
+				std::vector<uint8_t> data;
+				std::vector<uint8_t> compressed;
+				for (const auto& [entryPath, sourcePath] : files)
+				{
+					if (!ReadLooseFile(sourcePath, data))
+					{
+						std::cout << "Gino::AssetArchive : Could not read file: " << sourcePath << "\n";
+						continue;
+					}
+
+					// The Windows file system is case insensitive, so is the lookup
+					if (!packedPaths.insert(ToLower(entryPath)).second)
+					{
+						std::cout << "Gino::AssetArchive : Skipping " << entryPath << " (differs from another file only by case)\n";
+						continue;
+					}
+
+					PackEntry entry{};
+					entry.pathHash = HashPath(entryPath);
+					entry.contentHash = Utils::HashBytes(data.data(), data.size());
+					entry.size = data.size();
+
+					const uint8_t* stored = data.data();
+					entry.storedSize = data.size();
+					if (settings.compress && data.size() >= settings.minCompressBytes && data.size() <= UINT32_MAX && IsCompressible(sourcePath))
+					{
+						Compress(data.data(), data.size(), compressed);
+						if (compressed.size() <= data.size() - data.size() / 8)
+						{
+							stored = compressed.data();
+							entry.storedSize = compressed.size();
+							entry.flags |= s_entryCompressed;
+							++report.compressedFiles;
+						}
+					}
+
+					padTo(s_dataAlignment);
+					entry.offset = static_cast<uint64_t>(file.tellp());
+					file.write((const char*)stored, entry.storedSize);
+
+					entries.push_back(entry);
+					entryPaths.push_back(entryPath);
+					report.sourceBytes += entry.size;
+				}
+
+				// Table of contents sorted by path hash for binary search, paths in entry order
+				std::vector<uint32_t> order(entries.size());
+				for (uint32_t i = 0; i < order.size(); ++i)
+					order[i] = i;
+				std::sort(order.begin(), order.end(), [&entries](uint32_t a, uint32_t b) { return entries[a].pathHash < entries[b].pathHash; });
+
+				std::string stringTable;
+				std::vector<PackEntry> toc;
+				toc.reserve(entries.size());
+				for (const uint32_t index : order)
+				{
+					PackEntry entry = entries[index];
+					entry.pathOffset = static_cast<uint32_t>(stringTable.size());
+					entry.pathLength = static_cast<uint32_t>(entryPaths[index].size());
+					stringTable += entryPaths[index];
+					toc.push_back(entry);
+				}
+
+				padTo(s_dataAlignment);
+				header.magic = s_packMagic;
+				header.version = s_packVersion;
+				header.entryCount = static_cast<uint32_t>(toc.size());
+				header.tocOffset = static_cast<uint64_t>(file.tellp());
+				file.write((const char*)toc.data(), toc.size() * sizeof(PackEntry));
+
+				header.stringTableOffset = static_cast<uint64_t>(file.tellp());
+				header.stringTableSize = stringTable.size();
+				file.write(stringTable.data(), stringTable.size());
+
+				report.archiveBytes = static_cast<uint64_t>(file.tellp());
+				report.files = header.entryCount;
+
+				file.seekp(0);
+				file.write((const char*)&header, sizeof(header));
+			}, "AssetArchive");
+		if (!written)
+		{
+			report = {};
+			return report;
+		}
+
+		report.packMs = packTimer.TimeElapsed() * 1000.f;
+		std::cout << "Gino::AssetArchive : Packed " << report.files << " files (" << report.compressedFiles << " compressed) from " << rootDir << " into " << targetPath
+			<< " | " << report.sourceBytes / 1024 << " KB -> " << report.archiveBytes / 1024 << " KB | " << report.packMs << " ms\n";
+		if (targetPath != archivePath)
+			std::cout << "Gino::AssetArchive : " << archivePath << " is mounted, the new archive replaces it on the next start\n";
+		return report;
+	}
+
+	bool AssetArchive::Mount(const std::filesystem::path& archivePath, const std::filesystem::path& mountPoint)
+	{
+		Unmount();
+
+		std::error_code ec;
+		auto pendingPath = archivePath;
+		pendingPath += ".new";
+		if (std::filesystem::exists(pendingPath, ec))
+		{
+			std::filesystem::rename(pendingPath, archivePath, ec);
+			if (ec)
+				std::cout << "Gino::AssetArchive : Could not replace " << archivePath << " with " << pendingPath << " (" << ec.message() << ")\n";
+		}
+
+		if (!std::filesystem::exists(archivePath, ec))
+			return false;
+
+		auto archive = std::make_unique<AssetArchive>();
+		if (!archive->Open(archivePath, mountPoint))
+			return false;
+
+		std::cout << "Gino::AssetArchive : Mounted " << archivePath << " (" << archive->GetEntryCount() << " files) over " << mountPoint << "\n";
+		s_mounted = std::move(archive);
+		return true;
+	}
+
+	void AssetArchive::Unmount()
+	{
+		s_mounted.reset();
+	}
+
+	const AssetArchive* AssetArchive::GetMounted()
+	{
+		return s_mounted.get();
+	}
+
+	bool AssetArchive::ReadAsset(const std::filesystem::path& filePath, AssetView& view)
+	{
+		if (s_mounted && s_mounted->Read(filePath, view))
+			return true;
+
+		Timer readTimer;
+		if (!ReadLooseFile(filePath, view.owned))
+		{
+			view = {};
+			return false;
+		}
+		view.data = view.owned.data();
+		view.size = view.owned.size();
+
+		if (s_statsEnabled)
+		{
+			++s_looseReads;
+			s_looseBytes += view.size;
+			s_readMicroseconds += ToMicroseconds(readTimer.TimeElapsed());
+		}
+		return true;
+	}
+
+	void AssetArchive::SetStatisticsEnabled(bool enabled)
+	{
+		s_statsEnabled = enabled;
+	}
+
+	bool AssetArchive::IsStatisticsEnabled()
+	{
+		return s_statsEnabled;
+	}
+
+	AssetIOStats AssetArchive::GetStatistics()
+	{
+		AssetIOStats stats;
+		stats.archiveReads = s_archiveReads;
+		stats.archiveBytes = s_archiveBytes;
+		stats.decompressedBytes = s_decompressedBytes;
+		stats.looseReads = s_looseReads;
+		stats.looseBytes = s_looseBytes;
+		stats.readMs = s_readMicroseconds / 1000.f;
+		stats.decompressMs = s_decompressMicroseconds / 1000.f;
+		return stats;
+	}
+
+	void AssetArchive::Compress(const uint8_t* src, size_t size, std::vector<uint8_t>& out)
+	{
+		out.clear();
+		out.reserve(size + size / 255 + 16);
+
+		// Greedy single probe matcher: position of the last occurrence of each hashed 4 byte sequence
+		std::vector<uint32_t> table(1u << s_hashBits, 0);
+		size_t anchor = 0;
+		size_t pos = 1;
+		const size_t matchLimit = size > s_lastLiterals ? size - s_lastLiterals : 0;
+		while (pos + s_matchStartMargin <= size)
+		{
+			const uint32_t sequence = Load32(src + pos);
+			uint32_t& slot = table[HashSequence(sequence)];
+			const size_t candidate = slot;
+			slot = static_cast<uint32_t>(pos);
+
+			if (pos - candidate > s_maxOffset || Load32(src + candidate) != sequence)
+			{
+				++pos;
+				continue;
+			}
+
+			size_t matchStart = pos;
+			size_t reference = candidate;
+			while (matchStart > anchor && reference > 0 && src[matchStart - 1] == src[reference - 1])
+			{
+				--matchStart;
+				--reference;
+			}
+
+			size_t matchEnd = pos + s_minMatch;
+			for (size_t ref = candidate + s_minMatch; matchEnd < matchLimit && src[matchEnd] == src[ref]; ++ref)
+				++matchEnd;
+
+			WriteSequence(out, src + anchor, matchStart - anchor, pos - candidate, matchEnd - matchStart);
+			pos = anchor = matchEnd;
+		}
+
+		WriteLastLiterals(out, src + anchor, size - anchor);
+	}
+
+	bool AssetArchive::Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+	{
+		size_t in = 0;
+		size_t out = 0;
+		while (in < srcSize)
+		{
+			const uint8_t token = src[in++];
+
+			size_t literalLength = token >> 4;
+			if (literalLength == 15 && !ReadLength(src, srcSize, in, literalLength))
+				return false;
+			if (literalLength > srcSize - in || literalLength > dstSize - out)
+				return false;
+			std::memcpy(dst + out, src + in, literalLength);
+			in += literalLength;
+			out += literalLength;
+
+			// The last sequence has no match
+			if (in == srcSize)
+				break;
+
+			if (srcSize - in < 2)
+				return false;
+			const size_t offset = src[in] | (static_cast<size_t>(src[in + 1]) << 8);
+			in += 2;
+			if (offset == 0 || offset > out)
+				return false;
+
+			size_t matchLength = token & 15;
+			if (matchLength == 15 && !ReadLength(src, srcSize, in, matchLength))
+				return false;
+			matchLength += s_minMatch;
+			if (matchLength > dstSize - out)
+				return false;
+
+			// Matches may overlap their own output (offset < length repeats a pattern)
+			const uint8_t* reference = dst + out - offset;
+			if (offset >= matchLength)
+				std::memcpy(dst + out, reference, matchLength);
+			else
+			{
+				for (size_t i = 0; i < matchLength; ++i)
+					dst[out + i] = reference[i];
+			}
+			out += matchLength;
+		}
+		return out == dstSize;
+	}
+}
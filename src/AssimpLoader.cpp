@@ -1,58 +1,147 @@
 #include "pch.h"
 #include "AssimpLoader.h"
+#include "AssetArchive.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/MemoryIOWrapper.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
 
 
 namespace Gino
 {
-	AssimpLoader::AssimpLoader(const std::filesystem::path& filePath, bool PBR) :
+	namespace
+	{
+		constexpr size_t s_streamingBatchBytes = 8 * 1024 * 1024;		// Output written per batch before converted meshes are released
+
+		// Bytes of the per-vertex and face arrays of a mesh, which is what dominates the size of an aiScene
+		size_t GetMeshBytes(const aiMesh* mesh)
+		{
+			size_t vertexBytes = 0;
+			vertexBytes += mesh->mVertices ? sizeof(aiVector3D) : 0;
+			vertexBytes += mesh->mNormals ? sizeof(aiVector3D) : 0;
+			vertexBytes += mesh->mTangents ? sizeof(aiVector3D) : 0;
+			vertexBytes += mesh->mBitangents ? sizeof(aiVector3D) : 0;
+			for (unsigned int i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++i)
+				vertexBytes += mesh->mTextureCoords[i] ? sizeof(aiVector3D) : 0;
+			for (unsigned int i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; ++i)
+				vertexBytes += mesh->mColors[i] ? sizeof(aiColor4D) : 0;
+
+			size_t bytes = vertexBytes * mesh->mNumVertices + sizeof(aiFace) * mesh->mNumFaces;
+			for (unsigned int i = 0; mesh->mFaces && i < mesh->mNumFaces; ++i)
+				bytes += sizeof(unsigned int) * mesh->mFaces[i].mNumIndices;
+			return bytes;
+		}
+
+		// The aiMesh destructor copes with null arrays, so this leaves a valid (empty) mesh behind
+		void ReleaseMeshArrays(aiMesh* mesh)
+		{
+			delete[] mesh->mVertices;
+			delete[] mesh->mNormals;
+			delete[] mesh->mTangents;
+			delete[] mesh->mBitangents;
+			mesh->mVertices = mesh->mNormals = mesh->mTangents = mesh->mBitangents = nullptr;
+			for (unsigned int i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++i)
+			{
+				delete[] mesh->mTextureCoords[i];
+				mesh->mTextureCoords[i] = nullptr;
+			}
+			for (unsigned int i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; ++i)
+			{
+				delete[] mesh->mColors[i];
+				mesh->mColors[i] = nullptr;
+			}
+			delete[] mesh->mFaces;
+			mesh->mFaces = nullptr;
+			mesh->mNumFaces = 0;
+		}
+
+		// Serves files from the mounted asset archive (model + buffers + material libraries), the rest from disk
+		class ArchiveIOSystem : public Assimp::DefaultIOSystem
+		{
+		public:
+			ArchiveIOSystem(const AssetArchive* archive) :
+				m_archive(archive)
+			{
+			}
+
+			bool Exists(const char* pFile) const override
+			{
+				return m_archive->Contains(pFile) || Assimp::DefaultIOSystem::Exists(pFile);
+			}
+
+			Assimp::IOStream* Open(const char* pFile, const char* pMode = "rb") override
+			{
+				AssetView view;
+				if (std::strchr(pMode, 'w') || !m_archive->Read(pFile, view))
+					return Assimp::DefaultIOSystem::Open(pFile, pMode);
+
+				// Stored entries stay in the mapping, decompressed ones are handed over to the stream
+				if (view.owned.empty())
+					return new Assimp::MemoryIOStream(view.data, view.size);
+
+				uint8_t* buffer = new uint8_t[view.size];
+				std::memcpy(buffer, view.data, view.size);
+				return new Assimp::MemoryIOStream(buffer, view.size, true);
+			}
+
+		private:
+			const AssetArchive* m_archive;
+		};
+	}
+
+	AssimpLoader::AssimpLoader(const std::filesystem::path& filePath, bool PBR, bool streaming, ImportMemoryStats* memoryStats, ThreadPool* threadPool) :
+		m_PBR(PBR),
+		m_streaming(streaming),
 		m_filePath(filePath),
-		m_PBR(PBR)
+		m_memoryStats(memoryStats),
+		m_threadPool(threadPool)
 	{
 		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(
-			filePath.relative_path().string().c_str(),
-			aiProcess_Triangulate |
-			
-			// For Direct3D
-			aiProcess_ConvertToLeftHanded |
-			//aiProcess_FlipUVs |					// (0, 0) is top left
-			//aiProcess_FlipWindingOrder |		// D3D front face is CW
-
-			aiProcess_GenSmoothNormals |
-			aiProcess_CalcTangentSpace
-		);
-
-		// === WARNING - There are two place that use this directory
-		// One is here in Grab materials, but there is a duplicate in ProcessMesh!!!
-		const std::string directory = filePath.parent_path().string() + "/";
+		if (const AssetArchive* archive = AssetArchive::GetMounted())
+			importer.SetIOHandler(new ArchiveIOSystem(archive));		// Owned by the importer
+		importer.ReadFile(filePath.relative_path().string().c_str(), s_importFlags);
+
+		// Take ownership of the scene so that streaming can release mesh arrays as it goes
+		std::unique_ptr<aiScene> scene(importer.GetOrphanedScene());
+
+		m_directory = filePath.parent_path().string() + "/";
 
 		if (scene == nullptr)
 		{
-			std::cout << "Gino::AssimpLoader : File not found!\n";
-			assert(false);
+			std::cout << "Gino::AssimpLoader : Could not import " << filePath << " (" << importer.GetErrorString() << ")\n";
+			return;
 		}
+		m_loaded = true;
 
-		// Pre-allocate memory for resources
-		unsigned int totalVertexCount = 0;
-		unsigned int totalSubsetCount = 0;
-		for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
-		{
-			totalVertexCount += scene->mMeshes[i]->mNumVertices;
-		}
+		// First pass: the node hierarchy, and subsets in node order with their output ranges. A mesh referenced by several
+		// nodes is emitted once per reference, each subset keeps the transform of its node.
+		m_meshReferences.assign(scene->mNumMeshes, 0);
+		CollectNodes(scene.get());
 
-		m_vertices.reserve(totalVertexCount);
-		m_indices.reserve(totalVertexCount);
-		m_subsets.reserve(scene->mNumMeshes);
+		m_sceneBytes = 0;
+		for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+			m_sceneBytes += GetMeshBytes(scene->mMeshes[i]);
+		if (m_memoryStats)
+			m_memoryStats->Allocate(m_sceneBytes);
 
-		// Grab materials
+		// Reserved, not touched: output pages become resident as batches are sized
+		m_vertices.reserve(m_meshVertexCount);
+		m_indices.reserve(m_meshIndexCount);
 
+		// Grab materials once. Identical materials are merged and subsets refer to the result by index (see ConvertMeshes).
+		m_materialRemap.reserve(scene->mNumMaterials);
 		if (!PBR)
 		{
 			m_materials.reserve(scene->mNumMaterials);
 			for (unsigned int i = 0; i < scene->mNumMaterials; ++i)
 			{
 				auto mtl = scene->mMaterials[i];
-				aiString diffPath, norPath, opacityPath, specularPath, bruh;
+				aiString diffPath, norPath, opacityPath, specularPath;
 				mtl->GetTexture(aiTextureType_DIFFUSE, 0, &diffPath);
 
 				aiReturn norRet = mtl->GetTexture(aiTextureType_NORMALS, 0, &norPath);
@@ -61,15 +150,13 @@ namespace Gino
 
 				mtl->GetTexture(aiTextureType_OPACITY, 0, &opacityPath);
 				mtl->GetTexture(aiTextureType_SPECULAR, 0, &specularPath);
-				mtl->GetTexture(aiTextureType_UNKNOWN, 0, &bruh);
-
 
 				AssimpMaterialPaths matPaths;
-				matPaths.diffuseFilePath = (diffPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + diffPath.C_Str()));
-				matPaths.normalFilePath = (norPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + norPath.C_Str()));
-				matPaths.opacityFilePath = (opacityPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + opacityPath.C_Str()));
-				matPaths.specularFilePath = (specularPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + specularPath.C_Str()));
-				m_materials.push_back(matPaths);
+				matPaths.diffuse = InternTexturePath(diffPath);
+				matPaths.normal = InternTexturePath(norPath);
+				matPaths.opacity = InternTexturePath(opacityPath);
+				matPaths.specular = InternTexturePath(specularPath);
+				AddMaterial(matPaths, m_materials);
 			}
 		}
 		else
@@ -79,7 +166,7 @@ namespace Gino
 			for (unsigned int i = 0; i < scene->mNumMaterials; ++i)
 			{
 				auto mtl = scene->mMaterials[i];
-				aiString albedoPath, norPath, metallicPath, roughnessPath, aoPath, emissionPath;
+				aiString albedoPath, norPath, metallicAndRoughnessPath, aoPath, emissionPath;
 
 				mtl->GetTexture(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_BASE_COLOR_TEXTURE, &albedoPath);
 
@@ -87,8 +174,7 @@ namespace Gino
 				if (norRet != aiReturn_SUCCESS)
 					mtl->GetTexture(aiTextureType_HEIGHT, 0, &norPath);
 
-				mtl->GetTexture(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLICROUGHNESS_TEXTURE, &metallicPath);
-				mtl->GetTexture(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLICROUGHNESS_TEXTURE, &roughnessPath);
+				mtl->GetTexture(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLICROUGHNESS_TEXTURE, &metallicAndRoughnessPath);
 				//mtl->GetTexture(aiTextureType_AMBIENT_OCCLUSION, 0, &aoPath);
 				mtl->GetTexture(aiTextureType_LIGHTMAP, 0, &aoPath);
 				mtl->GetTexture(aiTextureType_EMISSIVE, 0, &emissionPath);
@@ -102,11 +188,11 @@ namespace Gino
 
 
 				AssimpMaterialPathsPBR matPaths;
-				matPaths.albedo = (albedoPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + albedoPath.C_Str()));
-				matPaths.normal = (norPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + norPath.C_Str()));
-				matPaths.metallicAndRoughness = (metallicPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + metallicPath.C_Str()));
-				matPaths.ao = (aoPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + aoPath.C_Str()));
-				matPaths.emission = (emissionPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + emissionPath.C_Str()));
+				matPaths.albedo = InternTexturePath(albedoPath);
+				matPaths.normal = InternTexturePath(norPath);
+				matPaths.metallicAndRoughness = InternTexturePath(metallicAndRoughnessPath);
+				matPaths.ao = InternTexturePath(aoPath);
+				matPaths.emission = InternTexturePath(emissionPath);
 				
 				mtl->Get("$mat.gltf.pbrMetallicRoughness.baseColorFactor", 0, 0, matPaths.baseColorFactor.x);
 				mtl->Get("$mat.gltf.pbrMetallicRoughness.baseColorFactor", 0, 1, matPaths.baseColorFactor.y);
@@ -115,19 +201,23 @@ namespace Gino
 				mtl->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLIC_FACTOR, matPaths.metallicAndRoughnessFactor.x);
 				mtl->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_ROUGHNESS_FACTOR, matPaths.metallicAndRoughnessFactor.y);
 
-				m_materialsPBR.push_back(matPaths);
+				AddMaterial(matPaths, m_materialsPBR);
 			}
 		}
 
-		
-
+		std::cout << "Gino::AssimpLoader : " << scene->mNumMaterials << " materials (" << (PBR ? m_materialsPBR.size() : m_materials.size()) << " unique), "
+			<< m_texturePaths.size() << " texture paths\n";
 
+		// Second pass
+		ConvertMeshes(scene.get());
 
-		// Start processing
-		ProcessNode(scene->mRootNode, scene);
+		scene.reset();
+		if (m_memoryStats)
+			m_memoryStats->Release(m_sceneBytes);
+		m_sceneBytes = 0;
  	}
 
-	const std::vector<AssimpVertex>& AssimpLoader::GetVertices() const
+	const std::vector<Vertex_POS_UV_NORMAL>& AssimpLoader::GetVertices() const
 	{
 		return m_vertices;
 	}
@@ -137,154 +227,206 @@ namespace Gino
 		return m_indices;
 	}
 
+	std::vector<Vertex_POS_UV_NORMAL> AssimpLoader::TakeVertices()
+	{
+		return std::move(m_vertices);
+	}
+
+	std::vector<uint32_t> AssimpLoader::TakeIndices()
+	{
+		return std::move(m_indices);
+	}
+
 	const std::vector<AssimpMeshSubset>& AssimpLoader::GetSubsets() const
 	{
 		return m_subsets;
 	}
 
+	const std::vector<AssimpNode>& AssimpLoader::GetNodes() const
+	{
+		return m_nodes;
+	}
+
 	const std::vector<AssimpMaterialPaths>& AssimpLoader::GetMaterials() const
 	{
 		return m_materials;
 	}
 
+	bool AssimpLoader::IsLoaded() const
+	{
+		return m_loaded;
+	}
+
 	const std::vector<AssimpMaterialPathsPBR>& AssimpLoader::GetMaterialsPBR() const
 	{
 		return m_materialsPBR;
 	}
 
-	void AssimpLoader::ProcessMesh(aiMesh* mesh, const aiScene* scene)
+	const std::vector<std::string>& AssimpLoader::GetTexturePaths() const
 	{
-		for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
-		{
-			AssimpVertex vert{};
-			vert.position = mesh->mVertices[i];
-			//vert.position[0] = mesh->mVertices[i].x;
-			//vert.position[1] = mesh->mVertices[i].y;
-			//vert.position[2] = mesh->mVertices[i].z;
+		return m_texturePaths;
+	}
 
-			vert.normal = mesh->mNormals[i];
-			//vert.normal[0] = mesh->mNormals[i].x;
-			//vert.normal[1] = mesh->mNormals[i].y;
-			//vert.normal[2] = mesh->mNormals[i].z;
+	uint32_t AssimpLoader::InternTexturePath(const aiString& path)
+	{
+		if (path.length == 0)
+			return AssimpMaterialPaths::s_noTexture;
 
-			if (mesh->mTextureCoords[0])
-			{
-				vert.uv.x = mesh->mTextureCoords[0][i].x;
-				vert.uv.y = mesh->mTextureCoords[0][i].y;
-			}
+		const auto [it, inserted] = m_texturePathIndices.try_emplace(m_directory + path.C_Str(), static_cast<uint32_t>(m_texturePaths.size()));
+		if (inserted)
+			m_texturePaths.push_back(it->first);
+		return it->second;
+	}
 
-			if (mesh->mTangents)
-				vert.tangent = mesh->mTangents[i];
-			if (mesh->mBitangents)
-				vert.bitangent = mesh->mBitangents[i];
+	template <typename T>
+	void AssimpLoader::AddMaterial(const T& material, std::vector<T>& materials)
+	{
+		// Material counts are small next to subset counts, a linear search is fine
+		const auto it = std::find(materials.begin(), materials.end(), material);
+		m_materialRemap.push_back(static_cast<uint32_t>(it - materials.begin()));
+		if (it == materials.end())
+			materials.push_back(material);
+	}
 
-			m_vertices.push_back(vert);
-		}
+	// aiMatrix4x4 is row major for column vectors, ours take row vectors: transposed
+	static DirectX::SimpleMath::Matrix ToMatrix(const aiMatrix4x4& m)
+	{
+		return DirectX::SimpleMath::Matrix(
+			m.a1, m.b1, m.c1, m.d1,
+			m.a2, m.b2, m.c2, m.d2,
+			m.a3, m.b3, m.c3, m.d3,
+			m.a4, m.b4, m.c4, m.d4);
+	}
 
-		unsigned int indicesThisMesh = 0;
-		for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
+	void AssimpLoader::CollectNodes(const aiScene* scene)
+	{
+		// The source nodes double as the queue, children are appended as their parent is visited
+		std::vector<const aiNode*> sourceNodes{ scene->mRootNode };
+		m_nodes.push_back(AssimpNode{ .parent = AssimpNode::s_noParent, .transform = ToMatrix(scene->mRootNode->mTransformation) });
+		for (uint32_t nodeIndex = 0; nodeIndex < sourceNodes.size(); ++nodeIndex)
 		{
-			aiFace face = mesh->mFaces[i];
-
-			for (unsigned int j = 0; j < face.mNumIndices; ++j)
+			const aiNode* node = sourceNodes[nodeIndex];
+			for (unsigned int i = 0; i < node->mNumMeshes; ++i)
 			{
-				m_indices.push_back(face.mIndices[j]);
-				++indicesThisMesh;
+				const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+				unsigned int indexCount = 0;
+				for (unsigned int f = 0; f < mesh->mNumFaces; ++f)
+					indexCount += mesh->mFaces[f].mNumIndices;
+
+				AssimpMeshSubset subsetData{};
+				subsetData.vertexStart = m_meshVertexCount;
+				subsetData.vertexCount = mesh->mNumVertices;
+				subsetData.indexStart = m_meshIndexCount;
+				subsetData.indexCount = indexCount;
+				subsetData.materialIndex = mesh->mMaterialIndex;		// Remapped once the materials are deduplicated
+				subsetData.node = nodeIndex;
+				m_subsets.push_back(subsetData);
+				m_meshOrder.push_back(node->mMeshes[i]);
+
+				m_meshVertexCount += mesh->mNumVertices;
+				m_meshIndexCount += indexCount;
+				++m_meshReferences[node->mMeshes[i]];
 			}
 
+			for (unsigned int i = 0; i < node->mNumChildren; ++i)
+			{
+				sourceNodes.push_back(node->mChildren[i]);
+				m_nodes.push_back(AssimpNode{ .parent = nodeIndex, .transform = ToMatrix(node->mChildren[i]->mTransformation) });
+			}
 		}
+	}
 
-		// Init subset (verts first
-		AssimpMeshSubset subsetData{};
-		subsetData.vertexStart = m_meshVertexCount;
-		m_meshVertexCount += mesh->mNumVertices;
+	void AssimpLoader::ConvertMeshes(aiScene* scene)
+	{
+		for (auto& subset : m_subsets)
+			subset.materialIndex = m_materialRemap[subset.materialIndex];
+
+		// Every subset writes its own range only, so a batch converts in any order (and in parallel) with the same result.
+		// Without streaming everything is one batch.
+		Timer convertTimer;
+		uint32_t batchCount = 0;
+		uint32_t batchBegin = 0;
+		const uint32_t subsetCount = static_cast<uint32_t>(m_subsets.size());
+		while (batchBegin < subsetCount)
+		{
+			uint32_t batchEnd = batchBegin;
+			size_t batchBytes = 0;
+			do
+			{
+				batchBytes += m_subsets[batchEnd].vertexCount * sizeof(Vertex_POS_UV_NORMAL) + m_subsets[batchEnd].indexCount * sizeof(uint32_t);
+				++batchEnd;
+			} while (batchEnd < subsetCount && (!m_streaming || batchBytes < s_streamingBatchBytes));
+
+			// Grows within the reservation, earlier batches stay in place
+			const AssimpMeshSubset& last = m_subsets[batchEnd - 1];
+			m_vertices.resize(last.vertexStart + last.vertexCount);
+			m_indices.resize(last.indexStart + last.indexCount);
+			if (m_memoryStats)
+				m_memoryStats->Allocate(batchBytes);
+
+			auto convert = [this, scene, batchBegin](uint32_t i)
+			{
+				const uint32_t subset = batchBegin + i;
+				ConvertMesh(scene->mMeshes[m_meshOrder[subset]], m_subsets[subset]);
+			};
+			if (m_threadPool)
+				m_threadPool->ParallelFor(batchEnd - batchBegin, convert);
+			else
+			{
+				for (uint32_t i = 0; i < batchEnd - batchBegin; ++i)
+					convert(i);
+			}
 
-		subsetData.indexCount = indicesThisMesh;
-		subsetData.indexStart = m_meshIndexCount;
-		m_meshIndexCount += indicesThisMesh;
+			// Streaming: the source arrays go as soon as the last reference to the mesh is converted
+			for (uint32_t subset = batchBegin; m_streaming && subset < batchEnd; ++subset)
+			{
+				if (--m_meshReferences[m_meshOrder[subset]] > 0)
+					continue;
+
+				aiMesh* mesh = scene->mMeshes[m_meshOrder[subset]];
+				const size_t meshBytes = GetMeshBytes(mesh);
+				ReleaseMeshArrays(mesh);
+				m_sceneBytes -= meshBytes;
+				if (m_memoryStats)
+					m_memoryStats->Release(meshBytes);
+			}
 
+			batchBegin = batchEnd;
+			++batchCount;
+		}
 
-		const std::string directory = m_filePath.parent_path().string() + "/";
+		std::cout << "Gino::AssimpLoader : " << subsetCount << " meshes converted in " << convertTimer.TimeElapsed() * 1000.f << " ms ("
+			<< (m_threadPool ? std::to_string(m_threadPool->GetWorkerCount() + 1) + " threads" : std::string("serial")) << ", " << batchCount << " batches)\n";
+	}
 
-		// Get Phong Material
-		if (!m_PBR)
+	void AssimpLoader::ConvertMesh(const aiMesh* mesh, const AssimpMeshSubset& subset)
+	{
+		// Written straight into our input layout
+		Vertex_POS_UV_NORMAL* vertices = m_vertices.data() + subset.vertexStart;
+		for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
 		{
-			auto mtl = scene->mMaterials[mesh->mMaterialIndex];
-			aiString diffPath, norPath, opacityPath, specularPath;
-			mtl->GetTexture(aiTextureType_DIFFUSE, 0, &diffPath);
+			Vertex_POS_UV_NORMAL vertex{};
+			vertex.pos = { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
 
-			aiReturn norRet = mtl->GetTexture(aiTextureType_NORMALS, 0, &norPath);
-			if (norRet != aiReturn_SUCCESS)
-				mtl->GetTexture(aiTextureType_HEIGHT, 0, &norPath);
+			if (mesh->mNormals)
+				vertex.normal = { mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z };
 
-			mtl->GetTexture(aiTextureType_OPACITY, 0, &opacityPath);
-			mtl->GetTexture(aiTextureType_SPECULAR, 0, &specularPath);
+			if (mesh->mTextureCoords[0])
+				vertex.uv = { mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y };
 
-			// Subset data
-			AssimpMaterialPaths matPaths;
-			matPaths.diffuseFilePath = (diffPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + diffPath.C_Str()));
-			matPaths.normalFilePath = (norPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + norPath.C_Str()));
-			matPaths.opacityFilePath = (opacityPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + opacityPath.C_Str()));
-			matPaths.specularFilePath = (specularPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + specularPath.C_Str()));
+			if (mesh->mTangents)
+				vertex.tangent = { mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z };
+			if (mesh->mBitangents)
+				vertex.bitangent = { mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z };
 
-			subsetData.mats = matPaths;
-		}
-		// Get PBR material
-		else
-		{
-			auto mtl = scene->mMaterials[mesh->mMaterialIndex];
-			aiString albedoPath, norPath, metallicAndRoughnessPath, aoPath, emissionPath;
-
-			mtl->GetTexture(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_BASE_COLOR_TEXTURE, &albedoPath);
-
-			aiReturn norRet = mtl->GetTexture(aiTextureType_NORMALS, 0, &norPath);
-			if (norRet != aiReturn_SUCCESS)
-				mtl->GetTexture(aiTextureType_HEIGHT, 0, &norPath);
-
-			mtl->GetTexture(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLICROUGHNESS_TEXTURE, &metallicAndRoughnessPath);
-		//	mtl->GetTexture(aiTextureType_AMBIENT_OCCLUSION, 0, &aoPath);
-			mtl->GetTexture(aiTextureType_LIGHTMAP, 0, &aoPath);
-			mtl->GetTexture(aiTextureType_EMISSIVE, 0, &emissionPath);
-
-			// Test
-			//aiString paths[aiTextureType_UNKNOWN];
-			//for (int x = 0; x < aiTextureType_UNKNOWN; ++x)
-			//{
-			//	mtl->GetTexture((aiTextureType)(x + 1), 0, &paths[x]);
-			//}
-
-			AssimpMaterialPathsPBR matPaths;
-			matPaths.albedo = (albedoPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + albedoPath.C_Str()));
-			matPaths.normal = (norPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + norPath.C_Str()));
-			matPaths.metallicAndRoughness = (metallicAndRoughnessPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + metallicAndRoughnessPath.C_Str()));
-			matPaths.ao = (aoPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + aoPath.C_Str()));
-			matPaths.emission = (emissionPath.length == 0) ? std::nullopt : std::optional<std::string>(std::string(directory + emissionPath.C_Str()));
-
-			mtl->Get("$mat.gltf.pbrMetallicRoughness.baseColorFactor", 0, 0, matPaths.baseColorFactor.x);
-			mtl->Get("$mat.gltf.pbrMetallicRoughness.baseColorFactor", 0, 1, matPaths.baseColorFactor.y);
-			mtl->Get("$mat.gltf.pbrMetallicRoughness.baseColorFactor", 0, 2, matPaths.baseColorFactor.z);
-
-			mtl->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLIC_FACTOR, matPaths.metallicAndRoughnessFactor.x);
-			mtl->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_ROUGHNESS_FACTOR, matPaths.metallicAndRoughnessFactor.y);
-
-			subsetData.mats = matPaths;
+			vertices[i] = vertex;
 		}
 
-
-
-		m_subsets.push_back(subsetData);
-	}
-
-	void AssimpLoader::ProcessNode(aiNode* node, const aiScene* scene)
-	{
-		for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+		uint32_t* indices = m_indices.data() + subset.indexStart;
+		for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
 		{
-			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-			ProcessMesh(mesh, scene);
+			const aiFace& face = mesh->mFaces[i];
+			indices = std::copy(face.mIndices, face.mIndices + face.mNumIndices, indices);
 		}
-
-		for (unsigned int i = 0; i < node->mNumChildren; ++i)
-			ProcessNode(node->mChildren[i], scene);
 	}
-
 }
@@ -1,23 +1,106 @@
 #include "pch.h"
 #include "Component.h"
+#include "TransformSystem.h"
+
+#include <utility>
 
 namespace Gino
 {
-	Transform::Transform() :
-		Component(ComponentType::TransformType)
+	Transform::Transform(TransformSystem* system) :
+		Component(ComponentType::TransformType),
+		m_system(system),
+		m_index(system->Allocate())
+	{
+	}
+
+	Transform::~Transform()
+	{
+		if (m_index != s_noSlot)
+			m_system->Release(m_index);
+	}
+
+	Transform::Transform(Transform&& other) noexcept :
+		Component(ComponentType::TransformType),
+		m_system(other.m_system),
+		m_index(std::exchange(other.m_index, s_noSlot))
+	{
+	}
+
+	Transform& Transform::operator=(Transform&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (m_index != s_noSlot)
+				m_system->Release(m_index);
+			m_system = other.m_system;
+			m_index = std::exchange(other.m_index, s_noSlot);
+		}
+		return *this;
+	}
+
+	void Transform::SetPosition(const DirectX::SimpleMath::Vector3& position)
+	{
+		m_system->SetPosition(m_index, position);
+	}
+
+	void Transform::SetRotation(const DirectX::SimpleMath::Vector3& eulerDegrees)
+	{
+		m_system->SetRotation(m_index, EulerToQuaternion(eulerDegrees));
+	}
+
+	void Transform::SetRotation(const DirectX::SimpleMath::Quaternion& rotation)
+	{
+		m_system->SetRotation(m_index, rotation);
+	}
+
+	void Transform::SetScaling(const DirectX::SimpleMath::Vector3& scaling)
+	{
+		m_system->SetScaling(m_index, scaling);
+	}
+
+	DirectX::SimpleMath::Vector3 Transform::GetPosition() const
 	{
+		return m_system->GetPosition(m_index);
 	}
 
-	DirectX::SimpleMath::Matrix Transform::GetWorldMatrix() const
+	DirectX::SimpleMath::Quaternion Transform::GetRotation() const
 	{
-		auto T = DirectX::XMMatrixTranslation(m_position.x, m_position.y, m_position.z);
-		auto R = DirectX::XMMatrixRotationRollPitchYaw(
-			DirectX::XMConvertToRadians(m_rotation.x),
-			DirectX::XMConvertToRadians(m_rotation.y), 
-			DirectX::XMConvertToRadians(m_rotation.z));
-		auto S = DirectX::XMMatrixScalingFromVector(m_scaling);
+		return m_system->GetRotation(m_index);
+	}
+
+	DirectX::SimpleMath::Vector3 Transform::GetScaling() const
+	{
+		return m_system->GetScaling(m_index);
+	}
+
+	bool Transform::SetParent(const Transform* parent)
+	{
+		assert(parent == nullptr || parent->m_system == m_system);
+		return m_system->SetParent(m_index, parent ? parent->m_index : TransformSystem::s_noParent);
+	}
 
-		return S * R * T;
+	bool Transform::HasParent() const
+	{
+		return m_system->GetParent(m_index) != TransformSystem::s_noParent;
+	}
+
+	const DirectX::SimpleMath::Matrix& Transform::GetWorldMatrix() const
+	{
+		return m_system->GetWorldMatrix(m_index);
+	}
+
+	uint32_t Transform::GetIndex() const
+	{
+		return m_index;
+	}
+
+	DirectX::SimpleMath::Quaternion Transform::EulerToQuaternion(const DirectX::SimpleMath::Vector3& eulerDegrees)
+	{
+		// Same rotation as XMMatrixRotationRollPitchYaw(x, y, z)
+		return DirectX::SimpleMath::Quaternion::CreateFromYawPitchRoll(
+			DirectX::XMConvertToRadians(eulerDegrees.y),
+			DirectX::XMConvertToRadians(eulerDegrees.x),
+			DirectX::XMConvertToRadians(eulerDegrees.z));
 	}
 
 	uint32_t Component::GetBit() const
@@ -4,6 +4,7 @@
 #include "Graphics/DXDevice.h"
 #include "Graphics/Renderer.h"
 #include "AssimpLoader.h"
+#include "MeshCache.h"
 #include "Input.h"
 #include "FPCamera.h"
 
@@ -15,14 +16,114 @@
 #include "Scene.h"
 
 #include "Timer.h"
+#include "ThreadPool.h"
+#include "Graphics/MipGenerator.h"
+#include "Graphics/DDSFile.h"
+#include "Graphics/Material.h"
+#include "TextureCooker.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "Graphics/VertexCompressor.h"
+#include "Graphics/TextureStreamer.h"
+#include "Graphics/ChannelPacker.h"
+#include "AssetArchive.h"
+
+#include <unordered_set>
+#include <algorithm>
 
 namespace Gino
 {
-	Engine::Engine(Settings& settings)
+	namespace
 	{
+		const std::filesystem::path assetRootPath = "../assets";
+		const std::string defaultDiffuseFilePath = "../assets/Textures/Default/defaultdiffuse.jpg";
+		const std::string defaultSpecularFilePath = "../assets/Textures/Default/defaultspecular.jpg";
+		const std::string defaultOpacityFilePath = "../assets/Textures/Default/defaultopacity.jpg";
+		const std::string defaultNormalFilePath = "../assets/Textures/Default/defaultnormal.jpg";
+
+		bool IsHDRSource(const std::string& filePath)
+		{
+			return std::filesystem::path(filePath).extension() == ".hdr";		// Packed ORM paths end in .orm
+		}
+
+		size_t CalcFloatBytes(uint32_t width, uint32_t height, uint32_t mipCount)
+		{
+			size_t bytes = 0;
+			for (uint32_t mip = 0; mip < mipCount; ++mip)
+				bytes += (size_t)std::max(width >> mip, 1u) * std::max(height >> mip, 1u) * 4 * sizeof(float);
+			return bytes;
+		}
+	}
+
+	// Output of the decode stage, waiting for upload on the device thread
+	struct Engine::DecodedTextures
+	{
+		std::vector<TextureRequest> requests;		// Unique and not resident when decoded
+		std::vector<MipChain> chains;
+		std::vector<std::unique_ptr<DDSFile>> cookedFiles;		// Set for textures that come from the cooked texture cache (no chain then)
+		std::vector<HDRTexture> hdrTextures;		// Encoded chains of decoded .hdr sources (no chain then)
+		std::vector<TextureHandle> resident;		// Requested textures that were already resident, pinned until the model holds them
+		float decodeMs = 0.f;
+		uint32_t cacheHits = 0;
+		uint32_t cacheMisses = 0;
+
+		// Level 0 errors of the HDR textures encoded here (Settings::ioStatistics only)
+		std::vector<HDRError> hdrErrors;
+		uint32_t hdrMeasured = 0;
+		float hdrWorstLogPSNR = 0.f;
+		float hdrMeanRelativeErrorSum = 0.f;
+		float hdrMaxRelativeError = 0.f;
+	};
+
+	// One model load: ImportModel fills everything up to the GPU resources (any thread), FinalizeModel creates those (device thread)
+	struct Engine::ModelLoadJob
+	{
+		std::filesystem::path filePath;
+		bool PBR = false;
+		ModelHandle model;								// Placeholder handed out by CreateModel/CreateModelAsync
+		std::function<void(Model*)> onResident;
+		Timer timer;
+
+		// Points into the mapped cache on a hit, into the owned buffers below after an import
+		ModelImportData data;
+		MeshCache cache;
+		bool fromCache = false;
+		bool failed = false;							// Import failed, the model stays an empty placeholder
+		std::vector<Vertex_POS_UV_NORMAL> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<MeshCluster> clusters;
+		std::vector<MeshLod> lods;
+		std::vector<float> uvDensities;					// Per subset, see Mesh::uvDensity
+		ImportMemoryStats memoryStats;
+
+		DecodedTextures textures;
+
+		// Vertex_Compact encoding (PBR only, empty when disabled)
+		std::vector<Vertex_Compact> compactVertices;
+		std::vector<PositionQuantization> quantizations;
+
+		std::future<void> cpuStage;						// Async loads only
+	};
+
+	Engine::Engine(Settings& settings) :
+		m_textures(static_cast<size_t>(settings.textureCacheBudgetMB) * 1024 * 1024, [this](StringId, Texture* texture) { m_renderer->GetTextureStreamer()->Remove(texture); }),
+		m_models(static_cast<size_t>(settings.modelCacheBudgetMB) * 1024 * 1024),
+		m_compactVertices(settings.compactVertices),
+		m_streamingImport(settings.streamingImport),
+		m_parallelImport(settings.parallelImport),
+		m_textureStreaming(settings.textureStreaming),
+		m_ioStatistics(settings.ioStatistics),
+		m_assetArchive(settings.assetArchive)
+	{
+		// Before anything loads (the renderer loads the skybox)
+		AssetArchive::SetStatisticsEnabled(settings.ioStatistics);
+		AssetArchive::Mount(m_assetArchive, assetRootPath);
+
+		m_threadPool = std::make_unique<ThreadPool>();
 		m_input = std::make_unique<Input>(settings.hwnd);
 		m_dxDev = std::make_unique<DXDevice>(settings.hwnd, settings.resolutionWidth, settings.resolutionHeight);
-		m_renderer = std::make_unique<Renderer>(m_dxDev.get(), settings.vsync);
+		m_renderer = std::make_unique<Renderer>(m_dxDev.get(), settings.vsync, TextureStreamingSettings{ .budgetBytes = static_cast<size_t>(settings.textureBudgetMB) * 1024 * 1024 }, m_threadPool.get());
 
 		m_fpCam = std::make_unique<FPCamera>((float)settings.resolutionWidth / settings.resolutionHeight, 87.f);
 		m_renderer->SetRenderCamera(m_fpCam.get());
@@ -30,13 +131,17 @@ namespace Gino
 
 	Engine::~Engine()
 	{
+		// Import jobs reference the engine, let them finish before anything is torn down
+		for (const auto& job : m_pendingModels)
+			job->cpuStage.wait();
 
+		AssetArchive::Unmount();
 	}
 
 	void Engine::SetScene(Scene* scene)
 	{
 		m_scene = scene;
-		m_renderer->SetModels(m_scene->GetModelInstances());
+		m_renderer->SetModels(m_scene->GetModelInstances(), m_scene->GetTransforms());
 	}
 
 	void Engine::SimulateAndRender(float dt)
@@ -68,6 +173,49 @@ namespace Gino
 		ImGui::Text("Total Engine CPU %s ms", std::to_string(dt).c_str());
 		ImGui::End();
 
+		ImGui::Begin("Load Statistics");
+		ImGui::Text("Textures loaded %u (%u worker threads)", m_loadStats.texturesLoaded, m_threadPool->GetWorkerCount());
+		ImGui::Text("Textures from cooked files %u", m_loadStats.texturesFromCooked);
+		const uint32_t cacheLookups = m_loadStats.textureCacheHits + m_loadStats.textureCacheMisses;
+		ImGui::Text("Texture cache hits %u | misses %u (%.1f%% hit rate)", m_loadStats.textureCacheHits, m_loadStats.textureCacheMisses,
+			cacheLookups > 0 ? 100.f * m_loadStats.textureCacheHits / cacheLookups : 0.f);
+		ImGui::Text("HDR textures %u | %s MB (%s MB as RGBA32F)", m_loadStats.hdrTexturesLoaded,
+			std::to_string(m_loadStats.hdrTextureBytes / (1024.f * 1024.f)).c_str(), std::to_string(m_loadStats.hdrTextureFloatBytes / (1024.f * 1024.f)).c_str());
+		if (m_loadStats.hdrTexturesMeasured > 0)
+			ImGui::Text("HDR encode error (%u measured) | worst log PSNR %.1f dB | relative error mean %.2f%% max %.2f%%", m_loadStats.hdrTexturesMeasured,
+				m_loadStats.hdrWorstLogPSNR, m_loadStats.hdrMeanRelativeError * 100.f, m_loadStats.hdrMaxRelativeError * 100.f);
+		ImGui::Text("Texture decode %s ms", std::to_string(m_loadStats.textureDecodeMs).c_str());
+		ImGui::Text("Texture upload %s ms", std::to_string(m_loadStats.textureUploadMs).c_str());
+		ImGui::Text("Peak model import memory %s MB", std::to_string(m_loadStats.peakImportBytes / (1024.f * 1024.f)).c_str());
+		ImGui::Text("Models loading %u", GetPendingModelCount());
+		auto cacheText = [](const char* name, const ResourceCacheStats& stats)
+		{
+			ImGui::Text("%s cache %s / %s MB | %u resident, %u unreferenced (%s MB) | %u evicted (%s MB), %u unloaded", name,
+				std::to_string(stats.residentBytes / (1024.f * 1024.f)).c_str(), std::to_string(stats.budgetBytes / (1024.f * 1024.f)).c_str(),
+				stats.resources, stats.unreferenced, std::to_string(stats.unreferencedBytes / (1024.f * 1024.f)).c_str(),
+				stats.evictions, std::to_string(stats.evictedBytes / (1024.f * 1024.f)).c_str(), stats.removals);
+		};
+		cacheText("Texture", m_textures.GetStats());
+		cacheText("Model", m_models.GetStats());
+		if (const AssetArchive* archive = AssetArchive::GetMounted())
+			ImGui::Text("Asset archive %s (%u files)", archive->GetArchivePath().string().c_str(), archive->GetEntryCount());
+		if (AssetArchive::IsStatisticsEnabled())
+		{
+			const AssetIOStats io = AssetArchive::GetStatistics();
+			ImGui::Text("Archive reads %llu | %s MB stored, %s MB decompressed", io.archiveReads,
+				std::to_string(io.archiveBytes / (1024.f * 1024.f)).c_str(), std::to_string(io.decompressedBytes / (1024.f * 1024.f)).c_str());
+			ImGui::Text("Loose file reads %llu | %s MB", io.looseReads, std::to_string(io.looseBytes / (1024.f * 1024.f)).c_str());
+			ImGui::Text("Asset read %s ms (decompress %s ms)", std::to_string(io.readMs).c_str(), std::to_string(io.decompressMs).c_str());
+		}
+		ImGui::End();
+
+		// Make finished async loads resident before the scene gathers what to draw
+		FinalizeModelLoads();
+
+		// Models first: evicting one can leave its textures unreferenced
+		m_models.Trim();
+		m_textures.Trim();
+
 		m_scene->Update(dt);
 		m_renderer->Render();
 		m_renderer->EndFrame();
@@ -92,6 +240,11 @@ namespace Gino
 		return m_input.get();
 	}
 
+	ThreadPool* Engine::GetThreadPool()
+	{
+		return m_threadPool.get();
+	}
+
 	std::function<void(HWND, UINT, WPARAM, LPARAM)> Engine::GetImGuiHook() const
 	{
 		if (m_renderer && m_renderer->GetImGui())
@@ -104,282 +257,827 @@ namespace Gino
 		}
 	}
 
-	Model* Engine::CreateModel(const std::string& id, const std::filesystem::path& filePath, bool PBR)
+	ModelHandle Engine::CreateModel(std::string_view name, const std::filesystem::path& filePath, bool PBR)
 	{
-		auto it = m_loadedModels.find(id);
-		if (it != m_loadedModels.end())
+		if (ModelHandle resident = m_models.Find(name))
+			return resident;
+
+		ModelLoadJob job;
+		job.filePath = filePath;
+		job.PBR = PBR;
+		job.model = AddModel(StringId::Register(name));
+
+		ImportModel(job);
+		FinalizeModel(job);
+		return job.model;
+	}
+
+	ModelHandle Engine::CreateModelAsync(std::string_view name, const std::filesystem::path& filePath, bool PBR, std::function<void(Model*)> onResident)
+	{
+		// Resident or still loading under this ID: onResident only runs for new loads
+		if (ModelHandle resident = m_models.Find(name))
+			return resident;
+
+		auto job = std::make_unique<ModelLoadJob>();
+		job->filePath = filePath;
+		job->PBR = PBR;
+		job->model = AddModel(StringId::Register(name));
+		job->onResident = std::move(onResident);
+
+		// The job is owned by m_pendingModels until FinalizeModelLoads picks it up, the worker only sees the raw pointer
+		ModelLoadJob* jobPtr = job.get();
+		job->cpuStage = m_threadPool->Submit([this, jobPtr]() { ImportModel(*jobPtr); });
+		m_pendingModels.push_back(std::move(job));
+		return jobPtr->model;
+	}
+
+	uint32_t Engine::GetPendingModelCount() const
+	{
+		return static_cast<uint32_t>(m_pendingModels.size());
+	}
+
+	ModelHandle Engine::AddModel(StringId id)
+	{
+		// Costs nothing until FinalizeModel knows the buffer sizes
+		return m_models.Insert(id, std::make_unique<Model>(), 0);
+	}
+
+	void Engine::FinalizeModelLoads()
+	{
+		// At most one model per frame, creating the GPU resources of a large model is a hitch on its own
+		for (auto it = m_pendingModels.begin(); it != m_pendingModels.end(); ++it)
 		{
-			std::cout << "ID already taken!\n";
-			assert(false);
-		}
+			if ((*it)->cpuStage.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				continue;
 
-		auto model = LoadModel(filePath, PBR);
-		auto ret = model.get();
-		m_loadedModels.insert({ id, std::move(model) });
-		return ret;
+			(*it)->cpuStage.get();		// Rethrows anything the import threw
+			FinalizeModel(**it);
+			m_pendingModels.erase(it);
+			return;
+		}
 	}
 
-	Model* Engine::GetModel(const std::string& id)
+	ModelHandle Engine::GetModel(StringId id)
 	{
-		auto it = m_loadedModels.find(id);
-		if (it == m_loadedModels.end())
+		ModelHandle model = m_models.Find(id);
+		if (!model)
 		{
-			std::cout << "Could not find model with ID: '" << id << "'\n";
+			std::cout << "Could not find model with ID: '" << id.GetName() << "'\n";
 			assert(false);
 		}
 
-		return (*it).second.get();
+		return model;
 	}
 
-	Texture* Engine::LoadTexture(const std::string& filePath, bool srgb)
+	bool Engine::UnloadModel(StringId id)
 	{
-		if (m_loadedTextures.find(filePath) == m_loadedTextures.end())
+		for (const auto& job : m_pendingModels)
 		{
-			auto text = std::make_unique<Texture>();
-			text->InitializeFromFile(m_dxDev->GetDevice(), m_dxDev->GetContext(), filePath, srgb);
-			auto pair = m_loadedTextures.insert({ filePath, std::move(text) });
-			
-			return pair.first->second.get();
+			if (job->model.GetKey() == id)
+			{
+				std::cout << "Gino::Engine : Model '" << id.GetName() << "' is still loading, it can not be unloaded yet\n";
+				return false;
+			}
 		}
-		else
+
+		// Keys only: the model's own handles must be gone before its textures can be freed
+		std::vector<StringId> textureKeys;
 		{
-			std::cout << "Skipping loading texture..: " << filePath << std::endl;
-			return nullptr;
+			const ModelHandle model = m_models.Find(id);
+			if (!model)
+			{
+				std::cout << "Gino::Engine : Could not find model with ID: '" << id.GetName() << "'\n";
+				return false;
+			}
+
+			for (const auto& texture : model->GetTextureReferences())
+				textureKeys.push_back(texture.GetKey());
+		}
+
+		if (!m_models.Remove(id))
+		{
+			std::cout << "Gino::Engine : Model '" << id.GetName() << "' is still referenced (" << m_models.GetRefCount(id) << " handles), not unloaded\n";
+			return false;
 		}
+
+		// Textures that other models still reference stay resident
+		std::sort(textureKeys.begin(), textureKeys.end(), [](StringId lhs, StringId rhs) { return lhs.GetHash() < rhs.GetHash(); });
+		textureKeys.erase(std::unique(textureKeys.begin(), textureKeys.end()), textureKeys.end());
+		uint32_t freedTextures = 0;
+		for (const StringId key : textureKeys)
+			freedTextures += m_textures.Remove(key) ? 1 : 0;
+
+		std::cout << "Gino::Engine : Unloaded model '" << id.GetName() << "' and " << freedTextures << " of its " << textureKeys.size() << " textures\n";
+		return true;
 	}
 
-	std::unique_ptr<Model> Engine::LoadModel(const std::filesystem::path& filePath, bool PBR)
+	ResourceCacheStats Engine::GetTextureCacheStats() const
 	{
-		AssimpLoader loader(filePath, PBR);
+		return m_textures.GetStats();
+	}
 
-		if (!PBR)
-			return LoadPhongModel(loader);
-		else
-			return LoadPBRModel(loader);
+	ResourceCacheStats Engine::GetModelCacheStats() const
+	{
+		return m_models.GetStats();
+	}
+
+	const Engine::LoadStatistics& Engine::GetLoadStatistics() const
+	{
+		return m_loadStats;
 	}
 
-	std::unique_ptr<Model> Engine::LoadPhongModel(const AssimpLoader& loader)
+	TextureHandle Engine::LoadTexture(const std::string& filePath, bool srgb, HDRFormat hdrFormat)
 	{
-		static std::string defaultDiffuseFilePath = "../assets/Textures/Default/defaultdiffuse.jpg";
-		static std::string defaultSpecularFilePath = "../assets/Textures/Default/defaultspecular.jpg";
-		static std::string defaultOpacityFilePath = "../assets/Textures/Default/defaultopacity.jpg";
-		static std::string defaultNormalFilePath = "../assets/Textures/Default/defaultnormal.jpg";
+		// Same path as model textures: cooked texture cache or decode with CPU mips. Resident textures are only looked up.
+		DecodedTextures decoded;
+		DecodeTextures({ TextureRequest{ .filePath = filePath, .srgb = srgb, .hdrFormat = hdrFormat } }, decoded);
+		UploadTextures(decoded);
+		return m_textures.Find(filePath);
+	}
 
-		auto verts = loader.GetVertices();
-		auto indices = loader.GetIndices();
-		auto subsets = loader.GetSubsets();
-		auto mats = loader.GetMaterials();
+	void Engine::DecodeTextures(const std::vector<TextureRequest>& requests, DecodedTextures& decoded)
+	{
+		// Unique paths that are not resident yet (first request of a path decides sRGB)
+		// Resident ones are pinned so that eviction can not free them before the model takes its references
+		std::unordered_set<StringId> queued;
+		for (const auto& request : requests)
+		{
+			const StringId key = request.filePath;
+			if (!queued.insert(key).second)
+				continue;
+
+			if (TextureHandle resident = m_textures.Find(key))
+				decoded.resident.push_back(std::move(resident));
+			else
+				decoded.requests.push_back(request);
+		}
 
-		//const std::string directory = filePath.parent_path().string() + "/";
+		if (decoded.requests.empty())
+			return;
+
+		// Decode stage on the worker pool. No D3D11 calls in here.
+		// Textures in the cooked texture cache (keyed by source contents) are only mapped, everything else is decoded,
+		// gets a CPU mip chain and is written to the cache for the next run.
+		// Mip generation and HDR encoding nest their own ParallelFor on the same pool.
+		Timer decodeTimer;
+		const MipGenerator mipGenerator(m_threadPool.get());
+		const HDREncoder hdrEncoder(m_threadPool.get());
+		const TextureCooker cooker(m_threadPool.get());
+		const auto& toLoad = decoded.requests;
+		decoded.chains.resize(toLoad.size());
+		decoded.cookedFiles.resize(toLoad.size());
+		decoded.hdrTextures.resize(toLoad.size());
+		decoded.hdrErrors.resize(m_ioStatistics ? toLoad.size() : 0);
+		const bool measureHDR = m_ioStatistics;
+		m_threadPool->ParallelFor(static_cast<uint32_t>(toLoad.size()), [&toLoad, &decoded, &mipGenerator, &hdrEncoder, &cooker, measureHDR](uint32_t i)
+			{
+				const auto& request = toLoad[i];
+				const std::filesystem::path sourcePath = request.filePath;
+				const bool hdr = IsHDRSource(request.filePath);
+				const uint64_t sourceHash = request.packedORM ? ChannelPacker::HashSources(request.occlusionSource, request.metallicRoughnessSource) : Utils::HashFile(sourcePath);
+				if (hdr)
+					decoded.cookedFiles[i] = cooker.OpenCachedHDR(sourcePath, sourceHash, request.hdrFormat);
+				else
+					decoded.cookedFiles[i] = cooker.OpenCached(sourcePath, sourceHash, request.role, request.srgb);
+				if (decoded.cookedFiles[i])
+					return;
+
+				auto image = request.packedORM ? ChannelPacker::PackORM(request.occlusionSource, request.metallicRoughnessSource) : Utils::ReadImageFile(sourcePath, hdr);
+
+				// HDR mips are filtered in linear float (MipGenerator ignores sRGB for them) before they are encoded
+				MipGenSettings settings{};
+				settings.srgb = request.srgb;
+				settings.normalMap = request.role == TextureRole::Normal;
+				decoded.chains[i] = mipGenerator.Generate(image, settings);
+
+				image.Release();
+
+				if (!hdr)
+				{
+					TextureCooker::WriteUncompressed(sourcePath, sourceHash, decoded.chains[i], request.srgb);
+					return;
+				}
+
+				auto& encoded = decoded.hdrTextures[i];
+				encoded = hdrEncoder.Encode(decoded.chains[i], request.hdrFormat);
+
+				// A second full resolution decode, only paid for when measuring (the cook report always measures)
+				if (measureHDR)
+					decoded.hdrErrors[i] = HDREncoder::CalcError(decoded.chains[i].levels[0], HDREncoder::Decode({ .format = encoded.format, .levels = { encoded.levels[0] } }).levels[0]);
 
-		// Load textures
-		for (auto& mat : mats)
+				TextureCooker::WriteHDR(sourcePath, sourceHash, encoded);
+				decoded.chains[i] = {};
+			});
+		decoded.decodeMs = decodeTimer.TimeElapsed() * 1000.f;
+
+		for (const auto& cookedFile : decoded.cookedFiles)
 		{
-			Texture* diffuse = nullptr;
-			Texture* specular = nullptr;
-			Texture* opacity = nullptr;
-			Texture* normal = nullptr;
-
-			if (mat.diffuseFilePath.has_value())	
-				diffuse = LoadTexture(mat.diffuseFilePath.value());
-			else									
-				diffuse = LoadTexture(defaultDiffuseFilePath);
-
-			if (mat.normalFilePath.has_value())		
-				normal = LoadTexture(mat.normalFilePath.value(), false);
-			else									
-				normal = LoadTexture(defaultNormalFilePath);
-
-			if (mat.opacityFilePath.has_value())	
-				opacity = LoadTexture(mat.opacityFilePath.value());
-			else									
-				opacity = LoadTexture(defaultOpacityFilePath);
-
-			if (mat.specularFilePath.has_value())	
-				specular = LoadTexture(mat.specularFilePath.value());
-			else									
-				specular = LoadTexture(defaultSpecularFilePath);
+			if (cookedFile)
+				++decoded.cacheHits;
+			else
+				++decoded.cacheMisses;
 		}
 
-		// Transform verts data into our specified input layout
-		std::vector<Vertex_POS_UV_NORMAL> vertsIn;
-		vertsIn.reserve(verts.size());
-		for (const auto& vert : verts)
+		for (size_t i = 0; i < decoded.hdrErrors.size(); ++i)
 		{
-			Vertex_POS_UV_NORMAL vertex;
-			vertex.pos.x = vert.position.x;
-			vertex.pos.y = vert.position.y;
-			vertex.pos.z = vert.position.z;
+			if (decoded.hdrTextures[i].levels.empty())
+				continue;
+
+			const HDRError& error = decoded.hdrErrors[i];
+			decoded.hdrWorstLogPSNR = decoded.hdrMeasured == 0 ? error.logPSNR : std::min(decoded.hdrWorstLogPSNR, error.logPSNR);
+			decoded.hdrMeanRelativeErrorSum += error.meanRelativeError;
+			decoded.hdrMaxRelativeError = std::max(decoded.hdrMaxRelativeError, error.maxRelativeError);
+			++decoded.hdrMeasured;
+		}
+	}
 
-			vertex.uv.x = vert.uv.x;
-			vertex.uv.y = vert.uv.y;
+	void Engine::UploadTextures(DecodedTextures& decoded)
+	{
+		const auto& toLoad = decoded.requests;
+		if (toLoad.empty())
+			return;
+
+		// Upload stage: GPU resource creation stays on the device thread
+		Timer uploadTimer;
+		uint32_t uploadCount = 0;
+		uint32_t cookedCount = 0;
+		uint32_t hdrCount = 0;
+		size_t hdrBytes = 0;
+		size_t hdrFloatBytes = 0;
+		for (size_t i = 0; i < toLoad.size(); ++i)
+		{
+			// Another load may have uploaded the same texture while this one was decoding, keep the resident one
+			const StringId key = toLoad[i].filePath;
+			if (TextureHandle resident = m_textures.Find(key))
+			{
+				decoded.resident.push_back(std::move(resident));
+				decoded.cookedFiles[i].reset();
+				decoded.chains[i] = {};
+				decoded.hdrTextures[i] = {};
+				continue;
+			}
+
+			// Streamed textures keep their source (cooked file mapping or decoded chain) and start out with their tail mips.
+			// Either way the cache counts the full chain: that is what the source holds on the CPU or the GPU texture needs.
+			auto text = std::make_unique<Texture>();
+			size_t bytes = 0;
+			if (IsHDRSource(toLoad[i].filePath))
+			{
+				const auto& cooked = decoded.cookedFiles[i];
+				const auto& levels = decoded.hdrTextures[i].levels;
+				hdrFloatBytes += cooked ? CalcFloatBytes(cooked->GetWidth(), cooked->GetHeight(), cooked->GetMipCount()) :
+					CalcFloatBytes(levels[0].width, levels[0].height, static_cast<uint32_t>(levels.size()));
+				++hdrCount;
+			}
+
+			if (decoded.cookedFiles[i])
+			{
+				bytes = decoded.cookedFiles[i]->GetDataSize();
+				if (m_textureStreaming)
+				{
+					m_renderer->GetTextureStreamer()->Add(text.get(), std::move(decoded.cookedFiles[i]));
+				}
+				else
+				{
+					text->InitializeFromDDS(m_dxDev->GetDevice(), m_dxDev->GetContext(), *decoded.cookedFiles[i]);
+					decoded.cookedFiles[i].reset();
+				}
+				++cookedCount;
+			}
+			else if (!decoded.hdrTextures[i].levels.empty())
+			{
+				bytes = HDREncoder::GetDataSize(decoded.hdrTextures[i]);
+				if (m_textureStreaming && decoded.hdrTextures[i].levels.size() > 1)
+					m_renderer->GetTextureStreamer()->Add(text.get(), std::move(decoded.hdrTextures[i]));
+				else
+					text->InitializeFromHDR(m_dxDev->GetDevice(), m_dxDev->GetContext(), decoded.hdrTextures[i]);
+				decoded.hdrTextures[i] = {};
+			}
+			else
+			{
+				for (const auto& level : decoded.chains[i].levels)
+					bytes += level.data.size();
+				if (m_textureStreaming && decoded.chains[i].levels.size() > 1)
+					m_renderer->GetTextureStreamer()->Add(text.get(), std::move(decoded.chains[i]), toLoad[i].srgb);
+				else
+					text->InitializeFromMipChain(m_dxDev->GetDevice(), m_dxDev->GetContext(), decoded.chains[i], toLoad[i].srgb);
+				decoded.chains[i] = {};
+			}
+
+			if (IsHDRSource(toLoad[i].filePath))
+				hdrBytes += bytes;
+
+			// Pinned like the resident ones until the model takes its references
+			decoded.resident.push_back(m_textures.Insert(StringId::Register(toLoad[i].filePath), std::move(text), bytes));
+			++uploadCount;
+		}
+		const float uploadMs = uploadTimer.TimeElapsed() * 1000.f;
 
-			vertex.normal.x = vert.normal.x;
-			vertex.normal.y = vert.normal.y;
-			vertex.normal.z = vert.normal.z;
+		{
+			std::lock_guard<std::mutex> lock(m_textureSourcesMutex);
+			for (const auto& request : toLoad)
+				m_textureSources.insert({ request.filePath, request });
+		}
 
-			vertex.tangent.x = vert.tangent.x;
-			vertex.tangent.y = vert.tangent.y;
-			vertex.tangent.z = vert.tangent.z;
+		m_loadStats.texturesLoaded += uploadCount;
+		m_loadStats.texturesFromCooked += cookedCount;
+		m_loadStats.hdrTexturesLoaded += hdrCount;
+		m_loadStats.hdrTextureBytes += hdrBytes;
+		m_loadStats.hdrTextureFloatBytes += hdrFloatBytes;
+		if (decoded.hdrMeasured > 0)
+		{
+			const uint32_t measured = m_loadStats.hdrTexturesMeasured + decoded.hdrMeasured;
+			m_loadStats.hdrWorstLogPSNR = m_loadStats.hdrTexturesMeasured == 0 ? decoded.hdrWorstLogPSNR : std::min(m_loadStats.hdrWorstLogPSNR, decoded.hdrWorstLogPSNR);
+			m_loadStats.hdrMeanRelativeError = (m_loadStats.hdrMeanRelativeError * m_loadStats.hdrTexturesMeasured + decoded.hdrMeanRelativeErrorSum) / measured;
+			m_loadStats.hdrMaxRelativeError = std::max(m_loadStats.hdrMaxRelativeError, decoded.hdrMaxRelativeError);
+			m_loadStats.hdrTexturesMeasured = measured;
+		}
+		m_loadStats.textureCacheHits += decoded.cacheHits;
+		m_loadStats.textureCacheMisses += decoded.cacheMisses;
+		m_loadStats.textureDecodeMs += decoded.decodeMs;
+		m_loadStats.textureUploadMs += uploadMs;
 
-			vertex.bitangent.x = vert.bitangent.x;
-			vertex.bitangent.y = vert.bitangent.y;
-			vertex.bitangent.z = vert.bitangent.z;
+		std::cout << "Gino::Engine : " << uploadCount << " textures (" << cookedCount << " cooked) | cache " << decoded.cacheHits << " hits, " << decoded.cacheMisses << " misses | decode " << decoded.decodeMs << " ms (" << m_threadPool->GetWorkerCount() + 1 << " threads) | upload " << uploadMs << " ms\n";
+	}
 
-			vertsIn.push_back(vertex);
+	void Engine::CookTextures()
+	{
+		std::vector<TextureRequest> sources;
+		{
+			std::lock_guard<std::mutex> lock(m_textureSourcesMutex);
+			for (const auto& [key, request] : m_textureSources)
+				sources.push_back(request);
 		}
 
-		Buffer vb;
-		Buffer ib;
-		vb.Initialize(m_dxDev->GetDevice(), VertexBufferDesc<Vertex_POS_UV_NORMAL>{.data = vertsIn });
-		ib.Initialize(m_dxDev->GetDevice(), IndexBufferDesc{ .data = indices });
+		const TextureCooker cooker(m_threadPool.get());
+		std::vector<TextureCookReport> reports(sources.size());
+		m_threadPool->ParallelFor(static_cast<uint32_t>(sources.size()), [&sources, &reports, &cooker](uint32_t i)
+			{
+				if (sources[i].packedORM)
+					reports[i] = cooker.CookORM(sources[i].occlusionSource, sources[i].metallicRoughnessSource);
+				else
+					reports[i] = cooker.Cook(sources[i].filePath, sources[i].role, sources[i].srgb);
+			});
 
-		// Setup meshes
-		std::vector<std::pair<Mesh, Material>> materialsAndMeshes;
-		materialsAndMeshes.reserve(subsets.size());
-		for (const auto& subset : subsets)
+		TextureCooker::PrintReport(reports);
+	}
+
+	void Engine::PackAssets()
+	{
+		AssetArchive::Pack(assetRootPath, m_assetArchive);
+	}
+
+	std::vector<TextureHandle> Engine::ResolveTextures(const std::vector<std::string>& filePaths)
+	{
+		std::vector<TextureHandle> textures;
+		textures.reserve(filePaths.size());
+		for (const auto& filePath : filePaths)
+			textures.push_back(m_textures.Find(filePath));
+		return textures;
+	}
+
+	void Engine::ImportModel(ModelLoadJob& job)
+	{
+		MeshCacheKey key = MeshCache::MakeKey(job.filePath, AssimpLoader::s_importFlags, job.PBR);
+		const auto cachePath = MeshCache::GetCachePath(job.filePath);
+
+		// Cache hit: vertex and index data go straight from the mapped file to the GPU buffers
+		if (job.cache.Open(cachePath, job.filePath, key))
 		{
-			Mesh mesh
+			job.data = job.cache.GetData();
+			job.fromCache = true;
+		}
+		else
+		{
+			// Cache miss: import with Assimp straight into our input layout and write the cache for the next run
+			AssimpLoader loader(job.filePath, job.PBR, m_streamingImport, &job.memoryStats, m_parallelImport ? m_threadPool.get() : nullptr);
+			if (!loader.IsLoaded())
 			{
-				.numIndices = subset.indexCount,
-				.indicesFirstIndex = subset.indexStart,
-				.vertexOffset = subset.vertexStart
-			};
+				job.failed = true;
+				return;
+			}
+
+			// The loader buffers are moved, not copied: they are processed in place and uploaded from
+			job.vertices = loader.TakeVertices();
+			job.indices = loader.TakeIndices();
+			std::vector<std::vector<MeshCluster>> subsetClusters;
+			OptimizeMeshSubsets(job.vertices, job.indices, loader.GetSubsets(), subsetClusters);
+			std::vector<std::vector<MeshLod>> subsetLods;
+			const size_t lod0IndexCount = job.indices.size();
+			GenerateMeshLods(job.vertices, job.indices, loader.GetSubsets(), subsetLods);
+			job.memoryStats.Allocate((job.indices.size() - lod0IndexCount) * sizeof(uint32_t));
+
+			auto& data = job.data;
+			data.pbr = job.PBR;
+			data.vertices = job.vertices.data();
+			data.vertexCount = static_cast<uint32_t>(job.vertices.size());
+			data.indices = job.indices.data();
+			data.indexCount = static_cast<uint32_t>(job.indices.size());
+			data.materials = loader.GetMaterials();
+			data.materialsPBR = loader.GetMaterialsPBR();
+			data.texturePaths = loader.GetTexturePaths();
+			data.nodes = loader.GetNodes();
+
+			auto& clusters = job.clusters;
+			auto& lods = job.lods;
+			data.subsets.reserve(loader.GetSubsets().size());
+			for (size_t i = 0; i < loader.GetSubsets().size(); ++i)
+			{
+				const auto& subset = loader.GetSubsets()[i];
+				data.subsets.push_back(MeshCacheSubset
+					{
+						.vertexStart = subset.vertexStart,
+						.vertexCount = subset.vertexCount,
+						.indexStart = subset.indexStart,
+						.indexCount = subset.indexCount,
+						.materialIndex = subset.materialIndex,
+						.clusterStart = static_cast<uint32_t>(clusters.size()),
+						.clusterCount = static_cast<uint32_t>(subsetClusters[i].size()),
+						.lodStart = static_cast<uint32_t>(lods.size()),
+						.lodCount = static_cast<uint32_t>(subsetLods[i].size()),
+						.node = subset.node
+					});
+				clusters.insert(clusters.end(), subsetClusters[i].begin(), subsetClusters[i].end());
+				lods.insert(lods.end(), subsetLods[i].begin(), subsetLods[i].end());
+			}
+			data.clusters = clusters.data();
+			data.clusterCount = static_cast<uint32_t>(clusters.size());
+			data.lods = lods.data();
+			data.lodCount = static_cast<uint32_t>(lods.size());
+
+			MeshCache::HashSources(job.filePath, key);
+			MeshCache::Write(cachePath, key, data);
+		}
 
-			auto phongMat = std::get<0>(subset.mats);
+		// Texture streaming estimates mips from how many model units a UV unit spans, per subset
+		const auto& subsets = job.data.subsets;
+		job.uvDensities.resize(subsets.size());
+		m_threadPool->ParallelFor(static_cast<uint32_t>(subsets.size()), [&job, &subsets](uint32_t i)
+			{
+				const auto& subset = subsets[i];
+				job.uvDensities[i] = TextureStreamer::CalcUVDensity(job.data.vertices + subset.vertexStart, job.data.indices + subset.indexStart, subset.indexCount);
+			});
 
-			std::string diffLook = phongMat.diffuseFilePath.has_value() ? phongMat.diffuseFilePath.value() : defaultDiffuseFilePath;
-			std::string specLook = phongMat.specularFilePath.has_value() ? phongMat.specularFilePath.value() : defaultSpecularFilePath;
-			std::string opacityLook = phongMat.opacityFilePath.has_value() ? phongMat.opacityFilePath.value() : defaultOpacityFilePath;
-			std::string normalLook = phongMat.normalFilePath.has_value() ? phongMat.normalFilePath.value() : defaultNormalFilePath;
+		DecodeTextures(GetTextureRequests(job.data), job.textures);
 
-			// Create material for this submesh to use
-			Material mat;
-			mat.Initialize(PhongMaterialData
-				{
-					.diffuse = m_loadedTextures.find(diffLook)->second.get(),
-					.specular = m_loadedTextures.find(specLook)->second.get(),
-					.opacity = m_loadedTextures.find(opacityLook)->second.get(),
-					.normal = m_loadedTextures.find(normalLook)->second.get()
-				});
+		if (job.PBR && m_compactVertices)
+			CompressVertices(job);
+	}
 
-			materialsAndMeshes.push_back({ mesh, mat });
+	void Engine::FinalizeModel(ModelLoadJob& job)
+	{
+		if (job.failed)
+		{
+			std::cout << "Gino::Engine : Could not load " << job.filePath << ", the model stays empty\n";
+			return;
 		}
 
-		auto model = std::make_unique<Model>();
-		model->Initialize(vb, ib, materialsAndMeshes);
-		return model;
+		UploadTextures(job.textures);
+
+		if (job.PBR)
+			CreatePBRModel(job);
+		else
+			CreatePhongModel(job);
+		job.model->SetResident();
+		m_models.SetBytes(job.model, job.model->GetMemoryBytes());
+		job.textures.resident.clear();			// The model holds its textures now
+
+		if (job.fromCache)
+		{
+			std::cout << "Gino::Engine : Loaded " << job.filePath << " from mesh cache in " << job.timer.TimeElapsed() * 1000.f << " ms\n";
+		}
+		else
+		{
+			m_loadStats.peakImportBytes = std::max(m_loadStats.peakImportBytes, job.memoryStats.peakBytes);
+			std::cout << "Gino::Engine : Imported " << job.filePath << " in " << job.timer.TimeElapsed() * 1000.f << " ms (mesh cache written)"
+				<< " | peak import memory " << job.memoryStats.peakBytes / (1024 * 1024) << " MB" << (m_streamingImport ? " (streaming)" : "") << "\n";
+		}
+
+		if (job.onResident)
+			job.onResident(job.model.Get());
 	}
 
-	std::unique_ptr<Model> Engine::LoadPBRModel(const AssimpLoader& loader)
+	void Engine::OptimizeMeshSubsets(std::vector<Vertex_POS_UV_NORMAL>& vertices, std::vector<uint32_t>& indices, const std::vector<AssimpMeshSubset>& subsets, std::vector<std::vector<MeshCluster>>& clusters)
 	{
-		static std::string defaultDiffuseFilePath = "../assets/Textures/Default/defaultdiffuse.jpg";
-		static std::string defaultSpecularFilePath = "../assets/Textures/Default/defaultspecular.jpg";
-		static std::string defaultOpacityFilePath = "../assets/Textures/Default/defaultopacity.jpg";
-		static std::string defaultNormalFilePath = "../assets/Textures/Default/defaultnormal.jpg";
-
-		auto verts = loader.GetVertices();
-		auto indices = loader.GetIndices();
-		auto subsets = loader.GetSubsets();
-		auto mats = loader.GetMaterialsPBR();
+		Timer optimizeTimer;
 
-		//const std::string directory = filePath.parent_path().string() + "/";
+		// Subsets own disjoint vertex and index ranges, so each one is optimized independently.
+		// Clusters are built on the cache optimized order, the vertex fetch remap runs last so it sees the final index order.
+		MeshOptimizeSettings settings{};
+		settings.vertexFetch = false;
 
-		// Load textures
-		for (auto& mat : mats)
+		clusters.assign(subsets.size(), {});
+		std::vector<VertexCacheStats> before(subsets.size());
+		std::vector<VertexCacheStats> after(subsets.size());
+		m_threadPool->ParallelFor(static_cast<uint32_t>(subsets.size()), [&subsets, &indices, &vertices, &clusters, &before, &after, &settings](uint32_t i)
+			{
+				const auto& subset = subsets[i];
+				uint32_t* subsetIndices = indices.data() + subset.indexStart;
+				Vertex_POS_UV_NORMAL* subsetVertices = vertices.data() + subset.vertexStart;
+
+				before[i] = MeshOptimizer::AnalyzeVertexCache(subsetIndices, subset.indexCount, subset.vertexCount);
+				MeshOptimizer::Optimize(subsetVertices, subset.vertexCount, sizeof(Vertex_POS_UV_NORMAL), subsetIndices, subset.indexCount, settings);
+				clusters[i] = MeshletBuilder::Build(subsetIndices, subset.indexCount, subsetVertices, subset.vertexCount, sizeof(Vertex_POS_UV_NORMAL), subset.indexStart);
+				MeshOptimizer::OptimizeVertexFetch(subsetVertices, subset.vertexCount, sizeof(Vertex_POS_UV_NORMAL), subsetIndices, subset.indexCount);
+				after[i] = MeshOptimizer::AnalyzeVertexCache(subsetIndices, subset.indexCount, subset.vertexCount);
+			});
+
+		VertexCacheStats totalBefore;
+		VertexCacheStats totalAfter;
+		for (size_t i = 0; i < subsets.size(); ++i)
 		{
-			Texture* albedo = nullptr;
-			Texture* normal = nullptr;
-			Texture* metallicAndRoughness = nullptr;
-			Texture* ao = nullptr;
-			Texture* emission = nullptr;
+			totalBefore += before[i];
+			totalAfter += after[i];
+		}
 
-			if (mat.albedo.has_value())					albedo = LoadTexture(mat.albedo.value());
-			else										albedo = LoadTexture(defaultDiffuseFilePath);	
+		size_t clusterCount = 0;
+		for (const auto& subsetClusters : clusters)
+			clusterCount += subsetClusters.size();
 
-			if (mat.normal.has_value())					normal = LoadTexture(mat.normal.value(), false);
-			else										normal = LoadTexture(defaultNormalFilePath);
+		std::cout << "Gino::MeshOptimizer : " << subsets.size() << " subsets, " << clusterCount << " clusters, " << totalAfter.triangleCount << " triangles"
+			<< " | ACMR " << totalBefore.GetACMR() << " -> " << totalAfter.GetACMR()
+			<< " | ATVR " << totalBefore.GetATVR() << " -> " << totalAfter.GetATVR()
+			<< " | " << optimizeTimer.TimeElapsed() * 1000.f << " ms\n";
+	}
 
-			if (mat.metallicAndRoughness.has_value())	metallicAndRoughness = LoadTexture(mat.metallicAndRoughness.value(), false);
-			else										metallicAndRoughness = LoadTexture(defaultSpecularFilePath);			// full black, rough/metal = (0, 0)
+	void Engine::GenerateMeshLods(const std::vector<Vertex_POS_UV_NORMAL>& vertices, std::vector<uint32_t>& indices, const std::vector<AssimpMeshSubset>& subsets, std::vector<std::vector<MeshLod>>& lods)
+	{
+		Timer simplifyTimer;
 
-			if (mat.ao.has_value())						ao = LoadTexture(mat.ao.value(), false);
-			else										ao = LoadTexture(defaultSpecularFilePath);
+		// Every level halves the LOD0 triangle count. Simplifying from LOD0 each time (rather than from the previous level)
+		// keeps the reported error relative to the source mesh. The error cap keeps small parts from collapsing into nothing.
+		static constexpr float s_levelRatio = 0.5f;
+		static constexpr float s_maxRelativeError = 0.05f;		// Of the subset bounding box diagonal
+		static constexpr float s_minReduction = 0.85f;			// Stop once a level no longer gets meaningfully smaller
+
+		std::vector<std::vector<std::vector<uint32_t>>> levelIndices(subsets.size());
+		lods.assign(subsets.size(), {});
+		m_threadPool->ParallelFor(static_cast<uint32_t>(subsets.size()), [&subsets, &indices, &vertices, &levelIndices, &lods](uint32_t i)
+			{
+				const auto& subset = subsets[i];
+				if (subset.vertexCount == 0 || subset.indexCount == 0)
+					return;
 
-			if (mat.emission.has_value())				emission = LoadTexture(mat.emission.value());
-			else										emission = LoadTexture(defaultSpecularFilePath);
+				const uint32_t* subsetIndices = indices.data() + subset.indexStart;
+				const Vertex_POS_UV_NORMAL* subsetVertices = vertices.data() + subset.vertexStart;
+
+				DirectX::SimpleMath::Vector3 min = subsetVertices[0].pos;
+				DirectX::SimpleMath::Vector3 max = subsetVertices[0].pos;
+				for (uint32_t v = 0; v < subset.vertexCount; ++v)
+				{
+					min = DirectX::SimpleMath::Vector3::Min(min, subsetVertices[v].pos);
+					max = DirectX::SimpleMath::Vector3::Max(max, subsetVertices[v].pos);
+				}
+				const float maxError = DirectX::SimpleMath::Vector3::Distance(min, max) * s_maxRelativeError;
+
+				size_t previousCount = subset.indexCount;
+				for (uint32_t level = 1; level < Model::s_maxLods; ++level)
+				{
+					const size_t target = static_cast<size_t>(subset.indexCount * std::pow(s_levelRatio, (float)level)) / 3 * 3;
+					float error = 0.f;
+					auto simplified = MeshSimplifier::Simplify(subsetIndices, subset.indexCount, subsetVertices, subset.vertexCount, sizeof(Vertex_POS_UV_NORMAL), target, maxError, &error);
+					if (simplified.empty() || simplified.size() > previousCount * s_minReduction)
+						break;
+
+					MeshOptimizer::OptimizeVertexCache(simplified.data(), simplified.size(), subset.vertexCount);
+					previousCount = simplified.size();
+					lods[i].push_back(MeshLod{ .indexStart = 0, .indexCount = static_cast<uint32_t>(simplified.size()), .error = error });
+					levelIndices[i].push_back(std::move(simplified));
+				}
+			});
+
+		// Simplified levels go after all LOD0 data so the LOD0 ranges (and the clusters in them) stay where they are
+		size_t lodTriangles[Model::s_maxLods] = {};
+		for (size_t i = 0; i < subsets.size(); ++i)
+		{
+			lodTriangles[0] += subsets[i].indexCount / 3;
+			for (size_t level = 0; level < lods[i].size(); ++level)
+			{
+				lods[i][level].indexStart = static_cast<uint32_t>(indices.size());
+				indices.insert(indices.end(), levelIndices[i][level].begin(), levelIndices[i][level].end());
+				lodTriangles[level + 1] += levelIndices[i][level].size() / 3;
+			}
 		}
 
-		// Transform verts data into our specified input layout
-		std::vector<Vertex_POS_UV_NORMAL> vertsIn;
-		vertsIn.reserve(verts.size());
-		for (const auto& vert : verts)
+		std::cout << "Gino::MeshSimplifier : triangles per level";
+		for (uint32_t level = 0; level < Model::s_maxLods; ++level)
+			std::cout << (level == 0 ? " " : " / ") << lodTriangles[level];
+		std::cout << " | " << simplifyTimer.TimeElapsed() * 1000.f << " ms\n";
+	}
+
+	std::vector<Engine::TextureRequest> Engine::GetTextureRequests(const ModelImportData& data)
+	{
+		std::vector<TextureRequest> requests;
+		if (data.pbr)
 		{
-			Vertex_POS_UV_NORMAL vertex;
-			vertex.pos.x = vert.position.x;
-			vertex.pos.y = vert.position.y;
-			vertex.pos.z = vert.position.z;
+			constexpr uint32_t noTexture = AssimpMaterialPathsPBR::s_noTexture;
+			auto pathOr = [&data](uint32_t texture, const std::string& fallback) -> const std::string& { return texture != noTexture ? data.texturePaths[texture] : fallback; };
 
-			vertex.uv.x = vert.uv.x;
-			vertex.uv.y = vert.uv.y;
+			const std::string noPath;
 
-			vertex.normal.x = vert.normal.x;
-			vertex.normal.y = vert.normal.y;
-			vertex.normal.z = vert.normal.z;
+			requests.reserve(data.materialsPBR.size() * 4);
+			for (const auto& mat : data.materialsPBR)
+			{
+				// Non-color data is loaded linear. Defaults keep the sRGB flag they were always loaded with.
+				requests.push_back({ pathOr(mat.albedo, defaultDiffuseFilePath), true, TextureRole::Color });
+				requests.push_back({ pathOr(mat.normal, defaultNormalFilePath), mat.normal == noTexture, mat.normal != noTexture ? TextureRole::Normal : TextureRole::Color });
+				requests.push_back({ pathOr(mat.emission, defaultSpecularFilePath), true, TextureRole::Color });
+
+				// AO, roughness and metalness packed into one linear ORM texture
+				const std::string& occlusion = pathOr(mat.ao, noPath);
+				const std::string& metallicRoughness = pathOr(mat.metallicAndRoughness, noPath);
+				requests.push_back(TextureRequest
+					{
+						.filePath = ChannelPacker::GetPackedPath(occlusion, metallicRoughness),
+						.srgb = false,
+						.role = TextureRole::Packed,
+						.packedORM = true,
+						.occlusionSource = occlusion,
+						.metallicRoughnessSource = metallicRoughness
+					});
+			}
+		}
+		else
+		{
+			constexpr uint32_t noTexture = AssimpMaterialPaths::s_noTexture;
+			auto pathOr = [&data](uint32_t texture, const std::string& fallback) -> const std::string& { return texture != noTexture ? data.texturePaths[texture] : fallback; };
 
-			vertex.tangent.x = vert.tangent.x;
-			vertex.tangent.y = vert.tangent.y;
-			vertex.tangent.z = vert.tangent.z;
+			requests.reserve(data.materials.size() * 4);
+			for (const auto& mat : data.materials)
+			{
+				requests.push_back({ pathOr(mat.diffuse, defaultDiffuseFilePath), true, TextureRole::Color });
+				requests.push_back({ pathOr(mat.normal, defaultNormalFilePath), mat.normal == noTexture, mat.normal != noTexture ? TextureRole::Normal : TextureRole::Color });
+				requests.push_back({ pathOr(mat.opacity, defaultOpacityFilePath), true, TextureRole::Mask });
+				requests.push_back({ pathOr(mat.specular, defaultSpecularFilePath), true, TextureRole::Packed });
+			}
+		}
+		return requests;
+	}
 
-			vertex.bitangent.x = vert.bitangent.x;
-			vertex.bitangent.y = vert.bitangent.y;
-			vertex.bitangent.z = vert.bitangent.z;
+	void Engine::CompressVertices(ModelLoadJob& job)
+	{
+		// Compact vertices are quantized per subset, so each subset is encoded independently
+		Timer compressTimer;
+
+		const auto& data = job.data;
+		const auto& subsets = data.subsets;
+		auto& compactVertices = job.compactVertices;
+		auto& quantizations = job.quantizations;
+
+		compactVertices.resize(data.vertexCount);
+		quantizations.resize(subsets.size());
+		if (!job.fromCache)
+			job.memoryStats.Allocate(compactVertices.size() * sizeof(Vertex_Compact));
+		std::vector<VertexCompressionError> errors(subsets.size());
+		m_threadPool->ParallelFor(static_cast<uint32_t>(subsets.size()), [&data, &subsets, &compactVertices, &quantizations, &errors](uint32_t i)
+			{
+				const auto& subset = subsets[i];
+				const Vertex_POS_UV_NORMAL* vertices = data.vertices + subset.vertexStart;
+
+				quantizations[i] = VertexCompressor::CalcPositionQuantization(vertices, subset.vertexCount);
+				VertexCompressor::Encode(vertices, compactVertices.data() + subset.vertexStart, subset.vertexCount, quantizations[i]);
+				errors[i] = VertexCompressor::MeasureError(vertices, compactVertices.data() + subset.vertexStart, subset.vertexCount, quantizations[i]);
+			});
+
+		VertexCompressionError error;
+		for (const auto& subsetError : errors)
+			error += subsetError;
+
+		std::cout << "Gino::VertexCompressor : " << data.vertexCount << " vertices, "
+			<< data.vertexCount * sizeof(Vertex_POS_UV_NORMAL) / 1024 << " KB -> " << data.vertexCount * sizeof(Vertex_Compact) / 1024 << " KB"
+			<< " | max error: position " << error.maxPosition << ", uv " << error.maxUV
+			<< ", normal " << error.maxNormalDegrees << " deg, tangent " << error.maxTangentDegrees << " deg, " << error.handednessFlips << " handedness flips"
+			<< " | " << compressTimer.TimeElapsed() * 1000.f << " ms\n";
+	}
 
-			vertsIn.push_back(vertex);
+	void Engine::CreatePhongModel(const ModelLoadJob& job)
+	{
+		const auto& data = job.data;
+		const auto& subsets = data.subsets;
+		const auto& mats = data.materials;
+
+		// Resolve every interned path once, materials and subsets only deal in indices from here on
+		constexpr uint32_t noTexture = AssimpMaterialPaths::s_noTexture;
+		const std::vector<TextureHandle> textures = ResolveTextures(data.texturePaths);
+		std::vector<TextureHandle> references;		// One per material slot, held by the model
+		auto reference = [&references](TextureHandle texture) { references.push_back(std::move(texture)); return references.back().Get(); };
+		auto textureOr = [this, &textures, &reference](uint32_t texture, const std::string& fallback) { return reference(texture != noTexture ? textures[texture] : m_textures.Find(fallback)); };
+
+		std::vector<Material> materials(mats.size());
+		for (size_t i = 0; i < mats.size(); ++i)
+		{
+			materials[i].Initialize(PhongMaterialData
+				{
+					.diffuse = textureOr(mats[i].diffuse, defaultDiffuseFilePath),
+					.specular = textureOr(mats[i].specular, defaultSpecularFilePath),
+					.opacity = textureOr(mats[i].opacity, defaultOpacityFilePath),
+					.normal = textureOr(mats[i].normal, defaultNormalFilePath)
+				});
 		}
 
+		// Vertex data is already in our input layout (converted on import or read from the mesh cache)
 		Buffer vb;
 		Buffer ib;
-		vb.Initialize(m_dxDev->GetDevice(), VertexBufferDesc<Vertex_POS_UV_NORMAL>{.data = vertsIn });
-		ib.Initialize(m_dxDev->GetDevice(), IndexBufferDesc{ .data = indices });
+		vb.Initialize(m_dxDev->GetDevice(), VertexBufferDescRaw{ .data = data.vertices, .totalSize = data.vertexCount * sizeof(Vertex_POS_UV_NORMAL) });
+		ib.Initialize(m_dxDev->GetDevice(), IndexBufferDescRaw{ .data = data.indices, .count = data.indexCount });
 
 		// Setup meshes
 		std::vector<std::pair<Mesh, Material>> materialsAndMeshes;
 		materialsAndMeshes.reserve(subsets.size());
-		for (const auto& subset : subsets)
+		for (size_t i = 0; i < subsets.size(); ++i)
 		{
+			const auto& subset = subsets[i];
 			Mesh mesh
 			{
 				.numIndices = subset.indexCount,
 				.indicesFirstIndex = subset.indexStart,
-				.vertexOffset = subset.vertexStart
+				.vertexOffset = subset.vertexStart,
+				.clusterStart = subset.clusterStart,
+				.clusterCount = subset.clusterCount,
+				.lodStart = subset.lodStart,
+				.lodCount = subset.lodCount,
+				.uvDensity = job.uvDensities[i],
+				.node = subset.node
 			};
 
-			auto pbrMat = std::get<1>(subset.mats);
+			materialsAndMeshes.push_back({ mesh, materials[subset.materialIndex] });
+		}
 
-			std::string albedoLook = pbrMat.albedo.has_value() ? pbrMat.albedo.value() : defaultDiffuseFilePath;
-			std::string normalLook = pbrMat.normal.has_value() ? pbrMat.normal.value() : defaultNormalFilePath;
-			std::string metallicAndRoughnessLook = pbrMat.metallicAndRoughness.has_value() ? pbrMat.metallicAndRoughness.value() : defaultSpecularFilePath;
-			std::string aoLook = pbrMat.ao.has_value() ? pbrMat.ao.value() : defaultSpecularFilePath;
-			std::string emissionLook = pbrMat.emission.has_value() ? pbrMat.emission.value() : defaultSpecularFilePath;
+		job.model->Initialize(vb, ib, materialsAndMeshes);
+		job.model->SetNodes(data.nodes.data(), data.nodes.size());
+		job.model->SetClusters(data.clusters, data.clusterCount, data.indices, data.indexCount);
+		job.model->SetLods(data.lods, data.lodCount);
+		job.model->SetTextureReferences(std::move(references));
+	}
 
-			// Create material for this submesh to use
-			Material mat;
-			mat.Initialize(PBRMaterialData
+	void Engine::CreatePBRModel(const ModelLoadJob& job)
+	{
+		const auto& data = job.data;
+		const auto& subsets = data.subsets;
+		const auto& mats = data.materialsPBR;
+
+		// Resolve every interned path once, materials and subsets only deal in indices from here on
+		constexpr uint32_t noTexture = AssimpMaterialPathsPBR::s_noTexture;
+		const std::vector<TextureHandle> textures = ResolveTextures(data.texturePaths);
+		std::vector<TextureHandle> references;		// One per material slot, held by the model
+		auto reference = [&references](TextureHandle texture) { references.push_back(std::move(texture)); return references.back().Get(); };
+		auto textureOr = [this, &textures, &reference](uint32_t texture, const std::string& fallback) { return reference(texture != noTexture ? textures[texture] : m_textures.Find(fallback)); };
+		auto texturePath = [&data](uint32_t texture) { return texture != noTexture ? data.texturePaths[texture] : std::string(); };
+
+		std::vector<Material> materials(mats.size());
+		for (size_t i = 0; i < mats.size(); ++i)
+		{
+			materials[i].Initialize(PBRMaterialData
 				{
-					.albedo = m_loadedTextures.find(albedoLook)->second.get(),
-					.normal = m_loadedTextures.find(normalLook)->second.get(),
-					.metallicAndRoughness = m_loadedTextures.find(metallicAndRoughnessLook)->second.get(),
-					.ao = m_loadedTextures.find(aoLook)->second.get(),
-					.emission = m_loadedTextures.find(emissionLook)->second.get()
+					.albedo = textureOr(mats[i].albedo, defaultDiffuseFilePath),
+					.normal = textureOr(mats[i].normal, defaultNormalFilePath),
+					.orm = reference(m_textures.Find(ChannelPacker::GetPackedPath(texturePath(mats[i].ao), texturePath(mats[i].metallicAndRoughness)))),
+					.emission = textureOr(mats[i].emission, defaultSpecularFilePath)
 				});
+		}
+
+		// Vertex data is in our full input layout (converted on import or read from the mesh cache), or was encoded by CompressVertices
+		const bool compactVertices = !job.compactVertices.empty();
+		Buffer vb;
+		Buffer ib;
+		if (compactVertices)
+			vb.Initialize(m_dxDev->GetDevice(), VertexBufferDescRaw{ .data = job.compactVertices.data(), .totalSize = job.compactVertices.size() * sizeof(Vertex_Compact) });
+		else
+			vb.Initialize(m_dxDev->GetDevice(), VertexBufferDescRaw{ .data = data.vertices, .totalSize = data.vertexCount * sizeof(Vertex_POS_UV_NORMAL) });
+		ib.Initialize(m_dxDev->GetDevice(), IndexBufferDescRaw{ .data = data.indices, .count = data.indexCount });
+
+		// Setup meshes
+		std::vector<std::pair<Mesh, Material>> materialsAndMeshes;
+		materialsAndMeshes.reserve(subsets.size());
+		for (size_t i = 0; i < subsets.size(); ++i)
+		{
+			const auto& subset = subsets[i];
+			Mesh mesh
+			{
+				.numIndices = subset.indexCount,
+				.indicesFirstIndex = subset.indexStart,
+				.vertexOffset = subset.vertexStart,
+				.clusterStart = subset.clusterStart,
+				.clusterCount = subset.clusterCount,
+				.lodStart = subset.lodStart,
+				.lodCount = subset.lodCount,
+				.uvDensity = job.uvDensities[i],
+				.node = subset.node
+			};
+			if (compactVertices)
+			{
+				mesh.positionOffset = job.quantizations[i].offset;
+				mesh.positionScale = job.quantizations[i].scale;
+			}
 
-			materialsAndMeshes.push_back({ mesh, mat });
+			materialsAndMeshes.push_back({ mesh, materials[subset.materialIndex] });
 		}
 
-		auto model = std::make_unique<Model>();
-		model->Initialize(vb, ib, materialsAndMeshes);
-		return model;
+		job.model->Initialize(vb, ib, materialsAndMeshes, compactVertices ? VertexFormat::Compact : VertexFormat::Full);
+		job.model->SetNodes(data.nodes.data(), data.nodes.size());
+		job.model->SetClusters(data.clusters, data.clusterCount, data.indices, data.indexCount);
+		job.model->SetLods(data.lods, data.lodCount);
+		job.model->SetTextureReferences(std::move(references));
 	}
 
 }
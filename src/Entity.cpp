@@ -3,21 +3,25 @@
 
 namespace Gino
 {
-	Entity::Entity() :
-		m_activeComponentBits(ComponentType::TransformType)
+	Entity::Entity(EntityStorage* storage, TransformSystem* transforms) :
+		m_storage(storage)
 	{
-		m_components[ComponentMapper<ComponentType::TransformType>::index] = new Transform;
+		m_storage->Insert(this, Transform(transforms));
 	}
 
 	Entity::~Entity()
 	{
-		// Clean up transform component
-		auto tr = reinterpret_cast<Transform*>(m_components[ComponentMapper<ComponentType::TransformType>::index]);
-		delete tr;
+		// The Transform releases its slot with its row
+		m_storage->Remove(this);
 	}
+
 	uint32_t Entity::GetActiveComponentBits() const
 	{
-		return m_activeComponentBits;
+		return m_archetype->mask;
 	}
-}
 
+	void Entity::SetComponentCallback(ComponentCallback callback)
+	{
+		m_onComponentChanged = std::move(callback);
+	}
+}
@@ -0,0 +1,161 @@
+#include "pch.h"
+#include "EntityStorage.h"
+#include "Entity.h"
+#include "TransformSystem.h"
+#include "Timer.h"
+
+#include <algorithm>
+
+namespace Gino
+{
+	void EntityStorage::Insert(Entity* entity, Transform&& transform)
+	{
+		Archetype* archetype = GetArchetype(ComponentMapper<TransformType>::bit);
+		entity->m_archetype = archetype;
+		entity->m_row = static_cast<uint32_t>(archetype->entities.size());
+		archetype->entities.push_back(entity);
+		archetype->Column<TransformType>().push_back(std::move(transform));
+	}
+
+	void EntityStorage::Remove(Entity* entity)
+	{
+		RemoveRow(entity->m_archetype, entity->m_row);
+		entity->m_archetype = nullptr;
+	}
+
+	void EntityStorage::RemoveComponent(Entity* entity, int index)
+	{
+		MoveEntity(entity, 0, 1u << index);
+	}
+
+	uint32_t EntityStorage::GetArchetypeCount() const
+	{
+		return static_cast<uint32_t>(m_archetypeList.size());
+	}
+
+	Archetype* EntityStorage::GetArchetype(uint32_t mask)
+	{
+		auto it = m_archetypes.find(mask);
+		if (it != m_archetypes.end())
+			return it->second.get();
+
+		auto archetype = std::make_unique<Archetype>();
+		archetype->mask = mask;
+
+		m_archetypeList.push_back(archetype.get());
+		return m_archetypes.insert({ mask, std::move(archetype) }).first->second.get();
+	}
+
+	Archetype* EntityStorage::MoveEntity(Entity* entity, uint32_t added, uint32_t removed)
+	{
+		Archetype* from = entity->m_archetype;
+		Archetype* archetype = GetArchetype((from->mask | added) & ~removed);
+		const uint32_t row = entity->m_row;
+
+		// The components both archetypes have, the rest stays behind for RemoveRow to destroy
+		from->ForEachColumn([archetype, row](auto& column, auto index)
+			{
+				if ((archetype->mask & (1u << index)) != 0)
+					std::get<decltype(index)::value>(archetype->columns).push_back(std::move(column[row]));
+			});
+
+		entity->m_archetype = archetype;
+		entity->m_row = static_cast<uint32_t>(archetype->entities.size());
+		archetype->entities.push_back(entity);
+
+		RemoveRow(from, row);
+		return archetype;
+	}
+
+	void EntityStorage::RemoveRow(Archetype* archetype, uint32_t row)
+	{
+		const uint32_t last = static_cast<uint32_t>(archetype->entities.size()) - 1;
+		if (row != last)
+		{
+			archetype->entities[row] = archetype->entities[last];
+			archetype->entities[row]->m_row = row;
+		}
+		archetype->entities.pop_back();
+
+		archetype->ForEachColumn([row, last](auto& column, auto)
+			{
+				if (row != last)
+					column[row] = std::move(column[last]);
+				column.pop_back();
+			});
+	}
+
+	void EntityStorage::RunBenchmark()
+	{
+		constexpr uint32_t modelCount = 16;
+		constexpr uint32_t frames = 100;
+		constexpr uint32_t entityCounts[] = { 1000, 10000, 100000 };
+
+		// The layout the archetypes had before: a column of component pointers per component, every Transform allocated on its own
+		struct PointerArchetype
+		{
+			std::vector<Entity*> entities;
+			std::vector<Component*> transforms;
+			std::vector<Component*> models;
+		};
+
+		std::vector<std::unique_ptr<Model>> models;
+		for (uint32_t i = 0; i < modelCount; ++i)
+			models.push_back(std::make_unique<Model>());
+
+		std::cout << "Gino::EntityStorage : Benchmark, Model + Transform slot gather (every 4th entity has no model, average of " << frames << " frames)\n";
+		for (const uint32_t entityCount : entityCounts)
+		{
+			TransformSystem transforms;
+			EntityStorage storage;
+			std::vector<std::unique_ptr<Entity>> entities;
+			std::vector<std::unique_ptr<Transform>> pointerTransforms;
+			PointerArchetype pointerArchetype;
+			for (uint32_t i = 0; i < entityCount; ++i)
+			{
+				// Allocated in between the entities, as they were
+				auto entity = std::make_unique<Entity>(&storage, &transforms);
+				pointerTransforms.push_back(std::make_unique<Transform>(&transforms));
+				if (i % 4 != 3)
+				{
+					entity->AddComponent<ModelType>(models[i % modelCount].get());
+					pointerArchetype.entities.push_back(entity.get());
+					pointerArchetype.transforms.push_back(pointerTransforms.back().get());
+					pointerArchetype.models.push_back(models[i % modelCount].get());
+				}
+				entities.push_back(std::move(entity));
+			}
+
+			std::vector<std::pair<Model*, uint32_t>> gathered;
+			gathered.reserve(entityCount);
+
+			Timer pointerTimer;
+			for (uint32_t frame = 0; frame < frames; ++frame)
+			{
+				gathered.clear();
+				for (size_t row = 0; row < pointerArchetype.entities.size(); ++row)
+				{
+					gathered.push_back({ static_cast<Model*>(pointerArchetype.models[row]),
+						static_cast<Transform*>(pointerArchetype.transforms[row])->GetIndex() });
+				}
+			}
+			const float pointerMs = pointerTimer.TimeElapsed() * 1000.f / frames;
+			const size_t pointerCount = gathered.size();
+
+			Timer queryTimer;
+			for (uint32_t frame = 0; frame < frames; ++frame)
+			{
+				gathered.clear();
+				storage.ForEach<TransformType, ModelType>([&gathered](Entity*, const Transform& transform, Model* model)
+					{
+						gathered.push_back({ model, transform.GetIndex() });
+					});
+			}
+			const float queryMs = queryTimer.TimeElapsed() * 1000.f / frames;
+
+			assert(gathered.size() == pointerCount);
+			std::cout << "  " << entityCount << " entities (" << gathered.size() << " matched) | pointer columns " << pointerMs
+				<< " ms | by value " << queryMs << " ms (" << pointerMs / std::max(queryMs, 1e-6f) << "x)\n";
+		}
+	}
+}
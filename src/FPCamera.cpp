@@ -122,6 +122,16 @@ namespace Gino
 		return DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(m_fovInDegs), m_aspectRatio, m_nearPlane, m_farPlane);
 	}
 
+	float FPCamera::GetFovInDegs() const
+	{
+		return m_fovInDegs;
+	}
+
+	float FPCamera::GetNearPlane() const
+	{
+		return m_nearPlane;
+	}
+
 	void FPCamera::Update(float dt)
 	{
 		// Update orientation
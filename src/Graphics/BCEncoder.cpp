@@ -0,0 +1,753 @@
+#include "pch.h"
+#include "Graphics/BCEncoder.h"
+#include "ThreadPool.h"
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+
+namespace Gino
+{
+	namespace
+	{
+		constexpr uint32_t s_blockRowsPerJob = 4;
+		constexpr int s_refineIterations = 2;
+
+		// 4x4 texels, channel major so four texels of one channel fit an SSE register
+		struct alignas(16) Block
+		{
+			float c[4][16];
+		};
+
+		struct alignas(16) Palette
+		{
+			float c[16][4];
+			int count = 0;
+		};
+
+		void LoadBlock(const MipLevel& level, uint32_t bx, uint32_t by, Block& block)
+		{
+			// Partial edge blocks replicate the last row/column
+			for (uint32_t y = 0; y < 4; ++y)
+			{
+				const uint32_t sy = std::min(by * 4 + y, level.height - 1);
+				for (uint32_t x = 0; x < 4; ++x)
+				{
+					const uint32_t sx = std::min(bx * 4 + x, level.width - 1);
+					const uint8_t* texel = &level.data[(size_t)sy * level.rowPitch + sx * 4];
+					for (uint32_t ch = 0; ch < 4; ++ch)
+						block.c[ch][y * 4 + x] = texel[ch];
+				}
+			}
+		}
+
+		// Picks the closest palette entry per texel over channels [firstChannel, firstChannel + channelCount). Returns the summed squared error.
+		float SelectIndices(const Block& block, const Palette& palette, int firstChannel, int channelCount, uint8_t indices[16])
+		{
+			__m128 total = _mm_setzero_ps();
+			for (int t = 0; t < 16; t += 4)
+			{
+				__m128 best = _mm_set1_ps(FLT_MAX);
+				__m128i bestIndex = _mm_setzero_si128();
+				for (int k = 0; k < palette.count; ++k)
+				{
+					__m128 dist = _mm_setzero_ps();
+					for (int ch = firstChannel; ch < firstChannel + channelCount; ++ch)
+					{
+						const __m128 diff = _mm_sub_ps(_mm_load_ps(&block.c[ch][t]), _mm_set1_ps(palette.c[k][ch]));
+						dist = _mm_add_ps(dist, _mm_mul_ps(diff, diff));
+					}
+
+					const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(dist, best));
+					bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, bestIndex));
+					best = _mm_min_ps(dist, best);
+				}
+
+				alignas(16) int32_t lanes[4];
+				_mm_store_si128((__m128i*)lanes, bestIndex);
+				for (int i = 0; i < 4; ++i)
+					indices[t + i] = (uint8_t)lanes[i];
+				total = _mm_add_ps(total, best);
+			}
+
+			alignas(16) float sums[4];
+			_mm_store_ps(sums, total);
+			return sums[0] + sums[1] + sums[2] + sums[3];
+		}
+
+		// Least squares endpoints for fixed indices, where palette entry i = lerp(e0, e1, weights[i])
+		bool FitEndpoints(const Block& block, const uint8_t indices[16], const float* weights, int firstChannel, int channelCount, float e0[4], float e1[4])
+		{
+			float a = 0.f, b = 0.f, c = 0.f;
+			float r0[4] = {}, r1[4] = {};
+			for (int t = 0; t < 16; ++t)
+			{
+				const float w = weights[indices[t]];
+				const float iw = 1.f - w;
+				a += iw * iw;
+				b += iw * w;
+				c += w * w;
+				for (int ch = firstChannel; ch < firstChannel + channelCount; ++ch)
+				{
+					r0[ch] += iw * block.c[ch][t];
+					r1[ch] += w * block.c[ch][t];
+				}
+			}
+
+			const float det = a * c - b * b;
+			if (std::abs(det) < 1e-6f)
+				return false;
+
+			const float invDet = 1.f / det;
+			for (int ch = firstChannel; ch < firstChannel + channelCount; ++ch)
+			{
+				e0[ch] = std::clamp((c * r0[ch] - b * r1[ch]) * invDet, 0.f, 255.f);
+				e1[ch] = std::clamp((a * r1[ch] - b * r0[ch]) * invDet, 0.f, 255.f);
+			}
+			return true;
+		}
+
+		// Endpoints at the extremes of the principal axis (power iteration on the covariance matrix)
+		void PrincipalAxisEndpoints(const Block& block, int channelCount, float e0[4], float e1[4])
+		{
+			float mean[4] = {};
+			for (int ch = 0; ch < channelCount; ++ch)
+			{
+				for (int t = 0; t < 16; ++t)
+					mean[ch] += block.c[ch][t];
+				mean[ch] /= 16.f;
+			}
+
+			float cov[4][4] = {};
+			for (int t = 0; t < 16; ++t)
+			{
+				for (int i = 0; i < channelCount; ++i)
+					for (int j = i; j < channelCount; ++j)
+						cov[i][j] += (block.c[i][t] - mean[i]) * (block.c[j][t] - mean[j]);
+			}
+			for (int i = 0; i < channelCount; ++i)
+				for (int j = 0; j < i; ++j)
+					cov[i][j] = cov[j][i];
+
+			float axis[4] = { 1.f, 1.f, 1.f, 1.f };
+			for (int iter = 0; iter < 8; ++iter)
+			{
+				float next[4] = {};
+				float len = 0.f;
+				for (int i = 0; i < channelCount; ++i)
+				{
+					for (int j = 0; j < channelCount; ++j)
+						next[i] += cov[i][j] * axis[j];
+					len += next[i] * next[i];
+				}
+				if (len < 1e-12f)
+					break;
+
+				len = 1.f / std::sqrt(len);
+				for (int i = 0; i < channelCount; ++i)
+					axis[i] = next[i] * len;
+			}
+
+			float minProj = FLT_MAX, maxProj = -FLT_MAX;
+			for (int t = 0; t < 16; ++t)
+			{
+				float proj = 0.f;
+				for (int ch = 0; ch < channelCount; ++ch)
+					proj += (block.c[ch][t] - mean[ch]) * axis[ch];
+				minProj = std::min(minProj, proj);
+				maxProj = std::max(maxProj, proj);
+			}
+
+			for (int ch = 0; ch < channelCount; ++ch)
+			{
+				e0[ch] = std::clamp(mean[ch] + axis[ch] * maxProj, 0.f, 255.f);
+				e1[ch] = std::clamp(mean[ch] + axis[ch] * minProj, 0.f, 255.f);
+			}
+		}
+
+		class BitWriter
+		{
+		public:
+			BitWriter(uint8_t* out, uint32_t size) : m_out(out) { std::memset(out, 0, size); }
+
+			void Write(uint32_t value, uint32_t bits)
+			{
+				for (uint32_t i = 0; i < bits; ++i, ++m_pos)
+					m_out[m_pos >> 3] |= ((value >> i) & 1) << (m_pos & 7);
+			}
+
+		private:
+			uint8_t* m_out;
+			uint32_t m_pos = 0;
+		};
+
+		uint32_t ReadBits(const uint8_t* in, uint32_t& pos, uint32_t bits)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < bits; ++i, ++pos)
+				value |= ((in[pos >> 3] >> (pos & 7)) & 1) << i;
+			return value;
+		}
+
+		// ---- BC1 ----
+
+		uint16_t To565(const float c[4])
+		{
+			const uint32_t r = (uint32_t)std::clamp((int)std::lround(c[0] * 31.f / 255.f), 0, 31);
+			const uint32_t g = (uint32_t)std::clamp((int)std::lround(c[1] * 63.f / 255.f), 0, 63);
+			const uint32_t b = (uint32_t)std::clamp((int)std::lround(c[2] * 31.f / 255.f), 0, 31);
+			return (uint16_t)((r << 11) | (g << 5) | b);
+		}
+
+		void From565(uint16_t v, float c[4])
+		{
+			const uint32_t r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+			c[0] = (float)((r << 3) | (r >> 2));
+			c[1] = (float)((g << 2) | (g >> 4));
+			c[2] = (float)((b << 3) | (b >> 2));
+			c[3] = 255.f;
+		}
+
+		void BuildBC1Palette(uint16_t c0, uint16_t c1, bool forceFourColor, Palette& palette)
+		{
+			From565(c0, palette.c[0]);
+			From565(c1, palette.c[1]);
+			palette.count = 4;
+			for (int ch = 0; ch < 4; ++ch)
+			{
+				if (c0 > c1 || forceFourColor)
+				{
+					palette.c[2][ch] = std::round((2.f * palette.c[0][ch] + palette.c[1][ch]) / 3.f);
+					palette.c[3][ch] = std::round((palette.c[0][ch] + 2.f * palette.c[1][ch]) / 3.f);
+				}
+				else
+				{
+					palette.c[2][ch] = std::round((palette.c[0][ch] + palette.c[1][ch]) * 0.5f);
+					palette.c[3][ch] = 0.f;
+				}
+			}
+			if (!(c0 > c1 || forceFourColor))
+				palette.c[3][3] = 0.f;		// Transparent black (never chosen by the encoder)
+		}
+
+		void EncodeBC1(const Block& block, uint8_t out[8])
+		{
+			static constexpr float weights[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+
+			float e0[4], e1[4];
+			PrincipalAxisEndpoints(block, 3, e0, e1);
+
+			float bestError = FLT_MAX;
+			uint16_t bestC0 = 0, bestC1 = 0;
+			uint8_t bestIndices[16] = {};
+
+			for (int iter = 0; iter <= s_refineIterations; ++iter)
+			{
+				uint16_t c0 = To565(e0);
+				uint16_t c1 = To565(e1);
+				if (c0 < c1)
+					std::swap(c0, c1);		// Four color mode requires c0 > c1
+
+				Palette palette;
+				BuildBC1Palette(c0, c1, true, palette);
+				if (c0 == c1)
+					palette.count = 1;
+
+				uint8_t indices[16];
+				const float error = SelectIndices(block, palette, 0, 3, indices);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestC0 = c0;
+					bestC1 = c1;
+					std::memcpy(bestIndices, indices, 16);
+				}
+
+				if (error == 0.f || !FitEndpoints(block, indices, weights, 0, 3, e0, e1))
+					break;
+			}
+
+			std::memcpy(out, &bestC0, 2);
+			std::memcpy(out + 2, &bestC1, 2);
+			uint32_t packed = 0;
+			for (int t = 0; t < 16; ++t)
+				packed |= (uint32_t)bestIndices[t] << (t * 2);
+			std::memcpy(out + 4, &packed, 4);
+		}
+
+		void DecodeBC1(const uint8_t* in, bool forceFourColor, uint8_t texels[16][4])
+		{
+			uint16_t c0, c1;
+			uint32_t packed;
+			std::memcpy(&c0, in, 2);
+			std::memcpy(&c1, in + 2, 2);
+			std::memcpy(&packed, in + 4, 4);
+
+			Palette palette;
+			BuildBC1Palette(c0, c1, forceFourColor, palette);
+			for (int t = 0; t < 16; ++t)
+			{
+				const uint32_t index = (packed >> (t * 2)) & 3;
+				for (int ch = 0; ch < 4; ++ch)
+					texels[t][ch] = (uint8_t)palette.c[index][ch];
+			}
+		}
+
+		// ---- BC4 ----
+
+		void BuildBC4Palette(uint8_t r0, uint8_t r1, int channel, Palette& palette)
+		{
+			palette.count = 8;
+			palette.c[0][channel] = r0;
+			palette.c[1][channel] = r1;
+			if (r0 > r1)
+			{
+				for (int i = 1; i <= 6; ++i)
+					palette.c[i + 1][channel] = std::round(((7 - i) * r0 + i * r1) / 7.f);
+			}
+			else
+			{
+				for (int i = 1; i <= 4; ++i)
+					palette.c[i + 1][channel] = std::round(((5 - i) * r0 + i * r1) / 5.f);
+				palette.c[6][channel] = 0.f;
+				palette.c[7][channel] = 255.f;
+			}
+		}
+
+		void EncodeBC4(const Block& block, int channel, uint8_t out[8])
+		{
+			static constexpr float weights8[8] = { 0.f, 1.f, 1.f / 7.f, 2.f / 7.f, 3.f / 7.f, 4.f / 7.f, 5.f / 7.f, 6.f / 7.f };
+
+			float minValue = 255.f, maxValue = 0.f;
+			float minInner = 255.f, maxInner = 0.f;		// Excluding 0 and 255, which the six value mode has for free
+			for (int t = 0; t < 16; ++t)
+			{
+				const float v = block.c[channel][t];
+				minValue = std::min(minValue, v);
+				maxValue = std::max(maxValue, v);
+				if (v > 0.f && v < 255.f)
+				{
+					minInner = std::min(minInner, v);
+					maxInner = std::max(maxInner, v);
+				}
+			}
+
+			float bestError = FLT_MAX;
+			uint8_t bestR0 = 0, bestR1 = 0;
+			uint8_t bestIndices[16] = {};
+
+			auto tryEndpoints = [&](uint8_t r0, uint8_t r1, uint8_t indices[16]) -> float
+			{
+				Palette palette;
+				BuildBC4Palette(r0, r1, channel, palette);
+				const float error = SelectIndices(block, palette, channel, 1, indices);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestR0 = r0;
+					bestR1 = r1;
+					std::memcpy(bestIndices, indices, 16);
+				}
+				return error;
+			};
+
+			// Eight value mode (r0 > r1), refined
+			float e0[4] = {}, e1[4] = {};
+			e0[channel] = maxValue;
+			e1[channel] = minValue;
+			for (int iter = 0; iter <= s_refineIterations; ++iter)
+			{
+				uint8_t r0 = (uint8_t)std::lround(e0[channel]);
+				uint8_t r1 = (uint8_t)std::lround(e1[channel]);
+				if (r0 < r1)
+					std::swap(r0, r1);
+
+				uint8_t indices[16];
+				const float error = tryEndpoints(r0, r1, indices);
+				if (error == 0.f || r0 == r1 || !FitEndpoints(block, indices, weights8, channel, 1, e0, e1))
+					break;
+			}
+
+			// Six value mode (r0 <= r1) with explicit 0 and 255
+			if (bestError > 0.f && minInner <= maxInner)
+			{
+				uint8_t indices[16];
+				tryEndpoints((uint8_t)minInner, (uint8_t)maxInner, indices);
+			}
+
+			out[0] = bestR0;
+			out[1] = bestR1;
+			uint64_t packed = 0;
+			for (int t = 0; t < 16; ++t)
+				packed |= (uint64_t)bestIndices[t] << (t * 3);
+			for (int i = 0; i < 6; ++i)
+				out[2 + i] = (uint8_t)(packed >> (i * 8));
+		}
+
+		void DecodeBC4(const uint8_t* in, int channel, uint8_t texels[16][4])
+		{
+			Palette palette;
+			BuildBC4Palette(in[0], in[1], channel, palette);
+
+			uint64_t packed = 0;
+			for (int i = 0; i < 6; ++i)
+				packed |= (uint64_t)in[2 + i] << (i * 8);
+
+			for (int t = 0; t < 16; ++t)
+				texels[t][channel] = (uint8_t)palette.c[(packed >> (t * 3)) & 7][channel];
+		}
+
+		// ---- BC7 (mode 6) ----
+
+		constexpr int s_bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		struct BC7Endpoint
+		{
+			uint32_t q[4];		// 7 bit
+			uint32_t p;			// Shared p-bit
+		};
+
+		BC7Endpoint QuantizeBC7Endpoint(const float e[4])
+		{
+			BC7Endpoint best{};
+			float bestError = FLT_MAX;
+			for (uint32_t p = 0; p < 2; ++p)
+			{
+				BC7Endpoint candidate{ .p = p };
+				float error = 0.f;
+				for (int ch = 0; ch < 4; ++ch)
+				{
+					candidate.q[ch] = (uint32_t)std::clamp((int)std::lround((e[ch] - p) * 0.5f), 0, 127);
+					const float diff = (float)((candidate.q[ch] << 1) | p) - e[ch];
+					error += diff * diff;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					best = candidate;
+				}
+			}
+			return best;
+		}
+
+		void BuildBC7Palette(const BC7Endpoint& a, const BC7Endpoint& b, Palette& palette)
+		{
+			palette.count = 16;
+			for (int ch = 0; ch < 4; ++ch)
+			{
+				const int v0 = (int)((a.q[ch] << 1) | a.p);
+				const int v1 = (int)((b.q[ch] << 1) | b.p);
+				for (int i = 0; i < 16; ++i)
+					palette.c[i][ch] = (float)(((64 - s_bc7Weights4[i]) * v0 + s_bc7Weights4[i] * v1 + 32) >> 6);
+			}
+		}
+
+		void EncodeBC7(const Block& block, uint8_t out[16])
+		{
+			static const std::array<float, 16> weights = []()
+			{
+				std::array<float, 16> w{};
+				for (int i = 0; i < 16; ++i)
+					w[i] = s_bc7Weights4[i] / 64.f;
+				return w;
+			}();
+
+			float e0[4], e1[4];
+			PrincipalAxisEndpoints(block, 4, e0, e1);
+
+			float bestError = FLT_MAX;
+			BC7Endpoint best0{}, best1{};
+			uint8_t bestIndices[16] = {};
+
+			for (int iter = 0; iter <= s_refineIterations; ++iter)
+			{
+				const BC7Endpoint a = QuantizeBC7Endpoint(e0);
+				const BC7Endpoint b = QuantizeBC7Endpoint(e1);
+
+				Palette palette;
+				BuildBC7Palette(a, b, palette);
+
+				uint8_t indices[16];
+				const float error = SelectIndices(block, palette, 0, 4, indices);
+				if (error < bestError)
+				{
+					bestError = error;
+					best0 = a;
+					best1 = b;
+					std::memcpy(bestIndices, indices, 16);
+				}
+
+				if (error == 0.f || !FitEndpoints(block, indices, weights.data(), 0, 4, e0, e1))
+					break;
+			}
+
+			// The anchor (texel 0) index is stored with its MSB implied zero
+			if (bestIndices[0] & 8)
+			{
+				std::swap(best0, best1);
+				for (int t = 0; t < 16; ++t)
+					bestIndices[t] = 15 - bestIndices[t];
+			}
+
+			BitWriter writer(out, 16);
+			writer.Write(1 << 6, 7);		// Mode 6
+			for (int ch = 0; ch < 4; ++ch)
+			{
+				writer.Write(best0.q[ch], 7);
+				writer.Write(best1.q[ch], 7);
+			}
+			writer.Write(best0.p, 1);
+			writer.Write(best1.p, 1);
+			writer.Write(bestIndices[0], 3);
+			for (int t = 1; t < 16; ++t)
+				writer.Write(bestIndices[t], 4);
+		}
+
+		bool DecodeBC7(const uint8_t* in, uint8_t texels[16][4])
+		{
+			uint32_t pos = 0;
+			if (ReadBits(in, pos, 7) != (1 << 6))
+				return false;		// Only mode 6 is decoded (the only mode we write)
+
+			BC7Endpoint a{}, b{};
+			for (int ch = 0; ch < 4; ++ch)
+			{
+				a.q[ch] = ReadBits(in, pos, 7);
+				b.q[ch] = ReadBits(in, pos, 7);
+			}
+			a.p = ReadBits(in, pos, 1);
+			b.p = ReadBits(in, pos, 1);
+
+			Palette palette;
+			BuildBC7Palette(a, b, palette);
+			for (int t = 0; t < 16; ++t)
+			{
+				const uint32_t index = ReadBits(in, pos, t == 0 ? 3 : 4);
+				for (int ch = 0; ch < 4; ++ch)
+					texels[t][ch] = (uint8_t)palette.c[index][ch];
+			}
+			return true;
+		}
+
+		void EncodeBlock(const Block& block, BCFormat format, uint8_t* out)
+		{
+			switch (format)
+			{
+			case BCFormat::BC1:
+				EncodeBC1(block, out);
+				break;
+			case BCFormat::BC3:
+				EncodeBC4(block, 3, out);
+				EncodeBC1(block, out + 8);
+				break;
+			case BCFormat::BC4:
+				EncodeBC4(block, 0, out);
+				break;
+			case BCFormat::BC5:
+				EncodeBC4(block, 0, out);
+				EncodeBC4(block, 1, out + 8);
+				break;
+			case BCFormat::BC7:
+				EncodeBC7(block, out);
+				break;
+			}
+		}
+
+		void DecodeBlock(const uint8_t* in, BCFormat format, uint8_t texels[16][4])
+		{
+			for (int t = 0; t < 16; ++t)
+			{
+				texels[t][0] = texels[t][1] = texels[t][2] = 0;
+				texels[t][3] = 255;
+			}
+
+			switch (format)
+			{
+			case BCFormat::BC1:
+				DecodeBC1(in, false, texels);
+				break;
+			case BCFormat::BC3:
+				DecodeBC1(in + 8, true, texels);		// BC2/BC3 color blocks are always four color
+				DecodeBC4(in, 3, texels);
+				break;
+			case BCFormat::BC4:
+				DecodeBC4(in, 0, texels);
+				break;
+			case BCFormat::BC5:
+				DecodeBC4(in, 0, texels);
+				DecodeBC4(in + 8, 1, texels);
+				break;
+			case BCFormat::BC7:
+				if (!DecodeBC7(in, texels))
+				{
+					std::cout << "Gino::BCEncoder : Unsupported BC7 mode, only mode 6 can be decoded\n";
+					assert(false);
+				}
+				break;
+			}
+		}
+	}
+
+	BCEncoder::BCEncoder(ThreadPool* threadPool) :
+		m_threadPool(threadPool)
+	{
+	}
+
+	CompressedTexture BCEncoder::Compress(const MipChain& chain, BCFormat format, bool srgb) const
+	{
+		if (chain.hdr)
+		{
+			std::cout << "Gino::BCEncoder : HDR chains can not be compressed to LDR block formats\n";
+			assert(false);
+			return {};
+		}
+
+		const uint32_t blockSize = GetBlockSize(format);
+
+		CompressedTexture texture;
+		texture.format = format;
+		texture.srgb = srgb;
+		texture.levels.resize(chain.levels.size());
+
+		// One job per few block rows over the whole chain, so small tail levels don't serialize
+		struct Job
+		{
+			uint32_t level;
+			uint32_t firstBlockRow;
+		};
+		std::vector<Job> jobs;
+
+		for (uint32_t i = 0; i < chain.levels.size(); ++i)
+		{
+			const auto& src = chain.levels[i];
+			auto& dst = texture.levels[i];
+			const uint32_t blocksX = (src.width + 3) / 4;
+			const uint32_t blocksY = (src.height + 3) / 4;
+
+			dst.width = src.width;
+			dst.height = src.height;
+			dst.rowPitch = blocksX * blockSize;
+			dst.data.resize((size_t)dst.rowPitch * blocksY);
+
+			for (uint32_t by = 0; by < blocksY; by += s_blockRowsPerJob)
+				jobs.push_back({ i, by });
+		}
+
+		auto compressJob = [&chain, &texture, &jobs, format, blockSize](uint32_t jobIndex)
+		{
+			const Job& job = jobs[jobIndex];
+			const auto& src = chain.levels[job.level];
+			auto& dst = texture.levels[job.level];
+			const uint32_t blocksX = (src.width + 3) / 4;
+			const uint32_t blocksY = (src.height + 3) / 4;
+
+			Block block;
+			for (uint32_t by = job.firstBlockRow; by < std::min(job.firstBlockRow + s_blockRowsPerJob, blocksY); ++by)
+			{
+				for (uint32_t bx = 0; bx < blocksX; ++bx)
+				{
+					LoadBlock(src, bx, by, block);
+					EncodeBlock(block, format, &dst.data[(size_t)by * dst.rowPitch + bx * blockSize]);
+				}
+			}
+		};
+
+		if (m_threadPool)
+			m_threadPool->ParallelFor(static_cast<uint32_t>(jobs.size()), compressJob);
+		else
+		{
+			for (uint32_t i = 0; i < jobs.size(); ++i)
+				compressJob(i);
+		}
+
+		return texture;
+	}
+
+	MipChain BCEncoder::Decompress(const CompressedTexture& texture)
+	{
+		const uint32_t blockSize = GetBlockSize(texture.format);
+
+		MipChain chain;
+		chain.levels.resize(texture.levels.size());
+		for (size_t i = 0; i < texture.levels.size(); ++i)
+		{
+			const auto& src = texture.levels[i];
+			auto& dst = chain.levels[i];
+			dst.width = src.width;
+			dst.height = src.height;
+			dst.rowPitch = src.width * 4;
+			dst.data.resize((size_t)dst.rowPitch * dst.height);
+
+			uint8_t texels[16][4];
+			for (uint32_t by = 0; by < (src.height + 3) / 4; ++by)
+			{
+				for (uint32_t bx = 0; bx < (src.width + 3) / 4; ++bx)
+				{
+					DecodeBlock(&src.data[(size_t)by * src.rowPitch + bx * blockSize], texture.format, texels);
+					for (uint32_t t = 0; t < 16; ++t)
+					{
+						const uint32_t x = bx * 4 + t % 4;
+						const uint32_t y = by * 4 + t / 4;
+						if (x < dst.width && y < dst.height)
+							std::memcpy(&dst.data[(size_t)y * dst.rowPitch + x * 4], texels[t], 4);
+					}
+				}
+			}
+		}
+		return chain;
+	}
+
+	float BCEncoder::CalcPSNR(const MipLevel& reference, const MipLevel& decoded, BCFormat format)
+	{
+		assert(reference.width == decoded.width && reference.height == decoded.height);
+
+		uint32_t firstChannel = 0, channelCount = 4;
+		switch (format)
+		{
+		case BCFormat::BC1:	channelCount = 3; break;
+		case BCFormat::BC4:	channelCount = 1; break;
+		case BCFormat::BC5:	channelCount = 2; break;
+		default: break;
+		}
+
+		double sumSq = 0.0;
+		for (uint32_t y = 0; y < reference.height; ++y)
+		{
+			const uint8_t* a = &reference.data[(size_t)y * reference.rowPitch];
+			const uint8_t* b = &decoded.data[(size_t)y * decoded.rowPitch];
+			for (uint32_t x = 0; x < reference.width; ++x)
+			{
+				for (uint32_t ch = firstChannel; ch < firstChannel + channelCount; ++ch)
+				{
+					const double diff = (double)a[x * 4 + ch] - b[x * 4 + ch];
+					sumSq += diff * diff;
+				}
+			}
+		}
+
+		const double mse = sumSq / ((double)reference.width * reference.height * channelCount);
+		if (mse == 0.0)
+			return std::numeric_limits<float>::infinity();
+		return (float)(10.0 * std::log10(255.0 * 255.0 / mse));
+	}
+
+	uint32_t BCEncoder::GetBlockSize(BCFormat format)
+	{
+		return (format == BCFormat::BC1 || format == BCFormat::BC4) ? 8 : 16;
+	}
+
+	const char* BCEncoder::GetFormatName(BCFormat format)
+	{
+		switch (format)
+		{
+		case BCFormat::BC1: return "BC1";
+		case BCFormat::BC3: return "BC3";
+		case BCFormat::BC4: return "BC4";
+		case BCFormat::BC5: return "BC5";
+		case BCFormat::BC7: return "BC7";
+		}
+		return "Unknown";
+	}
+}
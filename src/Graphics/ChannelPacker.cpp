@@ -0,0 +1,108 @@
+#include "pch.h"
+#include "Graphics/ChannelPacker.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace Gino
+{
+	namespace
+	{
+		constexpr uint64_t s_ormLayoutVersion = 1;		// Bump when the packed contents change
+
+		// Bilinear .r of an RGBA8 image at the texel centers of a width x height grid
+		uint8_t SampleRed(const Utils::ImageData& image, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+		{
+			const float u = std::max((x + 0.5f) * image.texWidth / width - 0.5f, 0.f);
+			const float v = std::max((y + 0.5f) * image.texHeight / height - 0.5f, 0.f);
+			const uint32_t x0 = std::min(static_cast<uint32_t>(u), image.texWidth - 1);
+			const uint32_t y0 = std::min(static_cast<uint32_t>(v), image.texHeight - 1);
+			const uint32_t x1 = std::min(x0 + 1, image.texWidth - 1);
+			const uint32_t y1 = std::min(y0 + 1, image.texHeight - 1);
+			const float fx = u - x0;
+			const float fy = v - y0;
+
+			auto texel = [&image](uint32_t tx, uint32_t ty) { return static_cast<float>(image.pixels[((size_t)ty * image.texWidth + tx) * 4]); };
+			const float top = texel(x0, y0) + (texel(x1, y0) - texel(x0, y0)) * fx;
+			const float bottom = texel(x0, y1) + (texel(x1, y1) - texel(x0, y1)) * fx;
+			return static_cast<uint8_t>(std::min(top + (bottom - top) * fy + 0.5f, 255.f));
+		}
+	}
+
+	std::string ChannelPacker::GetPackedPath(const std::string& occlusionPath, const std::string& metallicRoughnessPath)
+	{
+		if (occlusionPath.empty() && metallicRoughnessPath.empty())
+			return "default.orm";
+
+		// Next to the sources so that it reads like them in logs, unique per pair of sources
+		const std::filesystem::path namedAfter = metallicRoughnessPath.empty() ? occlusionPath : metallicRoughnessPath;
+		const std::string pair = occlusionPath + "|" + metallicRoughnessPath;
+
+		return (namedAfter.parent_path() / Utils::HashedFileName(namedAfter, Utils::HashBytes(pair.data(), pair.size()), ".orm")).generic_string();
+	}
+
+	uint64_t ChannelPacker::HashSources(const std::string& occlusionPath, const std::string& metallicRoughnessPath)
+	{
+		const uint64_t hashes[] =
+		{
+			s_ormLayoutVersion,
+			occlusionPath.empty() ? 0 : Utils::HashFile(occlusionPath),
+			metallicRoughnessPath.empty() ? 0 : Utils::HashFile(metallicRoughnessPath)
+		};
+		return Utils::HashBytes(hashes, sizeof(hashes));
+	}
+
+	Utils::ImageData ChannelPacker::PackORM(const std::string& occlusionPath, const std::string& metallicRoughnessPath)
+	{
+		if (occlusionPath.empty() && metallicRoughnessPath.empty())
+		{
+			// Allocated the way stb_image does, so that ImageData::Release frees it
+			unsigned char* texel = static_cast<unsigned char*>(std::malloc(4));
+			texel[0] = 255;
+			texel[1] = texel[2] = 0;
+			texel[3] = 255;
+			return Utils::ImageData(texel, 4, 1, 1, 4);
+		}
+
+		// The metallicRoughness image is packed in place, its G and B already are in the ORM layout
+		if (!metallicRoughnessPath.empty())
+		{
+			Utils::ImageData orm = Utils::ReadImageFile(metallicRoughnessPath);
+			Utils::ImageData occlusion;
+			if (!occlusionPath.empty())
+				occlusion = Utils::ReadImageFile(occlusionPath);
+
+			const bool sameSize = occlusion.pixels && occlusion.texWidth == orm.texWidth && occlusion.texHeight == orm.texHeight;
+			for (uint32_t y = 0; y < orm.texHeight; ++y)
+			{
+				for (uint32_t x = 0; x < orm.texWidth; ++x)
+				{
+					const size_t texel = ((size_t)y * orm.texWidth + x) * 4;
+					if (!occlusion.pixels)
+						orm.pixels[texel] = 255;
+					else if (sameSize)
+						orm.pixels[texel] = occlusion.pixels[texel];
+					else
+						orm.pixels[texel] = SampleRed(occlusion, x, y, orm.texWidth, orm.texHeight);
+					orm.pixels[texel + 3] = 255;
+				}
+			}
+
+			occlusion.Release();
+			orm.texChannels = 4;
+			return orm;
+		}
+
+		// Occlusion only: keep its R, no roughness or metalness
+		Utils::ImageData orm = Utils::ReadImageFile(occlusionPath);
+		const size_t texelCount = (size_t)orm.texWidth * orm.texHeight;
+		for (size_t texel = 0; texel < texelCount; ++texel)
+		{
+			orm.pixels[texel * 4 + 1] = 0;
+			orm.pixels[texel * 4 + 2] = 0;
+			orm.pixels[texel * 4 + 3] = 255;
+		}
+		orm.texChannels = 4;
+		return orm;
+	}
+}
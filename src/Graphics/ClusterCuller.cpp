@@ -0,0 +1,57 @@
+#include "pch.h"
+#include "Graphics/ClusterCuller.h"
+
+namespace Gino
+{
+	using namespace DirectX::SimpleMath;
+
+	ClusterCullView ClusterCuller::MakeView(const Matrix& world, const Matrix& view, const Matrix& projection, const Vector3& cameraPosition)
+	{
+		// Row vector convention (clip = p * M): planes are sums/differences of the columns of M (Gribb/Hartmann), D3D clip z in [0, w]
+		const Matrix m = world * view * projection;
+		const Vector4 col0(m._11, m._21, m._31, m._41);
+		const Vector4 col1(m._12, m._22, m._32, m._42);
+		const Vector4 col2(m._13, m._23, m._33, m._43);
+		const Vector4 col3(m._14, m._24, m._34, m._44);
+
+		ClusterCullView cullView{};
+		cullView.planes[0] = col3 + col0;		// Left
+		cullView.planes[1] = col3 - col0;		// Right
+		cullView.planes[2] = col3 + col1;		// Bottom
+		cullView.planes[3] = col3 - col1;		// Top
+		cullView.planes[4] = col2;				// Near
+		cullView.planes[5] = col3 - col2;		// Far
+
+		cullView.cameraPosition = Vector3::Transform(cameraPosition, world.Invert());
+		return cullView;
+	}
+
+	bool ClusterCuller::IsInFrustum(const MeshCluster& cluster, const ClusterCullView& view)
+	{
+		for (const auto& plane : view.planes)
+		{
+			// Corner of the AABB furthest along the plane normal
+			const float x = plane.x >= 0.f ? cluster.aabbMax[0] : cluster.aabbMin[0];
+			const float y = plane.y >= 0.f ? cluster.aabbMax[1] : cluster.aabbMin[1];
+			const float z = plane.z >= 0.f ? cluster.aabbMax[2] : cluster.aabbMin[2];
+			if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.f)
+				return false;
+		}
+		return true;
+	}
+
+	bool ClusterCuller::IsBackfacing(const MeshCluster& cluster, const ClusterCullView& view)
+	{
+		if (cluster.coneCutoff >= MeshCluster::s_noCone)
+			return false;
+
+		const Vector3 toCenter = Vector3(cluster.center[0], cluster.center[1], cluster.center[2]) - view.cameraPosition;
+		const Vector3 axis(cluster.coneAxis[0], cluster.coneAxis[1], cluster.coneAxis[2]);
+		return toCenter.Dot(axis) >= cluster.coneCutoff * toCenter.Length() + cluster.radius;
+	}
+
+	bool ClusterCuller::IsVisible(const MeshCluster& cluster, const ClusterCullView& view)
+	{
+		return IsInFrustum(cluster, view) && !IsBackfacing(cluster, view);
+	}
+}
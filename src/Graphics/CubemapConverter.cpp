@@ -0,0 +1,278 @@
+#include "pch.h"
+#include "Graphics/CubemapConverter.h"
+#include "AssetArchive.h"
+#include "Timer.h"
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace Gino
+{
+	namespace
+	{
+		constexpr float s_pi = 3.14159265358979f;
+		constexpr uint32_t s_rowsPerJob = 16;
+		constexpr uint32_t s_superSamples = 4;		// Per axis, per level 0 texel
+
+		constexpr uint32_t s_cubeMagic = 0x42554347;	// 'GCUB'
+		constexpr uint32_t s_cubeVersion = 1;
+
+		struct CubeFileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t faceSize;
+			uint32_t mipCount;
+		};
+
+		// Bilinear tap of an RGBA32F equirect, wrapping horizontally and clamping at the poles.
+		// Same mapping the sky shader used: u = atan2(z, x) / 2pi, v = acos(y) / pi.
+		__m128 SampleEquirect(const float* pixels, uint32_t width, uint32_t height, float x, float y, float z)
+		{
+			const float length = std::sqrt(x * x + y * y + z * z);
+			float u = std::atan2(z, x) / (2.f * s_pi);
+			u -= std::floor(u);
+			const float v = std::acos(std::clamp(y / length, -1.f, 1.f)) / s_pi;
+
+			const float fx = u * width - 0.5f;
+			const float fy = v * height - 0.5f;
+			const float x0f = std::floor(fx);
+			const float y0f = std::floor(fy);
+			const float wx = fx - x0f;
+			const float wy = fy - y0f;
+
+			const int32_t w = static_cast<int32_t>(width);
+			const int32_t h = static_cast<int32_t>(height);
+			const int32_t x0 = ((static_cast<int32_t>(x0f) % w) + w) % w;
+			const int32_t x1 = (x0 + 1) % w;
+			const int32_t y0 = std::clamp(static_cast<int32_t>(y0f), 0, h - 1);
+			const int32_t y1 = std::clamp(static_cast<int32_t>(y0f) + 1, 0, h - 1);
+
+			const __m128 t00 = _mm_loadu_ps(&pixels[((size_t)y0 * width + x0) * 4]);
+			const __m128 t10 = _mm_loadu_ps(&pixels[((size_t)y0 * width + x1) * 4]);
+			const __m128 t01 = _mm_loadu_ps(&pixels[((size_t)y1 * width + x0) * 4]);
+			const __m128 t11 = _mm_loadu_ps(&pixels[((size_t)y1 * width + x1) * 4]);
+
+			const __m128 wx4 = _mm_set1_ps(wx);
+			const __m128 top = _mm_add_ps(t00, _mm_mul_ps(_mm_sub_ps(t10, t00), wx4));
+			const __m128 bottom = _mm_add_ps(t01, _mm_mul_ps(_mm_sub_ps(t11, t01), wx4));
+			return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), _mm_set1_ps(wy)));
+		}
+	}
+
+	const std::vector<uint16_t>& CubeMapData::GetSubresource(uint32_t face, uint32_t mip) const
+	{
+		return subresources[face * mipCount + mip];
+	}
+
+	CubemapConverter::CubemapConverter(ThreadPool* threadPool) :
+		m_threadPool(threadPool)
+	{
+	}
+
+	void CubemapConverter::GetFaceDirection(uint32_t face, float s, float t, float& x, float& y, float& z)
+	{
+		switch (face)
+		{
+		case 0: x = 1.f;	y = -t;		z = -s;		break;		// +x
+		case 1: x = -1.f;	y = -t;		z = s;		break;		// -x
+		case 2: x = s;		y = 1.f;	z = t;		break;		// +y
+		case 3: x = s;		y = -1.f;	z = -t;		break;		// -y
+		case 4: x = s;		y = -t;		z = 1.f;	break;		// +z
+		default: x = -s;	y = -t;		z = -1.f;	break;		// -z
+		}
+	}
+
+	CubeMapData CubemapConverter::Convert(const Utils::ImageData& equirect, uint32_t faceSize) const
+	{
+		assert(equirect.hdrFpPixels != nullptr && equirect.texChannels == 4);
+
+		const float* pixels = equirect.hdrFpPixels;
+		const uint32_t width = equirect.texWidth;
+		const uint32_t height = equirect.texHeight;
+		if (faceSize == 0)
+		{
+			faceSize = 1;
+			while (faceSize < width / 4)
+				faceSize <<= 1;
+		}
+
+		CubeMapData cube;
+		cube.faceSize = faceSize;
+		cube.mipCount = Utils::CalcMipCount(faceSize);
+		cube.subresources.resize(6 * cube.mipCount);
+
+		// Level 0 of all faces in float, rows of all faces are one range so that small faces still spread over the pool
+		uint32_t size = faceSize;
+		std::vector<float> current((size_t)6 * size * size * 4);
+		Utils::ForRows(m_threadPool, 6 * size, s_rowsPerJob, [&](uint32_t begin, uint32_t end)
+			{
+				const float invSize = 1.f / size;
+				const __m128 invSamples = _mm_set1_ps(1.f / (s_superSamples * s_superSamples));
+				for (uint32_t row = begin; row < end; ++row)
+				{
+					const uint32_t face = row / size;
+					const uint32_t y = row % size;
+					float* dst = &current[(size_t)row * size * 4];
+					for (uint32_t x = 0; x < size; ++x)
+					{
+						__m128 sum = _mm_setzero_ps();
+						for (uint32_t sy = 0; sy < s_superSamples; ++sy)
+						{
+							const float t = (y + (sy + 0.5f) / s_superSamples) * invSize * 2.f - 1.f;
+							for (uint32_t sx = 0; sx < s_superSamples; ++sx)
+							{
+								const float s = (x + (sx + 0.5f) / s_superSamples) * invSize * 2.f - 1.f;
+								float dx, dy, dz;
+								GetFaceDirection(face, s, t, dx, dy, dz);
+								sum = _mm_add_ps(sum, SampleEquirect(pixels, width, height, dx, dy, dz));
+							}
+						}
+						_mm_storeu_ps(&dst[x * 4], _mm_mul_ps(sum, invSamples));
+					}
+				}
+			});
+
+		std::vector<float> next;
+		for (uint32_t mip = 0; mip < cube.mipCount; ++mip)
+		{
+			// Store the level as half floats
+			for (uint32_t face = 0; face < 6; ++face)
+				cube.subresources[face * cube.mipCount + mip].resize((size_t)size * size * 4);
+			Utils::ForRows(m_threadPool, 6 * size, s_rowsPerJob, [&](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t row = begin; row < end; ++row)
+					{
+						const uint32_t face = row / size;
+						const uint32_t y = row % size;
+						auto& subresource = cube.subresources[face * cube.mipCount + mip];
+						const float* src = &current[(size_t)row * size * 4];
+						uint16_t* dst = &subresource[(size_t)y * size * 4];
+						for (uint32_t i = 0; i < size * 4; ++i)
+							dst[i] = Utils::FloatToHalf(src[i]);
+					}
+				});
+
+			if (mip + 1 == cube.mipCount)
+				break;
+
+			// 2x2 box filter into the next level (power of two faces, so every texel has four parents)
+			const uint32_t nextSize = size / 2;
+			next.assign((size_t)6 * nextSize * nextSize * 4, 0.f);
+			Utils::ForRows(m_threadPool, 6 * nextSize, s_rowsPerJob, [&](uint32_t begin, uint32_t end)
+				{
+					const __m128 quarter = _mm_set1_ps(0.25f);
+					for (uint32_t row = begin; row < end; ++row)
+					{
+						const uint32_t face = row / nextSize;
+						const uint32_t y = row % nextSize;
+						const float* src0 = &current[((size_t)face * size + y * 2) * size * 4];
+						const float* src1 = src0 + (size_t)size * 4;
+						float* dst = &next[(size_t)row * nextSize * 4];
+						for (uint32_t x = 0; x < nextSize; ++x)
+						{
+							const __m128 a = _mm_add_ps(_mm_loadu_ps(&src0[x * 8]), _mm_loadu_ps(&src0[x * 8 + 4]));
+							const __m128 b = _mm_add_ps(_mm_loadu_ps(&src1[x * 8]), _mm_loadu_ps(&src1[x * 8 + 4]));
+							_mm_storeu_ps(&dst[x * 4], _mm_mul_ps(_mm_add_ps(a, b), quarter));
+						}
+					}
+				});
+
+			std::swap(current, next);
+			size = nextSize;
+		}
+
+		return cube;
+	}
+
+	CubeMapData CubemapConverter::LoadOrConvert(const std::filesystem::path& sourcePath) const
+	{
+		const auto cachePath = GetCachePath(sourcePath);
+
+		CubeMapData cube;
+		if (IsCacheUpToDate(sourcePath) && Read(cachePath, cube))
+			return cube;
+
+		Timer convertTimer;
+		auto image = Utils::ReadImageFile(sourcePath, true);
+		cube = Convert(image);
+		image.Release();
+		Write(cachePath, cube);
+
+		std::cout << "Gino::CubemapConverter : " << sourcePath << " -> " << cube.faceSize << "x" << cube.faceSize << " cube, " << cube.mipCount << " mips in "
+			<< convertTimer.TimeElapsed() * 1000.f << " ms (cached to " << cachePath << ")\n";
+		return cube;
+	}
+
+	std::filesystem::path CubemapConverter::GetCachePath(const std::filesystem::path& sourcePath)
+	{
+		const std::string pathStr = sourcePath.lexically_normal().generic_string();
+
+		return std::filesystem::path("cache/cubemaps") / Utils::HashedFileName(sourcePath, Utils::HashBytes(pathStr.data(), pathStr.size()), ".cube");
+	}
+
+	bool CubemapConverter::IsCacheUpToDate(const std::filesystem::path& sourcePath)
+	{
+		std::error_code ec;
+		const auto cacheTime = std::filesystem::last_write_time(GetCachePath(sourcePath), ec);
+		if (ec)
+			return false;
+
+		// An archived source is as old as the archive
+		auto sourceTime = std::filesystem::last_write_time(sourcePath, ec);
+		const AssetArchive* archive = AssetArchive::GetMounted();
+		if (archive && archive->Contains(sourcePath))
+			sourceTime = std::filesystem::last_write_time(archive->GetArchivePath(), ec);
+		return !ec && cacheTime >= sourceTime;
+	}
+
+	bool CubemapConverter::Write(const std::filesystem::path& filePath, const CubeMapData& cube)
+	{
+		return Utils::WriteFileAtomic(filePath, [&](std::ofstream& file)
+			{
+				const CubeFileHeader header{ s_cubeMagic, s_cubeVersion, cube.faceSize, cube.mipCount };
+				file.write((const char*)&header, sizeof(header));
+				for (const auto& subresource : cube.subresources)
+					file.write((const char*)subresource.data(), subresource.size() * sizeof(uint16_t));
+			}, "CubemapConverter");
+	}
+
+	bool CubemapConverter::Read(const std::filesystem::path& filePath, CubeMapData& cube)
+	{
+		std::ifstream file(filePath, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		CubeFileHeader header{};
+		file.read((char*)&header, sizeof(header));
+		if (!file || header.magic != s_cubeMagic || header.version != s_cubeVersion ||
+			!Utils::IsPowerOfTwo(header.faceSize) || header.mipCount != Utils::CalcMipCount(header.faceSize))
+		{
+			std::cout << "Gino::CubemapConverter : Invalid cube file: " << filePath << "\n";
+			return false;
+		}
+
+		cube.faceSize = header.faceSize;
+		cube.mipCount = header.mipCount;
+		cube.subresources.resize(6 * header.mipCount);
+		for (uint32_t face = 0; face < 6; ++face)
+		{
+			for (uint32_t mip = 0; mip < header.mipCount; ++mip)
+			{
+				const uint32_t size = header.faceSize >> mip;
+				auto& subresource = cube.subresources[face * header.mipCount + mip];
+				subresource.resize((size_t)size * size * 4);
+				file.read((char*)subresource.data(), subresource.size() * sizeof(uint16_t));
+			}
+		}
+
+		if (!file)
+		{
+			std::cout << "Gino::CubemapConverter : Truncated cube file: " << filePath << "\n";
+			return false;
+		}
+		return true;
+	}
+}
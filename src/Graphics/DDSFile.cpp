@@ -0,0 +1,301 @@
+#include "pch.h"
+#include "Graphics/DDSFile.h"
+#include "Graphics/BCEncoder.h"
+#include "Graphics/HDREncoder.h"
+#include "Graphics/MipGenerator.h"
+
+#include <fstream>
+#include <cstring>
+
+namespace Gino
+{
+	namespace
+	{
+		constexpr uint32_t s_ddsMagic = 0x20534444;		// 'DDS '
+		constexpr uint32_t s_fourCCDX10 = 0x30315844;		// 'DX10'
+
+		constexpr uint32_t DDSD_CAPS = 0x1;
+		constexpr uint32_t DDSD_HEIGHT = 0x2;
+		constexpr uint32_t DDSD_WIDTH = 0x4;
+		constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+		constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+		constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+		constexpr uint32_t DDPF_FOURCC = 0x4;
+		constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+		constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+		constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+		constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+		struct DDSPixelFormat
+		{
+			uint32_t size;
+			uint32_t flags;
+			uint32_t fourCC;
+			uint32_t rgbBitCount;
+			uint32_t rBitMask;
+			uint32_t gBitMask;
+			uint32_t bBitMask;
+			uint32_t aBitMask;
+		};
+
+		struct DDSHeader
+		{
+			uint32_t size;
+			uint32_t flags;
+			uint32_t height;
+			uint32_t width;
+			uint32_t pitchOrLinearSize;
+			uint32_t depth;
+			uint32_t mipMapCount;
+			uint32_t reserved1[11];
+			DDSPixelFormat pixelFormat;
+			uint32_t caps;
+			uint32_t caps2;
+			uint32_t caps3;
+			uint32_t caps4;
+			uint32_t reserved2;
+		};
+
+		struct DDSHeaderDX10
+		{
+			uint32_t dxgiFormat;
+			uint32_t resourceDimension;
+			uint32_t miscFlag;
+			uint32_t arraySize;
+			uint32_t miscFlags2;
+		};
+
+		static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+
+		// Bytes per 4x4 block, or 0 for uncompressed formats
+		uint32_t GetBlockBytes(DXGI_FORMAT format)
+		{
+			switch (format)
+			{
+			case DXGI_FORMAT_BC1_UNORM:
+			case DXGI_FORMAT_BC1_UNORM_SRGB:
+			case DXGI_FORMAT_BC4_UNORM:
+			case DXGI_FORMAT_BC4_SNORM:
+				return 8;
+			case DXGI_FORMAT_BC2_UNORM:
+			case DXGI_FORMAT_BC2_UNORM_SRGB:
+			case DXGI_FORMAT_BC3_UNORM:
+			case DXGI_FORMAT_BC3_UNORM_SRGB:
+			case DXGI_FORMAT_BC5_UNORM:
+			case DXGI_FORMAT_BC5_SNORM:
+			case DXGI_FORMAT_BC6H_UF16:
+			case DXGI_FORMAT_BC6H_SF16:
+			case DXGI_FORMAT_BC7_UNORM:
+			case DXGI_FORMAT_BC7_UNORM_SRGB:
+				return 16;
+			default:
+				return 0;
+			}
+		}
+
+		// Bytes per texel of the supported uncompressed formats, or 0
+		uint32_t GetTexelBytes(DXGI_FORMAT format)
+		{
+			switch (format)
+			{
+			case DXGI_FORMAT_R8G8B8A8_UNORM:
+			case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+			case DXGI_FORMAT_R11G11B10_FLOAT:
+			case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+				return 4;
+			case DXGI_FORMAT_R16G16B16A16_FLOAT:
+				return 8;
+			case DXGI_FORMAT_R32G32B32A32_FLOAT:
+				return 16;
+			default:
+				return 0;
+			}
+		}
+	}
+
+	DXGI_FORMAT DDSFile::ToDXGIFormat(BCFormat format, bool srgb)
+	{
+		switch (format)
+		{
+		case BCFormat::BC1: return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+		case BCFormat::BC3: return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+		case BCFormat::BC4: return DXGI_FORMAT_BC4_UNORM;
+		case BCFormat::BC5: return DXGI_FORMAT_BC5_UNORM;
+		case BCFormat::BC7: return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+		}
+		return DXGI_FORMAT_UNKNOWN;
+	}
+
+	DXGI_FORMAT DDSFile::ToDXGIFormat(HDRFormat format)
+	{
+		switch (format)
+		{
+		case HDRFormat::RGBA32F: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+		case HDRFormat::RGBA16F: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+		case HDRFormat::R11G11B10F: return DXGI_FORMAT_R11G11B10_FLOAT;
+		case HDRFormat::RGB9E5: return DXGI_FORMAT_R9G9B9E5_SHAREDEXP;
+		case HDRFormat::BC6H: return DXGI_FORMAT_BC6H_UF16;
+		}
+		return DXGI_FORMAT_UNKNOWN;
+	}
+
+	bool DDSFile::Write(const std::filesystem::path& filePath, const CompressedTexture& texture)
+	{
+		return Write(filePath, ToDXGIFormat(texture.format, texture.srgb), texture.levels);
+	}
+
+	bool DDSFile::Write(const std::filesystem::path& filePath, const MipChain& chain, bool srgb)
+	{
+		assert(!chain.hdr);
+		for (const auto& level : chain.levels)
+			assert(level.rowPitch == level.width * 4);		// Tightly packed rows, as Open expects
+
+		return Write(filePath, srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM, chain.levels);
+	}
+
+	bool DDSFile::Write(const std::filesystem::path& filePath, const HDRTexture& texture)
+	{
+		return Write(filePath, ToDXGIFormat(texture.format), texture.levels);
+	}
+
+	bool DDSFile::Write(const std::filesystem::path& filePath, DXGI_FORMAT format, const std::vector<MipLevel>& levels)
+	{
+		if (levels.empty())
+			return false;
+
+		const auto& top = levels[0];
+
+		DDSHeader header{};
+		header.size = sizeof(DDSHeader);
+		header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+		header.height = top.height;
+		header.width = top.width;
+		header.pitchOrLinearSize = static_cast<uint32_t>(top.data.size());
+		header.mipMapCount = static_cast<uint32_t>(levels.size());
+		header.pixelFormat.size = sizeof(DDSPixelFormat);
+		header.pixelFormat.flags = DDPF_FOURCC;
+		header.pixelFormat.fourCC = s_fourCCDX10;
+		header.caps = DDSCAPS_TEXTURE | (levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+		DDSHeaderDX10 headerDX10{};
+		headerDX10.dxgiFormat = format;
+		headerDX10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+		headerDX10.arraySize = 1;
+
+		return Utils::WriteFileAtomic(filePath, [&](std::ofstream& file)
+			{
+				file.write((const char*)&s_ddsMagic, sizeof(s_ddsMagic));
+				file.write((const char*)&header, sizeof(header));
+				file.write((const char*)&headerDX10, sizeof(headerDX10));
+				for (const auto& level : levels)
+					file.write((const char*)level.data.data(), level.data.size());
+			}, "DDSFile");
+	}
+
+	bool DDSFile::Open(const std::filesystem::path& filePath)
+	{
+		Close();
+
+		if (!m_file.Open(filePath))
+			return false;
+
+		const uint8_t* base = m_file.GetData();
+		const uint64_t fileSize = m_file.GetSize();
+		constexpr uint64_t dataOffset = sizeof(uint32_t) + sizeof(DDSHeader) + sizeof(DDSHeaderDX10);
+		if (fileSize < dataOffset)
+		{
+			Close();
+			return false;
+		}
+
+		uint32_t magic;
+		DDSHeader header;
+		DDSHeaderDX10 headerDX10;
+		std::memcpy(&magic, base, sizeof(magic));
+		std::memcpy(&header, base + sizeof(magic), sizeof(header));
+		std::memcpy(&headerDX10, base + sizeof(magic) + sizeof(header), sizeof(headerDX10));
+
+		const DXGI_FORMAT format = static_cast<DXGI_FORMAT>(headerDX10.dxgiFormat);
+		const uint32_t blockBytes = GetBlockBytes(format);
+		const uint32_t texelBytes = GetTexelBytes(format);
+
+		if (magic != s_ddsMagic ||
+			header.size != sizeof(DDSHeader) ||
+			(header.pixelFormat.flags & DDPF_FOURCC) == 0 ||
+			header.pixelFormat.fourCC != s_fourCCDX10 ||
+			headerDX10.resourceDimension != DDS_DIMENSION_TEXTURE2D ||
+			headerDX10.arraySize != 1 ||
+			(blockBytes == 0 && texelBytes == 0) ||
+			header.width == 0 || header.height == 0)
+		{
+			Close();
+			return false;
+		}
+
+		const uint32_t mipCount = std::max(header.mipMapCount, 1u);
+		uint64_t offset = dataOffset;
+		uint32_t width = header.width;
+		uint32_t height = header.height;
+		for (uint32_t i = 0; i < mipCount; ++i)
+		{
+			const uint32_t rowPitch = blockBytes != 0 ? ((width + 3) / 4) * blockBytes : width * texelBytes;
+			const uint32_t rows = blockBytes != 0 ? (height + 3) / 4 : height;
+			const uint64_t levelSize = (uint64_t)rowPitch * rows;
+			if (levelSize > fileSize - offset)
+			{
+				Close();
+				return false;		// Truncated
+			}
+
+			m_subresources.push_back({ .pSysMem = base + offset, .SysMemPitch = rowPitch, .SysMemSlicePitch = 0 });
+			offset += levelSize;
+			width = std::max(width >> 1, 1u);
+			height = std::max(height >> 1, 1u);
+		}
+
+		m_format = format;
+		m_width = header.width;
+		m_height = header.height;
+		m_dataSize = static_cast<size_t>(offset - dataOffset);
+		return true;
+	}
+
+	void DDSFile::Close()
+	{
+		m_file.Close();
+		m_subresources.clear();
+		m_format = DXGI_FORMAT_UNKNOWN;
+		m_width = m_height = 0;
+		m_dataSize = 0;
+	}
+
+	DXGI_FORMAT DDSFile::GetFormat() const
+	{
+		return m_format;
+	}
+
+	uint32_t DDSFile::GetWidth() const
+	{
+		return m_width;
+	}
+
+	uint32_t DDSFile::GetHeight() const
+	{
+		return m_height;
+	}
+
+	uint32_t DDSFile::GetMipCount() const
+	{
+		return static_cast<uint32_t>(m_subresources.size());
+	}
+
+	size_t DDSFile::GetDataSize() const
+	{
+		return m_dataSize;
+	}
+
+	const std::vector<D3D11_SUBRESOURCE_DATA>& DDSFile::GetSubresources() const
+	{
+		return m_subresources;
+	}
+}
@@ -0,0 +1,721 @@
+#include "pch.h"
+#include "Graphics/HDREncoder.h"
+#include "ThreadPool.h"
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+#include <limits>
+
+namespace Gino
+{
+	namespace
+	{
+		constexpr uint32_t s_rowsPerJob = 16;
+		constexpr uint32_t s_blockRowsPerJob = 4;
+		constexpr int s_refineIterations = 2;
+
+		// Largest finite values
+		constexpr float s_maxHalf = 65504.f;
+		constexpr float s_maxFloat11 = 65024.f;
+		constexpr float s_maxFloat10 = 64512.f;
+		constexpr float s_maxRGB9E5 = 65408.f;		// 511 / 512 * 2^16
+		constexpr float s_maxHalfBits = 31743.f;	// 0x7BFF
+
+		// Bits of unsigned floats with a 5 bit exponent (bias 15) and MantissaBits mantissa bits, rounded to nearest even.
+		// value must be in [0, largest finite value of the format].
+		template <int MantissaBits>
+		__m128i FloatToSmallFloat(__m128 value)
+		{
+			constexpr int shift = 23 - MantissaBits;
+			const __m128i bits = _mm_castps_si128(value);
+
+			// Below 2^-14 the result is denormal: adding a power of two whose ULP is the denormal step rounds in the FPU
+			const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(((127 - 15) + shift + 1) << 23));
+			const __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(value, magic)), _mm_castps_si128(magic));
+
+			// Rebias the exponent from 127 to 15, round the dropped mantissa bits to nearest even (carries into the exponent)
+			const __m128i odd = _mm_and_si128(_mm_srli_epi32(bits, shift), _mm_set1_epi32(1));
+			__m128i normal = _mm_sub_epi32(bits, _mm_set1_epi32((127 - 15) << 23));
+			normal = _mm_add_epi32(_mm_add_epi32(normal, _mm_set1_epi32((1 << (shift - 1)) - 1)), odd);
+			normal = _mm_srli_epi32(normal, shift);
+
+			const __m128i isDenormal = _mm_cmplt_epi32(bits, _mm_set1_epi32((127 - 14) << 23));
+			return _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+		}
+
+		float SmallFloatToFloat(uint32_t bits, int mantissaBits)
+		{
+			const uint32_t exponent = bits >> mantissaBits;
+			const uint32_t mantissa = bits & ((1u << mantissaBits) - 1);
+			if (exponent == 0)
+				return std::ldexp((float)mantissa, -14 - mantissaBits);
+			if (exponent == 31)
+				return mantissa == 0 ? std::numeric_limits<float>::infinity() : std::numeric_limits<float>::quiet_NaN();
+			return std::ldexp((float)(mantissa | (1u << mantissaBits)), (int)exponent - 15 - mantissaBits);
+		}
+
+		__m128 Clamp(__m128 value, __m128 max)
+		{
+			// max_ps returns the second operand for NaN, so NaN becomes 0
+			return _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), max);
+		}
+
+		void EncodeRowRGBA16F(const float* src, uint32_t width, uint16_t* dst)
+		{
+			const __m128 max = _mm_set1_ps(s_maxHalf);
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				// At most 0x7BFF per lane, so the signed saturating pack is exact
+				const __m128i half = FloatToSmallFloat<10>(Clamp(_mm_loadu_ps(src + x * 4), max));
+				_mm_storel_epi64((__m128i*)(dst + x * 4), _mm_packs_epi32(half, half));
+			}
+		}
+
+		void EncodeRowR11G11B10F(const float* src, uint32_t width, uint32_t* dst)
+		{
+			const __m128 max = _mm_setr_ps(s_maxFloat11, s_maxFloat11, s_maxFloat10, 0.f);
+			alignas(16) uint32_t float11[4];
+			alignas(16) uint32_t float10[4];
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const __m128 texel = Clamp(_mm_loadu_ps(src + x * 4), max);
+				_mm_store_si128((__m128i*)float11, FloatToSmallFloat<6>(texel));
+				_mm_store_si128((__m128i*)float10, FloatToSmallFloat<5>(texel));
+				dst[x] = float11[0] | (float11[1] << 11) | (float10[2] << 22);
+			}
+		}
+
+		// Four texels per iteration, the tail goes through a zero padded copy
+		void EncodeRowRGB9E5(const float* src, uint32_t width, uint32_t* dst)
+		{
+			const __m128 max = _mm_set1_ps(s_maxRGB9E5);
+			const __m128 half = _mm_set1_ps(0.5f);
+
+			auto encode4 = [&max, &half](const float* texels, uint32_t* out)
+			{
+				__m128 r = _mm_loadu_ps(texels + 0);
+				__m128 g = _mm_loadu_ps(texels + 4);
+				__m128 b = _mm_loadu_ps(texels + 8);
+				__m128 a = _mm_loadu_ps(texels + 12);
+				_MM_TRANSPOSE4_PS(r, g, b, a);
+				r = Clamp(r, max);
+				g = Clamp(g, max);
+				b = Clamp(b, max);
+				const __m128 maxChannel = _mm_max_ps(r, _mm_max_ps(g, b));
+
+				// floor(log2(maxChannel)) from the exponent bits, at least -16. Shared exponent = that + 1 + bias 15.
+				__m128i exponent = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(maxChannel), 23), _mm_set1_epi32(127));
+				const __m128i tooSmall = _mm_cmplt_epi32(exponent, _mm_set1_epi32(-16));
+				exponent = _mm_or_si128(_mm_and_si128(tooSmall, _mm_set1_epi32(-16)), _mm_andnot_si128(tooSmall, exponent));
+
+				// Mantissa scale 2^(8 - exponent), halved where the largest channel rounds up to 512
+				__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(127 + 8), exponent), 23));
+				const __m128i maxMantissa = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(maxChannel, scale), half));
+				const __m128i overflow = _mm_cmpeq_epi32(maxMantissa, _mm_set1_epi32(512));
+				scale = _mm_mul_ps(scale, _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(overflow), half), _mm_andnot_ps(_mm_castsi128_ps(overflow), _mm_set1_ps(1.f))));
+				const __m128i shared = _mm_sub_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(16)), overflow);		// overflow lanes are -1
+
+				const __m128i rm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(r, scale), half));
+				const __m128i gm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(g, scale), half));
+				const __m128i bm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(b, scale), half));
+				__m128i packed = _mm_or_si128(rm, _mm_slli_epi32(gm, 9));
+				packed = _mm_or_si128(packed, _mm_slli_epi32(bm, 18));
+				packed = _mm_or_si128(packed, _mm_slli_epi32(shared, 27));
+				_mm_storeu_si128((__m128i*)out, packed);
+			};
+
+			uint32_t x = 0;
+			for (; x + 4 <= width; x += 4)
+				encode4(src + x * 4, dst + x);
+
+			if (x < width)
+			{
+				float texels[16] = {};
+				uint32_t packed[4];
+				std::memcpy(texels, src + x * 4, (size_t)(width - x) * 4 * sizeof(float));
+				encode4(texels, packed);
+				std::memcpy(dst + x, packed, (size_t)(width - x) * sizeof(uint32_t));
+			}
+		}
+
+		// ---- BC6H ----
+
+		constexpr int s_bc6hWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		// 4x4 texels as half float bits, channel major so four texels of one channel fit an SSE register
+		struct alignas(16) HalfBlock
+		{
+			float c[3][16];
+		};
+
+		struct alignas(16) HalfPalette
+		{
+			float c[16][4];
+		};
+
+		struct BC6HEndpoints
+		{
+			uint32_t e0[3];		// 10 bit quantized
+			uint32_t e1[3];
+		};
+
+		void LoadHalfBlock(const MipLevel& level, uint32_t bx, uint32_t by, HalfBlock& block)
+		{
+			const __m128 max = _mm_set1_ps(s_maxHalf);
+			alignas(16) int32_t half[4];
+			for (uint32_t y = 0; y < 4; ++y)
+			{
+				// Partial edge blocks replicate the last row/column
+				const uint32_t sy = std::min(by * 4 + y, level.height - 1);
+				const float* row = reinterpret_cast<const float*>(&level.data[(size_t)sy * level.rowPitch]);
+				for (uint32_t x = 0; x < 4; ++x)
+				{
+					const uint32_t sx = std::min(bx * 4 + x, level.width - 1);
+					_mm_store_si128((__m128i*)half, FloatToSmallFloat<10>(Clamp(_mm_loadu_ps(row + sx * 4), max)));
+					for (uint32_t ch = 0; ch < 3; ++ch)
+						block.c[ch][y * 4 + x] = (float)half[ch];
+				}
+			}
+		}
+
+		uint32_t UnquantizeBC6H(uint32_t value)
+		{
+			if (value == 0)
+				return 0;
+			if (value == 1023)
+				return 0xFFFF;
+			return ((value << 16) + 0x8000) >> 10;
+		}
+
+		// Half bits of palette entry index between two unquantized endpoints (unsigned BC6H interpolation)
+		uint32_t InterpolateBC6H(uint32_t a, uint32_t b, uint32_t index)
+		{
+			const uint32_t w = s_bc6hWeights[index];
+			return (((a * (64 - w) + b * w + 32) >> 6) * 31) >> 6;
+		}
+
+		uint32_t QuantizeBC6H(float halfBits)
+		{
+			// An endpoint decodes to (Unquantize(q) * 31) >> 6, about 31 * q: try the neighbours of the estimate
+			const int estimate = std::clamp((int)(halfBits / 31.f), 0, 1023);
+			uint32_t best = 0;
+			float bestError = FLT_MAX;
+			for (int q = std::max(estimate - 1, 0); q <= std::min(estimate + 1, 1023); ++q)
+			{
+				const float error = std::abs((float)((UnquantizeBC6H(q) * 31) >> 6) - halfBits);
+				if (error < bestError)
+				{
+					bestError = error;
+					best = q;
+				}
+			}
+			return best;
+		}
+
+		void BuildBC6HPalette(const BC6HEndpoints& endpoints, HalfPalette& palette)
+		{
+			for (uint32_t ch = 0; ch < 3; ++ch)
+			{
+				const uint32_t a = UnquantizeBC6H(endpoints.e0[ch]);
+				const uint32_t b = UnquantizeBC6H(endpoints.e1[ch]);
+				for (uint32_t i = 0; i < 16; ++i)
+					palette.c[i][ch] = (float)InterpolateBC6H(a, b, i);
+			}
+		}
+
+		// Closest palette entry per texel over RGB, returns the summed squared error
+		float SelectBC6HIndices(const HalfBlock& block, const HalfPalette& palette, uint8_t indices[16])
+		{
+			__m128 total = _mm_setzero_ps();
+			for (int t = 0; t < 16; t += 4)
+			{
+				__m128 best = _mm_set1_ps(FLT_MAX);
+				__m128i bestIndex = _mm_setzero_si128();
+				for (int k = 0; k < 16; ++k)
+				{
+					__m128 dist = _mm_setzero_ps();
+					for (int ch = 0; ch < 3; ++ch)
+					{
+						const __m128 diff = _mm_sub_ps(_mm_load_ps(&block.c[ch][t]), _mm_set1_ps(palette.c[k][ch]));
+						dist = _mm_add_ps(dist, _mm_mul_ps(diff, diff));
+					}
+
+					const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(dist, best));
+					bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, bestIndex));
+					best = _mm_min_ps(dist, best);
+				}
+
+				alignas(16) int32_t lanes[4];
+				_mm_store_si128((__m128i*)lanes, bestIndex);
+				for (int i = 0; i < 4; ++i)
+					indices[t + i] = (uint8_t)lanes[i];
+				total = _mm_add_ps(total, best);
+			}
+
+			alignas(16) float sums[4];
+			_mm_store_ps(sums, total);
+			return sums[0] + sums[1] + sums[2] + sums[3];
+		}
+
+		// Endpoints at the extremes of the principal axis (power iteration on the covariance matrix)
+		void PrincipalAxisEndpoints(const HalfBlock& block, float e0[3], float e1[3])
+		{
+			float mean[3] = {};
+			for (int ch = 0; ch < 3; ++ch)
+			{
+				for (int t = 0; t < 16; ++t)
+					mean[ch] += block.c[ch][t];
+				mean[ch] /= 16.f;
+			}
+
+			float cov[3][3] = {};
+			for (int t = 0; t < 16; ++t)
+			{
+				for (int i = 0; i < 3; ++i)
+					for (int j = 0; j < 3; ++j)
+						cov[i][j] += (block.c[i][t] - mean[i]) * (block.c[j][t] - mean[j]);
+			}
+
+			float axis[3] = { 1.f, 1.f, 1.f };
+			for (int iter = 0; iter < 8; ++iter)
+			{
+				float next[3] = {};
+				float len = 0.f;
+				for (int i = 0; i < 3; ++i)
+				{
+					for (int j = 0; j < 3; ++j)
+						next[i] += cov[i][j] * axis[j];
+					len += next[i] * next[i];
+				}
+				if (len < 1e-12f)
+					break;
+
+				len = 1.f / std::sqrt(len);
+				for (int i = 0; i < 3; ++i)
+					axis[i] = next[i] * len;
+			}
+
+			float minProj = FLT_MAX, maxProj = -FLT_MAX;
+			for (int t = 0; t < 16; ++t)
+			{
+				float proj = 0.f;
+				for (int ch = 0; ch < 3; ++ch)
+					proj += (block.c[ch][t] - mean[ch]) * axis[ch];
+				minProj = std::min(minProj, proj);
+				maxProj = std::max(maxProj, proj);
+			}
+
+			for (int ch = 0; ch < 3; ++ch)
+			{
+				e0[ch] = std::clamp(mean[ch] + axis[ch] * minProj, 0.f, s_maxHalfBits);
+				e1[ch] = std::clamp(mean[ch] + axis[ch] * maxProj, 0.f, s_maxHalfBits);
+			}
+		}
+
+		// Least squares endpoints for fixed indices, interpolation is close to linear in half bit space
+		bool FitEndpoints(const HalfBlock& block, const uint8_t indices[16], float e0[3], float e1[3])
+		{
+			float a = 0.f, b = 0.f, c = 0.f;
+			float r0[3] = {}, r1[3] = {};
+			for (int t = 0; t < 16; ++t)
+			{
+				const float w = s_bc6hWeights[indices[t]] / 64.f;
+				const float iw = 1.f - w;
+				a += iw * iw;
+				b += iw * w;
+				c += w * w;
+				for (int ch = 0; ch < 3; ++ch)
+				{
+					r0[ch] += iw * block.c[ch][t];
+					r1[ch] += w * block.c[ch][t];
+				}
+			}
+
+			const float det = a * c - b * b;
+			if (std::abs(det) < 1e-6f)
+				return false;
+
+			const float invDet = 1.f / det;
+			for (int ch = 0; ch < 3; ++ch)
+			{
+				e0[ch] = std::clamp((c * r0[ch] - b * r1[ch]) * invDet, 0.f, s_maxHalfBits);
+				e1[ch] = std::clamp((a * r1[ch] - b * r0[ch]) * invDet, 0.f, s_maxHalfBits);
+			}
+			return true;
+		}
+
+		class BitWriter
+		{
+		public:
+			BitWriter(uint8_t* out, uint32_t size) : m_out(out) { std::memset(out, 0, size); }
+
+			void Write(uint32_t value, uint32_t bits)
+			{
+				for (uint32_t i = 0; i < bits; ++i, ++m_pos)
+					m_out[m_pos >> 3] |= ((value >> i) & 1) << (m_pos & 7);
+			}
+
+		private:
+			uint8_t* m_out;
+			uint32_t m_pos = 0;
+		};
+
+		uint32_t ReadBits(const uint8_t* in, uint32_t& pos, uint32_t bits)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < bits; ++i, ++pos)
+				value |= ((in[pos >> 3] >> (pos & 7)) & 1) << i;
+			return value;
+		}
+
+		void EncodeBC6H(const HalfBlock& block, uint8_t out[16])
+		{
+			float e0[3], e1[3];
+			PrincipalAxisEndpoints(block, e0, e1);
+
+			float bestError = FLT_MAX;
+			BC6HEndpoints best{};
+			uint8_t bestIndices[16] = {};
+			for (int iter = 0; iter <= s_refineIterations; ++iter)
+			{
+				BC6HEndpoints endpoints;
+				for (int ch = 0; ch < 3; ++ch)
+				{
+					endpoints.e0[ch] = QuantizeBC6H(e0[ch]);
+					endpoints.e1[ch] = QuantizeBC6H(e1[ch]);
+				}
+
+				HalfPalette palette;
+				BuildBC6HPalette(endpoints, palette);
+				uint8_t indices[16];
+				const float error = SelectBC6HIndices(block, palette, indices);
+				if (error < bestError)
+				{
+					bestError = error;
+					best = endpoints;
+					std::memcpy(bestIndices, indices, sizeof(indices));
+				}
+
+				if (bestError == 0.f || !FitEndpoints(block, indices, e0, e1))
+					break;
+			}
+
+			// The anchor (texel 0) index has an implicit 0 MSB: swap the endpoints when it is set
+			if (bestIndices[0] >= 8)
+			{
+				std::swap(best.e0, best.e1);
+				for (auto& index : bestIndices)
+					index = 15 - index;
+			}
+
+			BitWriter writer(out, 16);
+			writer.Write(0x03, 5);		// Mode 11
+			for (int ch = 0; ch < 3; ++ch)
+				writer.Write(best.e0[ch], 10);
+			for (int ch = 0; ch < 3; ++ch)
+				writer.Write(best.e1[ch], 10);
+			writer.Write(bestIndices[0], 3);
+			for (int t = 1; t < 16; ++t)
+				writer.Write(bestIndices[t], 4);
+		}
+
+		// Half bits of the 16 texels (RGB), false for modes other than 11
+		bool DecodeBC6H(const uint8_t* in, uint16_t texels[16][3])
+		{
+			uint32_t pos = 0;
+			if (ReadBits(in, pos, 5) != 0x03)
+				return false;
+
+			BC6HEndpoints endpoints;
+			for (int ch = 0; ch < 3; ++ch)
+				endpoints.e0[ch] = ReadBits(in, pos, 10);
+			for (int ch = 0; ch < 3; ++ch)
+				endpoints.e1[ch] = ReadBits(in, pos, 10);
+
+			for (int t = 0; t < 16; ++t)
+			{
+				const uint32_t index = ReadBits(in, pos, t == 0 ? 3 : 4);
+				for (int ch = 0; ch < 3; ++ch)
+					texels[t][ch] = (uint16_t)InterpolateBC6H(UnquantizeBC6H(endpoints.e0[ch]), UnquantizeBC6H(endpoints.e1[ch]), index);
+			}
+			return true;
+		}
+
+		bool IsBlockCompressed(HDRFormat format)
+		{
+			return format == HDRFormat::BC6H;
+		}
+
+		uint32_t GetRowCount(const MipLevel& level, HDRFormat format)
+		{
+			return IsBlockCompressed(format) ? (level.height + 3) / 4 : level.height;
+		}
+	}
+
+	HDREncoder::HDREncoder(ThreadPool* threadPool) :
+		m_threadPool(threadPool)
+	{
+	}
+
+	HDRTexture HDREncoder::Encode(const MipChain& chain, HDRFormat format) const
+	{
+		if (!chain.hdr)
+		{
+			std::cout << "Gino::HDREncoder : Expects an HDR (RGBA32F) mip chain\n";
+			assert(false);
+			return {};
+		}
+
+		HDRTexture texture;
+		texture.format = format;
+		texture.levels.resize(chain.levels.size());
+
+		// One job per few rows over the whole chain, so small tail levels don't serialize
+		struct Job
+		{
+			uint32_t level;
+			uint32_t firstRow;
+		};
+		std::vector<Job> jobs;
+
+		const uint32_t rowsPerJob = IsBlockCompressed(format) ? s_blockRowsPerJob : s_rowsPerJob;
+		for (uint32_t i = 0; i < chain.levels.size(); ++i)
+		{
+			const auto& src = chain.levels[i];
+			auto& dst = texture.levels[i];
+			dst.width = src.width;
+			dst.height = src.height;
+			dst.rowPitch = IsBlockCompressed(format) ? ((src.width + 3) / 4) * 16 : src.width * GetBitsPerTexel(format) / 8;
+			dst.data.resize((size_t)dst.rowPitch * GetRowCount(src, format));
+
+			for (uint32_t row = 0; row < GetRowCount(src, format); row += rowsPerJob)
+				jobs.push_back({ i, row });
+		}
+
+		auto encodeJob = [&chain, &texture, &jobs, format, rowsPerJob](uint32_t jobIndex)
+		{
+			const Job& job = jobs[jobIndex];
+			const auto& src = chain.levels[job.level];
+			auto& dst = texture.levels[job.level];
+			const uint32_t endRow = std::min(job.firstRow + rowsPerJob, GetRowCount(src, format));
+
+			for (uint32_t row = job.firstRow; row < endRow; ++row)
+			{
+				const float* srcRow = reinterpret_cast<const float*>(&src.data[(size_t)row * src.rowPitch]);
+				uint8_t* dstRow = &dst.data[(size_t)row * dst.rowPitch];
+				switch (format)
+				{
+				case HDRFormat::RGBA32F:
+					std::memcpy(dstRow, srcRow, dst.rowPitch);
+					break;
+				case HDRFormat::RGBA16F:
+					EncodeRowRGBA16F(srcRow, src.width, reinterpret_cast<uint16_t*>(dstRow));
+					break;
+				case HDRFormat::R11G11B10F:
+					EncodeRowR11G11B10F(srcRow, src.width, reinterpret_cast<uint32_t*>(dstRow));
+					break;
+				case HDRFormat::RGB9E5:
+					EncodeRowRGB9E5(srcRow, src.width, reinterpret_cast<uint32_t*>(dstRow));
+					break;
+				case HDRFormat::BC6H:
+				{
+					HalfBlock block;
+					for (uint32_t bx = 0; bx < (src.width + 3) / 4; ++bx)
+					{
+						LoadHalfBlock(src, bx, row, block);
+						EncodeBC6H(block, dstRow + bx * 16);
+					}
+					break;
+				}
+				}
+			}
+		};
+
+		if (m_threadPool)
+			m_threadPool->ParallelFor(static_cast<uint32_t>(jobs.size()), encodeJob);
+		else
+		{
+			for (uint32_t i = 0; i < jobs.size(); ++i)
+				encodeJob(i);
+		}
+
+		return texture;
+	}
+
+	MipChain HDREncoder::Decode(const HDRTexture& texture)
+	{
+		MipChain chain;
+		chain.hdr = true;
+		chain.levels.resize(texture.levels.size());
+		for (size_t i = 0; i < texture.levels.size(); ++i)
+		{
+			const auto& src = texture.levels[i];
+			auto& dst = chain.levels[i];
+			dst.width = src.width;
+			dst.height = src.height;
+			dst.rowPitch = src.width * 4 * sizeof(float);
+			dst.data.resize((size_t)dst.rowPitch * dst.height);
+
+			auto texelAt = [&dst](uint32_t x, uint32_t y) { return reinterpret_cast<float*>(&dst.data[(size_t)y * dst.rowPitch + x * 4 * sizeof(float)]); };
+
+			if (texture.format == HDRFormat::BC6H)
+			{
+				uint16_t texels[16][3];
+				for (uint32_t by = 0; by < (src.height + 3) / 4; ++by)
+				{
+					for (uint32_t bx = 0; bx < (src.width + 3) / 4; ++bx)
+					{
+						if (!DecodeBC6H(&src.data[(size_t)by * src.rowPitch + bx * 16], texels))
+						{
+							std::cout << "Gino::HDREncoder : Unsupported BC6H mode, only mode 11 can be decoded\n";
+							assert(false);
+						}
+
+						for (uint32_t t = 0; t < 16; ++t)
+						{
+							const uint32_t x = bx * 4 + t % 4;
+							const uint32_t y = by * 4 + t / 4;
+							if (x >= dst.width || y >= dst.height)
+								continue;
+
+							float* out = texelAt(x, y);
+							for (uint32_t ch = 0; ch < 3; ++ch)
+								out[ch] = Utils::HalfToFloat(texels[t][ch]);
+							out[3] = 1.f;
+						}
+					}
+				}
+				continue;
+			}
+
+			for (uint32_t y = 0; y < src.height; ++y)
+			{
+				const uint8_t* row = &src.data[(size_t)y * src.rowPitch];
+				for (uint32_t x = 0; x < src.width; ++x)
+				{
+					float* out = texelAt(x, y);
+					switch (texture.format)
+					{
+					case HDRFormat::RGBA32F:
+						std::memcpy(out, row + x * 16, 16);
+						break;
+					case HDRFormat::RGBA16F:
+					{
+						uint16_t half[4];
+						std::memcpy(half, row + x * 8, sizeof(half));
+						for (uint32_t ch = 0; ch < 4; ++ch)
+							out[ch] = Utils::HalfToFloat(half[ch]);
+						break;
+					}
+					case HDRFormat::R11G11B10F:
+					{
+						uint32_t packed;
+						std::memcpy(&packed, row + x * 4, sizeof(packed));
+						out[0] = SmallFloatToFloat(packed & 0x7FF, 6);
+						out[1] = SmallFloatToFloat((packed >> 11) & 0x7FF, 6);
+						out[2] = SmallFloatToFloat(packed >> 22, 5);
+						out[3] = 1.f;
+						break;
+					}
+					case HDRFormat::RGB9E5:
+					{
+						uint32_t packed;
+						std::memcpy(&packed, row + x * 4, sizeof(packed));
+						const int exponent = (int)(packed >> 27) - 15 - 9;
+						out[0] = std::ldexp((float)(packed & 0x1FF), exponent);
+						out[1] = std::ldexp((float)((packed >> 9) & 0x1FF), exponent);
+						out[2] = std::ldexp((float)((packed >> 18) & 0x1FF), exponent);
+						out[3] = 1.f;
+						break;
+					}
+					default:
+						break;
+					}
+				}
+			}
+		}
+		return chain;
+	}
+
+	HDRError HDREncoder::CalcError(const MipLevel& reference, const MipLevel& decoded)
+	{
+		assert(reference.width == decoded.width && reference.height == decoded.height);
+
+		double sumSq = 0.0;
+		double sumRelative = 0.0;
+		float maxRelative = 0.f;
+		float peak = 0.f;
+		for (uint32_t y = 0; y < reference.height; ++y)
+		{
+			const float* a = reinterpret_cast<const float*>(&reference.data[(size_t)y * reference.rowPitch]);
+			const float* b = reinterpret_cast<const float*>(&decoded.data[(size_t)y * decoded.rowPitch]);
+			for (uint32_t x = 0; x < reference.width * 4; x += 4)
+			{
+				for (uint32_t ch = 0; ch < 3; ++ch)
+				{
+					// Measured against what the encoder sees: negative and NaN texels are 0, infinite ones can't be compared
+					if (std::isinf(a[x + ch]))
+						continue;
+					const float ref = a[x + ch] > 0.f ? a[x + ch] : 0.f;
+					const float logRef = std::log2(1.f + ref);
+					const float diff = logRef - std::log2(1.f + std::max(b[x + ch], 0.f));
+					sumSq += (double)diff * diff;
+					peak = std::max(peak, logRef);
+
+					const float relative = std::abs(b[x + ch] - ref) / std::max(ref, 1.f / 1024.f);
+					sumRelative += relative;
+					maxRelative = std::max(maxRelative, relative);
+				}
+			}
+		}
+
+		const double count = (double)reference.width * reference.height * 3;
+		HDRError error;
+		error.meanRelativeError = (float)(sumRelative / count);
+		error.maxRelativeError = maxRelative;
+
+		const double mse = sumSq / count;
+		if (mse == 0.0)
+			error.logPSNR = std::numeric_limits<float>::infinity();
+		else
+			error.logPSNR = (float)(10.0 * std::log10(std::max((double)peak * peak, 1.0) / mse));
+		return error;
+	}
+
+	uint32_t HDREncoder::GetBitsPerTexel(HDRFormat format)
+	{
+		switch (format)
+		{
+		case HDRFormat::RGBA32F: return 128;
+		case HDRFormat::RGBA16F: return 64;
+		case HDRFormat::R11G11B10F: return 32;
+		case HDRFormat::RGB9E5: return 32;
+		case HDRFormat::BC6H: return 8;
+		}
+		return 0;
+	}
+
+	const char* HDREncoder::GetFormatName(HDRFormat format)
+	{
+		switch (format)
+		{
+		case HDRFormat::RGBA32F: return "RGBA32F";
+		case HDRFormat::RGBA16F: return "RGBA16F";
+		case HDRFormat::R11G11B10F: return "R11G11B10F";
+		case HDRFormat::RGB9E5: return "RGB9E5";
+		case HDRFormat::BC6H: return "BC6H";
+		}
+		return "Unknown";
+	}
+
+	uint64_t HDREncoder::GetDataSize(const HDRTexture& texture)
+	{
+		uint64_t bytes = 0;
+		for (const auto& level : texture.levels)
+			bytes += level.data.size();
+		return bytes;
+	}
+}
@@ -0,0 +1,501 @@
+#include "pch.h"
+#include "Graphics/IBLBaker.h"
+#include "Timer.h"
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace Gino
+{
+	namespace
+	{
+		constexpr float s_pi = 3.14159265358979f;
+		constexpr uint32_t s_rowsPerJob = 16;
+
+		constexpr uint32_t s_iblMagic = 0x4C424947;		// 'GIBL'
+		constexpr uint32_t s_iblVersion = 1;
+
+		struct IBLFileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t specularFaceSize;
+			uint32_t specularMipCount;
+			uint32_t brdfLutSize;
+		};
+
+		// Hammersley point i of count
+		void Hammersley(uint32_t i, uint32_t count, float& u, float& v)
+		{
+			uint32_t bits = i;
+			bits = (bits << 16u) | (bits >> 16u);
+			bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+			bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+			bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+			bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+
+			u = static_cast<float>(i) / count;
+			v = static_cast<float>(bits) * 2.3283064365386963e-10f;
+		}
+
+		// GGX distributed half vector around +z (tangent space), alpha = roughness^2
+		void ImportanceSampleGGX(float u, float v, float alpha, float& x, float& y, float& z)
+		{
+			const float phi = 2.f * s_pi * u;
+			const float cosTheta = std::sqrt((1.f - v) / (1.f + (alpha * alpha - 1.f) * v));
+			const float sinTheta = std::sqrt(std::max(1.f - cosTheta * cosTheta, 0.f));
+			x = sinTheta * std::cos(phi);
+			y = sinTheta * std::sin(phi);
+			z = cosTheta;
+		}
+
+		// Float copy of the mips [firstMip, end) of a cube with trilinear sampling by direction.
+		// Faces are sampled on their own (no filtering across seams), like the mips were built.
+		class EnvironmentSampler
+		{
+		public:
+			EnvironmentSampler(const CubeMapData& cube, uint32_t firstMip) :
+				m_faceSize(cube.faceSize >> firstMip),
+				m_mipCount(cube.mipCount - firstMip)
+			{
+				m_levels.resize(6 * m_mipCount);
+				for (uint32_t face = 0; face < 6; ++face)
+				{
+					for (uint32_t mip = 0; mip < m_mipCount; ++mip)
+					{
+						const auto& src = cube.GetSubresource(face, firstMip + mip);
+						auto& dst = m_levels[face * m_mipCount + mip];
+						dst.resize(src.size());
+						for (size_t i = 0; i < src.size(); ++i)
+							dst[i] = Utils::HalfToFloat(src[i]);
+					}
+				}
+			}
+
+			uint32_t GetFaceSize() const { return m_faceSize; }
+			uint32_t GetMipCount() const { return m_mipCount; }
+			const float* GetLevel(uint32_t face, uint32_t mip) const { return m_levels[face * m_mipCount + mip].data(); }
+
+			__m128 Sample(float x, float y, float z, float lod) const
+			{
+				const float ax = std::fabs(x);
+				const float ay = std::fabs(y);
+				const float az = std::fabs(z);
+
+				// Inverse of CubemapConverter::GetFaceDirection
+				uint32_t face;
+				float s, t, major;
+				if (ax >= ay && ax >= az)
+				{
+					major = ax;
+					if (x > 0.f)	{ face = 0; s = -z; t = -y; }
+					else			{ face = 1; s = z;	t = -y; }
+				}
+				else if (ay >= az)
+				{
+					major = ay;
+					if (y > 0.f)	{ face = 2; s = x;	t = z; }
+					else			{ face = 3; s = x;	t = -z; }
+				}
+				else
+				{
+					major = az;
+					if (z > 0.f)	{ face = 4; s = x;	t = -y; }
+					else			{ face = 5; s = -x; t = -y; }
+				}
+				s /= major;
+				t /= major;
+
+				lod = std::clamp(lod, 0.f, static_cast<float>(m_mipCount - 1));
+				const uint32_t mip0 = static_cast<uint32_t>(lod);
+				const float weight = lod - mip0;
+				const __m128 level0 = SampleFace(face, s, t, mip0);
+				if (weight <= 0.f || mip0 + 1 >= m_mipCount)
+					return level0;
+
+				const __m128 level1 = SampleFace(face, s, t, mip0 + 1);
+				return _mm_add_ps(level0, _mm_mul_ps(_mm_sub_ps(level1, level0), _mm_set1_ps(weight)));
+			}
+
+		private:
+			__m128 SampleFace(uint32_t face, float s, float t, uint32_t mip) const
+			{
+				const int32_t size = static_cast<int32_t>(m_faceSize >> mip);
+				const float* texels = GetLevel(face, mip);
+
+				const float fx = (s * 0.5f + 0.5f) * size - 0.5f;
+				const float fy = (t * 0.5f + 0.5f) * size - 0.5f;
+				const float x0f = std::floor(fx);
+				const float y0f = std::floor(fy);
+				const __m128 wx = _mm_set1_ps(fx - x0f);
+				const __m128 wy = _mm_set1_ps(fy - y0f);
+
+				const int32_t x0 = std::clamp(static_cast<int32_t>(x0f), 0, size - 1);
+				const int32_t x1 = std::clamp(static_cast<int32_t>(x0f) + 1, 0, size - 1);
+				const int32_t y0 = std::clamp(static_cast<int32_t>(y0f), 0, size - 1);
+				const int32_t y1 = std::clamp(static_cast<int32_t>(y0f) + 1, 0, size - 1);
+
+				const __m128 t00 = _mm_loadu_ps(&texels[((size_t)y0 * size + x0) * 4]);
+				const __m128 t10 = _mm_loadu_ps(&texels[((size_t)y0 * size + x1) * 4]);
+				const __m128 t01 = _mm_loadu_ps(&texels[((size_t)y1 * size + x0) * 4]);
+				const __m128 t11 = _mm_loadu_ps(&texels[((size_t)y1 * size + x1) * 4]);
+
+				const __m128 top = _mm_add_ps(t00, _mm_mul_ps(_mm_sub_ps(t10, t00), wx));
+				const __m128 bottom = _mm_add_ps(t01, _mm_mul_ps(_mm_sub_ps(t11, t01), wx));
+				return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), wy));
+			}
+
+		private:
+			uint32_t m_faceSize;
+			uint32_t m_mipCount;
+			std::vector<std::vector<float>> m_levels;		// face * m_mipCount + mip, RGBA floats
+		};
+
+		// Prefilter direction in the tangent space of N (= V = R), with the environment mip it is sampled at
+		struct SpecularSample
+		{
+			float x, y, z;
+			float weight;		// NdotL
+			float lod;
+		};
+	}
+
+	IBLBaker::IBLBaker(ThreadPool* threadPool) :
+		m_threadPool(threadPool)
+	{
+	}
+
+	IBLData IBLBaker::Bake(const CubeMapData& environment, const IBLSettings& settings) const
+	{
+		assert(environment.mipCount > 0 && Utils::IsPowerOfTwo(environment.faceSize));
+		assert(Utils::IsPowerOfTwo(settings.specularSize) && settings.specularMipCount > 0);
+
+		IBLData data;
+
+		// Environment mips the bake reads: the prefiltered mip 0 resolution and finer is never needed
+		const uint32_t specularSize = std::min(settings.specularSize, environment.faceSize);
+		const uint32_t specularBaseMip = Utils::CalcMipCount(environment.faceSize) - Utils::CalcMipCount(specularSize);
+		uint32_t irradianceMip = 0;
+		while ((environment.faceSize >> irradianceMip) > settings.irradianceSourceSize && irradianceMip + 1 < environment.mipCount)
+			++irradianceMip;
+
+		const uint32_t firstMip = std::min(specularBaseMip, irradianceMip);
+		const EnvironmentSampler sampler(environment, firstMip);
+
+		// SH9 irradiance (small source, single threaded)
+		{
+			Timer shTimer;
+			const uint32_t mip = irradianceMip - firstMip;
+			const uint32_t size = sampler.GetFaceSize() >> mip;
+
+			std::array<std::array<double, 3>, 9> sums{};
+			double solidAngleSum = 0.0;
+			for (uint32_t face = 0; face < 6; ++face)
+			{
+				const float* texels = sampler.GetLevel(face, mip);
+				for (uint32_t y = 0; y < size; ++y)
+				{
+					const float t = (y + 0.5f) / size * 2.f - 1.f;
+					for (uint32_t x = 0; x < size; ++x)
+					{
+						const float s = (x + 0.5f) / size * 2.f - 1.f;
+						float dx, dy, dz;
+						CubemapConverter::GetFaceDirection(face, s, t, dx, dy, dz);
+
+						// Solid angle of the texel: (2 / size)^2 / |d|^3
+						const float lengthSq = 1.f + s * s + t * t;
+						const float invLength = 1.f / std::sqrt(lengthSq);
+						const float solidAngle = 4.f / (size * size * lengthSq) * invLength;
+						dx *= invLength;
+						dy *= invLength;
+						dz *= invLength;
+
+						const float basis[9] =
+						{
+							0.282095f,
+							0.488603f * dy,
+							0.488603f * dz,
+							0.488603f * dx,
+							1.092548f * dx * dy,
+							1.092548f * dy * dz,
+							0.315392f * (3.f * dz * dz - 1.f),
+							1.092548f * dx * dz,
+							0.546274f * (dx * dx - dy * dy)
+						};
+
+						const float* color = &texels[((size_t)y * size + x) * 4];
+						for (uint32_t i = 0; i < 9; ++i)
+						{
+							const double weight = (double)basis[i] * solidAngle;
+							sums[i][0] += color[0] * weight;
+							sums[i][1] += color[1] * weight;
+							sums[i][2] += color[2] * weight;
+						}
+						solidAngleSum += solidAngle;
+					}
+				}
+			}
+
+			// Normalize the texel solid angles to the sphere, then convolve with the clamped cosine (per band)
+			const double normalize = 4.0 * s_pi / solidAngleSum;
+			const float bandScale[9] = { s_pi, 2.f * s_pi / 3.f, 2.f * s_pi / 3.f, 2.f * s_pi / 3.f, s_pi / 4.f, s_pi / 4.f, s_pi / 4.f, s_pi / 4.f, s_pi / 4.f };
+			for (uint32_t i = 0; i < 9; ++i)
+			{
+				for (uint32_t c = 0; c < 3; ++c)
+					data.irradianceSH[i][c] = static_cast<float>(sums[i][c] * normalize * bandScale[i]);
+				data.irradianceSH[i][3] = 0.f;
+			}
+
+			std::cout << "Gino::IBLBaker : SH9 irradiance from " << size << "x" << size << " faces in " << shTimer.TimeElapsed() * 1000.f << " ms\n";
+		}
+
+		// GGX prefiltered specular
+		{
+			auto& cube = data.specular;
+			cube.faceSize = specularSize;
+			cube.mipCount = std::min(settings.specularMipCount, Utils::CalcMipCount(specularSize));
+			cube.subresources.resize(6 * cube.mipCount);
+
+			const uint32_t baseMip = specularBaseMip - firstMip;
+			const float baseSize = static_cast<float>(sampler.GetFaceSize() >> baseMip);
+			const float texelSolidAngle = 4.f * s_pi / (6.f * baseSize * baseSize);
+
+			std::vector<SpecularSample> samples;
+			for (uint32_t mip = 0; mip < cube.mipCount; ++mip)
+			{
+				Timer mipTimer;
+				const uint32_t size = specularSize >> mip;
+				const float roughness = cube.mipCount > 1 ? static_cast<float>(mip) / (cube.mipCount - 1) : 0.f;
+
+				// With N = V the sample directions only depend on the roughness, so they are shared by all texels
+				samples.clear();
+				if (roughness <= 0.f)
+				{
+					samples.push_back({ 0.f, 0.f, 1.f, 1.f, static_cast<float>(baseMip + mip) });
+				}
+				else
+				{
+					const float alpha = roughness * roughness;
+					const uint32_t sampleCount = settings.specularSamples;
+					for (uint32_t i = 0; i < sampleCount; ++i)
+					{
+						float u, v, hx, hy, hz;
+						Hammersley(i, sampleCount, u, v);
+						ImportanceSampleGGX(u, v, alpha, hx, hy, hz);
+
+						const float NdotL = 2.f * hz * hz - 1.f;
+						if (NdotL <= 0.f)
+							continue;
+
+						// pdf of L = D * NdotH / (4 * VdotH) = D / 4 for V = N
+						const float denom = hz * hz * (alpha * alpha - 1.f) + 1.f;
+						const float pdf = alpha * alpha / (s_pi * denom * denom) / 4.f;
+						const float sampleSolidAngle = 1.f / (sampleCount * pdf);
+						const float lod = std::max(0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.f, 0.f) + baseMip;
+
+						samples.push_back({ 2.f * hz * hx, 2.f * hz * hy, NdotL, NdotL, lod });
+					}
+				}
+
+				float weightSum = 0.f;
+				for (const auto& sample : samples)
+					weightSum += sample.weight;
+				const __m128 invWeightSum = _mm_set1_ps(1.f / weightSum);
+
+				for (uint32_t face = 0; face < 6; ++face)
+					cube.subresources[face * cube.mipCount + mip].resize((size_t)size * size * 4);
+
+				Utils::ForRows(m_threadPool, 6 * size, s_rowsPerJob, [&](uint32_t begin, uint32_t end)
+					{
+						alignas(16) float result[4];
+						for (uint32_t row = begin; row < end; ++row)
+						{
+							const uint32_t face = row / size;
+							const uint32_t y = row % size;
+							uint16_t* dst = &cube.subresources[face * cube.mipCount + mip][(size_t)y * size * 4];
+							const float t = (y + 0.5f) / size * 2.f - 1.f;
+							for (uint32_t x = 0; x < size; ++x)
+							{
+								const float s = (x + 0.5f) / size * 2.f - 1.f;
+								float nx, ny, nz;
+								CubemapConverter::GetFaceDirection(face, s, t, nx, ny, nz);
+								const float invLength = 1.f / std::sqrt(nx * nx + ny * ny + nz * nz);
+								nx *= invLength;
+								ny *= invLength;
+								nz *= invLength;
+
+								// Tangent basis around N
+								const bool nearPole = std::fabs(ny) > 0.999f;
+								const float upX = nearPole ? 1.f : 0.f;
+								const float upY = nearPole ? 0.f : 1.f;
+								float tx = upY * nz;
+								float ty = -upX * nz;
+								float tz = upX * ny - upY * nx;
+								const float invTangentLength = 1.f / std::sqrt(tx * tx + ty * ty + tz * tz);
+								tx *= invTangentLength;
+								ty *= invTangentLength;
+								tz *= invTangentLength;
+								const float bx = ny * tz - nz * ty;
+								const float by = nz * tx - nx * tz;
+								const float bz = nx * ty - ny * tx;
+
+								__m128 sum = _mm_setzero_ps();
+								for (const auto& sample : samples)
+								{
+									const float lx = tx * sample.x + bx * sample.y + nx * sample.z;
+									const float ly = ty * sample.x + by * sample.y + ny * sample.z;
+									const float lz = tz * sample.x + bz * sample.y + nz * sample.z;
+									sum = _mm_add_ps(sum, _mm_mul_ps(sampler.Sample(lx, ly, lz, sample.lod), _mm_set1_ps(sample.weight)));
+								}
+
+								_mm_store_ps(result, _mm_mul_ps(sum, invWeightSum));
+								dst[x * 4 + 0] = Utils::FloatToHalf(result[0]);
+								dst[x * 4 + 1] = Utils::FloatToHalf(result[1]);
+								dst[x * 4 + 2] = Utils::FloatToHalf(result[2]);
+								dst[x * 4 + 3] = Utils::FloatToHalf(1.f);
+							}
+						}
+					});
+
+				std::cout << "Gino::IBLBaker : Specular mip " << mip << " (" << size << "x" << size << ", roughness " << roughness << ", "
+					<< samples.size() << " samples) in " << mipTimer.TimeElapsed() * 1000.f << " ms\n";
+			}
+		}
+
+		// Split sum BRDF LUT, geometry term with k = alpha / 2 for IBL
+		{
+			Timer lutTimer;
+			const uint32_t size = settings.brdfLutSize;
+			const uint32_t sampleCount = settings.brdfLutSamples;
+			data.brdfLutSize = size;
+			data.brdfLut.resize((size_t)size * size * 2);
+
+			Utils::ForRows(m_threadPool, size, s_rowsPerJob, [&](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t y = begin; y < end; ++y)
+					{
+						const float roughness = (y + 0.5f) / size;
+						const float alpha = roughness * roughness;
+						const float k = alpha / 2.f;
+						for (uint32_t x = 0; x < size; ++x)
+						{
+							const float NdotV = (x + 0.5f) / size;
+							const float vx = std::sqrt(1.f - NdotV * NdotV);
+							const float vz = NdotV;
+
+							float scale = 0.f;
+							float bias = 0.f;
+							for (uint32_t i = 0; i < sampleCount; ++i)
+							{
+								float u, v, hx, hy, hz;
+								Hammersley(i, sampleCount, u, v);
+								ImportanceSampleGGX(u, v, alpha, hx, hy, hz);
+
+								const float VdotH = vx * hx + vz * hz;
+								const float NdotL = 2.f * VdotH * hz - vz;
+								if (NdotL <= 0.f)
+									continue;
+
+								const float G = (NdotV / (NdotV * (1.f - k) + k)) * (NdotL / (NdotL * (1.f - k) + k));
+								const float visibility = G * VdotH / (hz * NdotV);
+								const float fresnel = std::pow(1.f - VdotH, 5.f);
+								scale += (1.f - fresnel) * visibility;
+								bias += fresnel * visibility;
+							}
+
+							uint16_t* dst = &data.brdfLut[((size_t)y * size + x) * 2];
+							dst[0] = Utils::FloatToHalf(scale / sampleCount);
+							dst[1] = Utils::FloatToHalf(bias / sampleCount);
+						}
+					}
+				});
+
+			std::cout << "Gino::IBLBaker : BRDF LUT " << size << "x" << size << " (" << sampleCount << " samples) in " << lutTimer.TimeElapsed() * 1000.f << " ms\n";
+		}
+
+		return data;
+	}
+
+	IBLData IBLBaker::LoadOrBake(const std::filesystem::path& sourcePath, const IBLSettings& settings) const
+	{
+		// Keyed by content, so edited sources are rebaked and renamed or copied sources are not
+		const uint64_t key = Utils::HashBytes(&settings, sizeof(settings), Utils::HashFile(sourcePath));
+		const auto cachePath = GetCachePath(sourcePath, key);
+
+		IBLData data;
+		if (Read(cachePath, data))
+			return data;
+
+		Timer bakeTimer;
+		const CubemapConverter converter(m_threadPool);
+		data = Bake(converter.LoadOrConvert(sourcePath), settings);
+		Write(cachePath, data);
+
+		std::cout << "Gino::IBLBaker : Baked " << sourcePath << " in " << bakeTimer.TimeElapsed() * 1000.f << " ms (cached to " << cachePath << ")\n";
+		return data;
+	}
+
+	std::filesystem::path IBLBaker::GetCachePath(const std::filesystem::path& sourcePath, uint64_t key)
+	{
+		return std::filesystem::path("cache/ibl") / Utils::HashedFileName(sourcePath, key, ".ibl");
+	}
+
+	bool IBLBaker::Write(const std::filesystem::path& filePath, const IBLData& data)
+	{
+		return Utils::WriteFileAtomic(filePath, [&](std::ofstream& file)
+			{
+				const IBLFileHeader header{ s_iblMagic, s_iblVersion, data.specular.faceSize, data.specular.mipCount, data.brdfLutSize };
+				file.write((const char*)&header, sizeof(header));
+				file.write((const char*)data.irradianceSH.data(), sizeof(data.irradianceSH));
+				for (const auto& subresource : data.specular.subresources)
+					file.write((const char*)subresource.data(), subresource.size() * sizeof(uint16_t));
+				file.write((const char*)data.brdfLut.data(), data.brdfLut.size() * sizeof(uint16_t));
+			}, "IBLBaker");
+	}
+
+	bool IBLBaker::Read(const std::filesystem::path& filePath, IBLData& data)
+	{
+		std::ifstream file(filePath, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		IBLFileHeader header{};
+		file.read((char*)&header, sizeof(header));
+		if (!file || header.magic != s_iblMagic || header.version != s_iblVersion || !Utils::IsPowerOfTwo(header.specularFaceSize) ||
+			header.specularMipCount == 0 || header.specularMipCount > Utils::CalcMipCount(header.specularFaceSize) || header.brdfLutSize == 0)
+		{
+			std::cout << "Gino::IBLBaker : Invalid IBL file: " << filePath << "\n";
+			return false;
+		}
+
+		file.read((char*)data.irradianceSH.data(), sizeof(data.irradianceSH));
+
+		auto& cube = data.specular;
+		cube.faceSize = header.specularFaceSize;
+		cube.mipCount = header.specularMipCount;
+		cube.subresources.resize(6 * cube.mipCount);
+		for (uint32_t face = 0; face < 6; ++face)
+		{
+			for (uint32_t mip = 0; mip < cube.mipCount; ++mip)
+			{
+				const uint32_t size = cube.faceSize >> mip;
+				auto& subresource = cube.subresources[face * cube.mipCount + mip];
+				subresource.resize((size_t)size * size * 4);
+				file.read((char*)subresource.data(), subresource.size() * sizeof(uint16_t));
+			}
+		}
+
+		data.brdfLutSize = header.brdfLutSize;
+		data.brdfLut.resize((size_t)header.brdfLutSize * header.brdfLutSize * 2);
+		file.read((char*)data.brdfLut.data(), data.brdfLut.size() * sizeof(uint16_t));
+
+		if (!file)
+		{
+			std::cout << "Gino::IBLBaker : Truncated IBL file: " << filePath << "\n";
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,342 @@
+#include "pch.h"
+#include "Graphics/MipGenerator.h"
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Gino
+{
+	namespace
+	{
+		constexpr float s_pi = 3.14159265358979f;
+		constexpr float s_windowRadius = 3.f;		// Kaiser/Lanczos radius in destination texels
+		constexpr float s_kaiserAlpha = 4.f;
+		constexpr uint32_t s_rowsPerJob = 16;
+
+		float Sinc(float x)
+		{
+			if (std::abs(x) < 1e-5f)
+				return 1.f;
+			x *= s_pi;
+			return std::sin(x) / x;
+		}
+
+		float BesselI0(float x)
+		{
+			// Power series, converges quickly for the arguments used by the Kaiser window (<= alpha)
+			float sum = 1.f;
+			float term = 1.f;
+			const float halfX = x * 0.5f;
+			for (int k = 1; k < 32; ++k)
+			{
+				const float f = halfX / k;
+				term *= f * f;
+				sum += term;
+				if (term < sum * 1e-8f)
+					break;
+			}
+			return sum;
+		}
+
+		float Kaiser(float x)
+		{
+			const float t = x / s_windowRadius;
+			if (t * t >= 1.f)
+				return 0.f;
+			return Sinc(x) * BesselI0(s_kaiserAlpha * std::sqrt(1.f - t * t)) / BesselI0(s_kaiserAlpha);
+		}
+
+		float Lanczos(float x)
+		{
+			if (std::abs(x) >= s_windowRadius)
+				return 0.f;
+			return Sinc(x) * Sinc(x / s_windowRadius);
+		}
+
+		// Precomputed 1D filter weights from a source axis to a (smaller) destination axis
+		struct FilterTaps
+		{
+			uint32_t maxTaps = 0;
+			std::vector<uint32_t> first;		// First source texel per destination texel
+			std::vector<uint32_t> count;		// Number of taps per destination texel
+			std::vector<float> weights;			// maxTaps weights per destination texel
+		};
+
+		FilterTaps BuildTaps(uint32_t srcSize, uint32_t dstSize, MipFilter filter)
+		{
+			const float scale = (float)srcSize / dstSize;
+			const float support = (filter == MipFilter::Box ? 0.5f : s_windowRadius) * scale;		// In source texels
+
+			FilterTaps taps;
+			taps.maxTaps = (uint32_t)std::ceil(support * 2.f) + 2;
+			taps.first.resize(dstSize);
+			taps.count.resize(dstSize);
+			taps.weights.resize((size_t)dstSize * taps.maxTaps, 0.f);
+
+			std::vector<float> folded(taps.maxTaps);
+			for (uint32_t x = 0; x < dstSize; ++x)
+			{
+				const float center = (x + 0.5f) * scale;
+				const int lo = (int)std::floor(center - support);
+				const int hi = (int)std::ceil(center + support);
+
+				// Clamp to edge by folding out of range taps onto the border texels
+				const int first = std::max(lo, 0);
+				const int last = std::min(hi, (int)srcSize - 1);
+				std::fill(folded.begin(), folded.end(), 0.f);
+
+				float sum = 0.f;
+				for (int i = lo; i <= hi; ++i)
+				{
+					float w = 0.f;
+					if (filter == MipFilter::Box)
+						w = std::max(0.f, std::min(i + 1.f, center + support) - std::max((float)i, center - support));		// Area coverage
+					else
+					{
+						const float d = (i + 0.5f - center) / scale;
+						w = filter == MipFilter::Kaiser ? Kaiser(d) : Lanczos(d);
+					}
+
+					folded[std::clamp(i, first, last) - first] += w;
+					sum += w;
+				}
+
+				if (std::abs(sum) < 1e-6f)
+				{
+					// Degenerate, fall back to nearest
+					folded.assign(taps.maxTaps, 0.f);
+					folded[std::clamp((int)center, first, last) - first] = 1.f;
+					sum = 1.f;
+				}
+
+				taps.first[x] = (uint32_t)first;
+				taps.count[x] = (uint32_t)(last - first + 1);
+				for (uint32_t t = 0; t < taps.count[x]; ++t)
+					taps.weights[(size_t)x * taps.maxTaps + t] = folded[t] / sum;
+			}
+			return taps;
+		}
+
+		const std::array<float, 256>& SrgbToLinearTable()
+		{
+			static const std::array<float, 256> table = []()
+			{
+				std::array<float, 256> t{};
+				for (int i = 0; i < 256; ++i)
+				{
+					const float c = i / 255.f;
+					t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+				}
+				return t;
+			}();
+			return table;
+		}
+
+		// Indexed by linear value quantized to 16 bits (fine enough that the steep segment near black still rounds correctly)
+		const std::vector<uint8_t>& LinearToSrgbTable()
+		{
+			static const std::vector<uint8_t> table = []()
+			{
+				std::vector<uint8_t> t(65536);
+				for (int i = 0; i < 65536; ++i)
+				{
+					const float l = i / 65535.f;
+					const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.f / 2.4f) - 0.055f;
+					t[i] = (uint8_t)std::clamp((int)(c * 255.f + 0.5f), 0, 255);
+				}
+				return t;
+			}();
+			return table;
+		}
+
+		inline __m128 RenormalizeTexel(__m128 v)
+		{
+			const __m128 n = _mm_sub_ps(_mm_add_ps(v, v), _mm_set1_ps(1.f));
+			const __m128 sq = _mm_mul_ps(n, n);
+			const __m128 len2 = _mm_add_ss(sq, _mm_add_ss(_mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 2, 2, 2))));
+
+			const float l2 = _mm_cvtss_f32(len2);
+			if (l2 < 1e-12f)
+				return _mm_set_ps(_mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))), 1.f, 0.5f, 0.5f);		// Flat normal, keep alpha
+
+			const float invLen = 1.f / std::sqrt(l2);
+			const __m128 scaled = _mm_mul_ps(n, _mm_set_ps(1.f, invLen, invLen, invLen));		// Alpha untouched
+			return _mm_add_ps(_mm_mul_ps(scaled, _mm_set1_ps(0.5f)), _mm_set1_ps(0.5f));
+		}
+	}
+
+	MipGenerator::MipGenerator(ThreadPool* threadPool) :
+		m_threadPool(threadPool)
+	{
+	}
+
+	uint32_t MipGenerator::CalcLevelCount(uint32_t width, uint32_t height)
+	{
+		return std::max(Utils::CalcMipCount(std::max(width, height)), 1u);
+	}
+
+	MipChain MipGenerator::Generate(const Utils::ImageData& image, const MipGenSettings& settings) const
+	{
+		const bool hdr = image.hdrFpPixels != nullptr;
+		assert(hdr || image.pixels != nullptr);
+
+		const bool srgb = settings.srgb && !hdr && !settings.normalMap;
+		const uint32_t texelSize = hdr ? sizeof(float) * 4 : sizeof(uint32_t);
+
+		uint32_t levelCount = CalcLevelCount(image.texWidth, image.texHeight);
+		if (settings.maxLevels != 0)
+			levelCount = std::min(levelCount, settings.maxLevels);
+
+		MipChain chain;
+		chain.hdr = hdr;
+		chain.levels.resize(levelCount);
+
+		// Level 0 is the source as is (no round trip through float)
+		auto& top = chain.levels[0];
+		top.width = image.texWidth;
+		top.height = image.texHeight;
+		top.rowPitch = top.width * texelSize;
+		top.data.resize((size_t)top.rowPitch * top.height);
+		std::memcpy(top.data.data(), hdr ? (const void*)image.hdrFpPixels : (const void*)image.pixels, top.data.size());
+
+		if (levelCount == 1)
+			return chain;
+
+		const auto& toLinear = SrgbToLinearTable();
+		const auto& toSrgb = LinearToSrgbTable();
+
+		// Working levels are linear float RGBA
+		uint32_t srcW = image.texWidth;
+		uint32_t srcH = image.texHeight;
+		std::vector<float> src((size_t)srcW * srcH * 4);
+		Utils::ForRows(m_threadPool, srcH, s_rowsPerJob, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t y = begin; y < end; ++y)
+				{
+					float* dst = &src[(size_t)y * srcW * 4];
+					if (hdr)
+					{
+						std::memcpy(dst, &image.hdrFpPixels[(size_t)y * srcW * 4], (size_t)srcW * 4 * sizeof(float));
+						continue;
+					}
+
+					const uint8_t* row = &image.pixels[(size_t)y * srcW * 4];
+					for (uint32_t x = 0; x < srcW * 4; x += 4)
+					{
+						dst[x + 0] = srgb ? toLinear[row[x + 0]] : row[x + 0] / 255.f;
+						dst[x + 1] = srgb ? toLinear[row[x + 1]] : row[x + 1] / 255.f;
+						dst[x + 2] = srgb ? toLinear[row[x + 2]] : row[x + 2] / 255.f;
+						dst[x + 3] = row[x + 3] / 255.f;
+					}
+				}
+			});
+
+		std::vector<float> tmp;
+		std::vector<float> dst;
+		for (uint32_t level = 1; level < levelCount; ++level)
+		{
+			const uint32_t dstW = std::max(srcW >> 1, 1u);
+			const uint32_t dstH = std::max(srcH >> 1, 1u);
+
+			const FilterTaps tapsX = BuildTaps(srcW, dstW, settings.filter);
+			const FilterTaps tapsY = BuildTaps(srcH, dstH, settings.filter);
+
+			// Horizontal pass: (srcW x srcH) -> (dstW x srcH)
+			tmp.resize((size_t)dstW * srcH * 4);
+			Utils::ForRows(m_threadPool, srcH, s_rowsPerJob, [&](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t y = begin; y < end; ++y)
+					{
+						const float* srcRow = &src[(size_t)y * srcW * 4];
+						float* tmpRow = &tmp[(size_t)y * dstW * 4];
+						for (uint32_t x = 0; x < dstW; ++x)
+						{
+							const float* weights = &tapsX.weights[(size_t)x * tapsX.maxTaps];
+							const float* texel = &srcRow[(size_t)tapsX.first[x] * 4];
+
+							__m128 acc = _mm_setzero_ps();
+							for (uint32_t t = 0; t < tapsX.count[x]; ++t)
+								acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(texel + t * 4), _mm_set1_ps(weights[t])));
+							_mm_storeu_ps(&tmpRow[x * 4], acc);
+						}
+					}
+				});
+
+			// Vertical pass: (dstW x srcH) -> (dstW x dstH), then renormalize and encode the finished rows
+			dst.resize((size_t)dstW * dstH * 4);
+			auto& out = chain.levels[level];
+			out.width = dstW;
+			out.height = dstH;
+			out.rowPitch = dstW * texelSize;
+			out.data.resize((size_t)out.rowPitch * dstH);
+
+			Utils::ForRows(m_threadPool, dstH, s_rowsPerJob, [&](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t y = begin; y < end; ++y)
+					{
+						float* dstRow = &dst[(size_t)y * dstW * 4];
+						std::fill(dstRow, dstRow + (size_t)dstW * 4, 0.f);
+
+						const float* weights = &tapsY.weights[(size_t)y * tapsY.maxTaps];
+						for (uint32_t t = 0; t < tapsY.count[y]; ++t)
+						{
+							const float* tmpRow = &tmp[(size_t)(tapsY.first[y] + t) * dstW * 4];
+							const __m128 w = _mm_set1_ps(weights[t]);
+							for (uint32_t x = 0; x < dstW * 4; x += 4)
+								_mm_storeu_ps(&dstRow[x], _mm_add_ps(_mm_loadu_ps(&dstRow[x]), _mm_mul_ps(_mm_loadu_ps(&tmpRow[x]), w)));
+						}
+
+						if (settings.normalMap)
+						{
+							for (uint32_t x = 0; x < dstW * 4; x += 4)
+								_mm_storeu_ps(&dstRow[x], RenormalizeTexel(_mm_loadu_ps(&dstRow[x])));
+						}
+
+						uint8_t* outRow = &out.data[(size_t)y * out.rowPitch];
+						if (hdr)
+						{
+							std::memcpy(outRow, dstRow, out.rowPitch);
+							continue;
+						}
+
+						const __m128 zero = _mm_setzero_ps();
+						const __m128 one = _mm_set1_ps(1.f);
+						if (srgb)
+						{
+							// Color through the LUT, alpha linear
+							for (uint32_t x = 0; x < dstW; ++x)
+							{
+								const __m128 c = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&dstRow[x * 4]), zero), one);
+								alignas(16) int32_t q[4];
+								_mm_store_si128((__m128i*)q, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, _mm_set_ps(255.f, 65535.f, 65535.f, 65535.f)), _mm_set1_ps(0.5f))));
+								outRow[x * 4 + 0] = toSrgb[q[0]];
+								outRow[x * 4 + 1] = toSrgb[q[1]];
+								outRow[x * 4 + 2] = toSrgb[q[2]];
+								outRow[x * 4 + 3] = (uint8_t)q[3];
+							}
+						}
+						else
+						{
+							for (uint32_t x = 0; x < dstW; ++x)
+							{
+								const __m128 c = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&dstRow[x * 4]), zero), one);
+								__m128i q = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(255.f)), _mm_set1_ps(0.5f)));
+								const __m128i words = _mm_packs_epi32(q, q);
+								q = _mm_packus_epi16(words, words);
+								const int packed = _mm_cvtsi128_si32(q);
+								std::memcpy(&outRow[x * 4], &packed, sizeof(packed));
+							}
+						}
+					}
+				});
+
+			std::swap(src, dst);
+			srcW = dstW;
+			srcH = dstH;
+		}
+
+		return chain;
+	}
+}
@@ -1,5 +1,8 @@
 #include "pch.h"
 #include "Graphics/Model.h"
+#include "AssimpLoader.h"
+
+#include <algorithm>
 
 namespace Gino
 {
@@ -8,10 +11,11 @@ namespace Gino
     {
     }
 
-    void Model::Initialize(const Buffer& vb, const Buffer& ib, const std::vector<std::pair<Mesh, Material>>& meshesAndMaterials)
+    void Model::Initialize(const Buffer& vb, const Buffer& ib, const std::vector<std::pair<Mesh, Material>>& meshesAndMaterials, VertexFormat vertexFormat)
     {
         m_vb = vb;
         m_ib = ib;
+        m_vertexFormat = vertexFormat;
 
         for (const auto& pair : meshesAndMaterials)
         {
@@ -20,6 +24,16 @@ namespace Gino
 
     }
 
+    void Model::SetResident()
+    {
+        m_resident = true;
+    }
+
+    bool Model::IsResident() const
+    {
+        return m_resident;
+    }
+
     void Model::AddMesh(const Mesh& mesh, const Material& material)
     {
         m_meshes.push_back(mesh);
@@ -47,6 +61,191 @@ namespace Gino
         return m_ib.buffer.Get();
     }
 
+    VertexFormat Model::GetVertexFormat() const
+    {
+        return m_vertexFormat;
+    }
+
+    uint32_t Model::GetVertexStride() const
+    {
+        return m_vertexFormat == VertexFormat::Compact ? sizeof(Vertex_Compact) : sizeof(Vertex_POS_UV_NORMAL);
+    }
+
+    static float GetMaxScale(const DirectX::SimpleMath::Matrix& m)
+    {
+        return std::max({ m.Right().Length(), m.Up().Length(), m.Forward().Length() });
+    }
+
+    void Model::SetNodes(const AssimpNode* nodes, size_t nodeCount)
+    {
+        m_nodeParents.resize(nodeCount);
+        m_nodeLocalTransforms.resize(nodeCount);
+        m_nodeTransforms.resize(nodeCount);
+
+        // Parents come first, one pass resolves the whole hierarchy
+        for (size_t i = 0; i < nodeCount; ++i)
+        {
+            const uint32_t parent = nodes[i].parent;
+            assert(parent == AssimpNode::s_noParent || parent < i);
+            m_nodeParents[i] = parent;
+            m_nodeLocalTransforms[i] = nodes[i].transform;
+            m_nodeTransforms[i] = parent == AssimpNode::s_noParent ? nodes[i].transform : nodes[i].transform * m_nodeTransforms[parent];
+        }
+
+        // UV density was measured in mesh units
+        for (auto& mesh : m_meshes)
+        {
+            assert(nodeCount == 0 || mesh.node < nodeCount);
+            mesh.uvDensity *= GetMaxScale(GetNodeTransform(mesh.node));
+        }
+    }
+
+    const std::vector<uint32_t>& Model::GetNodeParents() const
+    {
+        return m_nodeParents;
+    }
+
+    const DirectX::SimpleMath::Matrix& Model::GetNodeTransform(uint32_t node) const
+    {
+        return node < m_nodeTransforms.size() ? m_nodeTransforms[node] : DirectX::SimpleMath::Matrix::Identity;
+    }
+
+    void Model::SetClusters(const MeshCluster* clusters, size_t clusterCount, const uint32_t* indices, size_t indexCount)
+    {
+        m_clusters.assign(clusters, clusters + clusterCount);
+        m_indices.assign(indices, indices + indexCount);
+
+        // Sphere around the cluster AABB union that contains every cluster sphere, clusters are in the space of their mesh node
+        using DirectX::SimpleMath::Vector3;
+        if (m_clusters.empty())
+            return;
+
+        bool first = true;
+        Vector3 min, max;
+        for (const auto& mesh : m_meshes)
+        {
+            const auto& node = GetNodeTransform(mesh.node);
+            for (uint32_t c = mesh.clusterStart; c < mesh.clusterStart + mesh.clusterCount; ++c)
+            {
+                // AABB of the transformed AABB: the extent goes through the absolute rotation and scale
+                const Vector3 center = Vector3::Transform((Vector3(m_clusters[c].aabbMin) + Vector3(m_clusters[c].aabbMax)) * 0.5f, node);
+                const Vector3 halfExtent = (Vector3(m_clusters[c].aabbMax) - Vector3(m_clusters[c].aabbMin)) * 0.5f;
+                const Vector3 extent(
+                    halfExtent.x * std::abs(node._11) + halfExtent.y * std::abs(node._21) + halfExtent.z * std::abs(node._31),
+                    halfExtent.x * std::abs(node._12) + halfExtent.y * std::abs(node._22) + halfExtent.z * std::abs(node._32),
+                    halfExtent.x * std::abs(node._13) + halfExtent.y * std::abs(node._23) + halfExtent.z * std::abs(node._33));
+
+                min = first ? center - extent : Vector3::Min(min, center - extent);
+                max = first ? center + extent : Vector3::Max(max, center + extent);
+                first = false;
+            }
+        }
+        if (first)
+            return;
+
+        m_boundsCenter = (min + max) * 0.5f;
+        m_boundsRadius = 0.f;
+        for (const auto& mesh : m_meshes)
+        {
+            const auto& node = GetNodeTransform(mesh.node);
+            const float scale = GetMaxScale(node);
+            for (uint32_t c = mesh.clusterStart; c < mesh.clusterStart + mesh.clusterCount; ++c)
+                m_boundsRadius = std::max(m_boundsRadius, Vector3::Distance(m_boundsCenter, Vector3::Transform(Vector3(m_clusters[c].center), node)) + m_clusters[c].radius * scale);
+        }
+    }
+
+    const std::vector<MeshCluster>& Model::GetClusters() const
+    {
+        return m_clusters;
+    }
+
+    const std::vector<uint32_t>& Model::GetIndices() const
+    {
+        return m_indices;
+    }
+
+    void Model::SetLods(const MeshLod* lods, size_t lodCount)
+    {
+        m_lods.assign(lods, lods + lodCount);
+
+        m_lodCount = 1;
+        m_lodErrors.fill(0.f);
+        for (const auto& mesh : m_meshes)
+        {
+            assert(mesh.lodStart + mesh.lodCount <= lodCount && mesh.lodCount < s_maxLods);
+            m_lodCount = std::max(m_lodCount, mesh.lodCount + 1);
+        }
+
+        // A mesh with fewer levels keeps drawing its last one, so its error carries over to the coarser levels
+        for (uint32_t lod = 1; lod < m_lodCount; ++lod)
+        {
+            for (const auto& mesh : m_meshes)
+                m_lodErrors[lod] = std::max(m_lodErrors[lod], GetMeshLod(mesh, lod).error);
+        }
+    }
+
+    const std::vector<MeshLod>& Model::GetLods() const
+    {
+        return m_lods;
+    }
+
+    uint32_t Model::GetLodCount() const
+    {
+        return m_lodCount;
+    }
+
+    float Model::GetLodError(uint32_t lod) const
+    {
+        return m_lodErrors[std::min(lod, m_lodCount - 1)];
+    }
+
+    MeshLod Model::GetMeshLod(const Mesh& mesh, uint32_t lod) const
+    {
+        lod = std::min(lod, mesh.lodCount);
+        if (lod == 0)
+            return MeshLod{ .indexStart = mesh.indicesFirstIndex, .indexCount = mesh.numIndices, .error = 0.f };
+        return m_lods[mesh.lodStart + lod - 1];
+    }
+
+    const DirectX::SimpleMath::Vector3& Model::GetBoundsCenter() const
+    {
+        return m_boundsCenter;
+    }
+
+    float Model::GetBoundsRadius() const
+    {
+        return m_boundsRadius;
+    }
+
+    void Model::SetTextureReferences(std::vector<TextureHandle>&& textures)
+    {
+        m_textureReferences = std::move(textures);
+    }
+
+    const std::vector<TextureHandle>& Model::GetTextureReferences() const
+    {
+        return m_textureReferences;
+    }
+
+    size_t Model::GetMemoryBytes() const
+    {
+        size_t bytes = 0;
+        for (const Buffer* buffer : { &m_vb, &m_ib })
+        {
+            if (!buffer->buffer)
+                continue;
+            D3D11_BUFFER_DESC desc{};
+            buffer->buffer->GetDesc(&desc);
+            bytes += desc.ByteWidth;
+        }
+        bytes += m_clusters.size() * sizeof(MeshCluster);
+        bytes += m_indices.size() * sizeof(uint32_t);
+        bytes += m_lods.size() * sizeof(MeshLod);
+        bytes += m_nodeParents.size() * sizeof(uint32_t);
+        bytes += (m_nodeLocalTransforms.size() + m_nodeTransforms.size()) * sizeof(DirectX::SimpleMath::Matrix);
+        return bytes;
+    }
+
 
 }
 
@@ -3,23 +3,31 @@
 
 #include "FPCamera.h"
 #include "Graphics/Model.h"
+#include "TransformSystem.h"
 
 // Temp
 #include "Timer.h"
 
 #include "Graphics/ImGuiRenderer.h"
 #include "Graphics/SkyboxRenderer.h"
+#include "Graphics/ClusterCuller.h"
+#include "Graphics/IBLBaker.h"
+
+#include <algorithm>
 
 #define MAX_INSTANCES 3500
+#define MAX_CULLED_INSTANCES 16		// Models with more instances are drawn whole (clusters are tested against every instance)
 
 namespace Gino
 {
-	Renderer::Renderer(DXDevice* dxDev, bool vsync) :
+	Renderer::Renderer(DXDevice* dxDev, bool vsync, const TextureStreamingSettings& streamingSettings, ThreadPool* threadPool) :
 		m_mainCamera(nullptr),
 		m_vsync(vsync),
 		m_dxDev(dxDev),
 		m_imGui(std::make_unique<ImGuiRenderer>(dxDev->GetHWND(), dxDev->GetDevice(), dxDev->GetContext())),
-		m_skybox(std::make_unique<SkyboxRenderer>(dxDev))
+		m_skybox(std::make_unique<SkyboxRenderer>(dxDev, threadPool)),
+		m_textureStreamer(std::make_unique<TextureStreamer>(dxDev, streamingSettings)),
+		m_textureBudgetMB(static_cast<int>(streamingSettings.budgetBytes / (1024 * 1024)))
 	{
 		std::cout << "vsync: " << (vsync ? "on" : "off") << '\n';
 
@@ -52,6 +60,19 @@ namespace Gino
 			.AddInputDesc({ "INSTANCE_WM_ROW", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 })
 			.Build(dev);
 
+		// Same pixel shader, vertex shader decodes Vertex_Compact
+		m_forwardOpaquePBRCompactShaders
+			.AddStage(ShaderStage::Vertex, "compiled_shaders/ForwardPBRCompact_VS.cso")
+			.AddStage(ShaderStage::Pixel, "compiled_shaders/ForwardPBR_PS.cso")
+			.AddInputDescs(Vertex_Compact::GetElementDescriptors())
+
+			// Setup instancing data (Buffer 1)
+			.AddInputDesc({ "INSTANCE_WM_ROW", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 })
+			.AddInputDesc({ "INSTANCE_WM_ROW", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 })
+			.AddInputDesc({ "INSTANCE_WM_ROW", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 })
+			.AddInputDesc({ "INSTANCE_WM_ROW", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 })
+			.Build(dev);
+
 		m_forwardOpaquePhongShaders
 			.AddStage(ShaderStage::Vertex, "compiled_shaders/ForwardPhong_VS.cso")
 			.AddStage(ShaderStage::Pixel, "compiled_shaders/ForwardPhong_PS.cso")
@@ -113,6 +134,7 @@ namespace Gino
 
 		m_cbPerFrame.Initialize(dev);
 		m_cbPerObject.Initialize(dev);
+		m_cbPerMesh.Initialize(dev);
 
 
 		// Setup HDR render to texture
@@ -157,6 +179,7 @@ namespace Gino
 		// setup point light structued buffer
 		m_sbPointLights.Initialize(dev, StructuredBufferDesc<SB_PointLight>{.elementCount = 6, .dynamic = true, .cpuWrite = true});
 
+		InitializeIBL(threadPool);
 
 
 	}
@@ -165,6 +188,61 @@ namespace Gino
 	{
 	}
 
+	void Renderer::InitializeIBL(ThreadPool* threadPool)
+	{
+		auto& dev = m_dxDev->GetDevice();
+		auto& ctx = m_dxDev->GetContext();
+
+		const IBLBaker baker(threadPool);
+		const IBLData ibl = baker.LoadOrBake(m_skybox->GetEnvironmentPath());
+
+		m_cbIBL.Initialize(dev);
+		for (uint32_t i = 0; i < 9; ++i)
+			m_cbIBL.data.irradianceSH[i] = DirectX::SimpleMath::Vector4(ibl.irradianceSH[i][0], ibl.irradianceSH[i][1], ibl.irradianceSH[i][2], 0.f);
+		m_cbIBL.Upload(ctx);
+
+		m_iblSpecular.InitializeCubeFromData(dev, ctx, ibl.specular);
+		m_cbPerFrame.data.iblSpecularMaxMip = static_cast<float>(ibl.specular.mipCount - 1);
+
+		// Split sum LUT (RG16F)
+		D3D11_TEXTURE2D_DESC lutDesc
+		{
+			.Width = ibl.brdfLutSize,
+			.Height = ibl.brdfLutSize,
+			.MipLevels = 1,
+			.ArraySize = 1,
+			.Format = DXGI_FORMAT_R16G16_FLOAT,
+			.SampleDesc = {.Count = 1, .Quality = 0 },
+			.Usage = D3D11_USAGE_IMMUTABLE,
+			.BindFlags = D3D11_BIND_SHADER_RESOURCE,
+			.CPUAccessFlags = 0,
+			.MiscFlags = 0
+		};
+		D3D11_SUBRESOURCE_DATA lutData{ .pSysMem = ibl.brdfLut.data(), .SysMemPitch = ibl.brdfLutSize * 2 * sizeof(uint16_t), .SysMemSlicePitch = 0 };
+
+		Tex2DPtr lutTexture;
+		SrvPtr lutSrv;
+		HRCHECK(dev->CreateTexture2D(&lutDesc, &lutData, lutTexture.GetAddressOf()));
+		HRCHECK(dev->CreateShaderResourceView(lutTexture.Get(), nullptr, lutSrv.GetAddressOf()));
+		m_brdfLut.InitializeFromExisting(lutTexture, nullptr, lutSrv);
+
+		// Clamped so that the LUT edges (NdotV, roughness of 0 and 1) do not wrap
+		D3D11_SAMPLER_DESC iblSamplerDesc
+		{
+			.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR,
+			.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP,
+			.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP,
+			.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP,
+			.MipLODBias = 0.f,
+			.MaxAnisotropy = 0,
+			.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL,
+			.BorderColor = { 0.f, 0.f, 0.f, 1.f },
+			.MinLOD = 0.f,
+			.MaxLOD = D3D11_FLOAT32_MAX
+		};
+		HRCHECK(dev->CreateSamplerState(&iblSamplerDesc, m_iblSampler.GetAddressOf()));
+	}
+
 	void Renderer::SetRenderCamera(FPCamera* cam)
 	{
 		m_mainCamera = cam;
@@ -175,9 +253,10 @@ namespace Gino
 		}
 	}
 
-	void Renderer::SetModels(const std::vector<std::pair<Model*, std::vector<Transform*>>>* models)
+	void Renderer::SetModels(const RenderList* models, const TransformSystem* transforms)
 	{
 		m_opaqueModels = models;
+		m_transforms = transforms;
 	}
 	
 	void Renderer::BeginFrame()
@@ -198,6 +277,10 @@ namespace Gino
 
 	static bool norMapOn = true;
 	static bool aoTexOn = true;
+	static bool iblOn = true;
+	static bool clusterCullingOn = true;
+	static bool lodSelectionOn = true;
+	static float lodPixelError = 1.f;
 	void Renderer::Render()
 	{
 		assert(m_mainCamera != nullptr);
@@ -206,6 +289,12 @@ namespace Gino
 		ImGui::Begin("PBR Renderer Settings");
 		ImGui::Checkbox("Normal Mapping", &norMapOn);
 		ImGui::Checkbox("AO Texture", &aoTexOn);
+		ImGui::Checkbox("Image Based Lighting", &iblOn);
+		ImGui::Checkbox("Cluster Culling", &clusterCullingOn);
+		ImGui::Checkbox("LOD Selection", &lodSelectionOn);
+		ImGui::SliderFloat("LOD Pixel Error", &lodPixelError, 0.25f, 16.f);
+		if (ImGui::SliderInt("Texture Budget MB", &m_textureBudgetMB, 16, 2048))
+			m_textureStreamer->SetBudget(static_cast<size_t>(m_textureBudgetMB) * 1024 * 1024);
 		ImGui::End();
 
 		// Update frame data for GPU
@@ -216,6 +305,7 @@ namespace Gino
 			m_cbPerFrame.data.cameraPosition = m_mainCamera->GetPosition();
 			m_cbPerFrame.data.normalMapOn = norMapOn ? 1.f : 0.f;
 			m_cbPerFrame.data.aoTexOn = aoTexOn ? 1.f : 0.f;
+			m_cbPerFrame.data.iblOn = iblOn ? 1.f : 0.f;
 			m_cbPerFrame.Upload(ctx);
 
 			// Update light list
@@ -245,6 +335,37 @@ namespace Gino
 		// Render skybox
 		m_skybox->Render(m_renderFramebuffer, m_dxDev->GetBackbufferViewport());
 
+		// Pick a LOD per instance, then cull clusters of the LOD0 instances and compact the surviving indices for this frame
+		Timer lodTimer;
+		m_textureStreamer->BeginFrame();
+		SelectLods();
+		const float lodMs = lodTimer.TimeElapsed() * 1000.f;
+
+		// Stream texture mips towards the footprints reported by SelectLods, before anything samples them
+		Timer streamTimer;
+		m_textureStreamer->Update();
+		const float streamMs = streamTimer.TimeElapsed() * 1000.f;
+
+		Timer cullTimer;
+		CullClusters();
+		const float cullMs = cullTimer.TimeElapsed() * 1000.f;
+
+		ImGui::Begin("Frame Statistics");
+		ImGui::Text("LOD Selection CPU %s ms", std::to_string(lodMs).c_str());
+		ImGui::Text("Cluster Culling CPU %s ms", std::to_string(cullMs).c_str());
+		ImGui::Text("Clusters visible %u / %u", m_cullStats.clustersVisible, m_cullStats.clustersTotal);
+		ImGui::Text("Triangles submitted %llu / %llu", m_cullStats.trianglesSubmitted, m_cullStats.trianglesTotal);
+
+		const auto& streamStats = m_textureStreamer->GetStats();
+		constexpr float toMB = 1.f / (1024.f * 1024.f);
+		ImGui::Text("Texture Streaming CPU %s ms", std::to_string(streamMs).c_str());
+		ImGui::Text("Texture memory %.1f / %.1f MB (resident %.1f MB, wanted %.1f MB, full chains %.1f MB)",
+			streamStats.allocatedBytes * toMB, streamStats.budgetBytes * toMB, streamStats.residentBytes * toMB, streamStats.wantedBytes * toMB, streamStats.fullChainBytes * toMB);
+		ImGui::Text("Textures at wanted mip %u / %u (%u clamped by budget)", streamStats.texturesAtWantedMip, streamStats.textures, streamStats.texturesBudgetClamped);
+		ImGui::Text("Streamed in %u | evicted %u | uploaded %u levels (%.2f MB) | pending %u levels",
+			streamStats.streamedIn, streamStats.evicted, streamStats.levelsUploaded, streamStats.uploadedBytes * toMB, streamStats.pendingLevels);
+		ImGui::End();
+
 		// Render models
 		Timer opaquePassTimer;
 		{
@@ -258,7 +379,11 @@ namespace Gino
 
 			ctx->PSSetShaderResources(7, 1, m_sbPointLights.srv.GetAddressOf());
 
-			ID3D11SamplerState* samplers[] = { m_mainSampler.Get(), m_pointSampler.Get() };
+			ctx->PSSetConstantBuffers(3, 1, m_cbIBL.buffer.GetAddressOf());
+			ID3D11ShaderResourceView* iblSrvs[] = { m_iblSpecular.GetSRV(), m_brdfLut.GetSRV() };
+			ctx->PSSetShaderResources(5, _countof(iblSrvs), iblSrvs);
+
+			ID3D11SamplerState* samplers[] = { m_mainSampler.Get(), m_pointSampler.Get(), m_iblSampler.Get() };
 			ctx->PSSetSamplers(0, _countof(samplers), samplers);
 
 			// Render to texture
@@ -266,42 +391,60 @@ namespace Gino
 			ctx->OMSetDepthStencilState(m_dss.Get(), 0);
 
 			// Render models
-			for (const auto& modelInstance : *m_opaqueModels)
+			m_lodStats.trianglesDrawn = 0;
+			m_lodStats.trianglesAtLod0 = 0;
+			const auto& models = m_opaqueModels->GetModels();
+			for (size_t modelIndex = 0; modelIndex < models.size(); ++modelIndex)
 			{
-				const auto& model = modelInstance.first;
-				const auto& instances = modelInstance.second;
+				const auto& model = models[modelIndex].model;
+				const uint32_t instanceCount = models[modelIndex].count;
+				const int32_t culledDrawStart = m_culledDrawStart[modelIndex];
+				const uint32_t lodCount = model->GetLodCount();
+				const LodGroup* lodGroups = &m_lodGroups[m_lodGroupStart[modelIndex]];
+				const uint32_t firstInstance = lodGroups[0].first;
+				if (instanceCount == 0 || !model->IsResident())		// Async load still in flight
+					continue;
 
 				// We guarantee that the material type for a whole model is identical
 				auto matType = model->GetMaterials()[0].GetType();
+				const bool compactVertices = model->GetVertexFormat() == VertexFormat::Compact;
 				if (matType == MaterialType::PBR)
 				{
-					m_forwardOpaquePBRShaders.Bind(ctx);
+					if (compactVertices)
+						m_forwardOpaquePBRCompactShaders.Bind(ctx);
+					else
+						m_forwardOpaquePBRShaders.Bind(ctx);
 				}
 				else if (matType == MaterialType::Phong)
 				{
 					m_forwardOpaquePhongShaders.Bind(ctx);
 				}
+				ctx->VSSetConstantBuffers(2, 1, m_cbPerMesh.buffer.GetAddressOf());
 
 
-				assert(instances.size() <= MAX_INSTANCES);
+				assert(instanceCount <= MAX_INSTANCES);
 
-				// Fill instance data
+				// Fill instance data, grouped by LOD so that every level draws one contiguous instance range
 				D3D11_MAPPED_SUBRESOURCE mappedInstSubres;
 				ctx->Map(m_instanceBuffer.buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedInstSubres);
-				auto seat = (DirectX::SimpleMath::Matrix*)mappedInstSubres.pData;
-				for (int i = 0; i < instances.size(); ++i)
-				{
-					seat[i] = instances[i]->GetWorldMatrix();
-				}
+				m_transforms->CopyWorldMatrices(m_lodInstances.data() + firstInstance, instanceCount, (DirectX::SimpleMath::Matrix*)mappedInstSubres.pData);
 				ctx->Unmap(m_instanceBuffer.buffer.Get(), 0);
 
 				ID3D11Buffer* vbs[] = { model->GetVB(), m_instanceBuffer.buffer.Get() };
-				UINT vbStrides[] = { sizeof(Vertex_POS_UV_NORMAL), sizeof(DirectX::SimpleMath::Matrix) };
+				UINT vbStrides[] = { model->GetVertexStride(), sizeof(DirectX::SimpleMath::Matrix) };
 				UINT vbOffsets[] = { 0, 0 };
 				ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 				ctx->IASetVertexBuffers(0, _countof(vbs), vbs, vbStrides, vbOffsets);
-				ctx->IASetIndexBuffer(model->GetIB(), DXGI_FORMAT_R32_UINT, 0);
-				ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+				// LOD0 of a culled model draws from the compacted IB, everything else from the model IB
+				ID3D11Buffer* boundIB = nullptr;
+				auto bindIB = [&ctx, &boundIB](ID3D11Buffer* ib)
+				{
+					if (ib == boundIB)
+						return;
+					ctx->IASetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, 0);
+					boundIB = ib;
+				};
 
 				const auto& meshes = model->GetMeshes();
 				const auto& materials = model->GetMaterials();
@@ -316,9 +459,8 @@ namespace Gino
 						ID3D11ShaderResourceView* srvs[] =
 						{
 							materials[i].GetProperties<PBRMaterialData>().albedo->GetSRV() ,
-							materials[i].GetProperties<PBRMaterialData>().metallicAndRoughness->GetSRV(),
+							materials[i].GetProperties<PBRMaterialData>().orm->GetSRV(),
 							materials[i].GetProperties<PBRMaterialData>().normal->GetSRV(),
-							materials[i].GetProperties<PBRMaterialData>().ao->GetSRV(),
 							materials[i].GetProperties<PBRMaterialData>().emission->GetSRV()
 						};
 
@@ -337,7 +479,42 @@ namespace Gino
 						ctx->PSSetShaderResources(0, _countof(srvs), srvs);
 					}
 
-					ctx->DrawIndexedInstanced(meshes[i].numIndices, (uint32_t)instances.size(), meshes[i].indicesFirstIndex, meshes[i].vertexOffset, 0);
+					// Compact positions are quantized per mesh, meshes of one node (contiguous, see AssimpNode) share the rest
+					if (compactVertices || i == 0 || meshes[i].node != meshes[i - 1].node)
+					{
+						m_cbPerMesh.data.positionOffset = DirectX::SimpleMath::Vector4(meshes[i].positionOffset.x, meshes[i].positionOffset.y, meshes[i].positionOffset.z, 0.f);
+						m_cbPerMesh.data.positionScale = DirectX::SimpleMath::Vector4(meshes[i].positionScale.x, meshes[i].positionScale.y, meshes[i].positionScale.z, 0.f);
+						m_cbPerMesh.data.nodeTransform = model->GetNodeTransform(meshes[i].node);
+						m_cbPerMesh.Upload(ctx);
+					}
+
+					for (uint32_t lod = 0; lod < lodCount; ++lod)
+					{
+						const LodGroup& group = lodGroups[lod];
+						if (group.count == 0)
+							continue;
+
+						// Compacted index range of the visible clusters
+						MeshLod range = model->GetMeshLod(meshes[i], lod);
+						if (lod == 0 && culledDrawStart >= 0)
+						{
+							const auto& culledDraw = m_culledDraws[culledDrawStart + i];
+							range.indexStart = culledDraw.first;
+							range.indexCount = culledDraw.count;
+							bindIB(m_culledIB.buffer.Get());
+						}
+						else
+						{
+							bindIB(model->GetIB());
+						}
+
+						m_lodStats.trianglesDrawn += (uint64_t)range.indexCount / 3 * group.count;
+						m_lodStats.trianglesAtLod0 += (uint64_t)meshes[i].numIndices / 3 * group.count;
+						if (range.indexCount == 0)
+							continue;
+
+						ctx->DrawIndexedInstanced(range.indexCount, group.count, range.indexStart, meshes[i].vertexOffset, group.first - firstInstance);
+					}
 
 					//// no instancing
 					//for (int instanceID = 0; instanceID < modelInstance.second.size(); ++instanceID)
@@ -356,6 +533,11 @@ namespace Gino
 		}
 		ImGui::Begin("Frame Statistics");
 		ImGui::Text("Opaque Draw Pass CPU %s ms", std::to_string(opaquePassTimer.TimeElapsed() * 1000.f).c_str());
+		std::string instancesPerLod;
+		for (size_t lod = 0; lod < m_lodStats.instancesPerLod.size(); ++lod)
+			instancesPerLod += (lod == 0 ? "" : " / ") + std::to_string(m_lodStats.instancesPerLod[lod]);
+		ImGui::Text("Instances per LOD %s", instancesPerLod.c_str());
+		ImGui::Text("Triangles drawn %llu (%llu at LOD0)", m_lodStats.trianglesDrawn, m_lodStats.trianglesAtLod0);
 		ImGui::End();
 
 		// Render fullscreen quad pass
@@ -387,10 +569,187 @@ namespace Gino
 
 	}
 
+	void Renderer::SelectLods()
+	{
+		m_lodInstances.clear();
+		m_lodGroups.clear();
+		const auto& models = m_opaqueModels->GetModels();
+		m_lodGroupStart.resize(models.size());
+		m_lodStats.instancesPerLod.assign(Model::s_maxLods, 0);
+
+		// Projected error in pixels = error * scale / distance * projectionScale, with distance to the nearest point of the bounds
+		const float projectionScale = m_dxDev->GetBackbufferViewport().Height / (2.f * std::tan(DirectX::XMConvertToRadians(m_mainCamera->GetFovInDegs()) * 0.5f));
+		const float nearPlane = m_mainCamera->GetNearPlane();
+		const auto& cameraPosition = m_mainCamera->GetPosition();
+		const DirectX::SimpleMath::Vector3 camera(cameraPosition.x, cameraPosition.y, cameraPosition.z);
+
+		for (size_t modelIndex = 0; modelIndex < models.size(); ++modelIndex)
+		{
+			const auto& model = models[modelIndex].model;
+			const uint32_t* instances = m_opaqueModels->GetInstances().data() + models[modelIndex].first;
+			const uint32_t instanceCount = models[modelIndex].count;
+			const uint32_t lodCount = model->GetLodCount();
+
+			m_instanceLods.resize(instanceCount);
+			uint32_t counts[Model::s_maxLods] = {};
+			float maxPixelsPerUnit = 0.f;
+			for (uint32_t i = 0; i < instanceCount; ++i)
+			{
+				const auto& world = m_transforms->GetWorldMatrix(instances[i]);
+				const float scale = std::max({ world.Right().Length(), world.Up().Length(), world.Forward().Length() });
+				const auto center = DirectX::SimpleMath::Vector3::Transform(model->GetBoundsCenter(), world);
+				const float distance = std::max(DirectX::SimpleMath::Vector3::Distance(center, camera) - model->GetBoundsRadius() * scale, nearPlane);
+				const float pixelsPerUnit = scale * projectionScale / distance;
+				maxPixelsPerUnit = std::max(maxPixelsPerUnit, pixelsPerUnit);
+
+				uint32_t selected = 0;
+				if (lodSelectionOn && lodCount > 1)
+				{
+					// Coarsest level that stays under the pixel budget. The LOD error is an RMS estimate, not a bound,
+					// so the budget is a tuning value rather than a guaranteed pixel deviation.
+					for (uint32_t lod = lodCount - 1; lod > 0; --lod)
+					{
+						if (model->GetLodError(lod) * pixelsPerUnit <= lodPixelError)
+						{
+							selected = lod;
+							break;
+						}
+					}
+				}
+				m_instanceLods[i] = selected;
+				++counts[selected];
+			}
+
+			// Counting sort of the instances into one group per LOD
+			m_lodGroupStart[modelIndex] = static_cast<uint32_t>(m_lodGroups.size());
+			uint32_t first = static_cast<uint32_t>(m_lodInstances.size());
+			for (uint32_t lod = 0; lod < lodCount; ++lod)
+			{
+				m_lodGroups.push_back(LodGroup{ .first = first, .count = 0 });
+				first += counts[lod];
+				m_lodStats.instancesPerLod[lod] += counts[lod];
+			}
+
+			m_lodInstances.resize(first);
+			LodGroup* groups = &m_lodGroups[m_lodGroupStart[modelIndex]];
+			for (uint32_t i = 0; i < instanceCount; ++i)
+			{
+				LodGroup& group = groups[m_instanceLods[i]];
+				m_lodInstances[group.first + group.count++] = instances[i];
+			}
+
+			// Textures are sampled at the finest detail any instance needs
+			if (instanceCount != 0)
+				m_textureStreamer->RequestModel(model, maxPixelsPerUnit);
+		}
+	}
+
+	void Renderer::CullClusters()
+	{
+		m_culledIndices.clear();
+		m_culledDraws.clear();
+		const auto& models = m_opaqueModels->GetModels();
+		m_culledDrawStart.assign(models.size(), -1);
+		m_cullStats = {};
+
+		if (!clusterCullingOn)
+			return;
+
+		const auto view = m_mainCamera->GetViewMatrix();
+		const auto projection = m_mainCamera->GetProjectionMatrix();
+		const auto& cameraPosition = m_mainCamera->GetPosition();
+
+		std::vector<ClusterCullView> cullViews;
+		for (size_t modelIndex = 0; modelIndex < models.size(); ++modelIndex)
+		{
+			const auto& model = models[modelIndex].model;
+			const auto& clusters = model->GetClusters();
+			const LodGroup& lod0 = m_lodGroups[m_lodGroupStart[modelIndex]];		// Clusters only cover LOD0
+			if (clusters.empty() || lod0.count == 0 || lod0.count > MAX_CULLED_INSTANCES)
+				continue;
+
+			const auto& indices = model->GetIndices();
+			m_culledDrawStart[modelIndex] = static_cast<int32_t>(m_culledDraws.size());
+			uint32_t viewNode = ~0u;
+			for (const auto& mesh : model->GetMeshes())
+			{
+				CulledDraw draw{ .first = static_cast<uint32_t>(m_culledIndices.size()), .count = 0 };
+				if (mesh.clusterCount == 0)
+				{
+					m_culledIndices.insert(m_culledIndices.end(), indices.begin() + mesh.indicesFirstIndex, indices.begin() + mesh.indicesFirstIndex + mesh.numIndices);
+				}
+				else if (mesh.node != viewNode)
+				{
+					// A cluster is kept if any instance sees it. Clusters are in the space of the mesh node, which goes in front of the instance.
+					viewNode = mesh.node;
+					const auto& node = model->GetNodeTransform(mesh.node);
+					cullViews.clear();
+					for (uint32_t i = lod0.first; i < lod0.first + lod0.count; ++i)
+						cullViews.push_back(ClusterCuller::MakeView(node * m_transforms->GetWorldMatrix(m_lodInstances[i]), view, projection, DirectX::SimpleMath::Vector3(cameraPosition.x, cameraPosition.y, cameraPosition.z)));
+				}
+
+				for (uint32_t c = mesh.clusterStart; c < mesh.clusterStart + mesh.clusterCount; ++c)
+				{
+					const auto& cluster = clusters[c];
+					++m_cullStats.clustersTotal;
+					m_cullStats.trianglesTotal += cluster.indexCount / 3;
+
+					bool visible = false;
+					for (const auto& cullView : cullViews)
+					{
+						if (ClusterCuller::IsVisible(cluster, cullView))
+						{
+							visible = true;
+							break;
+						}
+					}
+					if (!visible)
+						continue;
+
+					++m_cullStats.clustersVisible;
+					m_cullStats.trianglesSubmitted += cluster.indexCount / 3;
+					m_culledIndices.insert(m_culledIndices.end(), indices.begin() + cluster.indexStart, indices.begin() + cluster.indexStart + cluster.indexCount);
+				}
+
+				draw.count = static_cast<uint32_t>(m_culledIndices.size()) - draw.first;
+				m_culledDraws.push_back(draw);
+			}
+		}
+
+		if (m_culledIndices.empty())
+			return;
+
+		// Grow the per-frame index buffer when needed
+		auto ctx = m_dxDev->GetContext();
+		if (m_culledIndices.size() > m_culledIBCapacity)
+		{
+			m_culledIBCapacity = static_cast<uint32_t>(m_culledIndices.size() + m_culledIndices.size() / 2);
+			D3D11_BUFFER_DESC ibDesc
+			{
+				.ByteWidth = m_culledIBCapacity * sizeof(uint32_t),
+				.Usage = D3D11_USAGE_DYNAMIC,
+				.BindFlags = D3D11_BIND_INDEX_BUFFER,
+				.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE
+			};
+			m_culledIB = {};
+			m_culledIB.Initialize(m_dxDev->GetDevice(), ibDesc);
+		}
+
+		D3D11_MAPPED_SUBRESOURCE mappedIndices;
+		HRCHECK(ctx->Map(m_culledIB.buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedIndices));
+		std::memcpy(mappedIndices.pData, m_culledIndices.data(), m_culledIndices.size() * sizeof(uint32_t));
+		ctx->Unmap(m_culledIB.buffer.Get(), 0);
+	}
+
 	ImGuiRenderer* Renderer::GetImGui() const
 	{
 		return m_imGui.get();
 	}
 
+	TextureStreamer* Renderer::GetTextureStreamer() const
+	{
+		return m_textureStreamer.get();
+	}
+
 }
 
@@ -1,5 +1,8 @@
 #include "pch.h"
 #include "Graphics/ResourceTypes.h"
+#include "Graphics/MipGenerator.h"
+#include "Graphics/DDSFile.h"
+#include "Graphics/CubemapConverter.h"
 
 namespace Gino
 {
@@ -16,6 +19,18 @@ namespace Gino
         return descriptor;
     }
 
+    std::vector<D3D11_INPUT_ELEMENT_DESC> Vertex_Compact::GetElementDescriptors()
+    {
+        std::vector<D3D11_INPUT_ELEMENT_DESC> descriptor =
+        {
+            { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+        };
+        return descriptor;
+    }
+
     void Buffer::Initialize(const DevicePtr& dev, const D3D11_BUFFER_DESC& desc, const void* initData)
     {
         D3D11_SUBRESOURCE_DATA subres
@@ -58,6 +73,21 @@ namespace Gino
         HRCHECK(dev->CreateBuffer(&ibDesc, &ibDat, buffer.GetAddressOf()));
     }
 
+    void Buffer::Initialize(const DevicePtr& dev, const IndexBufferDescRaw& desc)
+    {
+        D3D11_BUFFER_DESC ibDesc
+        {
+            .ByteWidth = static_cast<uint32_t>(desc.count * sizeof(uint32_t)),     // narrowing cast from size_t to unsigned
+            .Usage = D3D11_USAGE_IMMUTABLE,
+            .BindFlags = D3D11_BIND_INDEX_BUFFER,
+        };
+        D3D11_SUBRESOURCE_DATA ibDat
+        {
+            .pSysMem = desc.data,
+            .SysMemPitch = ibDesc.ByteWidth
+        };
+        HRCHECK(dev->CreateBuffer(&ibDesc, &ibDat, buffer.GetAddressOf()));
+    }
 
     void Buffer::Initialize(const DevicePtr& dev, const RWBufferDesc& desc)
     {
@@ -352,35 +382,22 @@ namespace Gino
         }
     }
 
-    void Texture::InitializeFromFile(const DevicePtr& dev, const DeviceContextPtr& ctx, const std::filesystem::path& filePath, bool srgb, bool genMipMaps)
+    void Texture::InitializeFromFile(const DevicePtr& dev, const DeviceContextPtr& ctx, const std::filesystem::path& filePath, bool srgb, bool genMipMaps, HDRFormat hdrFormat)
     {
         bool hdr = filePath.extension() == ".hdr" ? true : false;
-        genMipMaps = hdr ? false : genMipMaps;
 
         auto imageData = Utils::ReadImageFile(filePath, hdr);
-        
-        DXGI_FORMAT format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
-        format = hdr ? DXGI_FORMAT_R32G32B32A32_FLOAT : format;
-
-        UINT miscFlags = genMipMaps ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
-        UINT mipLevels = genMipMaps ? 0 : 1;
-        UINT bindFlags = genMipMaps ? D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET : D3D11_BIND_SHADER_RESOURCE;
 
-        D3D11_TEXTURE2D_DESC texDesc
+        if (hdr)
         {
-            .Width = imageData.texWidth,
-            .Height = imageData.texHeight,
-            .MipLevels = mipLevels,
-            .ArraySize = 1,
-            .Format = format,
-            .SampleDesc = {.Count = 1, .Quality = 0 },      // Hardcoded multisample settings for now
-            .Usage = D3D11_USAGE_DEFAULT,
-            .BindFlags = bindFlags,
-            .CPUAccessFlags = 0,
-            .MiscFlags = miscFlags
-        };
-
-        this->Initialize(dev, ctx, texDesc, { &imageData }, hdr);
+            // Mips are filtered in linear float before the encoder quantizes them (GenerateMips can not write BC6H anyway)
+            MipGenSettings settings{};
+            settings.maxLevels = genMipMaps ? 0 : 1;
+            const MipChain chain = MipGenerator().Generate(imageData, settings);
+            this->InitializeFromHDR(dev, ctx, HDREncoder().Encode(chain, hdrFormat));
+        }
+        else
+            this->InitializeFromImage(dev, ctx, imageData, srgb, genMipMaps, hdr);
 
         imageData.Release();
 
@@ -417,6 +434,116 @@ namespace Gino
 		//};
     }
 
+    void Texture::InitializeFromImage(const DevicePtr& dev, const DeviceContextPtr& ctx, Utils::ImageData& imageData, bool srgb, bool genMipMaps, bool hdr)
+    {
+        genMipMaps = hdr ? false : genMipMaps;
+
+        DXGI_FORMAT format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+        format = hdr ? DXGI_FORMAT_R32G32B32A32_FLOAT : format;
+
+        UINT miscFlags = genMipMaps ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
+        UINT mipLevels = genMipMaps ? 0 : 1;
+        UINT bindFlags = genMipMaps ? D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET : D3D11_BIND_SHADER_RESOURCE;
+
+        D3D11_TEXTURE2D_DESC texDesc
+        {
+            .Width = imageData.texWidth,
+            .Height = imageData.texHeight,
+            .MipLevels = mipLevels,
+            .ArraySize = 1,
+            .Format = format,
+            .SampleDesc = {.Count = 1, .Quality = 0 },      // Hardcoded multisample settings for now
+            .Usage = D3D11_USAGE_DEFAULT,
+            .BindFlags = bindFlags,
+            .CPUAccessFlags = 0,
+            .MiscFlags = miscFlags
+        };
+
+        this->Initialize(dev, ctx, texDesc, { &imageData }, hdr);
+    }
+
+    void Texture::InitializeFromMipChain(const DevicePtr& dev, const DeviceContextPtr& ctx, const MipChain& chain, bool srgb)
+    {
+        assert(!chain.levels.empty());
+
+        DXGI_FORMAT format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+        format = chain.hdr ? DXGI_FORMAT_R32G32B32A32_FLOAT : format;
+
+        D3D11_TEXTURE2D_DESC texDesc
+        {
+            .Width = chain.levels[0].width,
+            .Height = chain.levels[0].height,
+            .MipLevels = static_cast<UINT>(chain.levels.size()),
+            .ArraySize = 1,
+            .Format = format,
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Usage = D3D11_USAGE_IMMUTABLE,
+            .BindFlags = D3D11_BIND_SHADER_RESOURCE,
+            .CPUAccessFlags = 0,
+            .MiscFlags = 0
+        };
+
+        std::vector<D3D11_SUBRESOURCE_DATA> subresources;
+        subresources.reserve(chain.levels.size());
+        for (const auto& level : chain.levels)
+            subresources.push_back({ .pSysMem = level.data.data(), .SysMemPitch = level.rowPitch, .SysMemSlicePitch = 0 });
+
+        HRCHECK(dev->CreateTexture2D(&texDesc, subresources.data(), m_texture.GetAddressOf()));
+
+        CreateViews(dev, ctx, texDesc);
+    }
+
+    void Texture::InitializeFromDDS(const DevicePtr& dev, const DeviceContextPtr& ctx, const DDSFile& dds)
+    {
+        assert(dds.GetMipCount() > 0);
+
+        D3D11_TEXTURE2D_DESC texDesc
+        {
+            .Width = dds.GetWidth(),
+            .Height = dds.GetHeight(),
+            .MipLevels = dds.GetMipCount(),
+            .ArraySize = 1,
+            .Format = dds.GetFormat(),
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Usage = D3D11_USAGE_IMMUTABLE,
+            .BindFlags = D3D11_BIND_SHADER_RESOURCE,
+            .CPUAccessFlags = 0,
+            .MiscFlags = 0
+        };
+
+        HRCHECK(dev->CreateTexture2D(&texDesc, dds.GetSubresources().data(), m_texture.GetAddressOf()));
+
+        CreateViews(dev, ctx, texDesc);
+    }
+
+    void Texture::InitializeFromHDR(const DevicePtr& dev, const DeviceContextPtr& ctx, const HDRTexture& hdr)
+    {
+        assert(!hdr.levels.empty());
+
+        D3D11_TEXTURE2D_DESC texDesc
+        {
+            .Width = hdr.levels[0].width,
+            .Height = hdr.levels[0].height,
+            .MipLevels = static_cast<UINT>(hdr.levels.size()),
+            .ArraySize = 1,
+            .Format = DDSFile::ToDXGIFormat(hdr.format),
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Usage = D3D11_USAGE_IMMUTABLE,
+            .BindFlags = D3D11_BIND_SHADER_RESOURCE,
+            .CPUAccessFlags = 0,
+            .MiscFlags = 0
+        };
+
+        std::vector<D3D11_SUBRESOURCE_DATA> subresources;
+        subresources.reserve(hdr.levels.size());
+        for (const auto& level : hdr.levels)
+            subresources.push_back({ .pSysMem = level.data.data(), .SysMemPitch = level.rowPitch, .SysMemSlicePitch = 0 });
+
+        HRCHECK(dev->CreateTexture2D(&texDesc, subresources.data(), m_texture.GetAddressOf()));
+
+        CreateViews(dev, ctx, texDesc);
+    }
+
     void Texture::InitializeFromExisting(const Tex2DPtr& tex, const RtvPtr& rtv, const SrvPtr& srv, const DsvPtr& dsv, const UavPtr& uav)
     {
         assert(tex != nullptr);
@@ -487,6 +614,82 @@ namespace Gino
 
     }
 
+    void Texture::InitializeCubeFromFile(const DevicePtr& dev, const DeviceContextPtr& ctx, const std::filesystem::path& equirectHDR, ThreadPool* threadPool, HDRFormat format)
+    {
+        const CubemapConverter converter(threadPool);
+        InitializeCubeFromData(dev, ctx, converter.LoadOrConvert(equirectHDR), format, threadPool);
+    }
+
+    void Texture::InitializeCubeFromData(const DevicePtr& dev, const DeviceContextPtr& ctx, const CubeMapData& cube, HDRFormat format, ThreadPool* threadPool)
+    {
+        constexpr static int cubeDim = 6;
+
+        assert(cube.mipCount > 0);
+
+        D3D11_TEXTURE2D_DESC texDesc
+        {
+            .Width = cube.faceSize,
+            .Height = cube.faceSize,
+            .MipLevels = cube.mipCount,
+            .ArraySize = cubeDim,
+            .Format = DDSFile::ToDXGIFormat(format),
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Usage = D3D11_USAGE_IMMUTABLE,
+            .BindFlags = D3D11_BIND_SHADER_RESOURCE,
+            .CPUAccessFlags = 0,
+            .MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE
+        };
+
+        // Subresource index = face * mipCount + mip, same order as CubeMapData
+        std::vector<D3D11_SUBRESOURCE_DATA> subresources;
+        subresources.reserve(cube.subresources.size());
+        std::vector<HDRTexture> encodedFaces;       // Owns the subresource data of re-encoded faces
+        if (format == HDRFormat::RGBA16F)
+        {
+            for (uint32_t face = 0; face < cubeDim; ++face)
+            {
+                for (uint32_t mip = 0; mip < cube.mipCount; ++mip)
+                {
+                    const UINT rowPitch = (cube.faceSize >> mip) * 4 * sizeof(uint16_t);
+                    subresources.push_back({ .pSysMem = cube.GetSubresource(face, mip).data(), .SysMemPitch = rowPitch, .SysMemSlicePitch = 0 });
+                }
+            }
+        }
+        else
+        {
+            // Back to float per face (the mips are already filtered) and encoded like any HDR chain
+            const HDREncoder encoder(threadPool);
+            for (uint32_t face = 0; face < cubeDim; ++face)
+            {
+                MipChain chain;
+                chain.hdr = true;
+                for (uint32_t mip = 0; mip < cube.mipCount; ++mip)
+                {
+                    const auto& halfs = cube.GetSubresource(face, mip);
+                    MipLevel level;
+                    level.width = level.height = cube.faceSize >> mip;
+                    level.rowPitch = level.width * 4 * sizeof(float);
+                    level.data.resize(halfs.size() * sizeof(float));
+                    float* texels = reinterpret_cast<float*>(level.data.data());
+                    for (size_t i = 0; i < halfs.size(); ++i)
+                        texels[i] = Utils::HalfToFloat(halfs[i]);
+                    chain.levels.push_back(std::move(level));
+                }
+                encodedFaces.push_back(encoder.Encode(chain, format));
+            }
+
+            for (const auto& encoded : encodedFaces)
+            {
+                for (const auto& level : encoded.levels)
+                    subresources.push_back({ .pSysMem = level.data.data(), .SysMemPitch = level.rowPitch, .SysMemSlicePitch = 0 });
+            }
+        }
+
+        HRCHECK(dev->CreateTexture2D(&texDesc, subresources.data(), m_texture.GetAddressOf()));
+
+        CreateViews(dev, ctx, texDesc);
+    }
+
     void Texture::CreateViews(const DevicePtr& dev, const DeviceContextPtr& ctx, const D3D11_TEXTURE2D_DESC& desc)
     {
         bool shouldCreateSRV = false;
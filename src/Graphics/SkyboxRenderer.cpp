@@ -5,7 +5,7 @@
 namespace Gino
 {
 
-	SkyboxRenderer::SkyboxRenderer(DXDevice* dxDev) :
+	SkyboxRenderer::SkyboxRenderer(DXDevice* dxDev, ThreadPool* threadPool) :
 		m_dxDev(dxDev),
 		m_activeCam(nullptr)
 	{
@@ -47,7 +47,9 @@ namespace Gino
 		);
 
 		//m_skyboxHDR.InitializeFromFile(dev, ctx, "../assets/textures/skyboxes/HDR/Mono_Lake_C/Mono_Lake_C_Ref.hdr", false);
-		m_skyboxHDR.InitializeFromFile(dev, ctx, "../assets/textures/skyboxes/HDR/Hamarikyu_Bridge_B/14-Hamarikyu_Bridge_B_3k.hdr", false);
+		m_environmentPath = "../assets/textures/skyboxes/HDR/Hamarikyu_Bridge_B/14-Hamarikyu_Bridge_B_3k.hdr";
+		// The sky needs no alpha: R11G11B10F halves the cube compared to RGBA16F at a ~1.5% worst case relative error
+		m_skyboxHDR.InitializeCubeFromFile(dev, ctx, m_environmentPath, threadPool, HDRFormat::R11G11B10F);
 
 		// rasterizer state so we can see cube from inside
 		D3D11_RASTERIZER_DESC1 rssDesc
@@ -76,6 +78,11 @@ namespace Gino
 		m_activeCam = camera;
 	}
 
+	const std::filesystem::path& SkyboxRenderer::GetEnvironmentPath() const
+	{
+		return m_environmentPath;
+	}
+
 	void SkyboxRenderer::Render(Framebuffer& framebuffer, const D3D11_VIEWPORT& vp)
 	{
 		assert(m_activeCam != nullptr);
@@ -0,0 +1,413 @@
+#include "pch.h"
+#include "Graphics/TextureStreamer.h"
+#include "Graphics/ResourceTypes.h"
+#include "Graphics/Model.h"
+#include "Graphics/HDREncoder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Gino
+{
+	namespace
+	{
+		bool IsBlockCompressed(DXGI_FORMAT format)
+		{
+			return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+				(format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+		}
+
+		uint32_t CalcTailMip(const std::vector<uint32_t>& sizes, uint32_t tailSize)
+		{
+			for (uint32_t level = 0; level < sizes.size(); ++level)
+			{
+				if (sizes[level] <= tailSize)
+					return level;
+			}
+			return static_cast<uint32_t>(sizes.size()) - 1;
+		}
+	}
+
+	TextureStreamer::TextureStreamer(DXDevice* dxDev, const TextureStreamingSettings& settings) :
+		m_dxDev(dxDev),
+		m_settings(settings)
+	{
+		m_stats.budgetBytes = m_settings.budgetBytes;
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+	}
+
+	void TextureStreamer::Add(Texture* texture, MipChain&& chain, bool srgb)
+	{
+		assert(!chain.levels.empty());
+
+		StreamedTexture streamed;
+		streamed.texture = texture;
+		streamed.format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+		streamed.format = chain.hdr ? DXGI_FORMAT_R32G32B32A32_FLOAT : streamed.format;
+		streamed.chain = std::move(chain);
+
+		// Moving the chain keeps the level buffers in place
+		for (const auto& level : streamed.chain.levels)
+			streamed.levels.push_back({ .data = level.data.data(), .rowPitch = level.rowPitch, .width = level.width, .height = level.height, .bytes = static_cast<size_t>(level.rowPitch) * level.height });
+
+		Add(std::move(streamed));
+	}
+
+	void TextureStreamer::Add(Texture* texture, std::unique_ptr<DDSFile> dds)
+	{
+		assert(dds && dds->GetMipCount() > 0);
+
+		StreamedTexture streamed;
+		streamed.texture = texture;
+		streamed.format = dds->GetFormat();
+
+		const bool blockCompressed = IsBlockCompressed(streamed.format);
+		const auto& subresources = dds->GetSubresources();
+		for (uint32_t i = 0; i < subresources.size(); ++i)
+		{
+			const uint32_t width = std::max(dds->GetWidth() >> i, 1u);
+			const uint32_t height = std::max(dds->GetHeight() >> i, 1u);
+			const uint32_t rows = blockCompressed ? (height + 3) / 4 : height;
+			streamed.levels.push_back({ .data = static_cast<const uint8_t*>(subresources[i].pSysMem), .rowPitch = subresources[i].SysMemPitch, .width = width, .height = height, .bytes = static_cast<size_t>(subresources[i].SysMemPitch) * rows });
+		}
+		streamed.dds = std::move(dds);
+
+		Add(std::move(streamed));
+	}
+
+	void TextureStreamer::Add(Texture* texture, HDRTexture&& hdr)
+	{
+		assert(!hdr.levels.empty());
+
+		StreamedTexture streamed;
+		streamed.texture = texture;
+		streamed.format = DDSFile::ToDXGIFormat(hdr.format);
+		streamed.chain.hdr = true;
+		streamed.chain.levels = std::move(hdr.levels);
+
+		// Rows of blocks for BC6H, the level data is tightly packed either way
+		for (const auto& level : streamed.chain.levels)
+			streamed.levels.push_back({ .data = level.data.data(), .rowPitch = level.rowPitch, .width = level.width, .height = level.height, .bytes = level.data.size() });
+
+		Add(std::move(streamed));
+	}
+
+	void TextureStreamer::Add(StreamedTexture&& streamed)
+	{
+		assert(m_textureIndices.find(streamed.texture) == m_textureIndices.end());
+
+		std::vector<uint32_t> sizes;
+		for (const auto& level : streamed.levels)
+			sizes.push_back(std::max(level.width, level.height));
+		streamed.tailMip = CalcTailMip(sizes, m_settings.tailSize);
+		streamed.allocatedMip = streamed.tailMip;
+		streamed.residentMip = streamed.tailMip;
+		streamed.wantedMip = streamed.tailMip;
+		streamed.targetMip = streamed.tailMip;
+
+		// Tail mips go up with the texture, everything finer is streamed on demand
+		const auto& top = streamed.levels[streamed.tailMip];
+		D3D11_TEXTURE2D_DESC desc
+		{
+			.Width = top.width,
+			.Height = top.height,
+			.MipLevels = static_cast<UINT>(streamed.levels.size()) - streamed.tailMip,
+			.ArraySize = 1,
+			.Format = streamed.format,
+			.SampleDesc = {.Count = 1, .Quality = 0 },
+			.Usage = D3D11_USAGE_DEFAULT,		// Finer levels are uploaded with UpdateSubresource
+			.BindFlags = D3D11_BIND_SHADER_RESOURCE,
+			.CPUAccessFlags = 0,
+			.MiscFlags = 0
+		};
+
+		std::vector<D3D11_SUBRESOURCE_DATA> subresources;
+		for (uint32_t level = streamed.tailMip; level < streamed.levels.size(); ++level)
+			subresources.push_back({ .pSysMem = streamed.levels[level].data, .SysMemPitch = streamed.levels[level].rowPitch, .SysMemSlicePitch = 0 });
+
+		HRCHECK(m_dxDev->GetDevice()->CreateTexture2D(&desc, subresources.data(), streamed.gpuTexture.GetAddressOf()));
+		UpdateView(streamed);
+
+		m_textureIndices.insert({ streamed.texture, static_cast<uint32_t>(m_textures.size()) });
+		m_textures.push_back(std::move(streamed));
+	}
+
+	void TextureStreamer::Remove(const Texture* texture)
+	{
+		const auto it = m_textureIndices.find(texture);
+		if (it == m_textureIndices.end())
+			return;
+
+		// Swap with the last texture so that indices stay dense
+		const uint32_t index = it->second;
+		m_textureIndices.erase(it);
+		if (index != m_textures.size() - 1)
+		{
+			m_textures[index] = std::move(m_textures.back());
+			m_textureIndices[m_textures[index].texture] = index;
+		}
+		m_textures.pop_back();
+	}
+
+	void TextureStreamer::BeginFrame()
+	{
+		// Textures that no model asks for this frame only need their tail
+		for (auto& streamed : m_textures)
+			streamed.wantedMip = streamed.tailMip;
+	}
+
+	void TextureStreamer::RequestModel(const Model* model, float pixelsPerUnit)
+	{
+		const auto& meshes = model->GetMeshes();
+		const auto& materials = model->GetMaterials();
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			// A texture spans one UV unit, so it covers uvDensity model units on screen
+			const float pixelsPerUV = pixelsPerUnit * meshes[i].uvDensity;
+			auto request = [this, pixelsPerUV](const Texture* texture)
+			{
+				const auto it = m_textureIndices.find(texture);
+				if (it == m_textureIndices.end())
+					return;
+
+				auto& streamed = m_textures[it->second];
+				uint32_t mip = streamed.tailMip;
+				if (pixelsPerUV > 0.f)
+				{
+					// Finest level with at most two texels per pixel
+					const float texels = static_cast<float>(std::max(streamed.levels[0].width, streamed.levels[0].height));
+					const float estimate = std::log2(texels / pixelsPerUV) + m_settings.mipBias;
+					mip = estimate <= 0.f ? 0 : std::min(static_cast<uint32_t>(estimate), streamed.tailMip);
+				}
+				streamed.wantedMip = std::min(streamed.wantedMip, mip);
+			};
+
+			if (materials[i].GetType() == MaterialType::PBR)
+			{
+				const auto& data = materials[i].GetProperties<PBRMaterialData>();
+				request(data.albedo);
+				request(data.normal);
+				request(data.orm);
+				request(data.emission);
+			}
+			else
+			{
+				const auto& data = materials[i].GetProperties<PhongMaterialData>();
+				request(data.diffuse);
+				request(data.specular);
+				request(data.opacity);
+				request(data.normal);
+			}
+		}
+	}
+
+	void TextureStreamer::Update()
+	{
+		m_stats.streamedIn = 0;
+		m_stats.evicted = 0;
+		m_stats.levelsUploaded = 0;
+		m_stats.uploadedBytes = 0;
+
+		// Stream in to the estimate, keep finer levels that are already allocated while the budget allows
+		size_t totalBytes = 0;
+		for (auto& streamed : m_textures)
+		{
+			streamed.targetMip = std::min(streamed.allocatedMip, streamed.wantedMip);
+			totalBytes += GetBytesFrom(streamed, streamed.targetMip);
+		}
+
+		// Over budget: drop one level at a time. Textures that hold more than their estimate go first, then the largest levels.
+		if (totalBytes > m_settings.budgetBytes)
+		{
+			auto lowerPriority = [this](uint32_t a, uint32_t b)
+			{
+				const auto& lhs = m_textures[a];
+				const auto& rhs = m_textures[b];
+				const bool lhsExcess = lhs.targetMip < lhs.wantedMip;
+				const bool rhsExcess = rhs.targetMip < rhs.wantedMip;
+				if (lhsExcess != rhsExcess)
+					return rhsExcess;
+				return lhs.levels[lhs.targetMip].bytes < rhs.levels[rhs.targetMip].bytes;
+			};
+
+			std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(lowerPriority)> candidates(lowerPriority);
+			for (uint32_t i = 0; i < m_textures.size(); ++i)
+			{
+				if (m_textures[i].targetMip < m_textures[i].tailMip)
+					candidates.push(i);
+			}
+
+			while (totalBytes > m_settings.budgetBytes && !candidates.empty())
+			{
+				auto& streamed = m_textures[candidates.top()];
+				const uint32_t index = candidates.top();
+				candidates.pop();
+
+				totalBytes -= streamed.levels[streamed.targetMip].bytes;
+				++streamed.targetMip;
+				if (streamed.targetMip < streamed.tailMip)
+					candidates.push(index);
+			}
+		}
+
+		for (auto& streamed : m_textures)
+		{
+			if (streamed.targetMip == streamed.allocatedMip)
+				continue;
+
+			if (streamed.targetMip < streamed.allocatedMip)
+				++m_stats.streamedIn;
+			else
+				++m_stats.evicted;
+			Reallocate(streamed, streamed.targetMip);
+		}
+
+		// Upload coarse to fine, one level per texture per round so that all textures sharpen at the same pace
+		size_t uploadBytesLeft = m_settings.uploadBytesPerFrame;
+		bool uploaded = true;
+		while (uploaded)
+		{
+			uploaded = false;
+			for (auto& streamed : m_textures)
+			{
+				if (streamed.residentMip == streamed.allocatedMip)
+					continue;
+
+				const size_t bytes = streamed.levels[streamed.residentMip - 1].bytes;
+				if (bytes > uploadBytesLeft && m_stats.levelsUploaded > 0)
+					continue;
+
+				UploadLevel(streamed);
+				uploadBytesLeft -= std::min(bytes, uploadBytesLeft);
+				uploaded = true;
+			}
+		}
+
+		m_stats.textures = static_cast<uint32_t>(m_textures.size());
+		m_stats.texturesAtWantedMip = 0;
+		m_stats.texturesBudgetClamped = 0;
+		m_stats.budgetBytes = m_settings.budgetBytes;
+		m_stats.allocatedBytes = 0;
+		m_stats.residentBytes = 0;
+		m_stats.wantedBytes = 0;
+		m_stats.fullChainBytes = 0;
+		m_stats.pendingLevels = 0;
+		for (auto& streamed : m_textures)
+		{
+			if (streamed.viewDirty)
+				UpdateView(streamed);
+
+			m_stats.texturesAtWantedMip += streamed.residentMip <= streamed.wantedMip ? 1 : 0;
+			m_stats.texturesBudgetClamped += streamed.targetMip > streamed.wantedMip ? 1 : 0;
+			m_stats.allocatedBytes += GetBytesFrom(streamed, streamed.allocatedMip);
+			m_stats.residentBytes += GetBytesFrom(streamed, streamed.residentMip);
+			m_stats.wantedBytes += GetBytesFrom(streamed, streamed.wantedMip);
+			m_stats.fullChainBytes += GetBytesFrom(streamed, 0);
+			m_stats.pendingLevels += streamed.residentMip - streamed.allocatedMip;
+		}
+	}
+
+	void TextureStreamer::SetBudget(size_t bytes)
+	{
+		m_settings.budgetBytes = bytes;
+	}
+
+	const TextureStreamingStats& TextureStreamer::GetStats() const
+	{
+		return m_stats;
+	}
+
+	float TextureStreamer::CalcUVDensity(const Vertex_POS_UV_NORMAL* vertices, const uint32_t* indices, uint32_t indexCount)
+	{
+		double worldArea = 0.0;
+		double uvArea = 0.0;
+		for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			const auto& v0 = vertices[indices[i + 0]];
+			const auto& v1 = vertices[indices[i + 1]];
+			const auto& v2 = vertices[indices[i + 2]];
+
+			worldArea += 0.5 * (v1.pos - v0.pos).Cross(v2.pos - v0.pos).Length();
+
+			const DirectX::SimpleMath::Vector2 e1 = v1.uv - v0.uv;
+			const DirectX::SimpleMath::Vector2 e2 = v2.uv - v0.uv;
+			uvArea += 0.5 * std::abs(e1.x * e2.y - e1.y * e2.x);
+		}
+
+		return uvArea > 1e-12 ? static_cast<float>(std::sqrt(worldArea / uvArea)) : 0.f;
+	}
+
+	void TextureStreamer::Reallocate(StreamedTexture& streamed, uint32_t allocatedMip)
+	{
+		const auto& top = streamed.levels[allocatedMip];
+		D3D11_TEXTURE2D_DESC desc
+		{
+			.Width = top.width,
+			.Height = top.height,
+			.MipLevels = static_cast<UINT>(streamed.levels.size()) - allocatedMip,
+			.ArraySize = 1,
+			.Format = streamed.format,
+			.SampleDesc = {.Count = 1, .Quality = 0 },
+			.Usage = D3D11_USAGE_DEFAULT,
+			.BindFlags = D3D11_BIND_SHADER_RESOURCE,
+			.CPUAccessFlags = 0,
+			.MiscFlags = 0
+		};
+
+		Tex2DPtr texture;
+		HRCHECK(m_dxDev->GetDevice()->CreateTexture2D(&desc, nullptr, texture.GetAddressOf()));
+
+		// Uploaded levels that both textures have are copied on the GPU. Finer new levels are uploaded later, evicted ones are dropped.
+		const uint32_t firstShared = std::max(streamed.residentMip, allocatedMip);
+		for (uint32_t level = firstShared; level < streamed.levels.size(); ++level)
+			m_dxDev->GetContext()->CopySubresourceRegion(texture.Get(), level - allocatedMip, 0, 0, 0, streamed.gpuTexture.Get(), level - streamed.allocatedMip, nullptr);
+
+		streamed.gpuTexture = texture;
+		streamed.allocatedMip = allocatedMip;
+		streamed.residentMip = firstShared;
+		streamed.viewDirty = true;
+	}
+
+	void TextureStreamer::UploadLevel(StreamedTexture& streamed)
+	{
+		assert(streamed.residentMip > streamed.allocatedMip);
+
+		const uint32_t level = streamed.residentMip - 1;
+		const auto& source = streamed.levels[level];
+		m_dxDev->GetContext()->UpdateSubresource(streamed.gpuTexture.Get(), level - streamed.allocatedMip, nullptr, source.data, source.rowPitch, 0);
+
+		streamed.residentMip = level;
+		streamed.viewDirty = true;
+		++m_stats.levelsUploaded;
+		m_stats.uploadedBytes += source.bytes;
+	}
+
+	void TextureStreamer::UpdateView(StreamedTexture& streamed)
+	{
+		// Sampling is clamped to the uploaded levels, allocated levels that are still pending are never read
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+		srvDesc.Format = streamed.format;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D = D3D11_TEX2D_SRV
+		{
+			.MostDetailedMip = streamed.residentMip - streamed.allocatedMip,
+			.MipLevels = (uint32_t)-1
+		};
+
+		SrvPtr srv;
+		HRCHECK(m_dxDev->GetDevice()->CreateShaderResourceView(streamed.gpuTexture.Get(), &srvDesc, srv.GetAddressOf()));
+		streamed.texture->InitializeFromExisting(streamed.gpuTexture, nullptr, srv);
+		streamed.viewDirty = false;
+	}
+
+	size_t TextureStreamer::GetBytesFrom(const StreamedTexture& streamed, uint32_t mip) const
+	{
+		size_t bytes = 0;
+		for (uint32_t level = mip; level < streamed.levels.size(); ++level)
+			bytes += streamed.levels[level].bytes;
+		return bytes;
+	}
+}
@@ -0,0 +1,188 @@
+#include "pch.h"
+#include "Graphics/VertexCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Gino
+{
+	namespace
+	{
+		using DirectX::SimpleMath::Vector2;
+		using DirectX::SimpleMath::Vector3;
+
+		constexpr float s_radToDeg = 57.29577951f;
+
+		int16_t ToSnorm16(float value)
+		{
+			return static_cast<int16_t>(std::lrintf(std::clamp(value, -1.f, 1.f) * 32767.f));
+		}
+
+		// Same as the input assembler's SNORM conversion
+		float FromSnorm16(int16_t value)
+		{
+			return std::max(value / 32767.f, -1.f);
+		}
+
+		float SignNotZero(float value)
+		{
+			return value >= 0.f ? 1.f : -1.f;
+		}
+
+		// Unit vector -> [-1, 1]^2 (octahedron unfolded onto the square)
+		Vector2 OctEncode(const Vector3& n)
+		{
+			const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+			if (l1 <= 0.f)
+				return Vector2(0.f, 0.f);		// Degenerate input decodes to +Z
+
+			Vector2 p(n.x / l1, n.y / l1);
+			if (n.z < 0.f)
+				p = Vector2((1.f - std::abs(p.y)) * SignNotZero(p.x), (1.f - std::abs(p.x)) * SignNotZero(p.y));
+			return p;
+		}
+
+		Vector3 OctDecode(const Vector2& p)
+		{
+			Vector3 n(p.x, p.y, 1.f - std::abs(p.x) - std::abs(p.y));
+			const float t = std::max(-n.z, 0.f);
+			n.x += n.x >= 0.f ? -t : t;
+			n.y += n.y >= 0.f ? -t : t;
+			n.Normalize();
+			return n;
+		}
+
+		// Any unit vector perpendicular to n, for vertices without a usable tangent (no UVs)
+		Vector3 AnyPerpendicular(const Vector3& n)
+		{
+			Vector3 t = std::abs(n.x) < 0.9f ? Vector3(1.f, 0.f, 0.f).Cross(n) : Vector3(0.f, 1.f, 0.f).Cross(n);
+			t.Normalize();
+			return t;
+		}
+
+		Vector3 OrthogonalTangent(const Vector3& normal, const Vector3& tangent)
+		{
+			Vector3 t = tangent - normal * normal.Dot(tangent);
+			if (t.LengthSquared() < 1e-12f)
+				return AnyPerpendicular(normal);
+			t.Normalize();
+			return t;
+		}
+
+		float AngleDegrees(const Vector3& a, const Vector3& b)
+		{
+			return std::acos(std::clamp(a.Dot(b), -1.f, 1.f)) * s_radToDeg;
+		}
+	}
+
+	VertexCompressionError& VertexCompressionError::operator+=(const VertexCompressionError& other)
+	{
+		maxPosition = std::max(maxPosition, other.maxPosition);
+		maxUV = std::max(maxUV, other.maxUV);
+		maxNormalDegrees = std::max(maxNormalDegrees, other.maxNormalDegrees);
+		maxTangentDegrees = std::max(maxTangentDegrees, other.maxTangentDegrees);
+		handednessFlips += other.handednessFlips;
+		return *this;
+	}
+
+	PositionQuantization VertexCompressor::CalcPositionQuantization(const Vertex_POS_UV_NORMAL* vertices, size_t count)
+	{
+		if (count == 0)
+			return { Vector3(0.f, 0.f, 0.f), Vector3(0.f, 0.f, 0.f) };
+
+		Vector3 min = vertices[0].pos;
+		Vector3 max = vertices[0].pos;
+		for (size_t i = 1; i < count; ++i)
+		{
+			min = Vector3::Min(min, vertices[i].pos);
+			max = Vector3::Max(max, vertices[i].pos);
+		}
+		return { min, max - min };
+	}
+
+	Vertex_Compact VertexCompressor::Encode(const Vertex_POS_UV_NORMAL& vertex, const PositionQuantization& quantization)
+	{
+		Vertex_Compact out{};
+
+		const float* pos = &vertex.pos.x;
+		const float* offset = &quantization.offset.x;
+		const float* scale = &quantization.scale.x;
+		for (int i = 0; i < 3; ++i)
+		{
+			const float unorm = scale[i] > 0.f ? (pos[i] - offset[i]) / scale[i] : 0.f;
+			out.pos[i] = static_cast<uint16_t>(std::lrintf(std::clamp(unorm, 0.f, 1.f) * 65535.f));
+		}
+
+		out.uv[0] = Utils::FloatToHalf(vertex.uv.x);
+		out.uv[1] = Utils::FloatToHalf(vertex.uv.y);
+
+		Vector3 normal = vertex.normal;
+		if (normal.LengthSquared() < 1e-12f)
+			normal = Vector3(0.f, 0.f, 1.f);
+		normal.Normalize();
+
+		const Vector2 octNormal = OctEncode(normal);
+		out.normal[0] = ToSnorm16(octNormal.x);
+		out.normal[1] = ToSnorm16(octNormal.y);
+
+		// Orthogonalize against the normal that the shader will actually see
+		const Vector3 decodedNormal = OctDecode(Vector2(FromSnorm16(out.normal[0]), FromSnorm16(out.normal[1])));
+		const Vector3 tangent = OrthogonalTangent(decodedNormal, vertex.tangent);
+		const Vector2 octTangent = OctEncode(tangent);
+		out.tangent[0] = ToSnorm16(octTangent.x);
+		out.tangent[1] = ToSnorm16(octTangent.y);
+
+		const bool rightHanded = decodedNormal.Cross(tangent).Dot(vertex.bitangent) >= 0.f;
+		out.pos[3] = rightHanded ? 65535 : 0;
+
+		return out;
+	}
+
+	Vertex_POS_UV_NORMAL VertexCompressor::Decode(const Vertex_Compact& vertex, const PositionQuantization& quantization)
+	{
+		Vertex_POS_UV_NORMAL out{};
+
+		out.pos = quantization.offset + Vector3(vertex.pos[0], vertex.pos[1], vertex.pos[2]) / 65535.f * quantization.scale;
+		out.uv = Vector2(Utils::HalfToFloat(vertex.uv[0]), Utils::HalfToFloat(vertex.uv[1]));
+		out.normal = OctDecode(Vector2(FromSnorm16(vertex.normal[0]), FromSnorm16(vertex.normal[1])));
+		out.tangent = OctDecode(Vector2(FromSnorm16(vertex.tangent[0]), FromSnorm16(vertex.tangent[1])));
+		out.bitangent = out.normal.Cross(out.tangent) * (vertex.pos[3] >= 32768 ? 1.f : -1.f);
+
+		return out;
+	}
+
+	void VertexCompressor::Encode(const Vertex_POS_UV_NORMAL* vertices, Vertex_Compact* output, size_t count, const PositionQuantization& quantization)
+	{
+		for (size_t i = 0; i < count; ++i)
+			output[i] = Encode(vertices[i], quantization);
+	}
+
+	VertexCompressionError VertexCompressor::MeasureError(const Vertex_POS_UV_NORMAL* original, const Vertex_Compact* compressed, size_t count, const PositionQuantization& quantization)
+	{
+		VertexCompressionError error;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Vertex_POS_UV_NORMAL& ref = original[i];
+			const Vertex_POS_UV_NORMAL dec = Decode(compressed[i], quantization);
+
+			const Vector3 posDiff = dec.pos - ref.pos;
+			error.maxPosition = std::max({ error.maxPosition, std::abs(posDiff.x), std::abs(posDiff.y), std::abs(posDiff.z) });
+			error.maxUV = std::max({ error.maxUV, std::abs(dec.uv.x - ref.uv.x), std::abs(dec.uv.y - ref.uv.y) });
+
+			Vector3 refNormal = ref.normal;
+			if (refNormal.LengthSquared() < 1e-12f)
+				continue;
+			refNormal.Normalize();
+			error.maxNormalDegrees = std::max(error.maxNormalDegrees, AngleDegrees(refNormal, dec.normal));
+
+			if (ref.tangent.LengthSquared() < 1e-12f)
+				continue;
+			const Vector3 refTangent = OrthogonalTangent(refNormal, ref.tangent);
+			error.maxTangentDegrees = std::max(error.maxTangentDegrees, AngleDegrees(refTangent, dec.tangent));
+
+			if (dec.bitangent.Dot(ref.bitangent) < 0.f)
+				++error.handednessFlips;
+		}
+		return error;
+	}
+}
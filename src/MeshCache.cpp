@@ -0,0 +1,392 @@
+#include "pch.h"
+#include "MeshCache.h"
+#include "AssetArchive.h"
+
+#include <fstream>
+#include <cstddef>
+
+namespace Gino
+{
+	static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	static void WritePadding(std::ofstream& file, uint64_t alignment)
+	{
+		static constexpr char zeros[16] = {};
+		uint64_t pos = static_cast<uint64_t>(file.tellp());
+		uint64_t padding = AlignUp(pos, alignment) - pos;
+		file.write(zeros, padding);
+	}
+
+	// The source and any files sharing its stem (e.g Sponza.gltf + Sponza.bin, nanosuit.obj + nanosuit.mtl)
+	// so that an edit to the geometry buffers also invalidates the cache. Source first, then the sorted siblings.
+	static std::vector<std::filesystem::path> GetSourceFiles(const std::filesystem::path& sourcePath, bool archived)
+	{
+		std::vector<std::filesystem::path> siblings;
+		if (archived)
+		{
+			// Archived models are read from the archive, so are their buffers
+			for (const auto& file : AssetArchive::GetMounted()->GetFilesIn(sourcePath.parent_path()))
+			{
+				if (file.stem() == sourcePath.stem() && file.filename() != sourcePath.filename())
+					siblings.push_back(file);
+			}
+		}
+		else
+		{
+			std::error_code ec;
+			for (const auto& entry : std::filesystem::directory_iterator(sourcePath.parent_path(), ec))
+			{
+				if (entry.is_regular_file() && entry.path().stem() == sourcePath.stem() && entry.path().filename() != sourcePath.filename())
+					siblings.push_back(entry.path());
+			}
+		}
+		std::sort(siblings.begin(), siblings.end());
+		siblings.insert(siblings.begin(), sourcePath);
+		return siblings;
+	}
+
+	static bool IsArchived(const std::filesystem::path& sourcePath)
+	{
+		const AssetArchive* archive = AssetArchive::GetMounted();
+		return archive && archive->Contains(sourcePath);
+	}
+
+	MeshCacheKey MeshCache::MakeKey(const std::filesystem::path& sourcePath, uint32_t importFlags, bool pbr)
+	{
+		MeshCacheKey key{ .sourceStamp = 0, .sourceHash = 0, .importFlags = importFlags, .pbr = pbr ? 1u : 0u };
+
+		// The archive's table of contents already has the content hashes, the stamp is that hash then
+		if (IsArchived(sourcePath))
+		{
+			HashSources(sourcePath, key);
+			key.sourceStamp = key.sourceHash;
+			return key;
+		}
+
+		uint64_t stamp = Utils::HashBytes(nullptr, 0);
+		for (const auto& file : GetSourceFiles(sourcePath, false))
+		{
+			std::error_code ec;
+			const std::string name = file.filename().generic_string();
+			const uint64_t values[] =
+			{
+				static_cast<uint64_t>(std::filesystem::file_size(file, ec)),
+				static_cast<uint64_t>(std::filesystem::last_write_time(file, ec).time_since_epoch().count())
+			};
+			stamp = Utils::HashBytes(name.data(), name.size(), stamp);
+			stamp = Utils::HashBytes(values, sizeof(values), stamp);
+		}
+		key.sourceStamp = stamp;
+		return key;
+	}
+
+	void MeshCache::HashSources(const std::filesystem::path& sourcePath, MeshCacheKey& key)
+	{
+		if (key.sourceHash != 0)
+			return;
+
+		uint64_t hash = Utils::HashBytes(nullptr, 0);
+		for (const auto& file : GetSourceFiles(sourcePath, IsArchived(sourcePath)))
+			hash = Utils::HashFile(file, hash);
+		key.sourceHash = hash;
+	}
+
+	std::filesystem::path MeshCache::GetCachePath(const std::filesystem::path& sourcePath)
+	{
+		const std::string pathStr = sourcePath.lexically_normal().generic_string();
+
+		return std::filesystem::path("cache/meshes") / Utils::HashedFileName(sourcePath, Utils::HashBytes(pathStr.data(), pathStr.size()), ".mesh");
+	}
+
+	void MeshCache::Write(const std::filesystem::path& cachePath, const MeshCacheKey& key, const ModelImportData& data)
+	{
+		// Materials already refer to texture paths by index, the paths go into the string table once each
+		std::vector<MeshCacheMaterial> materials;
+		std::vector<uint32_t> pathOffsets;
+		std::string stringTable;
+
+		pathOffsets.reserve(data.texturePaths.size());
+		for (const auto& path : data.texturePaths)
+		{
+			pathOffsets.push_back(static_cast<uint32_t>(stringTable.size()));
+			stringTable += path;
+			stringTable.push_back('\0');
+		}
+
+		if (!data.pbr)
+		{
+			for (const auto& mat : data.materials)
+			{
+				MeshCacheMaterial cacheMat{};
+				cacheMat.textures[0] = mat.diffuse;
+				cacheMat.textures[1] = mat.specular;
+				cacheMat.textures[2] = mat.normal;
+				cacheMat.textures[3] = mat.opacity;
+				cacheMat.textures[4] = MeshCacheMaterial::s_noTexture;
+				materials.push_back(cacheMat);
+			}
+		}
+		else
+		{
+			for (const auto& mat : data.materialsPBR)
+			{
+				MeshCacheMaterial cacheMat{};
+				cacheMat.textures[0] = mat.albedo;
+				cacheMat.textures[1] = mat.normal;
+				cacheMat.textures[2] = mat.metallicAndRoughness;
+				cacheMat.textures[3] = mat.ao;
+				cacheMat.textures[4] = mat.emission;
+				cacheMat.baseColorFactor[0] = mat.baseColorFactor.x;
+				cacheMat.baseColorFactor[1] = mat.baseColorFactor.y;
+				cacheMat.baseColorFactor[2] = mat.baseColorFactor.z;
+				cacheMat.metallicAndRoughnessFactor[0] = mat.metallicAndRoughnessFactor.x;
+				cacheMat.metallicAndRoughnessFactor[1] = mat.metallicAndRoughnessFactor.y;
+				materials.push_back(cacheMat);
+			}
+		}
+
+		MeshCacheHeader header{};
+		header.magic = MeshCacheHeader::s_magic;
+		header.version = MeshCacheHeader::s_version;
+		header.key = key;
+		header.vertexStride = sizeof(Vertex_POS_UV_NORMAL);
+		header.vertexCount = data.vertexCount;
+		header.indexCount = data.indexCount;
+		header.subsetCount = static_cast<uint32_t>(data.subsets.size());
+		header.clusterCount = data.clusterCount;
+		header.lodCount = data.lodCount;
+		header.nodeCount = static_cast<uint32_t>(data.nodes.size());
+		header.materialCount = static_cast<uint32_t>(materials.size());
+		header.texturePathCount = static_cast<uint32_t>(pathOffsets.size());
+		header.stringTableSize = static_cast<uint32_t>(stringTable.size());
+
+		header.vertexOffset = AlignUp(sizeof(MeshCacheHeader), 16);
+		header.indexOffset = AlignUp(header.vertexOffset + (uint64_t)header.vertexCount * header.vertexStride, 16);
+		header.subsetOffset = AlignUp(header.indexOffset + (uint64_t)header.indexCount * sizeof(uint32_t), 16);
+		header.clusterOffset = AlignUp(header.subsetOffset + (uint64_t)header.subsetCount * sizeof(MeshCacheSubset), 16);
+		header.lodOffset = AlignUp(header.clusterOffset + (uint64_t)header.clusterCount * sizeof(MeshCluster), 16);
+		header.nodeOffset = AlignUp(header.lodOffset + (uint64_t)header.lodCount * sizeof(MeshLod), 16);
+		header.materialOffset = AlignUp(header.nodeOffset + (uint64_t)header.nodeCount * sizeof(AssimpNode), 16);
+		header.texturePathOffset = AlignUp(header.materialOffset + (uint64_t)header.materialCount * sizeof(MeshCacheMaterial), 16);
+		header.stringOffset = AlignUp(header.texturePathOffset + (uint64_t)header.texturePathCount * sizeof(uint32_t), 16);
+
+		Utils::WriteFileAtomic(cachePath, [&](std::ofstream& file)
+			{
+				file.write((const char*)&header, sizeof(header));
+				WritePadding(file, 16);
+				file.write((const char*)data.vertices, (std::streamsize)header.vertexCount * header.vertexStride);
+				WritePadding(file, 16);
+				file.write((const char*)data.indices, (std::streamsize)header.indexCount * sizeof(uint32_t));
+				WritePadding(file, 16);
+				file.write((const char*)data.subsets.data(), (std::streamsize)header.subsetCount * sizeof(MeshCacheSubset));
+				WritePadding(file, 16);
+				file.write((const char*)data.clusters, (std::streamsize)header.clusterCount * sizeof(MeshCluster));
+				WritePadding(file, 16);
+				file.write((const char*)data.lods, (std::streamsize)header.lodCount * sizeof(MeshLod));
+				WritePadding(file, 16);
+				file.write((const char*)data.nodes.data(), (std::streamsize)header.nodeCount * sizeof(AssimpNode));
+				WritePadding(file, 16);
+				file.write((const char*)materials.data(), (std::streamsize)header.materialCount * sizeof(MeshCacheMaterial));
+				WritePadding(file, 16);
+				file.write((const char*)pathOffsets.data(), (std::streamsize)header.texturePathCount * sizeof(uint32_t));
+				WritePadding(file, 16);
+				file.write(stringTable.data(), stringTable.size());
+			}, "MeshCache");
+	}
+
+	bool MeshCache::Open(const std::filesystem::path& cachePath, const std::filesystem::path& sourcePath, MeshCacheKey& key)
+	{
+		if (!m_file.Open(cachePath))
+			return false;
+
+		const uint8_t* base = m_file.GetData();
+		const uint64_t fileSize = m_file.GetSize();
+
+		if (fileSize < sizeof(MeshCacheHeader))
+			return false;
+
+		MeshCacheHeader header;
+		std::memcpy(&header, base, sizeof(header));
+
+		if (header.magic != MeshCacheHeader::s_magic ||
+			header.version != MeshCacheHeader::s_version ||
+			header.key.importFlags != key.importFlags ||
+			header.key.pbr != key.pbr ||
+			header.vertexStride != sizeof(Vertex_POS_UV_NORMAL))
+		{
+			m_file.Close();
+			return false;
+		}
+
+		// Sizes or write times changed (copied, touched or edited sources): only the contents decide
+		if (header.key.sourceStamp != key.sourceStamp)
+		{
+			HashSources(sourcePath, key);
+			if (header.key.sourceHash != key.sourceHash)
+			{
+				m_file.Close();
+				return false;
+			}
+
+			// Same contents, store the new stamp so that the next open skips the hash again
+			m_file.Close();
+			{
+				std::fstream file(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+				file.seekp(offsetof(MeshCacheHeader, key) + offsetof(MeshCacheKey, sourceStamp));
+				file.write((const char*)&key.sourceStamp, sizeof(key.sourceStamp));
+			}
+			if (!m_file.Open(cachePath) || m_file.GetSize() != fileSize)
+			{
+				m_file.Close();
+				return false;
+			}
+			base = m_file.GetData();
+		}
+
+		// Bounds check every section against the file size (truncated/corrupt files are treated as a miss)
+		auto inBounds = [fileSize](uint64_t offset, uint64_t size) { return offset <= fileSize && size <= fileSize - offset; };
+		if (!inBounds(header.vertexOffset, (uint64_t)header.vertexCount * header.vertexStride) ||
+			!inBounds(header.indexOffset, (uint64_t)header.indexCount * sizeof(uint32_t)) ||
+			!inBounds(header.subsetOffset, (uint64_t)header.subsetCount * sizeof(MeshCacheSubset)) ||
+			!inBounds(header.clusterOffset, (uint64_t)header.clusterCount * sizeof(MeshCluster)) ||
+			!inBounds(header.lodOffset, (uint64_t)header.lodCount * sizeof(MeshLod)) ||
+			!inBounds(header.nodeOffset, (uint64_t)header.nodeCount * sizeof(AssimpNode)) ||
+			!inBounds(header.materialOffset, (uint64_t)header.materialCount * sizeof(MeshCacheMaterial)) ||
+			!inBounds(header.texturePathOffset, (uint64_t)header.texturePathCount * sizeof(uint32_t)) ||
+			!inBounds(header.stringOffset, header.stringTableSize))
+		{
+			m_file.Close();
+			return false;
+		}
+
+		m_data = {};
+		m_data.pbr = header.key.pbr != 0;
+		m_data.vertices = reinterpret_cast<const Vertex_POS_UV_NORMAL*>(base + header.vertexOffset);
+		m_data.vertexCount = header.vertexCount;
+		m_data.indices = reinterpret_cast<const uint32_t*>(base + header.indexOffset);
+		m_data.indexCount = header.indexCount;
+
+		const auto subsets = reinterpret_cast<const MeshCacheSubset*>(base + header.subsetOffset);
+		m_data.subsets.assign(subsets, subsets + header.subsetCount);
+		m_data.clusters = reinterpret_cast<const MeshCluster*>(base + header.clusterOffset);
+		m_data.clusterCount = header.clusterCount;
+		m_data.lods = reinterpret_cast<const MeshLod*>(base + header.lodOffset);
+		m_data.lodCount = header.lodCount;
+
+		// Copied out like the subsets, Model keeps its own copy anyway
+		const auto nodes = reinterpret_cast<const AssimpNode*>(base + header.nodeOffset);
+		m_data.nodes.assign(nodes, nodes + header.nodeCount);
+		for (uint32_t i = 0; i < header.nodeCount; ++i)
+		{
+			// Parents come first, so the hierarchy can be resolved in one pass
+			if (m_data.nodes[i].parent != AssimpNode::s_noParent && m_data.nodes[i].parent >= i)
+			{
+				m_file.Close();
+				m_data = {};
+				return false;
+			}
+		}
+
+		// Texture paths are unpacked once, materials are small and go into the loader structures as is
+		const auto pathOffsets = reinterpret_cast<const uint32_t*>(base + header.texturePathOffset);
+		const char* strings = reinterpret_cast<const char*>(base + header.stringOffset);
+		m_data.texturePaths.reserve(header.texturePathCount);
+		for (uint32_t i = 0; i < header.texturePathCount; ++i)
+		{
+			const uint32_t offset = pathOffsets[i];
+			if (offset >= header.stringTableSize)
+			{
+				m_file.Close();
+				m_data = {};
+				return false;
+			}
+			m_data.texturePaths.emplace_back(strings + offset, strnlen(strings + offset, header.stringTableSize - offset));
+		}
+
+		const auto materials = reinterpret_cast<const MeshCacheMaterial*>(base + header.materialOffset);
+		for (uint32_t i = 0; i < header.materialCount; ++i)
+		{
+			const auto& cacheMat = materials[i];
+			for (const uint32_t texture : cacheMat.textures)
+			{
+				if (texture != MeshCacheMaterial::s_noTexture && texture >= header.texturePathCount)
+				{
+					m_file.Close();
+					m_data = {};
+					return false;
+				}
+			}
+
+			if (!m_data.pbr)
+			{
+				AssimpMaterialPaths mat;
+				mat.diffuse = cacheMat.textures[0];
+				mat.specular = cacheMat.textures[1];
+				mat.normal = cacheMat.textures[2];
+				mat.opacity = cacheMat.textures[3];
+				m_data.materials.push_back(mat);
+			}
+			else
+			{
+				AssimpMaterialPathsPBR mat;
+				mat.albedo = cacheMat.textures[0];
+				mat.normal = cacheMat.textures[1];
+				mat.metallicAndRoughness = cacheMat.textures[2];
+				mat.ao = cacheMat.textures[3];
+				mat.emission = cacheMat.textures[4];
+				mat.baseColorFactor = aiVector3D(cacheMat.baseColorFactor[0], cacheMat.baseColorFactor[1], cacheMat.baseColorFactor[2]);
+				mat.metallicAndRoughnessFactor = aiVector2D(cacheMat.metallicAndRoughnessFactor[0], cacheMat.metallicAndRoughnessFactor[1]);
+				m_data.materialsPBR.push_back(mat);
+			}
+		}
+
+		// Validate subset ranges so a bad cache can never issue out of range draws
+		const size_t materialCount = m_data.pbr ? m_data.materialsPBR.size() : m_data.materials.size();
+		for (const auto& subset : m_data.subsets)
+		{
+			if ((uint64_t)subset.indexStart + subset.indexCount > header.indexCount ||
+				(uint64_t)subset.vertexStart + subset.vertexCount > header.vertexCount ||
+				(uint64_t)subset.clusterStart + subset.clusterCount > header.clusterCount ||
+				(uint64_t)subset.lodStart + subset.lodCount > header.lodCount ||
+				subset.node >= header.nodeCount ||
+				subset.materialIndex >= materialCount)
+			{
+				m_file.Close();
+				m_data = {};
+				return false;
+			}
+
+			for (uint32_t i = subset.clusterStart; i < subset.clusterStart + subset.clusterCount; ++i)
+			{
+				const MeshCluster& cluster = m_data.clusters[i];
+				if (cluster.indexStart < subset.indexStart ||
+					(uint64_t)cluster.indexStart + cluster.indexCount > (uint64_t)subset.indexStart + subset.indexCount)
+				{
+					m_file.Close();
+					m_data = {};
+					return false;
+				}
+			}
+
+			for (uint32_t i = subset.lodStart; i < subset.lodStart + subset.lodCount; ++i)
+			{
+				if ((uint64_t)m_data.lods[i].indexStart + m_data.lods[i].indexCount > header.indexCount)
+				{
+					m_file.Close();
+					m_data = {};
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	const ModelImportData& MeshCache::GetData() const
+	{
+		return m_data;
+	}
+}
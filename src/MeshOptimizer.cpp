@@ -0,0 +1,367 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstring>
+
+namespace Gino
+{
+	namespace
+	{
+		// Vertex -> adjacent triangles, CSR layout
+		struct TriangleAdjacency
+		{
+			std::vector<uint32_t> offsets;
+			std::vector<uint32_t> triangles;
+		};
+
+		TriangleAdjacency BuildAdjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+		{
+			TriangleAdjacency adjacency;
+			adjacency.offsets.assign(vertexCount + 1, 0);
+			for (size_t i = 0; i < indexCount; ++i)
+				++adjacency.offsets[indices[i] + 1];
+			for (size_t v = 0; v < vertexCount; ++v)
+				adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+			adjacency.triangles.resize(indexCount);
+			std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+			for (size_t i = 0; i < indexCount; ++i)
+				adjacency.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			return adjacency;
+		}
+
+		// FIFO cache used for analysis and cluster splitting. Timestamps make a "flush" O(1).
+		class FifoCache
+		{
+		public:
+			FifoCache(size_t vertexCount, uint32_t cacheSize) : m_cacheSize(cacheSize), m_timestamps(vertexCount, 0) {}
+
+			// True on a miss
+			bool Access(uint32_t vertex)
+			{
+				if (m_time - m_timestamps[vertex] < m_cacheSize && m_timestamps[vertex] != 0)
+					return false;
+
+				m_timestamps[vertex] = ++m_time;
+				return true;
+			}
+
+			void Flush()
+			{
+				m_time += m_cacheSize + 1;
+			}
+
+		private:
+			uint32_t m_cacheSize;
+			uint32_t m_time = 0;
+			std::vector<uint32_t> m_timestamps;
+		};
+	}
+
+	float VertexCacheStats::GetACMR() const
+	{
+		return triangleCount ? (float)transformedCount / triangleCount : 0.f;
+	}
+
+	float VertexCacheStats::GetATVR() const
+	{
+		return vertexCount ? (float)transformedCount / vertexCount : 0.f;
+	}
+
+	VertexCacheStats& VertexCacheStats::operator+=(const VertexCacheStats& other)
+	{
+		triangleCount += other.triangleCount;
+		vertexCount += other.vertexCount;
+		transformedCount += other.transformedCount;
+		return *this;
+	}
+
+	void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0 || vertexCount == 0)
+			return;
+
+		const TriangleAdjacency adjacency = BuildAdjacency(indices, indexCount, vertexCount);
+
+		std::vector<uint32_t> liveTriangles(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v)
+			liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<uint8_t> emitted(triangleCount, 0);
+		std::vector<uint32_t> deadEnd;
+		deadEnd.reserve(indexCount);
+		std::vector<uint32_t> candidates;
+		candidates.reserve(64);
+
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+
+		uint32_t time = cacheSize + 1;
+		uint32_t cursor = 0;		// Next vertex to try when both the candidates and the dead-end stack are exhausted
+		int64_t fanning = 0;
+
+		while (fanning >= 0)
+		{
+			const uint32_t f = static_cast<uint32_t>(fanning);
+			candidates.clear();
+
+			// Emit all remaining triangles around the fanning vertex
+			for (uint32_t a = adjacency.offsets[f]; a < adjacency.offsets[f + 1]; ++a)
+			{
+				const uint32_t tri = adjacency.triangles[a];
+				if (emitted[tri])
+					continue;
+
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					const uint32_t v = indices[tri * 3 + k];
+					output.push_back(v);
+					deadEnd.push_back(v);
+					candidates.push_back(v);
+					--liveTriangles[v];
+
+					if (time - cacheTime[v] > cacheSize)
+						cacheTime[v] = time++;
+				}
+				emitted[tri] = 1;
+			}
+
+			// Next fanning vertex: the candidate still in cache after emitting its remaining triangles, oldest first
+			fanning = -1;
+			int64_t bestPriority = -1;
+			for (const uint32_t v : candidates)
+			{
+				if (liveTriangles[v] == 0)
+					continue;
+
+				int64_t priority = 0;
+				if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+					priority = time - cacheTime[v];
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					fanning = v;
+				}
+			}
+
+			if (fanning == -1)
+			{
+				// Dead end: most recently referenced vertex with work left, else the next one in input order
+				while (!deadEnd.empty())
+				{
+					const uint32_t v = deadEnd.back();
+					deadEnd.pop_back();
+					if (liveTriangles[v] > 0)
+					{
+						fanning = v;
+						break;
+					}
+				}
+
+				while (fanning == -1 && cursor < vertexCount)
+				{
+					if (liveTriangles[cursor] > 0)
+						fanning = cursor;
+					++cursor;
+				}
+			}
+		}
+
+		assert(output.size() == triangleCount * 3);
+		std::memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+	}
+
+	void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride, uint32_t cacheSize, float threshold)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount < 2)
+			return;
+
+		auto position = [vertices, vertexStride](uint32_t v)
+		{
+			const float* p = reinterpret_cast<const float*>(static_cast<const uint8_t*>(vertices) + v * vertexStride);
+			return std::array<float, 3>{ p[0], p[1], p[2] };
+		};
+
+		// Hard boundaries: triangles where all three vertices miss (the input order restarts a fan from scratch)
+		std::vector<uint32_t> clusterStarts;
+		{
+			FifoCache cache(vertexCount, cacheSize);
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				uint32_t misses = 0;
+				for (uint32_t k = 0; k < 3; ++k)
+					misses += cache.Access(indices[t * 3 + k]) ? 1 : 0;
+				if (t == 0 || misses == 3)
+					clusterStarts.push_back(static_cast<uint32_t>(t));
+			}
+		}
+		clusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+		// Soft boundaries: split hard clusters further wherever the running ACMR is already within threshold of the cluster's
+		std::vector<uint32_t> softStarts;
+		{
+			FifoCache cache(vertexCount, cacheSize);
+			for (size_t c = 0; c + 1 < clusterStarts.size(); ++c)
+			{
+				const uint32_t begin = clusterStarts[c];
+				const uint32_t end = clusterStarts[c + 1];
+
+				cache.Flush();
+				uint32_t clusterMisses = 0;
+				for (uint32_t t = begin; t < end; ++t)
+					for (uint32_t k = 0; k < 3; ++k)
+						clusterMisses += cache.Access(indices[t * 3 + k]) ? 1 : 0;
+				const float targetACMR = threshold * clusterMisses / (end - begin);
+
+				cache.Flush();
+				softStarts.push_back(begin);
+				uint32_t start = begin;
+				uint32_t misses = 0;
+				for (uint32_t t = begin; t < end; ++t)
+				{
+					for (uint32_t k = 0; k < 3; ++k)
+						misses += cache.Access(indices[t * 3 + k]) ? 1 : 0;
+
+					if (t + 1 < end && (float)misses / (t - start + 1) <= targetACMR)
+					{
+						softStarts.push_back(t + 1);
+						start = t + 1;
+						misses = 0;
+						cache.Flush();
+					}
+				}
+			}
+		}
+		softStarts.push_back(static_cast<uint32_t>(triangleCount));
+		const size_t clusterCount = softStarts.size() - 1;
+
+		// Mesh centroid (area weighted)
+		float meshCenter[3] = {};
+		float meshArea = 0.f;
+		std::vector<std::array<float, 4>> clusterKeyData(clusterCount);		// centroid * area (xyz), area
+		std::vector<std::array<float, 3>> clusterNormals(clusterCount);
+		for (size_t c = 0; c < clusterCount; ++c)
+		{
+			std::array<float, 4> centroid{};
+			std::array<float, 3> normal{};
+			for (uint32_t t = softStarts[c]; t < softStarts[c + 1]; ++t)
+			{
+				const auto p0 = position(indices[t * 3 + 0]);
+				const auto p1 = position(indices[t * 3 + 1]);
+				const auto p2 = position(indices[t * 3 + 2]);
+
+				const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				const float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+				for (int i = 0; i < 3; ++i)
+				{
+					centroid[i] += (p0[i] + p1[i] + p2[i]) / 3.f * area;
+					normal[i] += n[i];		// Area weighted already
+				}
+				centroid[3] += area;
+			}
+
+			clusterKeyData[c] = centroid;
+			clusterNormals[c] = normal;
+			for (int i = 0; i < 3; ++i)
+				meshCenter[i] += centroid[i];
+			meshArea += centroid[3];
+		}
+
+		if (meshArea <= 0.f)
+			return;
+		for (int i = 0; i < 3; ++i)
+			meshCenter[i] /= meshArea;
+
+		// Sort key: how much the cluster faces away from the mesh center. Outward facing clusters first occlude the rest.
+		std::vector<float> sortKeys(clusterCount, 0.f);
+		for (size_t c = 0; c < clusterCount; ++c)
+		{
+			const auto& centroid = clusterKeyData[c];
+			const auto& n = clusterNormals[c];
+			const float nLength = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (centroid[3] <= 0.f || nLength <= 0.f)
+				continue;
+
+			float key = 0.f;
+			for (int i = 0; i < 3; ++i)
+				key += (centroid[i] / centroid[3] - meshCenter[i]) * n[i] / nLength;
+			sortKeys[c] = key;
+		}
+
+		std::vector<uint32_t> order(clusterCount);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+		for (const uint32_t c : order)
+			output.insert(output.end(), indices + softStarts[c] * 3, indices + softStarts[c + 1] * 3);
+		std::memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+	}
+
+	void MeshOptimizer::OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexStride, uint32_t* indices, size_t indexCount)
+	{
+		constexpr uint32_t unassigned = ~0u;
+		std::vector<uint32_t> remap(vertexCount, unassigned);
+
+		uint32_t next = 0;
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			uint32_t& target = remap[indices[i]];
+			if (target == unassigned)
+				target = next++;
+			indices[i] = target;
+		}
+
+		// Unreferenced vertices keep their relative order at the end, so the vertex count (and subset ranges) don't change
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			if (remap[v] == unassigned)
+				remap[v] = next++;
+		}
+
+		std::vector<uint8_t> reordered(vertexCount * vertexStride);
+		const uint8_t* src = static_cast<const uint8_t*>(vertices);
+		for (size_t v = 0; v < vertexCount; ++v)
+			std::memcpy(&reordered[remap[v] * vertexStride], src + v * vertexStride, vertexStride);
+		std::memcpy(vertices, reordered.data(), reordered.size());
+	}
+
+	void MeshOptimizer::Optimize(void* vertices, size_t vertexCount, size_t vertexStride, uint32_t* indices, size_t indexCount, const MeshOptimizeSettings& settings)
+	{
+		OptimizeVertexCache(indices, indexCount, vertexCount, settings.cacheSize);
+		if (settings.overdraw)
+			OptimizeOverdraw(indices, indexCount, vertices, vertexCount, vertexStride, settings.cacheSize, settings.overdrawThreshold);
+		if (settings.vertexFetch)
+			OptimizeVertexFetch(vertices, vertexCount, vertexStride, indices, indexCount);
+	}
+
+	VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+	{
+		VertexCacheStats stats;
+		stats.triangleCount = indexCount / 3;
+
+		FifoCache cache(vertexCount, cacheSize);
+		std::vector<uint8_t> referenced(vertexCount, 0);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			const uint32_t v = indices[i];
+			stats.transformedCount += cache.Access(v) ? 1 : 0;
+			if (!referenced[v])
+			{
+				referenced[v] = 1;
+				++stats.vertexCount;
+			}
+		}
+		return stats;
+	}
+}
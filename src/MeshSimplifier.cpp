@@ -0,0 +1,457 @@
+#include "pch.h"
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Gino
+{
+	namespace
+	{
+		struct Vec3
+		{
+			double x, y, z;
+
+			Vec3 operator+(const Vec3& o) const { return { x + o.x, y + o.y, z + o.z }; }
+			Vec3 operator-(const Vec3& o) const { return { x - o.x, y - o.y, z - o.z }; }
+			Vec3 operator*(double s) const { return { x * s, y * s, z * s }; }
+			double Dot(const Vec3& o) const { return x * o.x + y * o.y + z * o.z; }
+			Vec3 Cross(const Vec3& o) const { return { y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x }; }
+			double Length() const { return std::sqrt(Dot(*this)); }
+		};
+
+		// Symmetric 4x4 plane quadric, weighted by area so that Evaluate / weight is the area weighted mean squared plane distance
+		struct Quadric
+		{
+			double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+			double b0 = 0, b1 = 0, b2 = 0;
+			double c = 0;
+			double weight = 0;
+
+			void AddPlane(const Vec3& n, double d, double w)
+			{
+				a00 += w * n.x * n.x;	a11 += w * n.y * n.y;	a22 += w * n.z * n.z;
+				a01 += w * n.x * n.y;	a02 += w * n.x * n.z;	a12 += w * n.y * n.z;
+				b0 += w * n.x * d;		b1 += w * n.y * d;		b2 += w * n.z * d;
+				c += w * d * d;
+				weight += w;
+			}
+
+			Quadric& operator+=(const Quadric& o)
+			{
+				a00 += o.a00; a11 += o.a11; a22 += o.a22; a01 += o.a01; a02 += o.a02; a12 += o.a12;
+				b0 += o.b0; b1 += o.b1; b2 += o.b2;
+				c += o.c;
+				weight += o.weight;
+				return *this;
+			}
+
+			double Evaluate(const Vec3& p) const
+			{
+				const double rx = a00 * p.x + a01 * p.y + a02 * p.z;
+				const double ry = a01 * p.x + a11 * p.y + a12 * p.z;
+				const double rz = a02 * p.x + a12 * p.y + a22 * p.z;
+				return std::max(p.x * rx + p.y * ry + p.z * rz + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c, 0.0);
+			}
+		};
+
+		enum class VertexKind : uint8_t
+		{
+			Manifold,		// Collapses onto any neighbor
+			Border,			// Collapses onto a border neighbor along an open edge
+			Seam,			// Two wedges, collapse together along the seam
+			Locked
+		};
+
+		// Border edges are weighted up so the silhouette of open meshes survives
+		constexpr double s_borderWeight = 10.0;
+
+		uint64_t EdgeKey(uint32_t a, uint32_t b)
+		{
+			return ((uint64_t)a << 32) | b;
+		}
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			double cost;
+		};
+	}
+
+	std::vector<uint32_t> MeshSimplifier::Simplify(const uint32_t* indicesIn, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride,
+		size_t targetIndexCount, float targetError, float* resultError)
+	{
+		std::vector<uint32_t> indices(indicesIn, indicesIn + indexCount);
+		if (resultError)
+			*resultError = 0.f;
+		if (indexCount < 3 || vertexCount == 0)
+			return indices;
+
+		std::vector<Vec3> positions(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			float p[3];
+			std::memcpy(p, static_cast<const uint8_t*>(vertices) + v * vertexStride, sizeof(p));
+			positions[v] = { p[0], p[1], p[2] };
+		}
+
+		// Wedges: vertices at the same position (split by UV or normal seams). rep = first vertex at that position.
+		std::vector<uint32_t> rep(vertexCount);
+		std::vector<uint32_t> sibling(vertexCount);		// Next wedge at the same position (circular)
+		std::vector<uint32_t> wedgeCount(vertexCount, 0);
+		{
+			struct PositionHash
+			{
+				size_t operator()(const Vec3& p) const
+				{
+					float f[3] = { (float)p.x, (float)p.y, (float)p.z };
+					uint32_t h[3];
+					std::memcpy(h, f, sizeof(h));
+					return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+				}
+			};
+			struct PositionEqual
+			{
+				bool operator()(const Vec3& a, const Vec3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+			};
+
+			std::unordered_map<Vec3, uint32_t, PositionHash, PositionEqual> firstAtPosition;
+			firstAtPosition.reserve(vertexCount);
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				const auto [it, inserted] = firstAtPosition.try_emplace(positions[v], v);
+				rep[v] = it->second;
+				if (inserted)
+				{
+					sibling[v] = v;
+				}
+				else
+				{
+					sibling[v] = sibling[it->second];
+					sibling[it->second] = v;
+				}
+				++wedgeCount[rep[v]];
+			}
+		}
+
+		// Directed edges in position space: an edge without its reverse is open (border), a duplicate is non-manifold
+		std::vector<VertexKind> kinds(vertexCount, VertexKind::Manifold);
+		{
+			std::unordered_map<uint64_t, uint32_t> directedEdges;
+			directedEdges.reserve(indexCount);
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				for (uint32_t e = 0; e < 3; ++e)
+				{
+					const uint32_t a = rep[indices[i + e]];
+					const uint32_t b = rep[indices[i + (e + 1) % 3]];
+					++directedEdges[EdgeKey(a, b)];
+				}
+			}
+
+			std::vector<uint8_t> onBorder(vertexCount, 0);
+			std::vector<uint8_t> nonManifold(vertexCount, 0);
+			for (const auto& [key, count] : directedEdges)
+			{
+				const uint32_t a = static_cast<uint32_t>(key >> 32);
+				const uint32_t b = static_cast<uint32_t>(key & 0xFFFFFFFF);
+				if (count > 1)
+					nonManifold[a] = nonManifold[b] = 1;
+				if (directedEdges.find(EdgeKey(b, a)) == directedEdges.end())
+					onBorder[a] = onBorder[b] = 1;
+			}
+
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				const uint32_t r = rep[v];
+				if (nonManifold[r] || wedgeCount[r] > 2 || (wedgeCount[r] == 2 && onBorder[r]))
+					kinds[v] = VertexKind::Locked;
+				else if (wedgeCount[r] == 2)
+					kinds[v] = VertexKind::Seam;
+				else if (onBorder[r])
+					kinds[v] = VertexKind::Border;
+			}
+		}
+
+		// Quadrics per position
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			const uint32_t r[3] = { rep[indices[i]], rep[indices[i + 1]], rep[indices[i + 2]] };
+			const Vec3 p0 = positions[r[0]];
+			const Vec3 n = (positions[r[1]] - p0).Cross(positions[r[2]] - p0);
+			const double doubleArea = n.Length();
+			if (doubleArea <= 0.0)
+				continue;
+
+			const Vec3 unitNormal = n * (1.0 / doubleArea);
+			Quadric q;
+			q.AddPlane(unitNormal, -unitNormal.Dot(p0), doubleArea * 0.5);
+			for (const uint32_t v : r)
+				quadrics[v] += q;
+		}
+
+		// Border edges get a plane perpendicular to the triangle through the edge
+		{
+			std::unordered_set<uint64_t> edges;
+			edges.reserve(indexCount);
+			for (size_t i = 0; i < indexCount; i += 3)
+				for (uint32_t e = 0; e < 3; ++e)
+					edges.insert(EdgeKey(rep[indices[i + e]], rep[indices[i + (e + 1) % 3]]));
+
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				const uint32_t r[3] = { rep[indices[i]], rep[indices[i + 1]], rep[indices[i + 2]] };
+				const Vec3 n = (positions[r[1]] - positions[r[0]]).Cross(positions[r[2]] - positions[r[0]]);
+				if (n.Length() <= 0.0)
+					continue;
+
+				for (uint32_t e = 0; e < 3; ++e)
+				{
+					const uint32_t a = r[e];
+					const uint32_t b = r[(e + 1) % 3];
+					if (edges.count(EdgeKey(b, a)))
+						continue;
+
+					const Vec3 edge = positions[b] - positions[a];
+					Vec3 planeNormal = edge.Cross(n);
+					const double length = planeNormal.Length();
+					if (length <= 0.0)
+						continue;
+					planeNormal = planeNormal * (1.0 / length);
+
+					Quadric q;
+					q.AddPlane(planeNormal, -planeNormal.Dot(positions[a]), edge.Dot(edge) * s_borderWeight);
+					quadrics[a] += q;
+					quadrics[b] += q;
+				}
+			}
+		}
+
+		auto collapseCost = [&](uint32_t from, uint32_t to)
+		{
+			Quadric q = quadrics[rep[from]];
+			q += quadrics[rep[to]];
+			return q.weight > 0.0 ? q.Evaluate(positions[to]) / q.weight : 0.0;
+		};
+
+		const double maxCost = (double)targetError * targetError;
+		double worstCost = 0.0;
+
+		std::vector<uint32_t> adjacencyOffsets;
+		std::vector<uint32_t> adjacency;
+		std::vector<uint32_t> remap(vertexCount);
+		std::vector<uint8_t> locked(vertexCount);
+		std::vector<Collapse> collapses;
+
+		auto hasEdge = [&](uint32_t a, uint32_t b)
+		{
+			for (uint32_t t = adjacencyOffsets[a]; t < adjacencyOffsets[a + 1]; ++t)
+			{
+				const uint32_t* tri = &indices[adjacency[t] * 3];
+				if (tri[0] == b || tri[1] == b || tri[2] == b)
+					return true;
+			}
+			return false;
+		};
+
+		// Moving 'from' onto 'to' must not turn any of the remaining triangles around it over
+		auto flipsTriangles = [&](uint32_t from, uint32_t to)
+		{
+			for (uint32_t t = adjacencyOffsets[from]; t < adjacencyOffsets[from + 1]; ++t)
+			{
+				const uint32_t* tri = &indices[adjacency[t] * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+					continue;		// Removed by the collapse
+
+				const uint32_t k = tri[0] == from ? 0 : (tri[1] == from ? 1 : 2);
+				const Vec3 a = positions[tri[(k + 1) % 3]];
+				const Vec3 b = positions[tri[(k + 2) % 3]];
+				const Vec3 before = (a - positions[from]).Cross(b - positions[from]);
+				const Vec3 after = (a - positions[to]).Cross(b - positions[to]);
+				if (before.Dot(after) < 0.25 * before.Length() * after.Length())
+					return true;
+			}
+			return false;
+		};
+
+		// Border vertices have a single wedge, so an edge from one is open when only one triangle uses it
+		auto isOpenEdge = [&](uint32_t from, uint32_t to)
+		{
+			uint32_t count = 0;
+			for (uint32_t t = adjacencyOffsets[from]; t < adjacencyOffsets[from + 1]; ++t)
+			{
+				const uint32_t* tri = &indices[adjacency[t] * 3];
+				count += (rep[tri[0]] == rep[to] || rep[tri[1]] == rep[to] || rep[tri[2]] == rep[to]) ? 1 : 0;
+			}
+			return count == 1;
+		};
+
+		auto lockRing = [&](uint32_t v)
+		{
+			locked[rep[v]] = 1;
+			for (uint32_t t = adjacencyOffsets[v]; t < adjacencyOffsets[v + 1]; ++t)
+			{
+				const uint32_t* tri = &indices[adjacency[t] * 3];
+				for (uint32_t k = 0; k < 3; ++k)
+					locked[rep[tri[k]]] = 1;
+			}
+		};
+
+		auto countShared = [&](uint32_t from, uint32_t to)
+		{
+			size_t count = 0;
+			for (uint32_t t = adjacencyOffsets[from]; t < adjacencyOffsets[from + 1]; ++t)
+			{
+				const uint32_t* tri = &indices[adjacency[t] * 3];
+				count += (tri[0] == to || tri[1] == to || tri[2] == to) ? 1 : 0;
+			}
+			return count;
+		};
+
+		bool relaxPassCost = false;
+		while (indices.size() > targetIndexCount)
+		{
+			const size_t triangleCount = indices.size() / 3;
+
+			// Vertex -> triangles
+			adjacencyOffsets.assign(vertexCount + 1, 0);
+			for (const uint32_t v : indices)
+				++adjacencyOffsets[v + 1];
+			for (size_t v = 0; v < vertexCount; ++v)
+				adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+			adjacency.resize(indices.size());
+			{
+				std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t i = 0; i < indices.size(); ++i)
+					adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			auto canCollapse = [&](uint32_t from, uint32_t to)
+			{
+				switch (kinds[from])
+				{
+				case VertexKind::Manifold:
+					return true;
+				case VertexKind::Border:
+					return kinds[to] == VertexKind::Border && isOpenEdge(from, to);
+				case VertexKind::Seam:
+					return kinds[to] == VertexKind::Seam;
+				default:
+					return false;
+				}
+			};
+
+			// Candidate collapses: the cheaper valid direction of every edge
+			collapses.clear();
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (uint32_t e = 0; e < 3; ++e)
+				{
+					const uint32_t a = indices[i + e];
+					const uint32_t b = indices[i + (e + 1) % 3];
+					if (rep[a] == rep[b])
+						continue;
+
+					const bool ab = canCollapse(a, b);
+					const bool ba = canCollapse(b, a);
+					if (!ab && !ba)
+						continue;
+
+					const double costAB = ab ? collapseCost(a, b) : std::numeric_limits<double>::max();
+					const double costBA = ba ? collapseCost(b, a) : std::numeric_limits<double>::max();
+					collapses.push_back(costAB <= costBA ? Collapse{ a, b, costAB } : Collapse{ b, a, costBA });
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+			for (uint32_t v = 0; v < vertexCount; ++v)
+				remap[v] = v;
+			std::fill(locked.begin(), locked.end(), 0);
+
+			// Many collapses get skipped because a neighbor already moved this pass, so accept a bit more than the
+			// cost of the last collapse that would reach the goal if none were skipped (as in meshoptimizer)
+			const size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+			const size_t goalCollapse = std::min(trianglesToRemove / 2, collapses.size() - 1);
+			const double passCost = collapses.empty() || relaxPassCost ? maxCost : std::min(maxCost, collapses[goalCollapse].cost * 1.5);
+
+			size_t trianglesRemoved = 0;
+			size_t collapseCount = 0;
+			for (const Collapse& collapse : collapses)
+			{
+				if (collapse.cost > passCost || trianglesRemoved >= trianglesToRemove)
+					break;
+
+				const uint32_t from = collapse.from;
+				const uint32_t to = collapse.to;
+				if (locked[rep[from]] || locked[rep[to]])
+					continue;
+
+				// Seams move both wedges: the sibling of 'from' goes to whichever wedge at 'to' it shares an edge with
+				uint32_t fromSibling = from;
+				uint32_t toSibling = to;
+				if (kinds[from] == VertexKind::Seam)
+				{
+					fromSibling = sibling[from];
+					if (hasEdge(fromSibling, sibling[to]))
+						toSibling = sibling[to];
+					else if (!hasEdge(fromSibling, to))
+						continue;
+				}
+
+				if (flipsTriangles(from, to) || (fromSibling != from && flipsTriangles(fromSibling, toSibling)))
+					continue;
+
+				trianglesRemoved += countShared(from, to);
+				lockRing(from);
+				remap[from] = to;
+				if (fromSibling != from)
+				{
+					trianglesRemoved += countShared(fromSibling, toSibling);
+					lockRing(fromSibling);
+					remap[fromSibling] = toSibling;
+				}
+				locked[rep[to]] = 1;
+
+				quadrics[rep[to]] += quadrics[rep[from]];
+				worstCost = std::max(worstCost, collapse.cost);
+				++collapseCount;
+			}
+
+			if (collapseCount == 0)
+			{
+				// Everything under the pass limit was rejected: try once more with the full error budget
+				if (relaxPassCost || passCost >= maxCost)
+					break;
+				relaxPassCost = true;
+				continue;
+			}
+			relaxPassCost = false;
+
+			// Apply and drop the triangles that became degenerate
+			size_t write = 0;
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				const uint32_t a = remap[indices[i]];
+				const uint32_t b = remap[indices[i + 1]];
+				const uint32_t c = remap[indices[i + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+
+				indices[write++] = a;
+				indices[write++] = b;
+				indices[write++] = c;
+			}
+			indices.resize(write);
+		}
+
+		if (resultError)
+			*resultError = static_cast<float>(std::sqrt(worstCost));
+		return indices;
+	}
+}
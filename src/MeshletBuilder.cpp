@@ -0,0 +1,257 @@
+#include "pch.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Gino
+{
+	namespace
+	{
+		struct Float3
+		{
+			float x, y, z;
+
+			Float3 operator+(const Float3& o) const { return { x + o.x, y + o.y, z + o.z }; }
+			Float3 operator-(const Float3& o) const { return { x - o.x, y - o.y, z - o.z }; }
+			Float3 operator*(float s) const { return { x * s, y * s, z * s }; }
+			float Dot(const Float3& o) const { return x * o.x + y * o.y + z * o.z; }
+			Float3 Cross(const Float3& o) const { return { y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x }; }
+			float Length() const { return std::sqrt(Dot(*this)); }
+		};
+
+		Float3 GetPosition(const void* vertices, size_t vertexStride, uint32_t v)
+		{
+			Float3 p;
+			std::memcpy(&p, static_cast<const uint8_t*>(vertices) + v * vertexStride, sizeof(p));
+			return p;
+		}
+	}
+
+	std::vector<MeshCluster> MeshletBuilder::Build(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride, uint32_t indexBase, const MeshletSettings& settings)
+	{
+		std::vector<MeshCluster> clusters;
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return clusters;
+
+		assert(settings.maxVertices >= 3 && settings.maxTriangles >= 1);
+
+		// Vertex -> adjacent triangles (CSR)
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t i = 0; i < indexCount; ++i)
+			++adjacencyOffsets[indices[i] + 1];
+		for (size_t v = 0; v < vertexCount; ++v)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		std::vector<uint32_t> adjacency(indexCount);
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indexCount; ++i)
+				adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::vector<Float3> triangleCentroids(triangleCount);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			const Float3 sum = GetPosition(vertices, vertexStride, indices[t * 3 + 0]) + GetPosition(vertices, vertexStride, indices[t * 3 + 1]) + GetPosition(vertices, vertexStride, indices[t * 3 + 2]);
+			triangleCentroids[t] = sum * (1.f / 3.f);
+		}
+
+		std::vector<uint8_t> emitted(triangleCount, 0);
+		std::vector<uint32_t> vertexStamp(vertexCount, 0);			// == clusterStamp if the vertex is in the current cluster
+		std::vector<uint32_t> candidateStamp(triangleCount, 0);		// == clusterStamp if the triangle is already a candidate
+		uint32_t clusterStamp = 0;
+
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+		std::vector<uint32_t> clusterTriangles;
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> vertexLocal(vertexCount);
+		std::vector<uint32_t> localToVertex;
+
+		size_t cursor = 0;
+		size_t emittedCount = 0;
+		while (emittedCount < triangleCount)
+		{
+			++clusterStamp;
+			clusterTriangles.clear();
+			candidates.clear();
+			uint32_t clusterVertexCount = 0;
+			Float3 centroidSum{ 0.f, 0.f, 0.f };
+
+			auto newVertexCount = [&](uint32_t tri)
+			{
+				uint32_t count = 0;
+				for (uint32_t k = 0; k < 3; ++k)
+					count += vertexStamp[indices[tri * 3 + k]] != clusterStamp ? 1 : 0;
+				return count;
+			};
+
+			auto addTriangle = [&](uint32_t tri)
+			{
+				emitted[tri] = 1;
+				++emittedCount;
+				clusterTriangles.push_back(tri);
+				centroidSum = centroidSum + triangleCentroids[tri];
+
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					const uint32_t v = indices[tri * 3 + k];
+					if (vertexStamp[v] == clusterStamp)
+						continue;
+
+					vertexStamp[v] = clusterStamp;
+					++clusterVertexCount;
+					for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+					{
+						const uint32_t neighbor = adjacency[a];
+						if (!emitted[neighbor] && candidateStamp[neighbor] != clusterStamp)
+						{
+							candidateStamp[neighbor] = clusterStamp;
+							candidates.push_back(neighbor);
+						}
+					}
+				}
+			};
+
+			// Seed with the first remaining triangle in input order
+			while (emitted[cursor])
+				++cursor;
+			addTriangle(static_cast<uint32_t>(cursor));
+
+			while (clusterTriangles.size() < settings.maxTriangles)
+			{
+				const Float3 centroid = centroidSum * (1.f / clusterTriangles.size());
+
+				int64_t best = -1;
+				uint32_t bestNewVertices = 4;
+				float bestDistance = 0.f;
+				for (size_t c = 0; c < candidates.size();)
+				{
+					const uint32_t tri = candidates[c];
+					if (emitted[tri])
+					{
+						candidates[c] = candidates.back();
+						candidates.pop_back();
+						continue;
+					}
+					++c;
+
+					const uint32_t newVertices = newVertexCount(tri);
+					if (clusterVertexCount + newVertices > settings.maxVertices)
+						continue;
+
+					const Float3 d = triangleCentroids[tri] - centroid;
+					const float distance = d.Dot(d);
+					if (newVertices < bestNewVertices || (newVertices == bestNewVertices && distance < bestDistance))
+					{
+						best = tri;
+						bestNewVertices = newVertices;
+						bestDistance = distance;
+					}
+				}
+
+				if (best < 0)
+					break;		// No connected triangle fits: start a new cluster rather than jumping across the mesh
+				addTriangle(static_cast<uint32_t>(best));
+			}
+
+			// Vertex cache order inside the cluster, on cluster local vertex ids
+			const uint32_t clusterIndexStart = static_cast<uint32_t>(output.size());
+			localToVertex.clear();
+			for (const uint32_t tri : clusterTriangles)
+			{
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					const uint32_t v = indices[tri * 3 + k];
+					if (vertexStamp[v] == clusterStamp)
+					{
+						vertexStamp[v] = clusterStamp - 1;		// Mark as assigned, slot stored in vertexLocal
+						vertexLocal[v] = static_cast<uint32_t>(localToVertex.size());
+						localToVertex.push_back(v);
+					}
+					output.push_back(vertexLocal[v]);
+				}
+			}
+			MeshOptimizer::OptimizeVertexCache(output.data() + clusterIndexStart, output.size() - clusterIndexStart, localToVertex.size());
+			for (size_t i = clusterIndexStart; i < output.size(); ++i)
+				output[i] = localToVertex[output[i]];
+
+			MeshCluster cluster = ComputeBounds(output.data() + clusterIndexStart, clusterTriangles.size() * 3, vertices, vertexStride);
+			cluster.indexStart = indexBase + clusterIndexStart;
+			clusters.push_back(cluster);
+		}
+
+		std::memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+		return clusters;
+	}
+
+	MeshCluster MeshletBuilder::ComputeBounds(const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexStride)
+	{
+		MeshCluster cluster{};
+		cluster.indexCount = static_cast<uint32_t>(indexCount);
+		cluster.coneCutoff = MeshCluster::s_noCone;
+		if (indexCount < 3)
+			return cluster;
+
+		// AABB, and the sphere around its center
+		Float3 min = GetPosition(vertices, vertexStride, indices[0]);
+		Float3 max = min;
+		std::vector<uint32_t> unique(indices, indices + indexCount);
+		std::sort(unique.begin(), unique.end());
+		unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+		cluster.vertexCount = static_cast<uint32_t>(unique.size());
+
+		for (const uint32_t v : unique)
+		{
+			const Float3 p = GetPosition(vertices, vertexStride, v);
+			min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+			max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+		}
+
+		const Float3 center = (min + max) * 0.5f;
+		float radius = 0.f;
+		for (const uint32_t v : unique)
+			radius = std::max(radius, (GetPosition(vertices, vertexStride, v) - center).Length());
+
+		std::memcpy(cluster.aabbMin, &min, sizeof(cluster.aabbMin));
+		std::memcpy(cluster.aabbMax, &max, sizeof(cluster.aabbMax));
+		std::memcpy(cluster.center, &center, sizeof(cluster.center));
+		cluster.radius = radius;
+
+		// Normal cone from the winding normals (D3D front faces are clockwise, which cross(p1 - p0, p2 - p0) points out of)
+		std::vector<Float3> normals;
+		normals.reserve(indexCount / 3);
+		Float3 axis{ 0.f, 0.f, 0.f };
+		for (size_t t = 0; t + 2 < indexCount; t += 3)
+		{
+			const Float3 p0 = GetPosition(vertices, vertexStride, indices[t + 0]);
+			const Float3 p1 = GetPosition(vertices, vertexStride, indices[t + 1]);
+			const Float3 p2 = GetPosition(vertices, vertexStride, indices[t + 2]);
+			const Float3 n = (p1 - p0).Cross(p2 - p0);
+			const float length = n.Length();
+			if (length <= 0.f)
+				continue;		// Degenerate triangles are never rasterized
+
+			normals.push_back(n * (1.f / length));
+			axis = axis + normals.back();
+		}
+
+		const float axisLength = axis.Length();
+		if (normals.empty() || axisLength <= 0.f)
+			return cluster;
+		axis = axis * (1.f / axisLength);
+
+		float minDot = 1.f;
+		for (const auto& n : normals)
+			minDot = std::min(minDot, n.Dot(axis));
+
+		std::memcpy(cluster.coneAxis, &axis, sizeof(cluster.coneAxis));
+		if (minDot > 0.f)
+			cluster.coneCutoff = std::sqrt(1.f - minDot * minDot);		// sin(angle) of the widest normal
+
+		return cluster;
+	}
+}
@@ -0,0 +1,238 @@
+#include "pch.h"
+#include "RenderList.h"
+#include "Entity.h"
+#include "TransformSystem.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace Gino
+{
+	void RenderList::Add(const Entity* entity, Model* model, uint32_t transform)
+	{
+		if (m_slots.find(entity) != m_slots.end())
+		{
+			std::cout << "Gino::RenderList : Entity is already in the render list\n";
+			assert(false);
+			return;
+		}
+
+		if (model->IsResident())
+		{
+			Insert(entity, model, transform);
+			return;
+		}
+
+		m_slots.insert({ entity, Slot{ model, static_cast<uint32_t>(m_pending.size()), true } });
+		m_pending.push_back({ entity, model, transform });
+	}
+
+	void RenderList::Remove(const Entity* entity)
+	{
+		const auto it = m_slots.find(entity);
+		if (it == m_slots.end())
+			return;
+
+		const Slot slot = it->second;
+		m_slots.erase(it);
+
+		if (slot.pending)
+		{
+			if (slot.index != m_pending.size() - 1)
+			{
+				m_pending[slot.index] = m_pending.back();
+				m_slots[m_pending[slot.index].entity].index = slot.index;
+			}
+			m_pending.pop_back();
+			return;
+		}
+
+		// Swap remove within the model, which leaves the hole at the end of its range
+		const uint32_t modelSlot = m_modelSlots[slot.model];
+		ModelRange& range = m_models[modelSlot];
+		uint32_t hole = range.first + --range.count;
+		if (slot.index != hole)
+			Move(hole, slot.index);
+
+		// Every later range moves its last instance into the hole in front of it, the hole ends up at the back
+		for (size_t i = modelSlot + 1; i < m_models.size(); ++i)
+		{
+			ModelRange& next = m_models[i];
+			const uint32_t last = next.first + next.count - 1;
+			Move(last, hole);
+			--next.first;
+			hole = last;
+		}
+		m_instances.pop_back();
+		m_owners.pop_back();
+
+		if (range.count != 0)
+			return;
+
+		// Empty, so the ranges after it keep their instances
+		m_modelSlots.erase(slot.model);
+		m_models.erase(m_models.begin() + modelSlot);
+		for (size_t i = modelSlot; i < m_models.size(); ++i)
+			m_modelSlots[m_models[i].model] = static_cast<uint32_t>(i);
+	}
+
+	bool RenderList::Contains(const Entity* entity) const
+	{
+		return m_slots.find(entity) != m_slots.end();
+	}
+
+	uint32_t RenderList::Update()
+	{
+		uint32_t moved = 0;
+		for (size_t i = 0; i < m_pending.size();)
+		{
+			if (!m_pending[i].model->IsResident())
+			{
+				++i;
+				continue;
+			}
+
+			const Pending pending = m_pending[i];
+			Remove(pending.entity);			// Swaps the last pending one into i
+			Insert(pending.entity, pending.model, pending.transform);
+			++moved;
+		}
+		return moved;
+	}
+
+	const std::vector<RenderList::ModelRange>& RenderList::GetModels() const
+	{
+		return m_models;
+	}
+
+	const std::vector<uint32_t>& RenderList::GetInstances() const
+	{
+		return m_instances;
+	}
+
+	uint32_t RenderList::GetInstanceCount() const
+	{
+		return static_cast<uint32_t>(m_instances.size());
+	}
+
+	uint32_t RenderList::GetPendingCount() const
+	{
+		return static_cast<uint32_t>(m_pending.size());
+	}
+
+	void RenderList::Insert(const Entity* entity, Model* model, uint32_t transform)
+	{
+		const auto [it, inserted] = m_modelSlots.try_emplace(model, static_cast<uint32_t>(m_models.size()));
+		if (inserted)
+			m_models.push_back(ModelRange{ .model = model, .first = static_cast<uint32_t>(m_instances.size()), .count = 0 });
+
+		// Open a hole at the end of the model's range: every later range moves its first instance to its end, back to front
+		const uint32_t modelSlot = it->second;
+		m_instances.push_back(0);
+		m_owners.push_back(nullptr);
+		for (size_t i = m_models.size() - 1; i > modelSlot; --i)
+		{
+			ModelRange& next = m_models[i];
+			Move(next.first, next.first + next.count);
+			++next.first;
+		}
+
+		ModelRange& range = m_models[modelSlot];
+		const uint32_t index = range.first + range.count++;
+		m_instances[index] = transform;
+		m_owners[index] = entity;
+		m_slots.insert({ entity, Slot{ model, index, false } });
+	}
+
+	void RenderList::Move(uint32_t from, uint32_t to)
+	{
+		m_instances[to] = m_instances[from];
+		m_owners[to] = m_owners[from];
+		m_slots[m_owners[to]].index = to;
+	}
+
+	void RenderList::RunBenchmark()
+	{
+		constexpr uint32_t modelCount = 16;
+		constexpr uint32_t frames = 100;
+		constexpr uint32_t entityCounts[] = { 1000, 10000, 100000 };
+
+		std::vector<std::unique_ptr<Model>> models;
+		for (uint32_t i = 0; i < modelCount; ++i)
+		{
+			models.push_back(std::make_unique<Model>());
+			models.back()->SetResident();
+		}
+
+		std::cout << "Gino::RenderList : Benchmark (" << modelCount << " models, average of " << frames << " frames)\n";
+		for (const uint32_t entityCount : entityCounts)
+		{
+			// Same container the scene uses
+			TransformSystem transforms;
+			EntityStorage storage;
+			std::unordered_map<std::string, std::unique_ptr<Entity>> entities;
+			for (uint32_t i = 0; i < entityCount; ++i)
+			{
+				auto entity = std::make_unique<Entity>(&storage, &transforms);
+				entity->AddComponent<ModelType>(models[i % modelCount].get());
+				entities.insert({ "ent" + std::to_string(i), std::move(entity) });
+			}
+
+			// Full rebuild every frame (what Scene::Update did before)
+			std::vector<std::pair<Model*, std::vector<Transform*>>> rebuilt;
+			Timer rebuildTimer;
+			for (uint32_t frame = 0; frame < frames; ++frame)
+			{
+				rebuilt.clear();
+				for (const auto& [name, entity] : entities)
+				{
+					Model* model = entity->GetComponent<ModelType>();
+					auto it = std::find_if(rebuilt.begin(), rebuilt.end(), [model](const auto& instances) { return instances.first == model; });
+					if (it == rebuilt.end())
+						rebuilt.push_back({ model, { entity->GetComponent<TransformType>() } });
+					else
+						it->second.push_back(entity->GetComponent<TransformType>());
+				}
+			}
+			const float rebuildMs = rebuildTimer.TimeElapsed() * 1000.f / frames;
+
+			RenderList list;
+			Timer buildTimer;
+			for (const auto& [name, entity] : entities)
+				list.Add(entity.get(), entity->GetComponent<ModelType>(), entity->GetComponent<TransformType>()->GetIndex());
+			const float buildMs = buildTimer.TimeElapsed() * 1000.f;
+
+			Timer idleTimer;
+			for (uint32_t frame = 0; frame < frames; ++frame)
+				list.Update();
+			const float idleMs = idleTimer.TimeElapsed() * 1000.f / frames;
+
+			// 1% of the entities swap their model every frame
+			std::vector<Entity*> churned;
+			for (const auto& [name, entity] : entities)
+			{
+				if (churned.size() == std::max(entityCount / 100, 1u))
+					break;
+				churned.push_back(entity.get());
+			}
+
+			Timer churnTimer;
+			for (uint32_t frame = 0; frame < frames; ++frame)
+			{
+				for (size_t i = 0; i < churned.size(); ++i)
+				{
+					list.Remove(churned[i]);
+					list.Add(churned[i], models[(frame + i) % modelCount].get(), churned[i]->GetComponent<TransformType>()->GetIndex());
+				}
+				list.Update();
+			}
+			const float churnMs = churnTimer.TimeElapsed() * 1000.f / frames;
+
+			assert(list.GetInstanceCount() == entityCount);
+			std::cout << "  " << entityCount << " entities | rebuild " << rebuildMs << " ms/frame | incremental: initial " << buildMs << " ms, "
+				<< idleMs << " ms/frame unchanged, " << churnMs << " ms/frame with " << churned.size() << " changes\n";
+		}
+	}
+}
@@ -9,42 +9,44 @@
 namespace Gino
 {
 	Scene::Scene(Engine* engine) :
-		m_engine(engine)
+		m_engine(engine),
+		m_transforms(engine->GetThreadPool())
 	{
 		m_engine->SetScene(this);
 
-		m_engine->CreateModel("sponza", "../assets/Models/Sponza_gltf/glTF/Sponza.gltf", true);
-		m_engine->CreateModel("pbrSpheres", "../assets/Models/MetalRoughSpheres/glTF/MetalRoughSpheres.gltf", true);
-		m_engine->CreateModel("helmet", "../assets/Models/DamagedHelmet/glTF/DamagedHelmet.gltf", true);
-		m_engine->CreateModel("ball", "../assets/Models/material_ball/scene.gltf", true);
-		m_engine->CreateModel("cerberus", "../assets/Models/cerberus/scene.gltf", true);
-
-		auto e = CreateEntity("Entity1");
-		e->AddComponent<ModelType>(m_engine->GetModel("sponza"));
-		e->GetComponent<TransformType>()->m_scaling = { 0.07f, 0.07f, 0.07f };
-
-		auto e2 = CreateEntity("Entity2");
-		e2->AddComponent<ModelType>(m_engine->GetModel("pbrSpheres"));
-		e2->GetComponent<TransformType>()->m_position = { 5.f, 50.f, 0.f };
-		e2->GetComponent<TransformType>()->m_rotation = { 90.f, 0.f, 0.f };
-
-		auto e3 = CreateEntity("Entity3");
-		e3->AddComponent<ModelType>(m_engine->GetModel("helmet"));
-		e3->GetComponent<TransformType>()->m_position = { 50.f, 50.f, 0.f };
-		e3->GetComponent<TransformType>()->m_scaling = { 4.f, 4.f, 4.f };
-		e3->GetComponent<TransformType>()->m_rotation = { -90.f, 0.f, 0.f };
-
-		auto e4 = CreateEntity("Entity4");
-		e4->AddComponent<ModelType>(m_engine->GetModel("ball"));
-		e4->GetComponent<TransformType>()->m_position = { 50.f, 7.f, 0.f };
-		e4->GetComponent<TransformType>()->m_scaling = { 1.f, 1.f, 1.f };
-		e4->GetComponent<TransformType>()->m_rotation = { 90.f, 90.f, 0.f };
-
-		auto e5 = CreateEntity("Entity5");
-		e5->AddComponent<ModelType>(m_engine->GetModel("cerberus"));
-		e5->GetComponent<TransformType>()->m_position = { 35.f, 50.f, 0.f };
-		e5->GetComponent<TransformType>()->m_scaling = { 0.1f, 0.1f, 0.1f };
-		e5->GetComponent<TransformType>()->m_rotation = { 90.f, 90.f, 0.f };
+		// Loaded on the worker pool, entities pick the models up as they become resident. The handles keep them loaded.
+		m_models.push_back(m_engine->CreateModelAsync("sponza", "../assets/Models/Sponza_gltf/glTF/Sponza.gltf", true));
+		m_models.push_back(m_engine->CreateModelAsync("pbrSpheres", "../assets/Models/MetalRoughSpheres/glTF/MetalRoughSpheres.gltf", true));
+		m_models.push_back(m_engine->CreateModelAsync("helmet", "../assets/Models/DamagedHelmet/glTF/DamagedHelmet.gltf", true));
+		m_models.push_back(m_engine->CreateModelAsync("ball", "../assets/Models/material_ball/scene.gltf", true));
+		m_models.push_back(m_engine->CreateModelAsync("cerberus", "../assets/Models/cerberus/scene.gltf", true));
+
+		auto e = GetEntity(CreateEntity("Entity1"));
+		e->AddComponent<ModelType>(m_engine->GetModel("sponza").Get());
+		e->GetComponent<TransformType>()->SetScaling({ 0.07f, 0.07f, 0.07f });
+
+		auto e2 = GetEntity(CreateEntity("Entity2"));
+		e2->AddComponent<ModelType>(m_engine->GetModel("pbrSpheres").Get());
+		e2->GetComponent<TransformType>()->SetPosition({ 5.f, 50.f, 0.f });
+		e2->GetComponent<TransformType>()->SetRotation({ 90.f, 0.f, 0.f });
+
+		auto e3 = GetEntity(CreateEntity("Entity3"));
+		e3->AddComponent<ModelType>(m_engine->GetModel("helmet").Get());
+		e3->GetComponent<TransformType>()->SetPosition({ 50.f, 50.f, 0.f });
+		e3->GetComponent<TransformType>()->SetScaling({ 4.f, 4.f, 4.f });
+		e3->GetComponent<TransformType>()->SetRotation({ -90.f, 0.f, 0.f });
+
+		auto e4 = GetEntity(CreateEntity("Entity4"));
+		e4->AddComponent<ModelType>(m_engine->GetModel("ball").Get());
+		e4->GetComponent<TransformType>()->SetPosition({ 50.f, 7.f, 0.f });
+		e4->GetComponent<TransformType>()->SetScaling({ 1.f, 1.f, 1.f });
+		e4->GetComponent<TransformType>()->SetRotation({ 90.f, 90.f, 0.f });
+
+		auto e5 = GetEntity(CreateEntity("Entity5"));
+		e5->AddComponent<ModelType>(m_engine->GetModel("cerberus").Get());
+		e5->GetComponent<TransformType>()->SetPosition({ 35.f, 50.f, 0.f });
+		e5->GetComponent<TransformType>()->SetScaling({ 0.1f, 0.1f, 0.1f });
+		e5->GetComponent<TransformType>()->SetRotation({ 90.f, 90.f, 0.f });
 
 		// Non PBR nanosuit models
 		//m_engine->CreateModel("nanosuit", "../assets/Models/nanosuit/nanosuit.obj");
@@ -53,11 +55,13 @@ namespace Gino
 		//{
 		//	for (int z = -10; z < 10; ++z)
 		//	{
-		//		auto newE = CreateEntity("ent" + std::to_string((counter++)));
-		//		newE->AddComponent<ModelType>(m_engine->GetModel("nanosuit"));
-		//		newE->GetComponent<TransformType>()->m_position = { (float)x * 8.f, 0.f, (float)z * 3.f + 5.f };
+		//		auto newE = GetEntity(CreateEntity("ent" + std::to_string((counter++))));
+		//		newE->AddComponent<ModelType>(m_engine->GetModel("nanosuit").Get());
+		//		newE->GetComponent<TransformType>()->SetPosition({ (float)x * 8.f, 0.f, (float)z * 3.f + 5.f });
 		//	}
 		//}
+
+		BuildRenderList();
 	}
 
 	static float timeElapsed = 0.f;
@@ -66,116 +70,121 @@ namespace Gino
 	{
 		timeElapsed += dt;
 
-		{
-			Timer clearTime;
-			m_modelInstances.clear();
-			ImGui::Begin("Frame Statistics");
-			ImGui::Text("Scene Render Data Clear %s ms", std::to_string(clearTime.TimeElapsed() * 1000.f).c_str());
-			ImGui::End();
-		}
-
 		/* Simulate models */
 		
-		ImGui::Begin("Frame Statistics");
-		ImGui::Text("Entity Count %i", m_entities.size());
-		ImGui::End();
+		// Only entities whose model was still loading are looked at, everything else is already in the list
+		Timer renderListTime;
+		m_renderList.Update();
+		const float renderListMs = renderListTime.TimeElapsed() * 1000.f;
+
+		// World matrices of the transforms that changed, read by the renderer this frame
+		Timer transformTime;
+		const uint32_t matricesComputed = m_transforms.Update();
+		const float transformMs = transformTime.TimeElapsed() * 1000.f;
 
-		Timer grabTime;
-		// Grab relevant data from entities (this is slow, but will do for now)
-		for (const auto& e : m_entities)
-		{
-			// Grab models and transforms
-			if ((e.second.get()->GetActiveComponentBits() & (ComponentType::TransformType | ComponentType::ModelType)) ==
-				(ComponentType::TransformType | ComponentType::ModelType))
-			{
-				// Check if the model already exists in this modelInstances vector
-				auto it = std::find_if(m_modelInstances.begin(), m_modelInstances.end(),
-					[&e](auto& existingModelInstance)
-					{
-						return e.second.get()->GetComponent<ModelType>() == existingModelInstance.first;
-					});
-
-				// Not found (push a new pair with new transform
-				if (it == m_modelInstances.end())
-				{
-					m_modelInstances.push_back({ e.second.get()->GetComponent<ModelType>(), { e.second.get()->GetComponent<TransformType>() } });
-				}
-				// Found
-				else
-				{
-					(*it).second.push_back(e.second.get()->GetComponent<TransformType>());
-				}
-
-			}
-		}
-		
 		ImGui::Begin("Frame Statistics");
-		ImGui::Text("Render Data Grabber %s ms", std::to_string(grabTime.TimeElapsed() * 1000.f).c_str());
+		ImGui::Text("Entity Count %i", m_entities.GetSize());
+		ImGui::Text("Transform Update %s ms (%u matrices, %.0f matrices/ms)", std::to_string(transformMs).c_str(), matricesComputed, transformMs > 0.f ? matricesComputed / transformMs : 0.f);
+		ImGui::Text("Render List Update %s ms (%u instances, %u pending)", std::to_string(renderListMs).c_str(), m_renderList.GetInstanceCount(), m_renderList.GetPendingCount());
 		ImGui::End();
 	}
 
-	const std::vector<std::pair<Model*, std::vector<Transform*>>>* Scene::GetModelInstances() const
+	const RenderList* Scene::GetModelInstances() const
+	{
+		return &m_renderList;
+	}
+
+	const TransformSystem* Scene::GetTransforms() const
 	{
-		return &m_modelInstances;
+		return &m_transforms;
 	}
 
-	void Scene::FinalizeScene()
+	EntityHandle Scene::CreateEntity(std::string_view name)
 	{
-		// Grab relevant data from entities
-		for (const auto& e : m_entities)
+		const StringId id = name.empty() ? StringId() : StringId::Register(name);
+		if (id && m_entityNames.find(id) != m_entityNames.end())
 		{
-			// Grab models and transforms
-			if ((e.second.get()->GetActiveComponentBits() & (ComponentType::TransformType | ComponentType::ModelType)) ==
-				(ComponentType::TransformType | ComponentType::ModelType))
-			{
-				// Check if the model already exists in this modelInstances vector
-				auto it = std::find_if(m_modelInstances.begin(), m_modelInstances.end(), 
-					[&e](auto& existingModelInstance) 
-					{ 
-						return e.second.get()->GetComponent<ModelType>() == existingModelInstance.first;
-					});
-
-				// Not found (push a new pair with new transform
-				if (it == m_modelInstances.end())
-				{
-					m_modelInstances.push_back({ e.second.get()->GetComponent<ModelType>(), { e.second.get()->GetComponent<TransformType>() } });
-				}
-				// Found
-				else
-				{
-					(*it).second.push_back(e.second.get()->GetComponent<TransformType>());
-				}
-
-			}
+			std::cout << "Entity name already taken: '" << name << "'\n";
+			assert(false);
+			return {};
 		}
 
+		auto entity = std::make_unique<Entity>(&m_storage, &m_transforms);
+		entity->SetComponentCallback([this](Entity* e, ComponentType type, bool added) { OnComponentChanged(e, type, added); });
 
-		m_finalized = true;
+		const EntityHandle handle = m_entities.Insert({ std::move(entity), id });
+		if (id)
+			m_entityNames.insert({ id, handle });
+		return handle;
+	}
+	
+	Entity* Scene::GetEntity(EntityHandle handle)
+	{
+		EntityRecord* record = m_entities.Get(handle);
+		return record ? record->entity.get() : nullptr;
 	}
 
-	Entity* Scene::CreateEntity(const std::string& name)
+	EntityHandle Scene::FindEntity(StringId name) const
 	{
-		auto it = m_entities.find(name);
-		if (it != m_entities.cend())
+		auto it = m_entityNames.find(name);
+		if (it == m_entityNames.end())
 		{
-			std::cout << "Entity name already taken!\n";
+			std::cout << "Couldn't find entity with name: '" << name.GetName() << "'\n";
 			assert(false);
+			return {};
 		}
 
-		return m_entities.insert({ name, std::make_unique<Entity>() }).first->second.get();
+		return it->second;
 	}
-	
-	Entity* Scene::GetEntity(const std::string& name)
+
+	void Scene::DestroyEntity(EntityHandle handle)
 	{
-		auto it = m_entities.find(name);
-		if (it == m_entities.end())
+		EntityRecord* record = m_entities.Get(handle);
+		if (!record)
 		{
-			std::cout << "Couldn't find entity with name: '" << name << "'\n";
+			std::cout << "Gino::Scene : Entity was already destroyed\n";
 			assert(false);
+			return;
 		}
 
-		return (*it).second.get();
+		m_renderList.Remove(record->entity.get());
+		if (record->name)
+			m_entityNames.erase(record->name);
+		m_entities.Remove(handle);
 	}
-}
 
+	bool Scene::SetParent(EntityHandle child, EntityHandle parent)
+	{
+		Entity* childEntity = GetEntity(child);
+		Entity* parentEntity = parent ? GetEntity(parent) : nullptr;
+		if (!childEntity || (parent && !parentEntity))
+		{
+			std::cout << "Gino::Scene : Can't parent a destroyed entity\n";
+			assert(false);
+			return false;
+		}
 
+		return childEntity->GetComponent<TransformType>()->SetParent(parentEntity ? parentEntity->GetComponent<TransformType>() : nullptr);
+	}
+
+	void Scene::BuildRenderList()
+	{
+		m_storage.ForEach<TransformType, ModelType>([this](Entity* entity, const Transform& transform, Model* model)
+			{
+				m_renderList.Add(entity, model, transform.GetIndex());
+			});
+		m_renderListBuilt = true;
+	}
+
+	void Scene::OnComponentChanged(Entity* entity, ComponentType type, bool added)
+	{
+		// Entities set up before the initial build are gathered by it
+		if (type != ComponentType::ModelType || !m_renderListBuilt)
+			return;
+
+		if (added)
+			m_renderList.Add(entity, entity->GetComponent<ModelType>(), entity->GetComponent<TransformType>()->GetIndex());
+		else
+			m_renderList.Remove(entity);
+	}
+}
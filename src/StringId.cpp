@@ -0,0 +1,61 @@
+#include "pch.h"
+#include "StringId.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <sstream>
+#include <iomanip>
+
+namespace Gino
+{
+	namespace
+	{
+		struct NameTable
+		{
+			std::mutex mutex;
+			std::unordered_map<uint64_t, std::string> names;
+		};
+
+		NameTable& GetNameTable()
+		{
+			static NameTable table;
+			return table;
+		}
+	}
+
+	std::string StringId::GetName() const
+	{
+		{
+			NameTable& table = GetNameTable();
+			std::lock_guard<std::mutex> lock(table.mutex);
+			auto it = table.names.find(m_hash);
+			if (it != table.names.end())
+				return it->second;
+		}
+
+		std::stringstream ss;
+		ss << "#" << std::hex << std::setw(16) << std::setfill('0') << m_hash;
+		return ss.str();
+	}
+
+	StringId StringId::Register(std::string_view name)
+	{
+		const StringId id(name);
+#ifdef _DEBUG
+		RegisterName(id.m_hash, name);
+#endif
+		return id;
+	}
+
+	void StringId::RegisterName(uint64_t hash, std::string_view name)
+	{
+		NameTable& table = GetNameTable();
+		std::lock_guard<std::mutex> lock(table.mutex);
+		auto [it, inserted] = table.names.try_emplace(hash, name);
+		if (!inserted && it->second != name)
+		{
+			std::cout << "Gino::StringId : Hash collision between '" << it->second << "' and '" << name << "'\n";
+			assert(false);
+		}
+	}
+}
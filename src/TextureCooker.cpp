@@ -0,0 +1,226 @@
+#include "pch.h"
+#include "TextureCooker.h"
+#include "Graphics/DDSFile.h"
+#include "Graphics/ChannelPacker.h"
+#include "Timer.h"
+
+#include <iomanip>
+
+namespace Gino
+{
+	TextureCooker::TextureCooker(ThreadPool* threadPool, const TextureCookSettings& settings) :
+		m_threadPool(threadPool),
+		m_settings(settings)
+	{
+	}
+
+	TextureCookReport TextureCooker::Cook(const std::filesystem::path& sourcePath, TextureRole role, bool srgb) const
+	{
+		if (sourcePath.extension() == ".hdr")
+			return CookHDR(sourcePath);
+
+		Timer readTimer;
+		auto image = Utils::ReadImageFile(sourcePath);
+		return CookImage(sourcePath, Utils::HashFile(sourcePath), image, role, srgb, readTimer.TimeElapsed() * 1000.f);
+	}
+
+	TextureCookReport TextureCooker::CookORM(const std::string& occlusionPath, const std::string& metallicRoughnessPath) const
+	{
+		Timer packTimer;
+		auto image = ChannelPacker::PackORM(occlusionPath, metallicRoughnessPath);
+		return CookImage(ChannelPacker::GetPackedPath(occlusionPath, metallicRoughnessPath), ChannelPacker::HashSources(occlusionPath, metallicRoughnessPath),
+			image, TextureRole::Packed, false, packTimer.TimeElapsed() * 1000.f);
+	}
+
+	TextureCookReport TextureCooker::CookHDR(const std::filesystem::path& sourcePath) const
+	{
+		TextureCookReport report;
+		report.source = sourcePath;
+		report.hdr = true;
+		report.hdrFormat = m_settings.hdrFormat;
+
+		Timer cookTimer;
+		const uint64_t sourceHash = Utils::HashFile(sourcePath);
+		report.cooked = GetCachePath(sourcePath, sourceHash, DDSFile::ToDXGIFormat(report.hdrFormat), false);
+
+		// Linear float mips, the filter is the only setting that applies to HDR
+		auto image = Utils::ReadImageFile(sourcePath, true);
+		MipGenSettings mipSettings{};
+		mipSettings.filter = m_settings.filter;
+		const MipChain chain = MipGenerator(m_threadPool).Generate(image, mipSettings);
+		image.Release();
+
+		const HDRTexture encoded = HDREncoder(m_threadPool).Encode(chain, report.hdrFormat);
+		report.success = WriteHDR(sourcePath, sourceHash, encoded);
+		report.cookMs = cookTimer.TimeElapsed() * 1000.f;
+
+		// Quality report (not part of the cook time)
+		const MipChain decoded = HDREncoder::Decode(encoded);
+		report.width = chain.levels[0].width;
+		report.height = chain.levels[0].height;
+		report.mipCount = static_cast<uint32_t>(chain.levels.size());
+		report.psnrWorst = std::numeric_limits<float>::infinity();
+		for (size_t i = 0; i < chain.levels.size(); ++i)
+		{
+			const HDRError error = HDREncoder::CalcError(chain.levels[i], decoded.levels[i]);
+			if (i == 0)
+				report.psnrTop = error.logPSNR;
+			report.psnrWorst = std::min(report.psnrWorst, error.logPSNR);
+			report.maxRelativeError = std::max(report.maxRelativeError, error.maxRelativeError);
+
+			report.uncompressedBytes += chain.levels[i].data.size();
+			report.cookedBytes += encoded.levels[i].data.size();
+		}
+
+		return report;
+	}
+
+	TextureCookReport TextureCooker::CookImage(const std::filesystem::path& sourcePath, uint64_t sourceHash, Utils::ImageData& image, TextureRole role, bool srgb, float readMs) const
+	{
+		TextureCookReport report;
+		report.source = sourcePath;
+		report.format = SelectFormat(role, srgb);
+
+		Timer cookTimer;
+		report.cooked = GetCachePath(sourcePath, sourceHash, DDSFile::ToDXGIFormat(report.format, srgb), srgb);
+
+		MipGenSettings mipSettings{};
+		mipSettings.filter = m_settings.filter;
+		mipSettings.srgb = srgb;
+		mipSettings.normalMap = role == TextureRole::Normal;
+		const MipChain chain = MipGenerator(m_threadPool).Generate(image, mipSettings);
+		image.Release();
+
+		const BCEncoder encoder(m_threadPool);
+		const CompressedTexture compressed = encoder.Compress(chain, report.format, srgb);
+		report.success = DDSFile::Write(report.cooked, compressed);
+		report.cookMs = readMs + cookTimer.TimeElapsed() * 1000.f;
+
+		// Quality report (not part of the cook time)
+		const MipChain decoded = BCEncoder::Decompress(compressed);
+		report.width = chain.levels[0].width;
+		report.height = chain.levels[0].height;
+		report.mipCount = static_cast<uint32_t>(chain.levels.size());
+		report.psnrWorst = std::numeric_limits<float>::infinity();
+		for (size_t i = 0; i < chain.levels.size(); ++i)
+		{
+			const float psnr = BCEncoder::CalcPSNR(chain.levels[i], decoded.levels[i], report.format);
+			if (i == 0)
+				report.psnrTop = psnr;
+			report.psnrWorst = std::min(report.psnrWorst, psnr);
+
+			report.uncompressedBytes += chain.levels[i].data.size();
+			report.cookedBytes += compressed.levels[i].data.size();
+		}
+
+		return report;
+	}
+
+	BCFormat TextureCooker::SelectFormat(TextureRole role, bool srgb) const
+	{
+		switch (role)
+		{
+		case TextureRole::Normal:
+			return srgb ? BCFormat::BC7 : BCFormat::BC5;
+		case TextureRole::Mask:
+			return srgb ? BCFormat::BC7 : BCFormat::BC4;
+		case TextureRole::Packed:
+			return m_settings.packedAsBC7 ? BCFormat::BC7 : BCFormat::BC1;
+		case TextureRole::Color:
+		default:
+			return BCFormat::BC7;
+		}
+	}
+
+	std::unique_ptr<DDSFile> TextureCooker::OpenCached(const std::filesystem::path& sourcePath, uint64_t sourceHash, TextureRole role, bool srgb) const
+	{
+		const DXGI_FORMAT formats[] =
+		{
+			DDSFile::ToDXGIFormat(SelectFormat(role, srgb), srgb),
+			srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM
+		};
+
+		for (const DXGI_FORMAT format : formats)
+		{
+			auto dds = std::make_unique<DDSFile>();
+			if (dds->Open(GetCachePath(sourcePath, sourceHash, format, srgb)))
+				return dds;
+		}
+		return nullptr;
+	}
+
+	bool TextureCooker::WriteUncompressed(const std::filesystem::path& sourcePath, uint64_t sourceHash, const MipChain& chain, bool srgb)
+	{
+		const DXGI_FORMAT format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+		return DDSFile::Write(GetCachePath(sourcePath, sourceHash, format, srgb), chain, srgb);
+	}
+
+	std::unique_ptr<DDSFile> TextureCooker::OpenCachedHDR(const std::filesystem::path& sourcePath, uint64_t sourceHash, HDRFormat format) const
+	{
+		const DXGI_FORMAT formats[] =
+		{
+			DDSFile::ToDXGIFormat(m_settings.hdrFormat),
+			DDSFile::ToDXGIFormat(format)
+		};
+
+		for (const DXGI_FORMAT cachedFormat : formats)
+		{
+			auto dds = std::make_unique<DDSFile>();
+			if (dds->Open(GetCachePath(sourcePath, sourceHash, cachedFormat, false)))
+				return dds;
+		}
+		return nullptr;
+	}
+
+	bool TextureCooker::WriteHDR(const std::filesystem::path& sourcePath, uint64_t sourceHash, const HDRTexture& texture)
+	{
+		return DDSFile::Write(GetCachePath(sourcePath, sourceHash, DDSFile::ToDXGIFormat(texture.format), false), texture);
+	}
+
+	std::filesystem::path TextureCooker::GetCachePath(const std::filesystem::path& sourcePath, uint64_t sourceHash, DXGI_FORMAT format, bool srgb)
+	{
+		// The format already tells sRGB apart for most formats, but not for BC4/BC5 and sRGB requests that fell back
+		const uint32_t target[] = { static_cast<uint32_t>(format), srgb ? 1u : 0u };
+		const uint64_t key = Utils::HashBytes(target, sizeof(target), sourceHash);
+
+		return std::filesystem::path("cache/textures") / Utils::HashedFileName(sourcePath, key, ".dds");
+	}
+
+	void TextureCooker::PrintReport(const std::vector<TextureCookReport>& reports)
+	{
+		uint64_t totalUncompressed = 0;
+		uint64_t totalCooked = 0;
+		float totalMs = 0.f;
+
+		const auto oldPrecision = std::cout.precision();
+		std::cout << "Gino::TextureCooker : Report\n";
+		std::cout << std::fixed << std::setprecision(2);
+		for (const auto& report : reports)
+		{
+			if (!report.success)
+			{
+				std::cout << "  FAILED " << report.source.filename().string() << "\n";
+				continue;
+			}
+
+			std::cout << "  " << (report.hdr ? HDREncoder::GetFormatName(report.hdrFormat) : BCEncoder::GetFormatName(report.format)) << " "
+				<< report.width << "x" << report.height << " (" << report.mipCount << " mips) "
+				<< report.source.filename().string()
+				<< " | PSNR top " << report.psnrTop << " dB, worst " << report.psnrWorst << " dB";
+			if (report.hdr)
+				std::cout << ", max relative error " << report.maxRelativeError * 100.f << "%";
+			std::cout << " | " << report.uncompressedBytes / 1024 << " KB -> " << report.cookedBytes / 1024 << " KB"
+				<< " | " << report.cookMs << " ms\n";
+
+			totalUncompressed += report.uncompressedBytes;
+			totalCooked += report.cookedBytes;
+			totalMs += report.cookMs;
+		}
+
+		std::cout << "  Total " << reports.size() << " textures | " << totalUncompressed / (1024 * 1024) << " MB -> " << totalCooked / (1024 * 1024) << " MB";
+		if (totalCooked > 0)
+			std::cout << " (" << (double)totalUncompressed / totalCooked << "x)";
+		std::cout << " | " << totalMs << " ms\n";
+		std::cout << std::defaultfloat << std::setprecision(oldPrecision);
+	}
+}
@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+#include <exception>
+
+namespace Gino
+{
+	ThreadPool::ThreadPool(uint32_t workerCount)
+	{
+		if (workerCount == 0)
+		{
+			uint32_t hwThreads = std::thread::hardware_concurrency();
+			workerCount = hwThreads > 1 ? hwThreads - 1 : 1;
+		}
+
+		m_workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; ++i)
+			m_workers.emplace_back([this]() { WorkerLoop(); });
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_jobAvailable.notify_all();
+
+		for (auto& worker : m_workers)
+			worker.join();
+	}
+
+	void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+	{
+		if (count == 0)
+			return;
+
+		// Shared so that helper jobs which get scheduled after we return never touch a dead stack frame
+		struct SharedState
+		{
+			std::function<void(uint32_t)> func;
+			uint32_t count;
+			std::atomic<uint32_t> next{ 0 };
+			std::atomic<uint32_t> completed{ 0 };
+			std::mutex mutex;
+			std::condition_variable done;
+			std::exception_ptr exception;		// First one thrown by func, rethrown on the calling thread
+		};
+
+		auto state = std::make_shared<SharedState>();
+		state->func = func;
+		state->count = count;
+
+		auto drain = [](SharedState& s)
+		{
+			uint32_t i;
+			while ((i = s.next.fetch_add(1)) < s.count)
+			{
+				// Every item still counts as completed, otherwise the caller would wait forever
+				try
+				{
+					s.func(i);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(s.mutex);
+					if (!s.exception)
+						s.exception = std::current_exception();
+				}
+
+				if (s.completed.fetch_add(1) + 1 == s.count)
+				{
+					std::lock_guard<std::mutex> lock(s.mutex);
+					s.done.notify_all();
+				}
+			}
+		};
+
+		uint32_t helpers = std::min(count - 1, GetWorkerCount());
+		for (uint32_t i = 0; i < helpers; ++i)
+			Enqueue([state, drain]() { drain(*state); });
+
+		drain(*state);
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->done.wait(lock, [&state]() { return state->completed.load() == state->count; });
+		if (state->exception)
+			std::rethrow_exception(state->exception);
+	}
+
+	uint32_t ThreadPool::GetWorkerCount() const
+	{
+		return static_cast<uint32_t>(m_workers.size());
+	}
+
+	void ThreadPool::Enqueue(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_jobs.push(std::move(job));
+		}
+		m_jobAvailable.notify_one();
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_jobAvailable.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+
+				if (m_stop && m_jobs.empty())
+					return;
+
+				job = std::move(m_jobs.front());
+				m_jobs.pop();
+			}
+			job();
+		}
+	}
+}
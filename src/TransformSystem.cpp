@@ -0,0 +1,614 @@
+#include "pch.h"
+#include "TransformSystem.h"
+#include "Component.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <xmmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace Gino
+{
+	// Smaller levels are propagated on the calling thread, a job would cost more than the matrices
+	static constexpr size_t s_minChunkSize = 512;
+
+	// out = a * b (row vectors), out must not alias a
+	static void MultiplyMatrix(const DirectX::SimpleMath::Matrix& a, const DirectX::SimpleMath::Matrix& b, DirectX::SimpleMath::Matrix& out)
+	{
+		const __m128 b0 = _mm_loadu_ps(&b._11);
+		const __m128 b1 = _mm_loadu_ps(&b._21);
+		const __m128 b2 = _mm_loadu_ps(&b._31);
+		const __m128 b3 = _mm_loadu_ps(&b._41);
+
+		const float* rowsA = &a._11;
+		float* rowsOut = &out._11;
+		for (size_t row = 0; row < 4; ++row)
+		{
+			const __m128 r = _mm_loadu_ps(rowsA + row * 4);
+			__m128 result = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+			_mm_storeu_ps(rowsOut + row * 4, result);
+		}
+	}
+
+	TransformSystem::TransformSystem(ThreadPool* threadPool) :
+		m_threadPool(threadPool)
+	{
+	}
+
+	uint32_t TransformSystem::Allocate()
+	{
+		uint32_t index;
+		if (!m_freeSlots.empty())
+		{
+			index = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else
+		{
+			index = m_slotCount++;
+
+			// Grow a whole group at a time so that Update can always load four lanes
+			if (index % 4 == 0)
+			{
+				const size_t size = static_cast<size_t>(index) + 4;
+				for (auto* component : { &m_positionX, &m_positionY, &m_positionZ, &m_rotationX, &m_rotationY, &m_rotationZ })
+					component->resize(size, 0.f);
+				for (auto* component : { &m_rotationW, &m_scalingX, &m_scalingY, &m_scalingZ })
+					component->resize(size, 1.f);
+				m_local.resize(size, DirectX::SimpleMath::Matrix::Identity);
+				m_world.resize(size, DirectX::SimpleMath::Matrix::Identity);
+				for (auto* links : { &m_parent, &m_firstChild, &m_nextSibling, &m_prevSibling })
+					links->resize(size, s_noParent);
+				m_depth.resize(size, 0);
+				m_queued.resize(size, 0);
+				m_groupDirtyMask.push_back(0);
+			}
+		}
+
+		++m_allocatedCount;
+		MarkDirty(index);
+		return index;
+	}
+
+	void TransformSystem::Release(uint32_t index)
+	{
+		assert(index < m_slotCount);
+
+		// Back to identity, the slot may still be computed as part of a dirty group
+		m_positionX[index] = m_positionY[index] = m_positionZ[index] = 0.f;
+		m_rotationX[index] = m_rotationY[index] = m_rotationZ[index] = 0.f;
+		m_rotationW[index] = 1.f;
+		m_scalingX[index] = m_scalingY[index] = m_scalingZ[index] = 1.f;
+
+		Unlink(index);
+		for (uint32_t child = m_firstChild[index]; child != s_noParent;)
+		{
+			const uint32_t next = m_nextSibling[child];
+			m_parent[child] = m_nextSibling[child] = m_prevSibling[child] = s_noParent;
+			UpdateDepths(child);
+			MarkDirty(child);
+			child = next;
+		}
+		m_firstChild[index] = s_noParent;
+		m_depth[index] = 0;
+
+		m_freeSlots.push_back(index);
+		--m_allocatedCount;
+	}
+
+	bool TransformSystem::SetParent(uint32_t index, uint32_t parent)
+	{
+		assert(index < m_slotCount && (parent == s_noParent || parent < m_slotCount));
+		for (uint32_t ancestor = parent; ancestor != s_noParent; ancestor = m_parent[ancestor])
+		{
+			if (ancestor == index)
+			{
+				std::cout << "Gino::TransformSystem : A transform can't be parented to itself or one of its descendants\n";
+				assert(false);
+				return false;
+			}
+		}
+
+		if (m_parent[index] == parent)
+			return true;
+
+		Unlink(index);
+		if (parent != s_noParent)
+		{
+			m_parent[index] = parent;
+			m_nextSibling[index] = m_firstChild[parent];
+			if (m_firstChild[parent] != s_noParent)
+				m_prevSibling[m_firstChild[parent]] = index;
+			m_firstChild[parent] = index;
+		}
+
+		UpdateDepths(index);
+		MarkDirty(index);
+		return true;
+	}
+
+	uint32_t TransformSystem::GetParent(uint32_t index) const
+	{
+		return m_parent[index];
+	}
+
+	uint32_t TransformSystem::GetDepth(uint32_t index) const
+	{
+		return m_depth[index];
+	}
+
+	void TransformSystem::SetPosition(uint32_t index, const DirectX::SimpleMath::Vector3& position)
+	{
+		m_positionX[index] = position.x;
+		m_positionY[index] = position.y;
+		m_positionZ[index] = position.z;
+		MarkDirty(index);
+	}
+
+	void TransformSystem::SetRotation(uint32_t index, const DirectX::SimpleMath::Quaternion& rotation)
+	{
+		DirectX::SimpleMath::Quaternion normalized;
+		rotation.Normalize(normalized);
+
+		m_rotationX[index] = normalized.x;
+		m_rotationY[index] = normalized.y;
+		m_rotationZ[index] = normalized.z;
+		m_rotationW[index] = normalized.w;
+		MarkDirty(index);
+	}
+
+	void TransformSystem::SetScaling(uint32_t index, const DirectX::SimpleMath::Vector3& scaling)
+	{
+		m_scalingX[index] = scaling.x;
+		m_scalingY[index] = scaling.y;
+		m_scalingZ[index] = scaling.z;
+		MarkDirty(index);
+	}
+
+	DirectX::SimpleMath::Vector3 TransformSystem::GetPosition(uint32_t index) const
+	{
+		return { m_positionX[index], m_positionY[index], m_positionZ[index] };
+	}
+
+	DirectX::SimpleMath::Quaternion TransformSystem::GetRotation(uint32_t index) const
+	{
+		return { m_rotationX[index], m_rotationY[index], m_rotationZ[index], m_rotationW[index] };
+	}
+
+	DirectX::SimpleMath::Vector3 TransformSystem::GetScaling(uint32_t index) const
+	{
+		return { m_scalingX[index], m_scalingY[index], m_scalingZ[index] };
+	}
+
+	const DirectX::SimpleMath::Matrix& TransformSystem::GetWorldMatrix(uint32_t index) const
+	{
+		return m_world[index];
+	}
+
+	uint32_t TransformSystem::Update()
+	{
+		// Local matrices of the dirty groups, the dirty transforms are queued at their depth
+		for (const uint32_t group : m_dirtyGroups)
+		{
+			ComputeGroup(group);
+			for (uint32_t lane = 0; lane < 4; ++lane)
+			{
+				if ((m_groupDirtyMask[group] & (1 << lane)) == 0)
+					continue;
+
+				const uint32_t index = group * 4 + lane;
+				if (m_depth[index] >= m_levels.size())
+					m_levels.resize(static_cast<size_t>(m_depth[index]) + 1);
+				m_queued[index] = 1;
+				m_levels[m_depth[index]].push_back(index);
+			}
+			m_groupDirtyMask[group] = 0;
+		}
+		m_dirtyGroups.clear();
+
+		// Top down, a level only reads world matrices of the levels above it (the size grows as children are queued)
+		uint32_t computed = 0;
+		for (uint32_t depth = 0; depth < m_levels.size(); ++depth)
+		{
+			computed += static_cast<uint32_t>(m_levels[depth].size());
+			PropagateLevel(depth);
+		}
+		return computed;
+	}
+
+	uint32_t TransformSystem::GetCount() const
+	{
+		return m_allocatedCount;
+	}
+
+	void TransformSystem::CopyWorldMatrices(const uint32_t* indices, size_t count, DirectX::SimpleMath::Matrix* dst) const
+	{
+		// Mapped dynamic buffers are write combined: full 16 byte streaming stores, never read back
+		float* out = reinterpret_cast<float*>(dst);
+		if ((reinterpret_cast<uintptr_t>(out) & 15) != 0)
+		{
+			for (size_t i = 0; i < count; ++i)
+				dst[i] = m_world[indices[i]];
+			return;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float* world = &m_world[indices[i]]._11;
+			_mm_stream_ps(out + 0, _mm_loadu_ps(world + 0));
+			_mm_stream_ps(out + 4, _mm_loadu_ps(world + 4));
+			_mm_stream_ps(out + 8, _mm_loadu_ps(world + 8));
+			_mm_stream_ps(out + 12, _mm_loadu_ps(world + 12));
+			out += 16;
+		}
+		_mm_sfence();
+	}
+
+	void TransformSystem::MarkDirty(uint32_t index)
+	{
+		const uint32_t group = index / 4;
+		if (m_groupDirtyMask[group] == 0)
+			m_dirtyGroups.push_back(group);
+		m_groupDirtyMask[group] |= 1 << (index % 4);
+	}
+
+	void TransformSystem::Unlink(uint32_t index)
+	{
+		const uint32_t parent = m_parent[index];
+		if (parent == s_noParent)
+			return;
+
+		const uint32_t prev = m_prevSibling[index];
+		const uint32_t next = m_nextSibling[index];
+		if (prev != s_noParent)
+			m_nextSibling[prev] = next;
+		else
+			m_firstChild[parent] = next;
+		if (next != s_noParent)
+			m_prevSibling[next] = prev;
+
+		m_parent[index] = m_nextSibling[index] = m_prevSibling[index] = s_noParent;
+	}
+
+	void TransformSystem::UpdateDepths(uint32_t index)
+	{
+		const uint32_t parent = m_parent[index];
+		m_depth[index] = parent == s_noParent ? 0 : m_depth[parent] + 1;
+		if (m_firstChild[index] == s_noParent)
+			return;
+
+		// Parents are popped before their children are pushed, so every parent depth is final when a child reads it
+		std::vector<uint32_t> stack;
+		for (uint32_t child = m_firstChild[index]; child != s_noParent; child = m_nextSibling[child])
+			stack.push_back(child);
+		while (!stack.empty())
+		{
+			const uint32_t current = stack.back();
+			stack.pop_back();
+			m_depth[current] = m_depth[m_parent[current]] + 1;
+			for (uint32_t child = m_firstChild[current]; child != s_noParent; child = m_nextSibling[child])
+				stack.push_back(child);
+		}
+	}
+
+	void TransformSystem::PropagateLevel(uint32_t depth)
+	{
+		if (m_levels[depth].empty())
+			return;
+		if (depth + 1 >= m_levels.size())
+			m_levels.resize(static_cast<size_t>(depth) + 2);
+
+		std::vector<uint32_t>& level = m_levels[depth];
+		std::vector<uint32_t>& next = m_levels[depth + 1];
+		const size_t count = level.size();
+		const uint32_t chunkCount = m_threadPool ? static_cast<uint32_t>(std::min<size_t>(m_threadPool->GetWorkerCount() + 1, count / s_minChunkSize)) : 0;
+		if (chunkCount <= 1)
+		{
+			PropagateRange(level.data(), count, next);
+		}
+		else
+		{
+			// A transform has one parent, so every child is queued by exactly one chunk
+			if (m_chunkChildren.size() < chunkCount)
+				m_chunkChildren.resize(chunkCount);
+			m_threadPool->ParallelFor(chunkCount, [this, &level, count, chunkCount](uint32_t chunk)
+				{
+					const size_t begin = count * chunk / chunkCount;
+					const size_t end = count * (chunk + 1) / chunkCount;
+					m_chunkChildren[chunk].clear();
+					PropagateRange(level.data() + begin, end - begin, m_chunkChildren[chunk]);
+				});
+			for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+				next.insert(next.end(), m_chunkChildren[chunk].begin(), m_chunkChildren[chunk].end());
+		}
+		level.clear();
+	}
+
+	void TransformSystem::PropagateRange(const uint32_t* indices, size_t count, std::vector<uint32_t>& children)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const uint32_t index = indices[i];
+			const uint32_t parent = m_parent[index];
+			if (parent == s_noParent)
+				m_world[index] = m_local[index];
+			else
+				MultiplyMatrix(m_local[index], m_world[parent], m_world[index]);
+			m_queued[index] = 0;
+
+			// The whole subtree depends on this world matrix
+			for (uint32_t child = m_firstChild[index]; child != s_noParent; child = m_nextSibling[child])
+			{
+				if (m_queued[child])
+					continue;
+				m_queued[child] = 1;
+				children.push_back(child);
+			}
+		}
+	}
+
+	void TransformSystem::ComputeGroup(uint32_t group)
+	{
+		// One transform per lane. Same matrix as XMMatrixScalingFromVector(s) * XMMatrixRotationQuaternion(q) * XMMatrixTranslation(p):
+		// the rotation rows scaled by s, translation in the last row
+		const size_t first = static_cast<size_t>(group) * 4;
+		const __m128 qx = _mm_loadu_ps(&m_rotationX[first]);
+		const __m128 qy = _mm_loadu_ps(&m_rotationY[first]);
+		const __m128 qz = _mm_loadu_ps(&m_rotationZ[first]);
+		const __m128 qw = _mm_loadu_ps(&m_rotationW[first]);
+		const __m128 sx = _mm_loadu_ps(&m_scalingX[first]);
+		const __m128 sy = _mm_loadu_ps(&m_scalingY[first]);
+		const __m128 sz = _mm_loadu_ps(&m_scalingZ[first]);
+
+		const __m128 x2 = _mm_add_ps(qx, qx);
+		const __m128 y2 = _mm_add_ps(qy, qy);
+		const __m128 z2 = _mm_add_ps(qz, qz);
+		const __m128 xx = _mm_mul_ps(qx, x2);
+		const __m128 yy = _mm_mul_ps(qy, y2);
+		const __m128 zz = _mm_mul_ps(qz, z2);
+		const __m128 xy = _mm_mul_ps(qx, y2);
+		const __m128 xz = _mm_mul_ps(qx, z2);
+		const __m128 yz = _mm_mul_ps(qy, z2);
+		const __m128 wx = _mm_mul_ps(qw, x2);
+		const __m128 wy = _mm_mul_ps(qw, y2);
+		const __m128 wz = _mm_mul_ps(qw, z2);
+		const __m128 one = _mm_set1_ps(1.f);
+
+		__m128 m00 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+		__m128 m01 = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+		__m128 m02 = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+		__m128 m03 = _mm_setzero_ps();
+
+		__m128 m10 = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+		__m128 m11 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+		__m128 m12 = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+		__m128 m13 = _mm_setzero_ps();
+
+		__m128 m20 = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+		__m128 m21 = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+		__m128 m22 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+		__m128 m23 = _mm_setzero_ps();
+
+		__m128 m30 = _mm_loadu_ps(&m_positionX[first]);
+		__m128 m31 = _mm_loadu_ps(&m_positionY[first]);
+		__m128 m32 = _mm_loadu_ps(&m_positionZ[first]);
+		__m128 m33 = one;
+
+		// Lanes -> rows of the four matrices
+		_MM_TRANSPOSE4_PS(m00, m01, m02, m03);
+		_MM_TRANSPOSE4_PS(m10, m11, m12, m13);
+		_MM_TRANSPOSE4_PS(m20, m21, m22, m23);
+		_MM_TRANSPOSE4_PS(m30, m31, m32, m33);
+
+		const __m128 rows[4][4] =
+		{
+			{ m00, m10, m20, m30 },
+			{ m01, m11, m21, m31 },
+			{ m02, m12, m22, m32 },
+			{ m03, m13, m23, m33 }
+		};
+		for (size_t i = 0; i < 4; ++i)
+		{
+			float* local = &m_local[first + i]._11;
+			for (size_t row = 0; row < 4; ++row)
+				_mm_storeu_ps(local + row * 4, rows[i][row]);
+		}
+	}
+
+	void TransformSystem::RunBenchmark()
+	{
+		constexpr uint32_t count = 100000;
+		constexpr uint32_t runs = 10;
+
+		// Scene like transforms, kept as Euler degrees as well for the old path
+		struct EulerTransform
+		{
+			DirectX::SimpleMath::Vector3 position;
+			DirectX::SimpleMath::Vector3 rotation;
+			DirectX::SimpleMath::Vector3 scaling;
+		};
+
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> positionDist(-100.f, 100.f);
+		std::uniform_real_distribution<float> angleDist(-180.f, 180.f);
+		std::uniform_real_distribution<float> scaleDist(0.1f, 4.f);
+
+		TransformSystem system;
+		std::vector<EulerTransform> eulers(count);
+		for (auto& euler : eulers)
+		{
+			euler.position = { positionDist(rng), positionDist(rng), positionDist(rng) };
+			euler.rotation = { angleDist(rng), angleDist(rng), angleDist(rng) };
+			euler.scaling = { scaleDist(rng), scaleDist(rng), scaleDist(rng) };
+
+			const uint32_t index = system.Allocate();
+			system.SetPosition(index, euler.position);
+			system.SetRotation(index, Transform::EulerToQuaternion(euler.rotation));
+			system.SetScaling(index, euler.scaling);
+		}
+
+		// Old path: S * R * T rebuilt from Euler degrees on every call
+		std::vector<DirectX::SimpleMath::Matrix> eulerWorld(count);
+		Timer eulerTimer;
+		for (uint32_t run = 0; run < runs; ++run)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const auto& euler = eulers[i];
+				auto T = DirectX::XMMatrixTranslation(euler.position.x, euler.position.y, euler.position.z);
+				auto R = DirectX::XMMatrixRotationRollPitchYaw(
+					DirectX::XMConvertToRadians(euler.rotation.x),
+					DirectX::XMConvertToRadians(euler.rotation.y),
+					DirectX::XMConvertToRadians(euler.rotation.z));
+				auto S = DirectX::XMMatrixScalingFromVector(euler.scaling);
+				eulerWorld[i] = S * R * T;
+			}
+		}
+		const float eulerMs = eulerTimer.TimeElapsed() * 1000.f / runs;
+
+		Timer batchTimer;
+		uint32_t computed = 0;
+		for (uint32_t run = 0; run < runs; ++run)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+				system.MarkDirty(i);
+			computed = system.Update();
+		}
+		const float batchMs = batchTimer.TimeElapsed() * 1000.f / runs;
+
+		// 1% of the transforms move per frame
+		Timer partialTimer;
+		uint32_t partialComputed = 0;
+		for (uint32_t run = 0; run < runs; ++run)
+		{
+			for (uint32_t i = run; i < count; i += 100)
+				system.SetPosition(i, eulers[i].position);
+			partialComputed = system.Update();
+		}
+		const float partialMs = partialTimer.TimeElapsed() * 1000.f / runs;
+
+		float maxError = 0.f;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const float* a = &eulerWorld[i]._11;
+			const float* b = &system.GetWorldMatrix(i)._11;
+			for (uint32_t j = 0; j < 16; ++j)
+				maxError = std::max(maxError, std::abs(a[j] - b[j]));
+		}
+
+		std::cout << "Gino::TransformSystem : Benchmark (" << count << " transforms)\n";
+		std::cout << "  Euler per call: " << eulerMs << " ms, " << count / eulerMs << " matrices/ms\n";
+		std::cout << "  Batched SoA, all dirty: " << batchMs << " ms, " << computed / batchMs << " matrices/ms\n";
+		std::cout << "  Batched SoA, 1% dirty: " << partialMs << " ms (" << partialComputed << " computed)\n";
+		std::cout << "  Max difference to the Euler matrices: " << maxError << "\n";
+	}
+
+	void TransformSystem::RunHierarchyBenchmark(ThreadPool* threadPool)
+	{
+		constexpr uint32_t count = 65536;
+		constexpr uint32_t runs = 10;
+
+		// Parent indices are below their children in both shapes, so a plain forward pass is the reference
+		struct Shape
+		{
+			const char* name;
+			uint32_t (*parentOf)(uint32_t);
+		};
+		const Shape shapes[] =
+		{
+			{ "wide (4 children per node)", [](uint32_t i) { return i == 0 ? s_noParent : (i - 1) / 4; } },
+			{ "deep (256 chains of 256)", [](uint32_t i) { return i < 256 ? s_noParent : i - 256; } }
+		};
+
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> positionDist(-1.f, 1.f);
+		std::uniform_real_distribution<float> angleDist(-10.f, 10.f);
+		std::uniform_real_distribution<float> scaleDist(0.99f, 1.01f);
+
+		struct Local
+		{
+			DirectX::SimpleMath::Vector3 position;
+			DirectX::SimpleMath::Quaternion rotation;
+			DirectX::SimpleMath::Vector3 scaling;
+		};
+		std::vector<Local> locals(count);
+		for (auto& local : locals)
+		{
+			local.position = { positionDist(rng), positionDist(rng), positionDist(rng) };
+			local.rotation = Transform::EulerToQuaternion({ angleDist(rng), angleDist(rng), angleDist(rng) });
+			local.scaling = { scaleDist(rng), scaleDist(rng), scaleDist(rng) };
+		}
+
+		std::cout << "Gino::TransformSystem : Hierarchy benchmark (" << count << " transforms, " << (threadPool ? threadPool->GetWorkerCount() : 0) << " workers, average of " << runs << " runs)\n";
+		for (const Shape& shape : shapes)
+		{
+			std::vector<DirectX::SimpleMath::Matrix> reference(count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const auto& local = locals[i];
+				const auto matrix = DirectX::SimpleMath::Matrix::CreateScale(local.scaling) * DirectX::SimpleMath::Matrix::CreateFromQuaternion(local.rotation) *
+					DirectX::SimpleMath::Matrix::CreateTranslation(local.position);
+				const uint32_t parent = shape.parentOf(i);
+				reference[i] = parent == s_noParent ? matrix : matrix * reference[parent];
+			}
+
+			float allMs[2] = {};
+			float partialMs[2] = {};
+			uint32_t partialComputed = 0;
+			uint32_t maxDepth = 0;
+			float maxError = 0.f;
+			for (uint32_t parallel = 0; parallel < 2; ++parallel)
+			{
+				TransformSystem system(parallel ? threadPool : nullptr);
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					const uint32_t index = system.Allocate();
+					system.SetPosition(index, locals[i].position);
+					system.SetRotation(index, locals[i].rotation);
+					system.SetScaling(index, locals[i].scaling);
+					system.SetParent(index, shape.parentOf(i));
+					maxDepth = std::max(maxDepth, system.GetDepth(index));
+				}
+				system.Update();
+
+				// Every root dirty: the whole forest is propagated
+				Timer allTimer;
+				for (uint32_t run = 0; run < runs; ++run)
+				{
+					for (uint32_t i = 0; i < count && shape.parentOf(i) == s_noParent; ++i)
+						system.MarkDirty(i);
+					system.Update();
+				}
+				allMs[parallel] = allTimer.TimeElapsed() * 1000.f / runs;
+
+				// 1% of the transforms move, each pulls in its subtree
+				Timer partialTimer;
+				for (uint32_t run = 0; run < runs; ++run)
+				{
+					for (uint32_t i = run; i < count; i += 100)
+						system.SetPosition(i, locals[i].position);
+					partialComputed = system.Update();
+				}
+				partialMs[parallel] = partialTimer.TimeElapsed() * 1000.f / runs;
+
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					const float* a = &reference[i]._11;
+					const float* b = &system.GetWorldMatrix(i)._11;
+					for (uint32_t j = 0; j < 16; ++j)
+						maxError = std::max(maxError, std::abs(a[j] - b[j]) / std::max(1.f, std::abs(a[j])));
+				}
+			}
+
+			std::cout << "  " << shape.name << ", depth " << maxDepth << "\n";
+			std::cout << "    All dirty: serial " << allMs[0] << " ms | level parallel " << allMs[1] << " ms (" << allMs[0] / std::max(allMs[1], 1e-6f) << "x)\n";
+			std::cout << "    1% dirty (" << partialComputed << " computed): serial " << partialMs[0] << " ms | level parallel " << partialMs[1] << " ms\n";
+			std::cout << "    Max relative difference to the reference: " << maxError << "\n";
+		}
+	}
+}
@@ -1,8 +1,15 @@
 #include "pch.h"
 #include "Utilities.h"
+#include "AssetArchive.h"
+#include "ThreadPool.h"
 
 #include <Windows.h>
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -28,18 +35,255 @@ namespace Gino::Utils
 
 	std::vector<uint8_t> ReadFile(const std::filesystem::path& filePath)
 	{
-		std::ifstream file(filePath, std::ios::ate | std::ios::binary);
-		if (!file.is_open())
+		// From the mounted asset archive if it has the file
+		AssetView view;
+		if (!AssetArchive::ReadAsset(filePath, view))
 			assert(false);
 
-		size_t fileSize = static_cast<size_t>(file.tellg());
-		std::vector<uint8_t> buffer(fileSize);
+		if (view.data == view.owned.data())
+			return std::move(view.owned);
+		return std::vector<uint8_t>(view.data, view.data + view.size);
+	}
+
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+	{
+		constexpr uint64_t prime = 1099511628211ull;
+
+		uint64_t hash = seed;
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= prime;
+		}
+		return hash;
+	}
+
+	uint64_t HashFile(const std::filesystem::path& filePath, uint64_t seed)
+	{
+		if (const AssetArchive* archive = AssetArchive::GetMounted())
+		{
+			// The table of contents has the default seeded hash of every file
+			uint64_t hash = 0;
+			if (seed == 14695981039346656037ull && archive->GetContentHash(filePath, hash))
+				return hash;
+
+			AssetView view;
+			if (archive->Read(filePath, view))
+				return HashBytes(view.data, view.size, seed);
+		}
+
+		MappedFile file;
+		if (!file.Open(filePath))
+			return seed;
+
+		return HashBytes(file.GetData(), file.GetSize(), seed);
+	}
+
+	std::string HashedFileName(const std::filesystem::path& namedAfter, uint64_t hash, std::string_view extension)
+	{
+		std::stringstream ss;
+		ss << namedAfter.stem().string() << "_" << std::hex << std::setw(16) << std::setfill('0') << hash << extension;
+		return ss.str();
+	}
+
+	bool WriteFileAtomic(const std::filesystem::path& filePath, const std::function<void(std::ofstream&)>& write, std::string_view owner)
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(filePath.parent_path(), ec);
+
+		// Own temporary per write: concurrent loads can write the same file (shared default textures), and two instances the same cache
+		static std::atomic<uint32_t> s_writeCounter = 0;
+		auto tmpPath = filePath;
+		tmpPath += "." + std::to_string(GetCurrentProcessId()) + "." + std::to_string(s_writeCounter.fetch_add(1)) + ".tmp";
+		{
+			std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				std::cout << "Gino::" << owner << " : Could not write file: " << filePath << "\n";
+				return false;
+			}
 
-		file.seekg(0); 
-		file.read((char*)buffer.data(), fileSize);    
+			write(file);
+			if (!file)
+			{
+				file.close();
+				std::filesystem::remove(tmpPath, ec);
+				std::cout << "Gino::" << owner << " : Could not write file: " << filePath << "\n";
+				return false;
+			}
+		}
 
-		file.close();
-		return buffer;
+		std::filesystem::rename(tmpPath, filePath, ec);
+		if (ec)
+		{
+			std::error_code removeEc;
+			std::filesystem::remove(tmpPath, removeEc);
+			std::cout << "Gino::" << owner << " : Could not finalize file: " << filePath << " (" << ec.message() << ")\n";
+			return false;
+		}
+		return true;
+	}
+
+	uint16_t FloatToHalf(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		const uint32_t sign = (bits >> 16) & 0x8000;
+		bits &= 0x7FFFFFFF;
+
+		if (bits > 0x7F800000)
+			return static_cast<uint16_t>(sign | 0x7E00);		// NaN
+		if (bits >= 0x477FE000)
+			return static_cast<uint16_t>(sign | 0x7BFF);		// >= 65504
+
+		if (bits < 0x38800000)
+		{
+			// Half denormal (below 2^-14)
+			if (bits < 0x33000000)
+				return static_cast<uint16_t>(sign);
+
+			const uint32_t shift = 126 - (bits >> 23);
+			const uint32_t mantissa = (bits & 0x7FFFFF) | 0x800000;
+			uint32_t half = mantissa >> shift;
+			const uint32_t rest = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			if (rest > halfway || (rest == halfway && (half & 1)))
+				++half;
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		uint32_t half = (bits - 0x38000000) >> 13;		// Rebias the exponent from 127 to 15
+		const uint32_t rest = bits & 0x1FFF;
+		if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+			++half;
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	float HalfToFloat(uint16_t value)
+	{
+		const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+		const uint32_t exponent = (value >> 10) & 0x1F;
+		uint32_t mantissa = value & 0x3FF;
+
+		uint32_t bits;
+		if (exponent == 0x1F)
+			bits = sign | 0x7F800000 | (mantissa << 13);			// inf/NaN
+		else if (exponent != 0)
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		else if (mantissa == 0)
+			bits = sign;
+		else
+		{
+			// Denormal, normalize the mantissa
+			uint32_t floatExponent = 113;
+			while ((mantissa & 0x400) == 0)
+			{
+				mantissa <<= 1;
+				--floatExponent;
+			}
+			bits = sign | (floatExponent << 23) | ((mantissa & 0x3FF) << 13);
+		}
+
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	bool IsPowerOfTwo(uint32_t value)
+	{
+		return value != 0 && (value & (value - 1)) == 0;
+	}
+
+	uint32_t CalcMipCount(uint32_t size)
+	{
+		uint32_t mipCount = 0;
+		for (; size > 0; size >>= 1)
+			++mipCount;
+		return mipCount;
+	}
+
+	void ForRows(ThreadPool* threadPool, uint32_t rowCount, uint32_t rowsPerJob, const std::function<void(uint32_t, uint32_t)>& func)
+	{
+		const uint32_t jobCount = (rowCount + rowsPerJob - 1) / rowsPerJob;
+		if (!threadPool || jobCount <= 1)
+		{
+			func(0, rowCount);
+			return;
+		}
+
+		threadPool->ParallelFor(jobCount, [&func, rowCount, rowsPerJob](uint32_t job)
+			{
+				const uint32_t begin = job * rowsPerJob;
+				func(begin, std::min(begin + rowsPerJob, rowCount));
+			});
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	bool MappedFile::Open(const std::filesystem::path& filePath)
+	{
+		Close();
+
+		HANDLE file = CreateFileW(filePath.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		m_file = file;
+		m_mapping = mapping;
+		m_data = static_cast<const uint8_t*>(view);
+		m_size = static_cast<size_t>(fileSize.QuadPart);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file)
+			CloseHandle(m_file);
+
+		m_data = nullptr;
+		m_mapping = nullptr;
+		m_file = nullptr;
+		m_size = 0;
+	}
+
+	const uint8_t* MappedFile::GetData() const
+	{
+		return m_data;
+	}
+
+	size_t MappedFile::GetSize() const
+	{
+		return m_size;
 	}
 
 	ImageData ReadImageFile(const std::filesystem::path& filePath, bool hdr)
@@ -47,9 +291,18 @@ namespace Gino::Utils
 		int texWidth, texHeight, texChannels;
 		texWidth = texHeight = texChannels = 0;
 
+		// Decoded from memory so that archived images work too
+		AssetView view;
+		if (!AssetArchive::ReadAsset(filePath, view))
+		{
+			assert(false);		// failed to load image
+		}
+		const stbi_uc* fileData = view.data;
+		const int fileSize = static_cast<int>(view.size);
+
 		if (!hdr)
 		{
-			stbi_uc* pixels = stbi_load(filePath.string().c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+			stbi_uc* pixels = stbi_load_from_memory(fileData, fileSize, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 			if (!pixels)
 			{
 				assert(false);		// failed to load image
@@ -63,7 +316,7 @@ namespace Gino::Utils
 			uint32_t reqTexChannel = 4;		// force RGBA because DXGI RGB format does not support sampling
 			// https://www.gamedev.net/forums/topic/699346-r32g32b32-texture-format-cannot-be-sampled-in-pixel-shader/
 
-			float* pixels = stbi_loadf(filePath.string().c_str(), &texWidth, &texHeight, &texChannels, reqTexChannel);
+			float* pixels = stbi_loadf_from_memory(fileData, fileSize, &texWidth, &texHeight, &texChannels, reqTexChannel);
 			if (!pixels)
 			{
 				assert(false);		// failed to load image